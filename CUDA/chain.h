@@ -0,0 +1,389 @@
+#ifndef STENCIL_CHAIN
+#define STENCIL_CHAIN
+
+#include <vector>
+#include <cuda_runtime.h>
+#include "constants.h"
+#include "threadpool.h"
+#include "offsets.h"
+#include "cpu-kernels-1d.h"
+#include "cpu-kernels-2d.h"
+#include "cpu-kernels-3d.h"
+
+/*******************************************************************************
+ * Fusion of stencils applied one after the other,
+ *     typedef Chain<smooth, laplace, smooth> pipeline;
+ * out = smooth(laplace(smooth(A))), each stage an offset or weighted list
+ * (offsets.h, weights.h) with its reads clamped to the grid as when it runs
+ * alone. The halo of the chain is the sum of the halos of its stages. A tile
+ * of the input with that halo is loaded once, and every stage computes the
+ * part of its result that the later stages read, shrinking by its own halo,
+ * in a scratch buffer: shared memory in big_tile_2d/3d_chain, a per-thread
+ * buffer that stays in cache in the host engines. The intermediate grids are
+ * never written to memory; the halos are computed redundantly by neighbouring
+ * tiles instead.
+ *
+ * Every buffer holds, at each of its positions, the value of its stage at the
+ * position clamped to the grid, as the tile loaders do for the input, so the
+ * results are bit-identical to running the stages one by one.
+ */
+template<typename... Ls>
+struct Chain;
+
+template<>
+struct Chain<> {
+    static constexpr int stages = 0;
+    static constexpr int min_x = 0, min_y = 0, min_z = 0;
+    static constexpr int max_x = 0, max_y = 0, max_z = 0;
+};
+
+template<typename L0, typename... Ls>
+struct Chain<L0, Ls...> {
+    typedef L0 First;
+    typedef Chain<Ls...> Rest;
+    static constexpr int stages = 1 + Rest::stages;
+    static constexpr int min_x = L0::min_x + Rest::min_x;
+    static constexpr int min_y = L0::min_y + Rest::min_y;
+    static constexpr int min_z = L0::min_z + Rest::min_z;
+    static constexpr int max_x = L0::max_x + Rest::max_x;
+    static constexpr int max_y = L0::max_y + Rest::max_y;
+    static constexpr int max_z = L0::max_z + Rest::max_z;
+};
+
+// a box of the grid held in a buffer, flat with x innermost; org is the grid
+// position of the first element.
+struct ChainRegion {
+    long3 org;
+    int3 size;
+};
+
+// the region a chain reads around the box [org, org + size).
+template<typename C>
+MACROLIKE ChainRegion chain_region(const long3 org, const int3 size)
+{
+    const ChainRegion r = {
+        { org.x + C::min_x, org.y + C::min_y, org.z + C::min_z },
+        { size.x + C::max_x - C::min_x, size.y + C::max_y - C::min_y, size.z + C::max_z - C::min_z } };
+    return r;
+}
+
+template<typename C>
+MACROLIKE constexpr int chain_region_size(const int size_x, const int size_y, const int size_z)
+{
+    return (size_x + C::max_x - C::min_x) * (size_y + C::max_y - C::min_y) * (size_z + C::max_z - C::min_z);
+}
+
+MACROLIKE bool chain_region_inside(const ChainRegion r, const long3 lens)
+{
+    return in_bounds(r.org.x, long(r.size.x), lens.x - 1)
+        && in_bounds(r.org.y, long(r.size.y), lens.y - 1)
+        && in_bounds(r.org.z, long(r.size.z), lens.z - 1);
+}
+
+// the elements first, first + stride, ... of the region, as the threads of a
+// block (or one host thread) share them.
+template<const bool clamp>
+MACROLIKE void chain_load_bounded(
+    const T* A, T* dst, const ChainRegion rd, const long3 lens, const int first, const int stride)
+{
+    const int n = rd.size.x * rd.size.y * rd.size.z;
+    for(int i = first; i < n; i += stride){
+        const long z = bound_if<clamp,true,long>(rd.org.z + i / rd.size.x / rd.size.y, lens.z - 1);
+        const long y = bound_if<clamp,true,long>(rd.org.y + i / rd.size.x % rd.size.y, lens.y - 1);
+        const long x = bound_if<clamp,true,long>(rd.org.x + i % rd.size.x, lens.x - 1);
+        dst[i] = A[(z * lens.y + y) * lens.x + x];
+    }
+}
+
+template<typename L, const bool clamp>
+MACROLIKE void chain_stage_bounded(
+    const T* src, const ChainRegion rs, T* dst, const ChainRegion rd,
+    const long3 lens, const int first, const int stride)
+{
+    const int n = rd.size.x * rd.size.y * rd.size.z;
+    for(int i = first; i < n; i += stride){
+        const long z = bound_if<clamp,true,long>(rd.org.z + i / rd.size.x / rd.size.y, lens.z - 1);
+        const long y = bound_if<clamp,true,long>(rd.org.y + i / rd.size.x % rd.size.y, lens.y - 1);
+        const long x = bound_if<clamp,true,long>(rd.org.x + i % rd.size.x, lens.x - 1);
+        const T* base = src + ((z - rs.org.z) * rs.size.y + (y - rs.org.y)) * rs.size.x + (x - rs.org.x);
+        dst[i] = L::apply([&](const int dx, const int dy, const int dz){
+            return base[(dz * rs.size.y + dy) * rs.size.x + dx]; });
+    }
+}
+
+template<typename L, const bool clamp>
+MACROLIKE void chain_write_bounded(
+    const T* src, const ChainRegion rs, T* out, const ChainRegion rd,
+    const long3 lens, const int first, const int stride)
+{
+    const int n = rd.size.x * rd.size.y * rd.size.z;
+    for(int i = first; i < n; i += stride){
+        const long z = rd.org.z + i / rd.size.x / rd.size.y;
+        const long y = rd.org.y + i / rd.size.x % rd.size.y;
+        const long x = rd.org.x + i % rd.size.x;
+        if(clamp && (x >= lens.x || y >= lens.y || z >= lens.z)){ continue; }
+        const T* base = src + ((z - rs.org.z) * rs.size.y + (y - rs.org.y)) * rs.size.x + (x - rs.org.x);
+        out[(z * lens.y + y) * lens.x + x] = L::apply([&](const int dx, const int dy, const int dz){
+            return base[(dz * rs.size.y + dy) * rs.size.x + dx]; });
+    }
+}
+
+/*
+ * The stages of a chain from src, which holds the region the chain reads
+ * around the box, to the box of out; a and b are the scratch buffers, the
+ * stages alternate between them. sync is for the blocks of the kernels.
+ */
+template<typename C, const bool sync, const bool last = (C::stages == 1)>
+struct chain_stages {
+    MACROLIKE static void run(
+        const T* src, const ChainRegion rs, T* a, T* b, T* out,
+        const long3 lens, const long3 org, const int3 size, const int first, const int stride)
+    {
+        typedef typename C::Rest Rest;
+        const ChainRegion rd = chain_region<Rest>(org, size);
+        if(chain_region_inside(rd, lens)){
+            chain_stage_bounded<typename C::First,false>(src, rs, a, rd, lens, first, stride);
+        }
+        else {
+            chain_stage_bounded<typename C::First,true>(src, rs, a, rd, lens, first, stride);
+        }
+#if defined(__CUDA_ARCH__) || defined(HOST_EMULATION)
+        if(sync){ __syncthreads(); }
+#endif
+        chain_stages<Rest,sync>::run(a, rd, b, a, out, lens, org, size, first, stride);
+    }
+};
+
+template<typename C, const bool sync>
+struct chain_stages<C, sync, true> {
+    MACROLIKE static void run(
+        const T* src, const ChainRegion rs, T*, T*, T* out,
+        const long3 lens, const long3 org, const int3 size, const int first, const int stride)
+    {
+        const ChainRegion rd = { org, size };
+        if(chain_region_inside(rd, lens)){
+            chain_write_bounded<typename C::First,false>(src, rs, out, rd, lens, first, stride);
+        }
+        else {
+            chain_write_bounded<typename C::First,true>(src, rs, out, rd, lens, first, stride);
+        }
+    }
+};
+
+template<typename C, const bool sync>
+MACROLIKE void chain_box(
+    const T* A, T* in_buf, T* a, T* b, T* out,
+    const long3 lens, const long3 org, const int3 size, const int first, const int stride)
+{
+    static_assert(C::stages > 0, "a chain needs a stage");
+    const ChainRegion rs = chain_region<C>(org, size);
+    if(chain_region_inside(rs, lens)){
+        chain_load_bounded<false>(A, in_buf, rs, lens, first, stride);
+    }
+    else {
+        chain_load_bounded<true>(A, in_buf, rs, lens, first, stride);
+    }
+#if defined(__CUDA_ARCH__) || defined(HOST_EMULATION)
+    if(sync){ __syncthreads(); }
+#endif
+    chain_stages<C,sync>::run(in_buf, rs, a, b, out, lens, org, size, first, stride);
+}
+
+/*******************************************************************************
+ * Kernels, with the grids and blocks of the offset list kernels. The input
+ * tile takes the largest buffer, the result of the first stage the second;
+ * the later stages reuse them in turn.
+ */
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+struct ChainTile {
+    static constexpr int in_size = chain_region_size<C>(group_size_x, group_size_y, group_size_z);
+    static constexpr int stage_size = chain_region_size<typename C::Rest>(group_size_x, group_size_y, group_size_z);
+    static constexpr int size = in_size + stage_size;
+};
+
+template<typename C, const int group_size>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_1d_chain(
+    const T* A,
+    T* out,
+    const long nx)
+{
+    typedef ChainTile<C,group_size,1,1> Tile;
+    __shared__ T tile[Tile::size];
+    const long3 lens = { nx, 1, 1 };
+    const long3 org = { long(blockIdx.x) * group_size, 0, 0 };
+    const int3 size = { group_size, 1, 1 };
+    chain_box<C,true>(A, tile, tile + Tile::in_size, tile, out, lens, org, size
+        , threadIdx.x, group_size);
+}
+
+template<typename C, const int group_size_x, const int group_size_y>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_2d_chain(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    typedef ChainTile<C,group_size_x,group_size_y,1> Tile;
+    __shared__ T tile[Tile::size];
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    const long3 org = { long(blockIdx.x) * group_size_x, long(blockIdx.y) * group_size_y, 0 };
+    const int3 size = { group_size_x, group_size_y, 1 };
+    const int local_flat = threadIdx.y * group_size_x + threadIdx.x;
+    chain_box<C,true>(A, tile, tile + Tile::in_size, tile, out, lens3, org, size
+        , local_flat, group_size_x * group_size_y);
+}
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_3d_chain(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    typedef ChainTile<C,group_size_x,group_size_y,group_size_z> Tile;
+    __shared__ T tile[Tile::size];
+    const long3 org = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        long(blockIdx.z) * group_size_z };
+    const int3 size = { group_size_x, group_size_y, group_size_z };
+    const int local_flat = (threadIdx.z * group_size_y + threadIdx.y) * group_size_x + threadIdx.x;
+    chain_box<C,true>(A, tile, tile + Tile::in_size, tile, out, lens, org, size
+        , local_flat, group_size_x * group_size_y * group_size_z);
+}
+
+/*******************************************************************************
+ * Host engines, a tile of the grid per task, the buffers per worker.
+ */
+template<typename C, const int tile_x, const int tile_y, const int tile_z>
+__host__
+void chain_host_tile(const T* A, T* out, const long3 lens, const long3 org, const int3 size)
+{
+    static thread_local std::vector<T> buffers;
+    const int in_size = chain_region_size<C>(tile_x, tile_y, tile_z);
+    const int stage_size = chain_region_size<typename C::Rest>(tile_x, tile_y, tile_z);
+    if(buffers.size() < size_t(in_size + stage_size)){ buffers.resize(in_size + stage_size); }
+    T* in_buf = buffers.data();
+    chain_box<C,false>(A, in_buf, in_buf + in_size, in_buf, out, lens, org, size, 0, 1);
+}
+
+template<typename C, const int tile_x>
+__host__
+void stencil_1d_cpu_chain(const T* A, T* out, const long nx)
+{
+    const long3 lens = { nx, 1, 1 };
+    for_each_tile_1d<tile_x>(nx, [&](const long x_start, const long x_end){
+        const long3 org = { x_start, 0, 0 };
+        const int3 size = { int(x_end - x_start), 1, 1 };
+        chain_host_tile<C,tile_x,1,1>(A, out, lens, org, size);
+    });
+}
+
+template<typename C, const int tile_x, const int tile_y>
+__host__
+void stencil_2d_cpu_chain(const T* A, T* out, const long2 lens)
+{
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    for_each_tile_2d<tile_x,tile_y>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end){
+        const long3 org = { x_start, y_start, 0 };
+        const int3 size = { int(x_end - x_start), int(y_end - y_start), 1 };
+        chain_host_tile<C,tile_x,tile_y,1>(A, out, lens3, org, size);
+    });
+}
+
+template<typename C, const int tile_x, const int tile_y, const int tile_z>
+__host__
+void stencil_3d_cpu_chain(const T* A, T* out, const long3 lens)
+{
+    for_each_tile_3d<tile_x,tile_y,tile_z>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end,
+            const long z_start, const long z_end){
+        const long3 org = { x_start, y_start, z_start };
+        const int3 size = { int(x_end - x_start), int(y_end - y_start), int(z_end - z_start) };
+        chain_host_tile<C,tile_x,tile_y,tile_z>(A, out, lens, org, size);
+    });
+}
+
+/*******************************************************************************
+ * The chain stage by stage, each a pass over the grid into one of the two
+ * temporary grids tmp_a and tmp_b, the last into out: the unfused reference.
+ * A pass is pass.apply<List>(src, dst, lens), e.g. ChainPassKernels to run
+ * the big tile of the offset lists.
+ */
+template<typename C, const bool last = (C::stages == 1)>
+struct chain_passes {
+    template<typename Pass, typename L>
+    __host__
+    static void run(const Pass& pass, const T* src, T* out, T* tmp_a, T* tmp_b, const L lens){
+        pass.template apply<typename C::First>(src, tmp_a, lens);
+        chain_passes<typename C::Rest>::run(pass, tmp_a, out, tmp_b, tmp_a, lens);
+    }
+};
+
+template<typename C>
+struct chain_passes<C, true> {
+    template<typename Pass, typename L>
+    __host__
+    static void run(const Pass& pass, const T* src, T* out, T*, T*, const L lens){
+        pass.template apply<typename C::First>(src, out, lens);
+    }
+};
+
+template<typename C, typename Pass, typename L>
+__host__
+void chain_unfused(const Pass& pass, const T* A, T* out, T* tmp_a, T* tmp_b, const L lens)
+{
+    static_assert(C::stages > 0, "a chain needs a stage");
+    chain_passes<C>::run(pass, A, out, tmp_a, tmp_b, lens);
+}
+
+template<const int group_size_x, const int group_size_y = 1, const int group_size_z = 1>
+struct ChainPassKernels {
+    template<typename L>
+    __host__
+    void apply(const T* A, T* out, const long lens) const {
+        void (*kfun)(const T*, T*, const long) = big_tile_1d_offsets<L,group_size_x>;
+        LAUNCH(kfun, divUp(lens, long(group_size_x)), group_size_x, 0)(A, out, lens);
+    }
+    template<typename L>
+    __host__
+    void apply(const T* A, T* out, const long2 lens) const {
+        void (*kfun)(const T*, T*, const long2) = big_tile_2d_offsets<L,group_size_x,group_size_y>;
+        const dim3 block(group_size_x, group_size_y);
+        const dim3 grid(divUp(lens.x, long(group_size_x)), divUp(lens.y, long(group_size_y)));
+        LAUNCH(kfun, grid, block, 0)(A, out, lens);
+    }
+    template<typename L>
+    __host__
+    void apply(const T* A, T* out, const long3 lens) const {
+        void (*kfun)(const T*, T*, const long3) = big_tile_3d_offsets<L,group_size_x,group_size_y,group_size_z>;
+        const dim3 block(group_size_x, group_size_y, group_size_z);
+        const dim3 grid(
+            divUp(lens.x, long(group_size_x)),
+            divUp(lens.y, long(group_size_y)),
+            divUp(lens.z, long(group_size_z)));
+        LAUNCH(kfun, grid, block, 0)(A, out, lens);
+    }
+};
+
+// the host references of the offset lists as passes.
+struct ChainPassHost {
+    template<typename L>
+    __host__
+    void apply(const T* A, T* out, const long lens) const { stencil_1d_cpu_offsets<L>(A, out, lens); }
+    template<typename L>
+    __host__
+    void apply(const T* A, T* out, const long2 lens) const { stencil_2d_cpu_offsets<L>(A, out, lens); }
+    template<typename L>
+    __host__
+    void apply(const T* A, T* out, const long3 lens) const { stencil_3d_cpu_offsets<L>(A, out, lens); }
+};
+
+#endif
@@ -1,16 +1,166 @@
 #ifndef CONSTANTS
 #define CONSTANTS
 
-#define T float
+#include <stdint.h>
 
 #define BLOCKSIZE 1024
 #define SQ_BLOCKSIZE 32
 
+// host tile sizes for the cpu engines (in elements)
+#define CPU_TILE_X 256
+#define CPU_TILE_Y 16
+#define CPU_TILE_Z 4
+#define CPU_TILE_1D (CPU_TILE_X*CPU_TILE_Y)
+#define CPU_STRIP_Y 256
+#define CPU_PLANE_X 64
+#define CPU_PLANE_Y 16
+#define CPU_MARCH_Z 64
+#define CPU_BOX_Y 64
+// zoids of at most this many point updates are swept directly, and x is not
+// cut below this width (cpu-zoid.h).
+#define CPU_ZOID_BASE (1 << 20)
+#define CPU_ZOID_MIN_X 512
+// host grid buffers are aligned to and rounded up to huge pages (cpu-arena.h).
+#define CPU_HUGE_PAGE (2L << 20)
+
 #define MACROLIKE __device__ __host__ __forceinline__
 
+/*******************************************************************************
+ * Element types of the grids.
+ * The kernels, the host engines and Globs take the element type as their
+ * template parameter T; T at namespace scope is the default, float, which the
+ * headers written for a single type (offsets.h, fields.h, chain.h, ...) use.
+ * ElemTraits<T>::acc is the type the stencils sum in: the element type itself
+ * for float and double, float for the types that are only stored narrow.
+ * name() is the short name of the benchmark lines, type_name() the C++
+ * spelling, for the sources the jit writes (jit.h).
+ */
+typedef float DefaultElem;
+typedef DefaultElem T;
+
+// IEEE binary16 storage, converted to and from float with round to nearest
+// even; all arithmetic happens on the float.
+MACROLIKE uint32_t float_bits(const float f){ union { float f; uint32_t u; } v; v.f = f; return v.u; }
+MACROLIKE float bits_float(const uint32_t u){ union { float f; uint32_t u; } v; v.u = u; return v.f; }
+
+MACROLIKE uint16_t half_bits_from_float(const float f){
+    const uint32_t x = float_bits(f);
+    const uint32_t sign = (x >> 16) & 0x8000;
+    const uint32_t absx = x & 0x7fffffff;
+    if(absx >= 0x7f800000){ return sign | (absx > 0x7f800000 ? 0x7e00 : 0x7c00); }
+    // from halfway between 65504 and 65536 on, everything rounds to infinity.
+    if(absx >= 0x477ff000){ return sign | 0x7c00; }
+    if(absx < 0x38800000){
+        // subnormal: the mantissa with its hidden bit in units of 2^-24.
+        if(absx <= 0x33000000){ return sign; }
+        const uint32_t m = (absx & 0x7fffff) | 0x800000;
+        const int shift = 126 - int(absx >> 23);
+        uint32_t q = m >> shift;
+        const uint32_t rem = m & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if(rem > halfway || (rem == halfway && (q & 1))){ q++; }
+        return sign | q;
+    }
+    uint32_t h = (absx >> 13) - (112 << 10);
+    const uint32_t rem = absx & 0x1fff;
+    if(rem > 0x1000 || (rem == 0x1000 && (h & 1))){ h++; }
+    return sign | h;
+}
+
+MACROLIKE float half_bits_to_float(const uint16_t h){
+    const uint32_t sign = uint32_t(h & 0x8000) << 16;
+    const uint32_t e = (h >> 10) & 0x1f;
+    const uint32_t m = h & 0x3ff;
+    if(e == 0){
+        const float sub = float(m) * 5.9604644775390625e-8f; // m * 2^-24
+        return sign ? -sub : sub;
+    }
+    if(e == 31){ return bits_float(sign | 0x7f800000 | (m << 13)); }
+    return bits_float(sign | ((e + 112) << 23) | (m << 13));
+}
+
+struct half_t {
+    uint16_t bits;
+    half_t() = default;
+    MACROLIKE half_t(const float f) : bits(half_bits_from_float(f)) {}
+    MACROLIKE operator float() const { return half_bits_to_float(bits); }
+};
+
+template<typename E> struct ElemTraits;
+template<> struct ElemTraits<float> {
+    typedef float acc;
+    static const char* name(){ return "f32"; }
+    static const char* type_name(){ return "float"; }
+    static double epsilon(){ return 1.1920928955078125e-7; }
+};
+template<> struct ElemTraits<double> {
+    typedef double acc;
+    static const char* name(){ return "f64"; }
+    static const char* type_name(){ return "double"; }
+    static double epsilon(){ return 2.220446049250313e-16; }
+};
+// sums of int8 data are exact in float and the mean is truncated on store.
+template<> struct ElemTraits<int8_t> {
+    typedef float acc;
+    static const char* name(){ return "i8"; }
+    static const char* type_name(){ return "int8_t"; }
+    static double epsilon(){ return 0; }
+};
+template<> struct ElemTraits<half_t> {
+    typedef float acc;
+    static const char* name(){ return "f16"; }
+    static const char* type_name(){ return "half_t"; }
+    static double epsilon(){ return 9.765625e-4; }
+};
+template<typename E> using ElemAcc = typename ElemTraits<E>::acc;
+
+// a size in elements tuned for 4 byte floats (the CPU_* tiles, the gpu strips)
+// scaled to cover the same bytes of E.
+template<typename E> MACROLIKE constexpr
+int elem_scaled(const int n){ return n * int(sizeof(float)) / int(sizeof(E)) > 0 ? n * int(sizeof(float)) / int(sizeof(E)) : 1; }
+
+// the grids of n fields (fields.h), passed to kernels by value.
+template<const int n>
+struct FieldPtrs {
+    T* at[n];
+};
+
+// kernel launches and dynamic shared memory, spelled so that the host
+// emulation (host-emu/cuda_runtime.h) can stand in for them.
+#ifdef HOST_EMULATION
+#define LAUNCH(kernel, grid, block, sh_size_bytes) emu::launch(kernel, grid, block, sh_size_bytes)
+#define EXTERN_SHARED(type, name) alignas(128) static thread_local type name[EMU_MAX_SHARED_BYTES / sizeof(type)]
+#else
+#define LAUNCH(kernel, grid, block, sh_size_bytes) kernel<<<grid, block, sh_size_bytes>>>
+// one dynamic shared array per kernel whatever its element type, so it is
+// declared as bytes.
+#define EXTERN_SHARED(type, name) extern __shared__ __align__(16) unsigned char name##_bytes[]; type* const name = reinterpret_cast<type*>(name##_bytes)
+#endif
+
+// accounting of the memory accesses between TRAFFIC_BEGIN and TRAFFIC_END in
+// the instrumented emulation builds (host-emu/traffic.h), nothing otherwise.
+#if defined(HOST_EMULATION) && defined(COUNT_TRAFFIC)
+#define TRAFFIC_BEGIN() emu::traffic_begin()
+#define TRAFFIC_END(outputs) emu::traffic_end(outputs, sizeof(T))
+#define TRAFFIC_REPORT() emu::traffic_report()
+#define TRAFFIC_GLOBAL(ptr, bytes) emu::traffic_add_global(ptr, bytes)
+#else
+#define TRAFFIC_BEGIN() do {} while(0)
+#define TRAFFIC_END(outputs) do {} while(0)
+#define TRAFFIC_REPORT() do {} while(0)
+#define TRAFFIC_GLOBAL(ptr, bytes) do {} while(0)
+#endif
+
 template<bool lowBound,typename L> MACROLIKE constexpr
 L bound(const L i, const L max_i){ return min(max_i, lowBound ? max(L(0), i) : i); }
 template<typename L> MACROLIKE constexpr L divUp(L i, L d){ return (i + (d- (L(1))))/d; }
+// bound<> for code paths that are split into a clamping boundary version and a
+// clamp-free interior version.
+template<bool clamp, bool lowBound, typename L> MACROLIKE constexpr
+L bound_if(const L i, const L max_i){ return clamp ? bound<lowBound,L>(i, max_i) : i; }
+// true when bound<> is the identity on [start, start + len).
+template<typename L> MACROLIKE constexpr
+bool in_bounds(const L start, const L len, const L max_i){ return L(0) <= start && start + len - L(1) <= max_i; }
 
 MACROLIKE constexpr int3 create_spans(const int3 lens){ return { 1, lens.x, lens.x*lens.y }; }
 MACROLIKE constexpr int2 create_spans(const int2 lens){ return { 1, lens.x, }; }
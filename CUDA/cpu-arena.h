@@ -0,0 +1,129 @@
+#ifndef CPU_ARENA
+#define CPU_ARENA
+
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <vector>
+#include "constants.h"
+#include "threadpool.h"
+#include "cpu-numa.h"
+
+/*******************************************************************************
+ * Arena for the host grid buffers.
+ * A buffer is mapped CPU_HUGE_PAGE aligned and advised as transparent huge
+ * pages, so a 16M element grid takes 32 TLB entries instead of 16384. It is
+ * then prefaulted by place_grids, which also places its pages on the nodes of
+ * the workers. A released buffer stays mapped and is handed out again for the
+ * next request of the same shape, so later tests neither fault nor zero pages
+ * in their timed regions. Mapping and prefault time is printed per buffer and
+ * kept apart from the benchmark times, with how much of it the kernel backs
+ * with huge pages after the prefault (AnonHugePages of /proc/self/smaps): the
+ * advice is only a hint, khugepaged or a fragmented memory may not follow it.
+ *
+ * A reused buffer keeps the contents its last user left in it. Buffers are
+ * typed by their element type, acquire<E>, float by default.
+ */
+class GridArena {
+    public :
+        ~GridArena(void){
+            for(size_t i = 0; i < blocks.size(); i++){
+                munmap(blocks[i].grids, blocks[i].bytes);
+            }
+        }
+
+        // count grids of len elements, back to back.
+        template<typename E = T>
+        E* acquire(const long len, const int count = 1){
+            for(size_t i = 0; i < blocks.size(); i++){
+                Block& b = blocks[i];
+                if(!b.in_use && b.len == len && b.count == count && b.elem_size == sizeof(E)){
+                    b.in_use = true;
+                    return (E*)b.grids;
+                }
+            }
+            Block b;
+            b.len = len;
+            b.count = count;
+            b.elem_size = sizeof(E);
+            b.bytes = divUp(long(len*count*sizeof(E)), CPU_HUGE_PAGE) * CPU_HUGE_PAGE;
+            b.in_use = true;
+
+            struct timeval t_start, t_end;
+            gettimeofday(&t_start, NULL);
+            // over-map by one huge page and trim both ends to align the buffer.
+            const long mapped = b.bytes + CPU_HUGE_PAGE;
+            char* raw = (char*)mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(raw == (char*)MAP_FAILED){
+                fprintf(stderr, ">>> host allocation of %ld bytes failed\n", b.bytes);
+                exit(1);
+            }
+            char* start = (char*)(divUp((unsigned long)raw, (unsigned long)CPU_HUGE_PAGE) * CPU_HUGE_PAGE);
+            if(start > raw){ munmap(raw, start - raw); }
+            munmap(start + b.bytes, (raw + mapped) - (start + b.bytes));
+            bool huge = false;
+#ifdef MADV_HUGEPAGE
+            huge = madvise(start, b.bytes, MADV_HUGEPAGE) == 0;
+#endif
+            b.grids = start;
+            TRAFFIC_GLOBAL(b.grids, b.bytes);
+            place_grids((E*)b.grids, len, count);
+            gettimeofday(&t_end, NULL);
+            const long elapsed = (t_end.tv_sec - t_start.tv_sec)*1000000L + (t_end.tv_usec - t_start.tv_usec);
+
+            printf("## Grid arena: mapped %d x %ld %s - %ld MiB - %s, %ld MiB in 2MiB pages - prefault %ld microseconds ##\n",
+                   count, len, ElemTraits<E>::name(), b.bytes >> 20, huge ? "THP advised" : "THP not advised"
+                   , huge_bytes(b.grids, b.bytes) >> 20, elapsed);
+            blocks.push_back(b);
+            return (E*)b.grids;
+        }
+
+        void release(const void* grids){
+            for(size_t i = 0; i < blocks.size(); i++){
+                if(blocks[i].grids == grids){ blocks[i].in_use = false; }
+            }
+        }
+
+    private :
+        // bytes of [p, p+bytes) backed by huge pages, summed over the
+        // mappings it spans; 0 when smaps can not be read.
+        static long huge_bytes(const char* p, const long bytes){
+            FILE* f = fopen("/proc/self/smaps", "r");
+            if(f == NULL){ return 0; }
+            const unsigned long lo = (unsigned long)p, hi = lo + bytes;
+            char line[256];
+            bool inside = false;
+            long total = 0;
+            while(fgets(line, sizeof(line), f)){
+                unsigned long start, end;
+                long kb;
+                if(sscanf(line, "%lx-%lx ", &start, &end) == 2){
+                    inside = start < hi && end > lo;
+                }
+                else if(inside && sscanf(line, "AnonHugePages: %ld kB", &kb) == 1){
+                    total += kb << 10;
+                }
+            }
+            fclose(f);
+            return total < bytes ? total : bytes;
+        }
+
+        struct Block {
+            char* grids;
+            long len;
+            int count;
+            size_t elem_size;
+            long bytes;
+            bool in_use;
+        };
+        std::vector<Block> blocks;
+};
+
+// the arena shared by the drivers.
+static GridArena& host_arena(){
+    static GridArena arena;
+    return arena;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef CPU_BOX
+#define CPU_BOX
+
+#include "constants.h"
+
+/*******************************************************************************
+ * Running window sums shared by the box mean engines.
+ * Every stencil_fun_* without the Jacobi masks is the mean of a full box, and
+ * a box sum factors into window sums along each axis. A window sum along one
+ * line is slid one element at a time (add the entering value, drop the leaving
+ * one), so its cost does not depend on the radius.
+ *
+ * The sums are kept in double: exact for the integral test data and otherwise
+ * far more precise than the float accumulation of the reference.
+ */
+
+// sums[i - start] = sum of line[bound(i + k)] for k in [amin, amax], for i in
+// [start, end).
+template<
+    const int amin,
+    const int amax,
+    typename T>
+__host__
+inline
+void box_line_sums(
+    const T* line,
+    const long max_ix,
+    const long start, const long end,
+    double* sums)
+{
+    double sum = 0;
+    for(int k = amin; k <= amax; k++){
+        sum += line[bound<(amin<0),long>(start + k, max_ix)];
+    }
+    for(long i = start; i < end; i++){
+        sums[i - start] = sum;
+        sum += line[bound<(amin<0),long>(i + amax + 1, max_ix)];
+        sum -= line[bound<(amin<0),long>(i + amin, max_ix)];
+    }
+}
+
+// the same window slid over rows of doubles: dst row r = sum of src rows
+// [r, r + range), for n rows of width values that are row_stride apart.
+template<const int range>
+__host__
+inline
+void box_slide_rows(
+    const double* src,
+    double* dst,
+    const long n,
+    const long width,
+    const long row_stride)
+{
+    for(long x = 0; x < width; x++){
+        dst[x] = 0;
+    }
+    for(int k = 0; k < range; k++){
+        for(long x = 0; x < width; x++){
+            dst[x] += src[k*row_stride + x];
+        }
+    }
+    for(long r = 1; r < n; r++){
+        const double* enter = src + (r - 1 + range)*row_stride;
+        const double* leave = src + (r - 1)*row_stride;
+        double* prev = dst + (r - 1)*row_stride;
+        double* cur = dst + r*row_stride;
+        for(long x = 0; x < width; x++){
+            cur[x] = (prev[x] + enter[x]) - leave[x];
+        }
+    }
+}
+
+#endif
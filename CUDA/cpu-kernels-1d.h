@@ -0,0 +1,296 @@
+#ifndef CPU_KERNELS1D
+#define CPU_KERNELS1D
+
+#include <vector>
+#include "constants.h"
+#include "threadpool.h"
+#include "cpu-simd.h"
+#include "cpu-zoid.h"
+#include "cpu-box.h"
+#include "cpu-steal.h"
+#include "kernels-1d.h"
+
+/*******************************************************************************
+ * Host engines for the 1d stencils.
+ * They evaluate the same stencil_fun_1d as the kernels, with the same gather
+ * order, so their output is bit-identical to the gpu versions.
+ */
+template<
+    const int amin_x,
+    const int amax_x,
+    const bool clamp,
+    typename T>
+__host__
+inline
+void stencil_1d_cpu_tile_bounded(
+    const T* A,
+    T* out,
+    const long lens,
+    const long x_start, const long count)
+{
+    constexpr int range = amax_x - amin_x + 1;
+
+    const long max_ix_x = lens - 1;
+    for (long i = 0; i < count; ++i){
+        const long gidx = x_start + i;
+        T arr[range];
+        for(int k=0; k < range; k++){
+            const long x = bound_if<clamp,(amin_x<0),long>(gidx + (k + amin_x), max_ix_x);
+            arr[k] = A[x];
+        }
+        out[gidx] = stencil_fun_1d<amin_x,amax_x>(arr);
+    }
+}
+
+// only the outputs within a halo of the array ends clamp their reads.
+template<
+    const int amin_x,
+    const int amax_x,
+    typename T>
+__host__
+inline
+void stencil_1d_cpu_tile(
+    const T* A,
+    T* out,
+    const long lens,
+    const long x_start, const long x_end)
+{
+    if(x_start >= x_end){ return; }
+    const long ix_start = min(max(x_start, long(-amin_x)), x_end);
+    const long ix_end = max(min(x_end, lens - amax_x), ix_start);
+    // the bands are passed as counts, skipped when empty, so the loop bounds
+    // stay provably non-negative once this is inlined into the simd tiles.
+    const long head = ix_start - x_start;
+    const long body = ix_end - ix_start;
+    const long tail = x_end - ix_end;
+    if(head > 0){ stencil_1d_cpu_tile_bounded<amin_x,amax_x,true>(A, out, lens, x_start, head); }
+    if(body > 0){ stencil_1d_cpu_tile_bounded<amin_x,amax_x,false>(A, out, lens, ix_start, body); }
+    if(tail > 0){ stencil_1d_cpu_tile_bounded<amin_x,amax_x,true>(A, out, lens, ix_end, tail); }
+}
+
+// hands the tile_x sized chunks of [0,lens) to the host pool. A worker starts
+// on the chunks of its own share of the array (see cpu-numa.h), then steals.
+template<const int tile_x, typename F>
+__host__
+void for_each_tile_1d(const long lens, const F& fun)
+{
+    const long tile_grid = divUp(lens, long(tile_x));
+    steal_for_each(tile_grid, [&](const long tile_id){
+        const long x_start = tile_id * tile_x;
+        const long x_end = min(x_start + tile_x, lens);
+        fun(x_start, x_end);
+    });
+}
+
+template<
+    const int amin_x,
+    const int amax_x,
+    const int tile_x,
+    typename T>
+__host__
+void stencil_1d_cpu_tiled(
+    const T* A,
+    T* out,
+    const long lens)
+{
+    for_each_tile_1d<tile_x>(lens, [&](const long x_start, const long x_end){
+        stencil_1d_cpu_tile<amin_x,amax_x>(A, out, lens, x_start, x_end);
+    });
+}
+
+/*******************************************************************************
+ * Vectorized host engines.
+ * Ops::width * Ops::unroll consecutive outputs are computed per step from
+ * shifted unaligned loads, one per stencil offset. Outputs whose window would
+ * be clamped at the array ends are left to the scalar tile.
+ */
+#if HOST_SIMD
+SIMD_ABI_BEGIN
+template<
+    typename Ops,
+    const int amin_x,
+    const int amax_x,
+    typename T>
+SIMD_INLINE
+void stencil_1d_simd_tile(
+    const T* A,
+    T* out,
+    const long lens,
+    const long x_start, const long x_end)
+{
+    typedef typename Ops::V V;
+    constexpr int range = amax_x - amin_x + 1;
+    constexpr int step = Ops::width * Ops::unroll;
+
+    const long vec_start = max(x_start, long(-amin_x));
+    const long vec_end = min(x_end, lens - amax_x);
+    const T* row = A + amin_x;
+
+    long x = x_start;
+    if(vec_start < vec_end){
+        stencil_1d_cpu_tile<amin_x,amax_x>(A, out, lens, x_start, vec_start);
+        for(x = vec_start; x + step <= vec_end; x += step){
+            V acc[Ops::unroll];
+            for(int u=0; u < Ops::unroll; u++){ acc[u] = Ops::zero(); }
+            for(int k=0; k < range; k++){
+                for(int u=0; u < Ops::unroll; u++){
+                    acc[u] = Ops::add(acc[u], Ops::load(row + x + u*Ops::width + k));
+                }
+            }
+            for(int u=0; u < Ops::unroll; u++){
+                Ops::store(out + x + u*Ops::width, Ops::div(acc[u], range));
+            }
+        }
+    }
+    stencil_1d_cpu_tile<amin_x,amax_x>(A, out, lens, x, x_end);
+}
+
+#define STENCIL_1D_SIMD_ENTRY(isa, Ops, target) \
+template<const int amin_x, const int amax_x, typename T> \
+target void stencil_1d_simd_tile_##isa( \
+    const T* A, T* out, const long lens, const long x_start, const long x_end){ \
+    stencil_1d_simd_tile<SimdOpsOf<Ops,T>,amin_x,amax_x>(A, out, lens, x_start, x_end); \
+}
+STENCIL_1D_SIMD_ENTRY(sse42, SimdSse42, SIMD_TARGET_SSE42)
+STENCIL_1D_SIMD_ENTRY(avx2, SimdAvx2, SIMD_TARGET_AVX2)
+STENCIL_1D_SIMD_ENTRY(avx512, SimdAvx512, SIMD_TARGET_AVX512)
+#undef STENCIL_1D_SIMD_ENTRY
+SIMD_ABI_END
+#endif
+
+template<typename E> using Tile1dFun = void (*)(const E*, E*, const long, const long, const long);
+
+// the simd tile for the ISA of this cpu, picked once per stencil shape.
+template<
+    const int amin_x,
+    const int amax_x,
+    typename T>
+__host__
+Tile1dFun<T> stencil_1d_simd_tile_fun()
+{
+    static const Tile1dFun<T> tile_fun = []{
+        switch(host_isa_for<T>()){
+#if HOST_SIMD
+            case ISA_AVX512: return Tile1dFun<T>(stencil_1d_simd_tile_avx512<amin_x,amax_x>);
+            case ISA_AVX2: return Tile1dFun<T>(stencil_1d_simd_tile_avx2<amin_x,amax_x>);
+            case ISA_SSE42: return Tile1dFun<T>(stencil_1d_simd_tile_sse42<amin_x,amax_x>);
+#endif
+            default: return Tile1dFun<T>(stencil_1d_cpu_tile<amin_x,amax_x>);
+        }
+    }();
+    return tile_fun;
+}
+
+template<
+    const int amin_x,
+    const int amax_x,
+    const int tile_x,
+    typename T>
+__host__
+void stencil_1d_cpu_simd(
+    const T* A,
+    T* out,
+    const long lens)
+{
+    const Tile1dFun<T> tile_fun = stencil_1d_simd_tile_fun<amin_x,amax_x,T>();
+    for_each_tile_1d<tile_x>(lens, [&](const long x_start, const long x_end){
+        tile_fun(A, out, lens, x_start, x_end);
+    });
+}
+
+/*******************************************************************************
+ * Iterative stencils: out = stencil^iterations(A), tmp is a second grid sized
+ * buffer. The ping-pong sweeps are the reference; the zoid engine runs the
+ * same steps in cache-oblivious order (see cpu-zoid.h).
+ */
+template<
+    const int amin_x,
+    const int amax_x,
+    const int tile_x,
+    typename T>
+__host__
+void stencil_1d_cpu_iterate(
+    const T* A,
+    T* out,
+    T* tmp,
+    const long lens,
+    const int iterations)
+{
+    const T* src = A;
+    T* dst = (iterations & 1) ? out : tmp;
+    for(int t = 0; t < iterations; t++){
+        stencil_1d_cpu_simd<amin_x,amax_x,tile_x>(src, dst, lens);
+        src = dst;
+        dst = (dst == out) ? tmp : out;
+    }
+    if(iterations <= 0){ memcpy(out, A, lens*sizeof(T)); }
+}
+
+template<
+    const int amin_x,
+    const int amax_x,
+    typename T>
+__host__
+void stencil_1d_cpu_zoid(
+    const T* A,
+    T* out,
+    T* tmp,
+    const long lens,
+    const int iterations)
+{
+    if(iterations <= 0){ memcpy(out, A, lens*sizeof(T)); return; }
+    // level 0 is A, level t > 0 is in out when it has the parity of iterations.
+    T* const levels[2] = { (iterations & 1) ? tmp : out, (iterations & 1) ? out : tmp };
+    const Tile1dFun<T> tile_fun = stencil_1d_simd_tile_fun<amin_x,amax_x,T>();
+    const long len[1] = { lens };
+    const long sigma[1] = { zoid_slope(amin_x, amax_x) };
+    zoid_run<1>(len, sigma, iterations, [&](const long t, const long* lo, const long* hi){
+        const T* src = t == 0 ? A : levels[t & 1];
+        tile_fun(src, levels[(t + 1) & 1], lens, lo[0], hi[0]);
+    });
+}
+
+/*******************************************************************************
+ * Box mean from a running sum (see cpu-box.h): O(1) work per output whatever
+ * the radius. The sums are reassociated, so the results are validated with
+ * reassociation_tolerance(range).
+ */
+template<
+    const int amin_x,
+    const int amax_x,
+    typename T>
+__host__
+inline
+void stencil_1d_box_tile(
+    const T* A,
+    T* out,
+    const long lens,
+    const long x_start, const long x_end)
+{
+    constexpr int range = amax_x - amin_x + 1;
+    static thread_local std::vector<double> sums;
+    sums.resize(x_end - x_start);
+
+    box_line_sums<amin_x,amax_x>(A, lens - 1, x_start, x_end, sums.data());
+    for (long gidx = x_start; gidx < x_end; ++gidx){
+        out[gidx] = T(sums[gidx - x_start] / double(range));
+    }
+}
+
+template<
+    const int amin_x,
+    const int amax_x,
+    const int tile_x,
+    typename T>
+__host__
+void stencil_1d_cpu_box(
+    const T* A,
+    T* out,
+    const long lens)
+{
+    for_each_tile_1d<tile_x>(lens, [&](const long x_start, const long x_end){
+        stencil_1d_box_tile<amin_x,amax_x>(A, out, lens, x_start, x_end);
+    });
+}
+
+#endif
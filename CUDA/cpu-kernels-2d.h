@@ -0,0 +1,845 @@
+#ifndef CPU_KERNELS2D
+#define CPU_KERNELS2D
+
+#include <vector>
+#include "constants.h"
+#include "threadpool.h"
+#include "cpu-simd.h"
+#include "cpu-zoid.h"
+#include "cpu-box.h"
+#include "cpu-separable.h"
+#include "cpu-steal.h"
+#include "kernels-2d.h"
+
+/*******************************************************************************
+ * Host engines for the 2d stencils.
+ * They evaluate the same stencil_fun_2d as the kernels, with the same gather
+ * order, so their output is bit-identical to the gpu versions.
+ */
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const bool clamp,
+    typename T>
+__host__
+inline
+void stencil_2d_cpu_tile_bounded(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end)
+{
+    constexpr int2 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1};
+    constexpr int total_range = range.x * range.y;
+
+    const long max_ix_y = lens.y - 1;
+    const long max_ix_x = lens.x - 1;
+    for (long gidy = y_start; gidy < y_end; ++gidy){
+        for (long gidx = x_start; gidx < x_end; ++gidx){
+            T arr[total_range];
+            for(int j=0; j < range.y; j++){
+                for(int k=0; k < range.x; k++){
+                    const long y = bound_if<clamp,(amin_y<0),long>(gidy + (j + amin_y), max_ix_y);
+                    const long x = bound_if<clamp,(amin_x<0),long>(gidx + (k + amin_x), max_ix_x);
+                    const long index = y*lens.x + x;
+                    const int flat_idx = j*range.x + k;
+                    arr[flat_idx] = A[index];
+                }
+            }
+            out[gidy*lens.x + gidx] = stencil_fun_2d<amin_x,amin_y,amax_x,amax_y>(arr);
+        }
+    }
+}
+
+// the tile is cut into the clamp-free interior, where every window lies inside
+// the grid, and the boundary bands around it, which keep the clamps.
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+__host__
+inline
+void stencil_2d_cpu_tile(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end)
+{
+    const long ix_start = max(x_start, long(-amin_x));
+    const long ix_end = min(x_end, lens.x - amax_x);
+    const long iy_start = max(y_start, long(-amin_y));
+    const long iy_end = min(y_end, lens.y - amax_y);
+    if(ix_start >= ix_end || iy_start >= iy_end){
+        stencil_2d_cpu_tile_bounded<amin_x,amin_y,amax_x,amax_y,true>
+            (A, out, lens, x_start, x_end, y_start, y_end);
+        return;
+    }
+    stencil_2d_cpu_tile_bounded<amin_x,amin_y,amax_x,amax_y,true>
+        (A, out, lens, x_start, x_end, y_start, iy_start);
+    stencil_2d_cpu_tile_bounded<amin_x,amin_y,amax_x,amax_y,true>
+        (A, out, lens, x_start, ix_start, iy_start, iy_end);
+    stencil_2d_cpu_tile_bounded<amin_x,amin_y,amax_x,amax_y,false>
+        (A, out, lens, ix_start, ix_end, iy_start, iy_end);
+    stencil_2d_cpu_tile_bounded<amin_x,amin_y,amax_x,amax_y,true>
+        (A, out, lens, ix_end, x_end, iy_start, iy_end);
+    stencil_2d_cpu_tile_bounded<amin_x,amin_y,amax_x,amax_y,true>
+        (A, out, lens, x_start, x_end, iy_end, y_end);
+}
+
+/*
+ * The grid is cut into tile_x * tile_y tiles which the host pool hands out to
+ * its workers. A tile (plus halo) should fit in the per-core caches. In
+ * row-major order each worker starts on the rows of its own share of the grid
+ * (see cpu-numa.h) and then steals (see cpu-steal.h).
+ */
+template<const int tile_x, const int tile_y, typename F>
+__host__
+void for_each_tile_2d(const long2 lens, const F& fun)
+{
+    const long2 tile_grid = {
+        divUp(lens.x, long(tile_x)),
+        divUp(lens.y, long(tile_y))};
+    const long tile_grid_flat = tile_grid.x * tile_grid.y;
+
+    steal_for_each(tile_grid_flat, [&](const long tile_id){
+        const long tile_id_y = tile_id / tile_grid.x;
+        const long tile_id_x = tile_id % tile_grid.x;
+        const long x_start = tile_id_x * tile_x;
+        const long y_start = tile_id_y * tile_y;
+        const long x_end = min(x_start + tile_x, lens.x);
+        const long y_end = min(y_start + tile_y, lens.y);
+        fun(x_start, x_end, y_start, y_end);
+    });
+}
+
+// for_each_tile_2d with the tiles taken in Morton order from work-stealing
+// deques (see cpu-steal.h), for tiles of uneven cost.
+template<const int tile_x, const int tile_y, typename F>
+__host__
+void steal_for_each_tile_2d(const long2 lens, const F& fun)
+{
+    const long2 tile_grid = {
+        divUp(lens.x, long(tile_x)),
+        divUp(lens.y, long(tile_y))};
+
+    const std::vector<long> order = morton_order(tile_grid);
+    steal_for_each(order.size(), [&](const long i){
+        const long tile_id = order[i];
+        const long tile_id_y = tile_id / tile_grid.x;
+        const long tile_id_x = tile_id % tile_grid.x;
+        const long x_start = tile_id_x * tile_x;
+        const long y_start = tile_id_y * tile_y;
+        const long x_end = min(x_start + tile_x, lens.x);
+        const long y_end = min(y_start + tile_y, lens.y);
+        fun(x_start, x_end, y_start, y_end);
+    });
+}
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int tile_x, const int tile_y,
+    typename T>
+__host__
+void stencil_2d_cpu_tiled(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    for_each_tile_2d<tile_x,tile_y>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end){
+        stencil_2d_cpu_tile
+            <amin_x,amin_y
+            ,amax_x,amax_y>
+            (A, out, lens, x_start, x_end, y_start, y_end);
+    });
+}
+
+/*******************************************************************************
+ * Vectorized host engines.
+ * Per row, the range.y input rows are fixed and Ops::width * Ops::unroll
+ * consecutive outputs are computed per step from shifted unaligned loads.
+ */
+SIMD_ABI_BEGIN
+// computes out_row[x] for x in [x_from, x_to) from rows[j][x + k], whole steps
+// only; returns where it stopped so the caller can finish the row.
+template<
+    typename Ops,
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+SIMD_INLINE
+long stencil_2d_simd_row(
+    const T* const rows[],
+    T* const out_row,
+    const long x_from, const long x_to)
+{
+    typedef typename Ops::V V;
+    constexpr int2 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1};
+    constexpr int total_range = range.x * range.y;
+    constexpr int step = Ops::width * Ops::unroll;
+
+    long x = x_from;
+    for(; x + step <= x_to; x += step){
+        V acc[Ops::unroll];
+        for(int u=0; u < Ops::unroll; u++){ acc[u] = Ops::zero(); }
+        for(int j=0; j < range.y; j++){
+            for(int k=0; k < range.x; k++){
+#ifdef Jacobi2D
+                constexpr int yc = range.y / 2;
+                constexpr int xc = range.x / 2;
+                const bool yn = j == yc;
+                const bool xn = k == xc;
+                if(yn || xn)
+#endif
+                for(int u=0; u < Ops::unroll; u++){
+                    acc[u] = Ops::add(acc[u], Ops::load(rows[j] + x + u*Ops::width + k));
+                }
+            }
+        }
+        for(int u=0; u < Ops::unroll; u++){
+            Ops::store(out_row + x + u*Ops::width, Ops::div(acc[u], total_range));
+        }
+    }
+    return x;
+}
+
+/*
+ * One sweep over the region [rx_start,rx_end) x [ry_start,ry_end) of dst. src
+ * and dst hold the rectangles of the grid starting at src_org/dst_org, with
+ * row strides src_sx/dst_sx; reads are clamped to the grid, which the src
+ * rectangle has to cover. Outputs whose x window would be clamped are gathered
+ * one at a time, all others run on the vector path.
+ */
+template<
+    typename Ops,
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+SIMD_INLINE
+void stencil_2d_region_step(
+    const T* src, const long2 src_org, const long src_sx,
+    T* dst, const long2 dst_org, const long dst_sx,
+    const long2 lens,
+    const long rx_start, const long rx_end,
+    const long ry_start, const long ry_end)
+{
+    constexpr int2 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1};
+    constexpr int total_range = range.x * range.y;
+
+    const long max_ix_x = lens.x - 1;
+    const long max_ix_y = lens.y - 1;
+    const long vec_start = min(rx_end, max(rx_start, long(-amin_x)));
+    const long vec_end = max(vec_start, min(rx_end, lens.x - amax_x));
+    for (long gidy = ry_start; gidy < ry_end; ++gidy){
+        const T* rows[range.y];
+        const T* vec_rows[range.y];
+        for(int j=0; j < range.y; j++){
+            const long y = bound<(amin_y<0),long>(gidy + (j + amin_y), max_ix_y);
+            rows[j] = src + (y - src_org.y)*src_sx;
+            vec_rows[j] = rows[j] + (vec_start + amin_x - src_org.x);
+        }
+        T* const out_row = dst + (gidy - dst_org.y)*dst_sx;
+
+        const long vec_done = vec_start + stencil_2d_simd_row<Ops,amin_x,amin_y,amax_x,amax_y>
+            (vec_rows, out_row + (vec_start - dst_org.x), 0, vec_end - vec_start);
+        const long scalar_start[2] = { rx_start, vec_done };
+        const long scalar_end[2] = { vec_start, rx_end };
+        for(int part = 0; part < 2; part++){
+            for (long gidx = scalar_start[part]; gidx < scalar_end[part]; ++gidx){
+                T arr[total_range];
+                for(int j=0; j < range.y; j++){
+                    for(int k=0; k < range.x; k++){
+                        const long x = bound<(amin_x<0),long>(gidx + (k + amin_x), max_ix_x);
+                        arr[j*range.x + k] = rows[j][x - src_org.x];
+                    }
+                }
+                out_row[gidx - dst_org.x] = stencil_fun_2d<amin_x,amin_y,amax_x,amax_y>(arr);
+            }
+        }
+    }
+}
+
+template<
+    typename Ops,
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+SIMD_INLINE
+void stencil_2d_simd_tile(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end)
+{
+    const long2 origin = {0, 0};
+    stencil_2d_region_step<Ops,amin_x,amin_y,amax_x,amax_y>
+        (A, origin, lens.x, out, origin, lens.x, lens, x_start, x_end, y_start, y_end);
+}
+
+#if HOST_SIMD
+#define STENCIL_2D_SIMD_ENTRY(isa, Ops, target) \
+template<const int amin_x, const int amin_y, const int amax_x, const int amax_y, typename T> \
+target void stencil_2d_simd_tile_##isa( \
+    const T* A, T* out, const long2 lens, \
+    const long x_start, const long x_end, const long y_start, const long y_end){ \
+    stencil_2d_simd_tile<SimdOpsOf<Ops,T>,amin_x,amin_y,amax_x,amax_y> \
+        (A, out, lens, x_start, x_end, y_start, y_end); \
+}
+STENCIL_2D_SIMD_ENTRY(sse42, SimdSse42, SIMD_TARGET_SSE42)
+STENCIL_2D_SIMD_ENTRY(avx2, SimdAvx2, SIMD_TARGET_AVX2)
+STENCIL_2D_SIMD_ENTRY(avx512, SimdAvx512, SIMD_TARGET_AVX512)
+#undef STENCIL_2D_SIMD_ENTRY
+#endif
+
+template<typename E> using Tile2dFun = void (*)(const E*, E*, const long2, const long, const long, const long, const long);
+
+// the simd tile for the ISA of this cpu, picked once per stencil shape.
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+__host__
+Tile2dFun<T> stencil_2d_simd_tile_fun()
+{
+    static const Tile2dFun<T> tile_fun = []{
+        switch(host_isa_for<T>()){
+#if HOST_SIMD
+            case ISA_AVX512: return Tile2dFun<T>(stencil_2d_simd_tile_avx512<amin_x,amin_y,amax_x,amax_y>);
+            case ISA_AVX2: return Tile2dFun<T>(stencil_2d_simd_tile_avx2<amin_x,amin_y,amax_x,amax_y>);
+            case ISA_SSE42: return Tile2dFun<T>(stencil_2d_simd_tile_sse42<amin_x,amin_y,amax_x,amax_y>);
+#endif
+            default: return Tile2dFun<T>(stencil_2d_cpu_tile<amin_x,amin_y,amax_x,amax_y>);
+        }
+    }();
+    return tile_fun;
+}
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int tile_x, const int tile_y,
+    typename T>
+__host__
+void stencil_2d_cpu_simd(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    const Tile2dFun<T> tile_fun = stencil_2d_simd_tile_fun<amin_x,amin_y,amax_x,amax_y,T>();
+    for_each_tile_2d<tile_x,tile_y>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end){
+        tile_fun(A, out, lens, x_start, x_end, y_start, y_end);
+    });
+}
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int tile_x, const int tile_y,
+    typename T>
+__host__
+void stencil_2d_cpu_simd_steal(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    const Tile2dFun<T> tile_fun = stencil_2d_simd_tile_fun<amin_x,amin_y,amax_x,amax_y,T>();
+    steal_for_each_tile_2d<tile_x,tile_y>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end){
+        tile_fun(A, out, lens, x_start, x_end, y_start, y_end);
+    });
+}
+
+/*******************************************************************************
+ * Host port of sliding_tile_flat_smalltile_singleDim.
+ * A task owns a column strip [x_start,x_end) and marches down y. The range.y
+ * live input rows of the strip (x-clamped, with halo) sit in a small ring, so
+ * every input row is copied from memory once per strip and all further reads
+ * hit L1. Since the halo is already clamped in the ring, every output of the
+ * strip runs on the vector path.
+ */
+template<
+    typename Ops,
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int strip_x,
+    typename T>
+SIMD_INLINE
+void stencil_2d_sliding_strip(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end)
+{
+    constexpr int2 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1};
+    constexpr int total_range = range.x * range.y;
+    constexpr int ring_x = strip_x + range.x - 1;
+    constexpr int ring_size_flat = range.y * ring_x;
+
+    alignas(64) T ring[ring_size_flat];
+    const long max_ix_x = lens.x - 1;
+    const long max_ix_y = lens.y - 1;
+    const long strip_len = x_end - x_start;
+    const long row_len = strip_len + (range.x - 1);
+    const long read_gid_x = x_start + amin_x;
+    const bool interior_x = read_gid_x >= 0 && read_gid_x + row_len - 1 <= max_ix_x;
+
+    int write_row = 0;
+    int read_row = 0;
+    long read_gid_y = y_start + amin_y;
+    for(long y__ = y_start - 1; y__ < y_end; y__++){
+        // the first iteration only preloads the range.y - 1 leading rows.
+        const int new_rows = (y__ < y_start) ? range.y - 1 : 1;
+        for(int i__ = 0; i__ < new_rows; i__++){
+            const T* src = A + bound<(amin_y<0),long>(read_gid_y, max_ix_y)*lens.x;
+            T* dst = ring + write_row*ring_x;
+            if(interior_x){
+                memcpy(dst, src + read_gid_x, row_len*sizeof(T));
+            }
+            else {
+                for(long i = 0; i < row_len; i++){
+                    dst[i] = src[bound<(amin_x<0),long>(read_gid_x + i, max_ix_x)];
+                }
+            }
+            write_row++;
+            if(write_row >= range.y){ write_row -= range.y; }
+            read_gid_y++;
+        }
+        if(y__ < y_start){ continue; }
+
+        const T* rows[range.y];
+        for(int j=0; j < range.y; j++){
+            const int r = read_row + j;
+            rows[j] = ring + (r - (r >= range.y ? range.y : 0))*ring_x;
+        }
+        T* const out_row = out + y__*lens.x + x_start;
+        long x = stencil_2d_simd_row<Ops,amin_x,amin_y,amax_x,amax_y>
+            (rows, out_row, 0, strip_len);
+        for(; x < strip_len; x++){
+            T vals[total_range];
+            for(int j=0; j < range.y; j++){
+                for(int k=0; k < range.x; k++){
+                    vals[j*range.x + k] = rows[j][x + k];
+                }
+            }
+            out_row[x] = stencil_fun_2d<amin_x,amin_y,amax_x,amax_y>(vals);
+        }
+        read_row++;
+        if(read_row >= range.y){ read_row -= range.y; }
+    }
+}
+
+#define STENCIL_2D_SLIDING_ENTRY(isa, Ops, target) \
+template<const int amin_x, const int amin_y, const int amax_x, const int amax_y, const int strip_x, typename T> \
+target void stencil_2d_sliding_strip_##isa( \
+    const T* A, T* out, const long2 lens, \
+    const long x_start, const long x_end, const long y_start, const long y_end){ \
+    stencil_2d_sliding_strip<SimdOpsOf<Ops,T>,amin_x,amin_y,amax_x,amax_y,strip_x> \
+        (A, out, lens, x_start, x_end, y_start, y_end); \
+}
+STENCIL_2D_SLIDING_ENTRY(scalar, SimdScalar, )
+#if HOST_SIMD
+STENCIL_2D_SLIDING_ENTRY(sse42, SimdSse42, SIMD_TARGET_SSE42)
+STENCIL_2D_SLIDING_ENTRY(avx2, SimdAvx2, SIMD_TARGET_AVX2)
+STENCIL_2D_SLIDING_ENTRY(avx512, SimdAvx512, SIMD_TARGET_AVX512)
+#endif
+#undef STENCIL_2D_SLIDING_ENTRY
+
+/*
+ * strip_y bounds the march of one task so that there are enough strips to keep
+ * all workers busy; every task re-reads range.y - 1 rows to fill its ring.
+ */
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int strip_x, const int strip_y,
+    typename T>
+__host__
+void stencil_2d_cpu_sliding(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    typedef void (*StripFun)(const T*, T*, const long2, const long, const long, const long, const long);
+    static const StripFun strip_fun = []{
+        switch(host_isa_for<T>()){
+#if HOST_SIMD
+            case ISA_AVX512: return StripFun(stencil_2d_sliding_strip_avx512<amin_x,amin_y,amax_x,amax_y,strip_x>);
+            case ISA_AVX2: return StripFun(stencil_2d_sliding_strip_avx2<amin_x,amin_y,amax_x,amax_y,strip_x>);
+            case ISA_SSE42: return StripFun(stencil_2d_sliding_strip_sse42<amin_x,amin_y,amax_x,amax_y,strip_x>);
+#endif
+            default: return StripFun(stencil_2d_sliding_strip_scalar<amin_x,amin_y,amax_x,amax_y,strip_x>);
+        }
+    }();
+
+    for_each_tile_2d<strip_x,strip_y>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end){
+        strip_fun(A, out, lens, x_start, x_end, y_start, y_end);
+    });
+}
+
+/*******************************************************************************
+ * Iterative stencils: out = stencil^iterations(A), tmp is a second grid sized
+ * buffer. Sweeps ping-pong between out and tmp (ordered so that the last one
+ * lands in out), A is left untouched.
+ */
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int tile_x, const int tile_y,
+    typename T>
+__host__
+void stencil_2d_cpu_iterate(
+    const T* A,
+    T* out,
+    T* tmp,
+    const long2 lens,
+    const int iterations)
+{
+    const T* src = A;
+    T* dst = (iterations & 1) ? out : tmp;
+    for(int t = 0; t < iterations; t++){
+        stencil_2d_cpu_simd<amin_x,amin_y,amax_x,amax_y,tile_x,tile_y>(src, dst, lens);
+        src = dst;
+        dst = (dst == out) ? tmp : out;
+    }
+    if(iterations <= 0){ memcpy(out, A, lens.x*lens.y*sizeof(T)); }
+}
+
+/*
+ * Temporal blocking with overlapped (trapezoidal) tiles. A task advances its
+ * output tile up to depth time steps at once: step s of steps is computed over
+ * the tile grown by (steps - s) halos (cut at the grid borders), in two local
+ * buffers that stay in cache. Only the first step reads the grid and only the
+ * last one writes it, so DRAM traffic drops by about the depth, paid for by
+ * recomputing the overlap. Every value is computed from the same inputs in the
+ * same order as a plain sweep, so the result is bit-identical to
+ * stencil_2d_cpu_iterate.
+ */
+template<
+    typename Ops,
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int tile_x, const int tile_y,
+    const int depth,
+    typename T>
+SIMD_INLINE
+void stencil_2d_timetile(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const int steps)
+{
+    constexpr int2 halo_lo = { amin_x < 0 ? -amin_x : 0, amin_y < 0 ? -amin_y : 0 };
+    constexpr int2 halo_hi = { amax_x > 0 ?  amax_x : 0, amax_y > 0 ?  amax_y : 0 };
+    constexpr int buf_x = tile_x + (depth-1)*(halo_lo.x + halo_hi.x);
+    constexpr int buf_y = tile_y + (depth-1)*(halo_lo.y + halo_hi.y);
+
+    alignas(64) T buf[2][buf_x * buf_y];
+    const T* src = A;
+    long2 src_org = {0, 0};
+    long src_sx = lens.x;
+    for(int s = 1; s <= steps; s++){
+        const int grow = steps - s;
+        const long rx_start = max(0L, x_start - long(grow*halo_lo.x));
+        const long ry_start = max(0L, y_start - long(grow*halo_lo.y));
+        const long rx_end = min(lens.x, x_end + long(grow*halo_hi.x));
+        const long ry_end = min(lens.y, y_end + long(grow*halo_hi.y));
+
+        const bool last = s == steps;
+        T* dst = last ? out : buf[s & 1];
+        const long2 dst_org = { last ? 0 : rx_start, last ? 0 : ry_start };
+        const long dst_sx = last ? lens.x : rx_end - rx_start;
+        stencil_2d_region_step<Ops,amin_x,amin_y,amax_x,amax_y>
+            (src, src_org, src_sx, dst, dst_org, dst_sx, lens,
+             rx_start, rx_end, ry_start, ry_end);
+        src = dst;
+        src_org = dst_org;
+        src_sx = dst_sx;
+    }
+}
+
+#define STENCIL_2D_TIMETILE_ENTRY(isa, Ops, target) \
+template< \
+    const int amin_x, const int amin_y, const int amax_x, const int amax_y, \
+    const int tile_x, const int tile_y, const int depth, typename T> \
+target void stencil_2d_timetile_##isa( \
+    const T* A, T* out, const long2 lens, \
+    const long x_start, const long x_end, const long y_start, const long y_end, \
+    const int steps){ \
+    stencil_2d_timetile<SimdOpsOf<Ops,T>,amin_x,amin_y,amax_x,amax_y,tile_x,tile_y,depth> \
+        (A, out, lens, x_start, x_end, y_start, y_end, steps); \
+}
+STENCIL_2D_TIMETILE_ENTRY(scalar, SimdScalar, )
+#if HOST_SIMD
+STENCIL_2D_TIMETILE_ENTRY(sse42, SimdSse42, SIMD_TARGET_SSE42)
+STENCIL_2D_TIMETILE_ENTRY(avx2, SimdAvx2, SIMD_TARGET_AVX2)
+STENCIL_2D_TIMETILE_ENTRY(avx512, SimdAvx512, SIMD_TARGET_AVX512)
+#endif
+#undef STENCIL_2D_TIMETILE_ENTRY
+SIMD_ABI_END
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int tile_x, const int tile_y,
+    const int depth,
+    typename T>
+__host__
+void stencil_2d_cpu_timetiled(
+    const T* A,
+    T* out,
+    T* tmp,
+    const long2 lens,
+    const int iterations)
+{
+    static_assert(depth >= 1, "temporal block depth must be at least one step\n");
+    typedef void (*TileFun)(const T*, T*, const long2,
+            const long, const long, const long, const long, const int);
+    static const TileFun tile_fun = []{
+        switch(host_isa_for<T>()){
+#if HOST_SIMD
+            case ISA_AVX512: return TileFun(stencil_2d_timetile_avx512<amin_x,amin_y,amax_x,amax_y,tile_x,tile_y,depth>);
+            case ISA_AVX2: return TileFun(stencil_2d_timetile_avx2<amin_x,amin_y,amax_x,amax_y,tile_x,tile_y,depth>);
+            case ISA_SSE42: return TileFun(stencil_2d_timetile_sse42<amin_x,amin_y,amax_x,amax_y,tile_x,tile_y,depth>);
+#endif
+            default: return TileFun(stencil_2d_timetile_scalar<amin_x,amin_y,amax_x,amax_y,tile_x,tile_y,depth>);
+        }
+    }();
+
+    const int n_blocks = divUp(iterations, depth);
+    const T* src = A;
+    T* dst = (n_blocks & 1) ? out : tmp;
+    for(int t = 0; t < iterations; t += depth){
+        const int steps = min(depth, iterations - t);
+        for_each_tile_2d<tile_x,tile_y>(lens, [&](
+                const long x_start, const long x_end,
+                const long y_start, const long y_end){
+            tile_fun(src, dst, lens, x_start, x_end, y_start, y_end, steps);
+        });
+        src = dst;
+        dst = (dst == out) ? tmp : out;
+    }
+    if(iterations <= 0){ memcpy(out, A, lens.x*lens.y*sizeof(T)); }
+}
+
+// stencil_2d_cpu_iterate in cache-oblivious order (see cpu-zoid.h).
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+__host__
+void stencil_2d_cpu_zoid(
+    const T* A,
+    T* out,
+    T* tmp,
+    const long2 lens,
+    const int iterations)
+{
+    if(iterations <= 0){ memcpy(out, A, lens.x*lens.y*sizeof(T)); return; }
+    // level 0 is A, level t > 0 is in out when it has the parity of iterations.
+    T* const levels[2] = { (iterations & 1) ? tmp : out, (iterations & 1) ? out : tmp };
+    const Tile2dFun<T> tile_fun = stencil_2d_simd_tile_fun<amin_x,amin_y,amax_x,amax_y,T>();
+    const long len[2] = { lens.x, lens.y };
+    const long sigma[2] = { zoid_slope(amin_x, amax_x), zoid_slope(amin_y, amax_y) };
+    zoid_run<2>(len, sigma, iterations, [&](const long t, const long* lo, const long* hi){
+        const T* src = t == 0 ? A : levels[t & 1];
+        tile_fun(src, levels[(t + 1) & 1], lens, lo[0], hi[0], lo[1], hi[1]);
+    });
+}
+
+/*******************************************************************************
+ * Box mean from running sums (see cpu-box.h).
+ * Each tile first takes the x window sums of the tile_y + range.y - 1 rows it
+ * reads, then slides the y window down those, so every output costs a few adds
+ * whatever the radius. Not for Jacobi2D, whose cross is not a box. Validate
+ * with reassociation_tolerance(total_range).
+ */
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+__host__
+inline
+void stencil_2d_box_tile(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end)
+{
+    constexpr int2 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1};
+    constexpr int total_range = range.x * range.y;
+
+    const long width = x_end - x_start;
+    const long height = y_end - y_start;
+    const long n_rows = height + range.y - 1;
+    static thread_local std::vector<double> buf_store;
+    buf_store.resize((n_rows + height) * width);
+    double* const row_sums = buf_store.data();
+    double* const box_sums = row_sums + n_rows * width;
+
+    for(long r = 0; r < n_rows; r++){
+        const long y = bound<(amin_y<0),long>(y_start + amin_y + r, lens.y - 1);
+        box_line_sums<amin_x,amax_x>(A + y*lens.x, lens.x - 1, x_start, x_end, row_sums + r*width);
+    }
+    box_slide_rows<range.y>(row_sums, box_sums, height, width, width);
+
+    for(long r = 0; r < height; r++){
+        T* const out_row = out + (y_start + r)*lens.x + x_start;
+        for(long x = 0; x < width; x++){
+            out_row[x] = T(box_sums[r*width + x] / double(total_range));
+        }
+    }
+}
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int tile_x, const int tile_y,
+    typename T>
+__host__
+void stencil_2d_cpu_box(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    for_each_tile_2d<tile_x,tile_y>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end){
+        stencil_2d_box_tile<amin_x,amin_y,amax_x,amax_y>
+            (A, out, lens, x_start, x_end, y_start, y_end);
+    });
+}
+
+/*******************************************************************************
+ * Separable execution (see cpu-separable.h).
+ * A strip marches down y keeping the x pass of the last range.y rows in a
+ * ring; each output row is the weighted y pass across the ring.
+ */
+
+// stencil_fun_2d is a full box, and so separable, unless the Jacobi2D cross
+// spans both axes.
+template<const int range_x, const int range_y>
+__host__
+constexpr bool stencil_2d_is_separable(){
+#ifdef Jacobi2D
+    return range_x == 1 || range_y == 1;
+#else
+    return true;
+#endif
+}
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+__host__
+inline
+void stencil_2d_separable_strip(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const SeparableWeights<ElemAcc<T> >& w,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end)
+{
+    constexpr int range_y = amax_y - amin_y + 1;
+    const long width = x_end - x_start;
+    typedef ElemAcc<T> V;
+    const V norm = w.norm;
+    static thread_local std::vector<V> buf_store;
+    buf_store.resize((range_y + 1) * width);
+    V* const acc = buf_store.data() + range_y * width;
+
+    auto x_pass = [&](const long r, V* dst){
+        const long y = bound<(amin_y<0),long>(y_start + amin_y + r, lens.y - 1);
+        separable_line_pass<amin_x,amax_x>(A + y*lens.x, lens.x - 1, x_start, x_end, w.x, dst);
+    };
+    for(int j = 0; j < range_y; j++){
+        x_pass(j, buf_store.data() + j*width);
+    }
+    for(long r = 0; y_start + r < y_end; r++){
+        const V* ring[range_y];
+        for(int j = 0; j < range_y; j++){
+            ring[j] = buf_store.data() + ((r + j) % range_y)*width;
+        }
+        separable_ring_pass<range_y>(ring, w.y, acc, width);
+        T* const out_row = out + (y_start + r)*lens.x + x_start;
+        for(long x = 0; x < width; x++){
+            out_row[x] = T(acc[x] / norm);
+        }
+        // the row leaving the window is replaced by the one entering it.
+        if(y_start + r + 1 < y_end){
+            x_pass(r + range_y, buf_store.data() + (r % range_y)*width);
+        }
+    }
+}
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int strip_x, const int strip_y,
+    typename T>
+__host__
+void stencil_2d_cpu_separable(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const SeparableWeights<ElemAcc<T> >& w)
+{
+    for_each_tile_2d<strip_x,strip_y>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end){
+        stencil_2d_separable_strip<amin_x,amin_y,amax_x,amax_y>
+            (A, out, lens, w, x_start, x_end, y_start, y_end);
+    });
+}
+
+// the mean of stencil_fun_2d, separable whenever the shape allows it and
+// otherwise on the simd engine. strip_x and strip_y size the strips of the
+// separable path only; the simd engine keeps its own CPU_TILE_X/Y tiles.
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int strip_x, const int strip_y,
+    typename T>
+__host__
+void stencil_2d_cpu_separable_mean(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    constexpr int range_x = amax_x - amin_x + 1;
+    constexpr int range_y = amax_y - amin_y + 1;
+    if(stencil_2d_is_separable<range_x,range_y>()){
+        stencil_2d_cpu_separable<amin_x,amin_y,amax_x,amax_y,strip_x,strip_y>
+            (A, out, lens, separable_mean_weights<range_x,range_y,1,ElemAcc<T> >());
+    }
+    else {
+        stencil_2d_cpu_simd<amin_x,amin_y,amax_x,amax_y,elem_scaled<T>(CPU_TILE_X),CPU_TILE_Y>(A, out, lens);
+    }
+}
+
+#endif
@@ -0,0 +1,1014 @@
+#ifndef CPU_KERNELS3D
+#define CPU_KERNELS3D
+
+#include <vector>
+#include "constants.h"
+#include "threadpool.h"
+#include "cpu-simd.h"
+#include "cpu-zoid.h"
+#include "cpu-box.h"
+#include "cpu-separable.h"
+#include "cpu-steal.h"
+#include "kernels-3d.h"
+
+/*******************************************************************************
+ * Host engines for the 3d stencils.
+ * They evaluate the same stencil_fun_3d as the kernels, with the same gather
+ * order, so their output is bit-identical to the gpu versions.
+ */
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const bool clamp,
+    typename T>
+__host__
+inline
+void stencil_3d_cpu_tile_bounded(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end)
+{
+    constexpr int3 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1,
+        amax_z - amin_z + 1};
+    constexpr int total_range = range.x * range.y * range.z;
+
+    const long max_x_idx = lens.x - 1;
+    const long max_y_idx = lens.y - 1;
+    const long max_z_idx = lens.z - 1;
+    for (long gidz = z_start; gidz < z_end; ++gidz){
+        for (long gidy = y_start; gidy < y_end; ++gidy){
+            for (long gidx = x_start; gidx < x_end; ++gidx){
+                T arr[total_range];
+                for(int i=0; i < range.z; i++){
+                    for(int j=0; j < range.y; j++){
+                        for(int k=0; k < range.x; k++){
+                            const long z = bound_if<clamp,(amin_z<0),long>(gidz + (i + amin_z), max_z_idx);
+                            const long y = bound_if<clamp,(amin_y<0),long>(gidy + (j + amin_y), max_y_idx);
+                            const long x = bound_if<clamp,(amin_x<0),long>(gidx + (k + amin_x), max_x_idx);
+                            const long index = (z*lens.y + y)*lens.x + x;
+                            const int flat_idx = (i*range.y + j)*range.x + k;
+                            arr[flat_idx] = A[index];
+                        }
+                    }
+                }
+                out[(gidz*lens.y + gidy)*lens.x + gidx] =
+                    stencil_fun_3d<amin_x, amin_y, amin_z, amax_x, amax_y, amax_z>(arr);
+            }
+        }
+    }
+}
+
+// as in 2d: clamp-free interior, clamped boundary bands around it.
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
+__host__
+inline
+void stencil_3d_cpu_tile(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end)
+{
+    const long ix_start = max(x_start, long(-amin_x));
+    const long ix_end = min(x_end, lens.x - amax_x);
+    const long iy_start = max(y_start, long(-amin_y));
+    const long iy_end = min(y_end, lens.y - amax_y);
+    const long iz_start = max(z_start, long(-amin_z));
+    const long iz_end = min(z_end, lens.z - amax_z);
+    if(ix_start >= ix_end || iy_start >= iy_end || iz_start >= iz_end){
+        stencil_3d_cpu_tile_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,true>
+            (A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end);
+        return;
+    }
+    stencil_3d_cpu_tile_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,true>
+        (A, out, lens, x_start, x_end, y_start, y_end, z_start, iz_start);
+    stencil_3d_cpu_tile_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,true>
+        (A, out, lens, x_start, x_end, y_start, iy_start, iz_start, iz_end);
+    stencil_3d_cpu_tile_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,true>
+        (A, out, lens, x_start, ix_start, iy_start, iy_end, iz_start, iz_end);
+    stencil_3d_cpu_tile_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,false>
+        (A, out, lens, ix_start, ix_end, iy_start, iy_end, iz_start, iz_end);
+    stencil_3d_cpu_tile_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,true>
+        (A, out, lens, ix_end, x_end, iy_start, iy_end, iz_start, iz_end);
+    stencil_3d_cpu_tile_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,true>
+        (A, out, lens, x_start, x_end, iy_end, y_end, iz_start, iz_end);
+    stencil_3d_cpu_tile_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,true>
+        (A, out, lens, x_start, x_end, y_start, y_end, iz_end, z_end);
+}
+
+/*
+ * The grid is cut into tile_x * tile_y * tile_z tiles which the host pool hands
+ * out to its workers. A tile (plus halo) should fit in the per-core caches. In
+ * row-major order each worker starts on the planes of its own share of the
+ * grid (see cpu-numa.h) and then steals (see cpu-steal.h).
+ */
+template<const int tile_x, const int tile_y, const int tile_z, typename F>
+__host__
+void for_each_tile_3d(const long3 lens, const F& fun)
+{
+    const long3 tile_grid = {
+        divUp(lens.x, long(tile_x)),
+        divUp(lens.y, long(tile_y)),
+        divUp(lens.z, long(tile_z))};
+    const long tile_grid_flat = tile_grid.x * tile_grid.y * tile_grid.z;
+
+    steal_for_each(tile_grid_flat, [&](const long tile_id){
+        const long tile_id_z = tile_id / (tile_grid.x * tile_grid.y);
+        const long tile_id__ = tile_id % (tile_grid.x * tile_grid.y);
+        const long tile_id_y = tile_id__ / tile_grid.x;
+        const long tile_id_x = tile_id__ % tile_grid.x;
+        const long x_start = tile_id_x * tile_x;
+        const long y_start = tile_id_y * tile_y;
+        const long z_start = tile_id_z * tile_z;
+        const long x_end = min(x_start + tile_x, lens.x);
+        const long y_end = min(y_start + tile_y, lens.y);
+        const long z_end = min(z_start + tile_z, lens.z);
+        fun(x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+// for_each_tile_3d with the tiles taken in Morton order from work-stealing
+// deques (see cpu-steal.h), for tiles of uneven cost.
+template<const int tile_x, const int tile_y, const int tile_z, typename F>
+__host__
+void steal_for_each_tile_3d(const long3 lens, const F& fun)
+{
+    const long3 tile_grid = {
+        divUp(lens.x, long(tile_x)),
+        divUp(lens.y, long(tile_y)),
+        divUp(lens.z, long(tile_z))};
+
+    const std::vector<long> order = morton_order(tile_grid);
+    steal_for_each(order.size(), [&](const long i){
+        const long tile_id = order[i];
+        const long tile_id_z = tile_id / (tile_grid.x * tile_grid.y);
+        const long tile_id__ = tile_id % (tile_grid.x * tile_grid.y);
+        const long tile_id_y = tile_id__ / tile_grid.x;
+        const long tile_id_x = tile_id__ % tile_grid.x;
+        const long x_start = tile_id_x * tile_x;
+        const long y_start = tile_id_y * tile_y;
+        const long z_start = tile_id_z * tile_z;
+        const long x_end = min(x_start + tile_x, lens.x);
+        const long y_end = min(y_start + tile_y, lens.y);
+        const long z_end = min(z_start + tile_z, lens.z);
+        fun(x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int tile_z,
+    typename T>
+__host__
+void stencil_3d_cpu_tiled(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    for_each_tile_3d<tile_x,tile_y,tile_z>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end,
+            const long z_start, const long z_end){
+        stencil_3d_cpu_tile
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z>
+            (A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+/*******************************************************************************
+ * Vectorized host engines.
+ * Per row, the range.z * range.y input rows are fixed and Ops::width *
+ * Ops::unroll consecutive outputs are computed per step from shifted unaligned
+ * loads.
+ */
+SIMD_ABI_BEGIN
+// computes out_row[x] for x in [x_from, x_to) from rows[i*range.y + j][x + k],
+// whole steps only; returns where it stopped so the caller can finish the row.
+template<
+    typename Ops,
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
+SIMD_INLINE
+long stencil_3d_simd_row(
+    const T* const rows[],
+    T* const out_row,
+    const long x_from, const long x_to)
+{
+    typedef typename Ops::V V;
+    constexpr int3 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1,
+        amax_z - amin_z + 1};
+    constexpr int total_range = range.x * range.y * range.z;
+    constexpr int step = Ops::width * Ops::unroll;
+
+    long x = x_from;
+    for(; x + step <= x_to; x += step){
+        V acc[Ops::unroll];
+        for(int u=0; u < Ops::unroll; u++){ acc[u] = Ops::zero(); }
+        for(int i=0; i < range.z; i++){
+            for(int j=0; j < range.y; j++){
+                for(int k=0; k < range.x; k++){
+#ifdef Jacobi3D
+                    constexpr int zc = range.z / 2;
+                    constexpr int yc = range.y / 2;
+                    constexpr int xc = range.x / 2;
+                    const bool zn = i == zc;
+                    const bool yn = j == yc;
+                    const bool xn = k == xc;
+                    if((zn && yn) || (zn && xn) || (yn && xn))
+#endif
+                    for(int u=0; u < Ops::unroll; u++){
+                        acc[u] = Ops::add(acc[u], Ops::load(rows[i*range.y + j] + x + u*Ops::width + k));
+                    }
+                }
+            }
+        }
+        for(int u=0; u < Ops::unroll; u++){
+            Ops::store(out_row + x + u*Ops::width, Ops::div(acc[u], total_range));
+        }
+    }
+    return x;
+}
+
+/*
+ * One sweep over the region [rx_start,rx_end) x [ry_start,ry_end) x
+ * [rz_start,rz_end) of dst. src and dst hold the boxes of the grid starting at
+ * src_org/dst_org, with row and plane strides src_sx,src_sy/dst_sx,dst_sy;
+ * reads are clamped to the grid, which the src box has to cover. Outputs whose
+ * x window would be clamped are gathered one at a time, all others run on the
+ * vector path.
+ */
+template<
+    typename Ops,
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
+SIMD_INLINE
+void stencil_3d_region_step(
+    const T* src, const long3 src_org, const long src_sx, const long src_sy,
+    T* dst, const long3 dst_org, const long dst_sx, const long dst_sy,
+    const long3 lens,
+    const long rx_start, const long rx_end,
+    const long ry_start, const long ry_end,
+    const long rz_start, const long rz_end)
+{
+    constexpr int3 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1,
+        amax_z - amin_z + 1};
+    constexpr int total_range = range.x * range.y * range.z;
+
+    const long max_x_idx = lens.x - 1;
+    const long max_y_idx = lens.y - 1;
+    const long max_z_idx = lens.z - 1;
+    const long vec_start = min(rx_end, max(rx_start, long(-amin_x)));
+    const long vec_end = max(vec_start, min(rx_end, lens.x - amax_x));
+    for (long gidz = rz_start; gidz < rz_end; ++gidz){
+        for (long gidy = ry_start; gidy < ry_end; ++gidy){
+            const T* rows[range.z * range.y];
+            const T* vec_rows[range.z * range.y];
+            for(int i=0; i < range.z; i++){
+                for(int j=0; j < range.y; j++){
+                    const long z = bound<(amin_z<0),long>(gidz + (i + amin_z), max_z_idx);
+                    const long y = bound<(amin_y<0),long>(gidy + (j + amin_y), max_y_idx);
+                    const int r = i*range.y + j;
+                    rows[r] = src + (z - src_org.z)*src_sy + (y - src_org.y)*src_sx;
+                    vec_rows[r] = rows[r] + (vec_start + amin_x - src_org.x);
+                }
+            }
+            T* const out_row = dst + (gidz - dst_org.z)*dst_sy + (gidy - dst_org.y)*dst_sx;
+
+            const long vec_done = vec_start + stencil_3d_simd_row<Ops,amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>
+                (vec_rows, out_row + (vec_start - dst_org.x), 0, vec_end - vec_start);
+            const long scalar_start[2] = { rx_start, vec_done };
+            const long scalar_end[2] = { vec_start, rx_end };
+            for(int part = 0; part < 2; part++){
+                for (long gidx = scalar_start[part]; gidx < scalar_end[part]; ++gidx){
+                    T arr[total_range];
+                    for(int i=0; i < range.z; i++){
+                        for(int j=0; j < range.y; j++){
+                            for(int k=0; k < range.x; k++){
+                                const long x = bound<(amin_x<0),long>(gidx + (k + amin_x), max_x_idx);
+                                arr[(i*range.y + j)*range.x + k] = rows[i*range.y + j][x - src_org.x];
+                            }
+                        }
+                    }
+                    out_row[gidx - dst_org.x] =
+                        stencil_fun_3d<amin_x, amin_y, amin_z, amax_x, amax_y, amax_z>(arr);
+                }
+            }
+        }
+    }
+}
+
+template<
+    typename Ops,
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
+SIMD_INLINE
+void stencil_3d_simd_tile(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end)
+{
+    const long3 origin = {0, 0, 0};
+    const long plane = lens.x * lens.y;
+    stencil_3d_region_step<Ops,amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>
+        (A, origin, lens.x, plane, out, origin, lens.x, plane, lens,
+         x_start, x_end, y_start, y_end, z_start, z_end);
+}
+
+#if HOST_SIMD
+#define STENCIL_3D_SIMD_ENTRY(isa, Ops, target) \
+template< \
+    const int amin_x, const int amin_y, const int amin_z, \
+    const int amax_x, const int amax_y, const int amax_z, typename T> \
+target void stencil_3d_simd_tile_##isa( \
+    const T* A, T* out, const long3 lens, \
+    const long x_start, const long x_end, \
+    const long y_start, const long y_end, \
+    const long z_start, const long z_end){ \
+    stencil_3d_simd_tile<SimdOpsOf<Ops,T>,amin_x,amin_y,amin_z,amax_x,amax_y,amax_z> \
+        (A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end); \
+}
+STENCIL_3D_SIMD_ENTRY(sse42, SimdSse42, SIMD_TARGET_SSE42)
+STENCIL_3D_SIMD_ENTRY(avx2, SimdAvx2, SIMD_TARGET_AVX2)
+STENCIL_3D_SIMD_ENTRY(avx512, SimdAvx512, SIMD_TARGET_AVX512)
+#undef STENCIL_3D_SIMD_ENTRY
+#endif
+
+template<typename E> using Tile3dFun = void (*)(const E*, E*, const long3,
+        const long, const long, const long, const long, const long, const long);
+
+// the simd tile for the ISA of this cpu, picked once per stencil shape.
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
+__host__
+Tile3dFun<T> stencil_3d_simd_tile_fun()
+{
+    static const Tile3dFun<T> tile_fun = []{
+        switch(host_isa_for<T>()){
+#if HOST_SIMD
+            case ISA_AVX512: return Tile3dFun<T>(stencil_3d_simd_tile_avx512<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>);
+            case ISA_AVX2: return Tile3dFun<T>(stencil_3d_simd_tile_avx2<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>);
+            case ISA_SSE42: return Tile3dFun<T>(stencil_3d_simd_tile_sse42<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>);
+#endif
+            default: return Tile3dFun<T>(stencil_3d_cpu_tile<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>);
+        }
+    }();
+    return tile_fun;
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int tile_z,
+    typename T>
+__host__
+void stencil_3d_cpu_simd(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    const Tile3dFun<T> tile_fun = stencil_3d_simd_tile_fun<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,T>();
+    for_each_tile_3d<tile_x,tile_y,tile_z>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end,
+            const long z_start, const long z_end){
+        tile_fun(A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int tile_z,
+    typename T>
+__host__
+void stencil_3d_cpu_simd_steal(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    const Tile3dFun<T> tile_fun = stencil_3d_simd_tile_fun<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,T>();
+    steal_for_each_tile_3d<tile_x,tile_y,tile_z>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end,
+            const long z_start, const long z_end){
+        tile_fun(A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+/*******************************************************************************
+ * 2.5d z-marching engine, the host counterpart of
+ * stripmine_big_tile_3d_inlined_cube_singleDim.
+ * A task owns an x/y tile and streams through z. Only the range.z live planes
+ * of the tile (clamped in x and y, with halo) are kept, in a ring, so every
+ * input plane is copied from memory once per tile column instead of range.z
+ * times, and with the halo already clamped all outputs run on the vector path.
+ */
+template<
+    typename Ops,
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y,
+    typename T>
+SIMD_INLINE
+void stencil_3d_zmarch_tile(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end)
+{
+    constexpr int3 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1,
+        amax_z - amin_z + 1};
+    constexpr int total_range = range.x * range.y * range.z;
+    constexpr int plane_x = tile_x + range.x - 1;
+    constexpr int plane_y = tile_y + range.y - 1;
+    constexpr int plane_size_flat = plane_x * plane_y;
+    constexpr int ring_size_flat = range.z * plane_size_flat;
+
+    alignas(64) T ring[ring_size_flat];
+    const long max_x_idx = lens.x - 1;
+    const long max_y_idx = lens.y - 1;
+    const long max_z_idx = lens.z - 1;
+    const long tile_len_x = x_end - x_start;
+    const long tile_len_y = y_end - y_start;
+    const long row_len = tile_len_x + (range.x - 1);
+    const long plane_len_y = tile_len_y + (range.y - 1);
+    const long read_gid_x = x_start + amin_x;
+    const bool interior_x = read_gid_x >= 0 && read_gid_x + row_len - 1 <= max_x_idx;
+
+    int write_plane = 0;
+    int read_plane = 0;
+    long read_gid_z = z_start + amin_z;
+    for(long z__ = z_start - 1; z__ < z_end; z__++){
+        // the first iteration only preloads the range.z - 1 leading planes.
+        const int new_planes = (z__ < z_start) ? range.z - 1 : 1;
+        for(int i__ = 0; i__ < new_planes; i__++){
+            const long z = bound<(amin_z<0),long>(read_gid_z, max_z_idx);
+            for(long py = 0; py < plane_len_y; py++){
+                const long y = bound<(amin_y<0),long>(y_start + amin_y + py, max_y_idx);
+                const T* src = A + (z*lens.y + y)*lens.x;
+                T* dst = ring + write_plane*plane_size_flat + py*plane_x;
+                if(interior_x){
+                    memcpy(dst, src + read_gid_x, row_len*sizeof(T));
+                }
+                else {
+                    for(long i = 0; i < row_len; i++){
+                        dst[i] = src[bound<(amin_x<0),long>(read_gid_x + i, max_x_idx)];
+                    }
+                }
+            }
+            write_plane++;
+            if(write_plane >= range.z){ write_plane -= range.z; }
+            read_gid_z++;
+        }
+        if(z__ < z_start){ continue; }
+
+        const T* planes[range.z];
+        for(int i=0; i < range.z; i++){
+            const int p = read_plane + i;
+            planes[i] = ring + (p - (p >= range.z ? range.z : 0))*plane_size_flat;
+        }
+        for(long ly = 0; ly < tile_len_y; ly++){
+            const T* rows[range.z * range.y];
+            for(int i=0; i < range.z; i++){
+                for(int j=0; j < range.y; j++){
+                    rows[i*range.y + j] = planes[i] + (ly + j)*plane_x;
+                }
+            }
+            T* const out_row = out + (z__*lens.y + (y_start + ly))*lens.x + x_start;
+            long x = stencil_3d_simd_row<Ops,amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>
+                (rows, out_row, 0, tile_len_x);
+            for(; x < tile_len_x; x++){
+                T vals[total_range];
+                for(int i=0; i < range.z; i++){
+                    for(int j=0; j < range.y; j++){
+                        for(int k=0; k < range.x; k++){
+                            vals[(i*range.y + j)*range.x + k] = rows[i*range.y + j][x + k];
+                        }
+                    }
+                }
+                out_row[x] = stencil_fun_3d<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>(vals);
+            }
+        }
+        read_plane++;
+        if(read_plane >= range.z){ read_plane -= range.z; }
+    }
+}
+
+#define STENCIL_3D_ZMARCH_ENTRY(isa, Ops, target) \
+template< \
+    const int amin_x, const int amin_y, const int amin_z, \
+    const int amax_x, const int amax_y, const int amax_z, \
+    const int tile_x, const int tile_y, typename T> \
+target void stencil_3d_zmarch_tile_##isa( \
+    const T* A, T* out, const long3 lens, \
+    const long x_start, const long x_end, \
+    const long y_start, const long y_end, \
+    const long z_start, const long z_end){ \
+    stencil_3d_zmarch_tile<SimdOpsOf<Ops,T>,amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y> \
+        (A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end); \
+}
+STENCIL_3D_ZMARCH_ENTRY(scalar, SimdScalar, )
+#if HOST_SIMD
+STENCIL_3D_ZMARCH_ENTRY(sse42, SimdSse42, SIMD_TARGET_SSE42)
+STENCIL_3D_ZMARCH_ENTRY(avx2, SimdAvx2, SIMD_TARGET_AVX2)
+STENCIL_3D_ZMARCH_ENTRY(avx512, SimdAvx512, SIMD_TARGET_AVX512)
+#endif
+#undef STENCIL_3D_ZMARCH_ENTRY
+
+/*
+ * march_z bounds how far one task streams so that there are enough tasks to
+ * keep all workers busy; every task re-reads range.z - 1 planes to fill its
+ * ring.
+ */
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int march_z,
+    typename T>
+__host__
+void stencil_3d_cpu_zmarch(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    typedef void (*TileFun)(const T*, T*, const long3,
+            const long, const long, const long, const long, const long, const long);
+    static const TileFun tile_fun = []{
+        switch(host_isa_for<T>()){
+#if HOST_SIMD
+            case ISA_AVX512: return TileFun(stencil_3d_zmarch_tile_avx512<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y>);
+            case ISA_AVX2: return TileFun(stencil_3d_zmarch_tile_avx2<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y>);
+            case ISA_SSE42: return TileFun(stencil_3d_zmarch_tile_sse42<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y>);
+#endif
+            default: return TileFun(stencil_3d_zmarch_tile_scalar<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y>);
+        }
+    }();
+
+    for_each_tile_3d<tile_x,tile_y,march_z>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end,
+            const long z_start, const long z_end){
+        tile_fun(A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+/*******************************************************************************
+ * Iterative stencils: out = stencil^iterations(A), tmp is a second grid sized
+ * buffer. Sweeps ping-pong between out and tmp (ordered so that the last one
+ * lands in out), A is left untouched.
+ */
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int tile_z,
+    typename T>
+__host__
+void stencil_3d_cpu_iterate(
+    const T* A,
+    T* out,
+    T* tmp,
+    const long3 lens,
+    const int iterations)
+{
+    const T* src = A;
+    T* dst = (iterations & 1) ? out : tmp;
+    for(int t = 0; t < iterations; t++){
+        stencil_3d_cpu_simd
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,tile_x,tile_y,tile_z>
+            (src, dst, lens);
+        src = dst;
+        dst = (dst == out) ? tmp : out;
+    }
+    if(iterations <= 0){ memcpy(out, A, lens.x*lens.y*lens.z*sizeof(T)); }
+}
+
+/*
+ * Temporal blocking with overlapped (trapezoidal) tiles, see
+ * stencil_2d_timetile. Step s of steps is computed over the tile grown by
+ * (steps - s) halos in every dimension, in two local buffers; only the first
+ * step reads the grid and only the last one writes it. Bit-identical to
+ * stencil_3d_cpu_iterate.
+ */
+template<
+    typename Ops,
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int tile_z,
+    const int depth,
+    typename T>
+SIMD_INLINE
+void stencil_3d_timetile(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end,
+    const int steps)
+{
+    constexpr int3 halo_lo = {
+        amin_x < 0 ? -amin_x : 0,
+        amin_y < 0 ? -amin_y : 0,
+        amin_z < 0 ? -amin_z : 0};
+    constexpr int3 halo_hi = {
+        amax_x > 0 ? amax_x : 0,
+        amax_y > 0 ? amax_y : 0,
+        amax_z > 0 ? amax_z : 0};
+    constexpr int buf_x = tile_x + (depth-1)*(halo_lo.x + halo_hi.x);
+    constexpr int buf_y = tile_y + (depth-1)*(halo_lo.y + halo_hi.y);
+    constexpr int buf_z = tile_z + (depth-1)*(halo_lo.z + halo_hi.z);
+
+    // too large for the worker stacks, so every worker keeps its own pair.
+    static thread_local std::vector<T> buf_store;
+    buf_store.resize(2 * long(buf_x) * buf_y * buf_z);
+    T* const buf[2] = { buf_store.data(), buf_store.data() + long(buf_x) * buf_y * buf_z };
+
+    const T* src = A;
+    long3 src_org = {0, 0, 0};
+    long src_sx = lens.x;
+    long src_sy = lens.x * lens.y;
+    for(int s = 1; s <= steps; s++){
+        const int grow = steps - s;
+        const long rx_start = max(0L, x_start - long(grow*halo_lo.x));
+        const long ry_start = max(0L, y_start - long(grow*halo_lo.y));
+        const long rz_start = max(0L, z_start - long(grow*halo_lo.z));
+        const long rx_end = min(lens.x, x_end + long(grow*halo_hi.x));
+        const long ry_end = min(lens.y, y_end + long(grow*halo_hi.y));
+        const long rz_end = min(lens.z, z_end + long(grow*halo_hi.z));
+
+        const bool last = s == steps;
+        T* dst = last ? out : buf[s & 1];
+        const long3 dst_org = {
+            last ? 0 : rx_start,
+            last ? 0 : ry_start,
+            last ? 0 : rz_start};
+        const long dst_sx = last ? lens.x : rx_end - rx_start;
+        const long dst_sy = last ? lens.x * lens.y : dst_sx * (ry_end - ry_start);
+        stencil_3d_region_step<Ops,amin_x,amin_y,amin_z,amax_x,amax_y,amax_z>
+            (src, src_org, src_sx, src_sy, dst, dst_org, dst_sx, dst_sy, lens,
+             rx_start, rx_end, ry_start, ry_end, rz_start, rz_end);
+        src = dst;
+        src_org = dst_org;
+        src_sx = dst_sx;
+        src_sy = dst_sy;
+    }
+}
+
+#define STENCIL_3D_TIMETILE_ENTRY(isa, Ops, target) \
+template< \
+    const int amin_x, const int amin_y, const int amin_z, \
+    const int amax_x, const int amax_y, const int amax_z, \
+    const int tile_x, const int tile_y, const int tile_z, const int depth, typename T> \
+target void stencil_3d_timetile_##isa( \
+    const T* A, T* out, const long3 lens, \
+    const long x_start, const long x_end, \
+    const long y_start, const long y_end, \
+    const long z_start, const long z_end, \
+    const int steps){ \
+    stencil_3d_timetile<SimdOpsOf<Ops,T>,amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y,tile_z,depth> \
+        (A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end, steps); \
+}
+STENCIL_3D_TIMETILE_ENTRY(scalar, SimdScalar, )
+#if HOST_SIMD
+STENCIL_3D_TIMETILE_ENTRY(sse42, SimdSse42, SIMD_TARGET_SSE42)
+STENCIL_3D_TIMETILE_ENTRY(avx2, SimdAvx2, SIMD_TARGET_AVX2)
+STENCIL_3D_TIMETILE_ENTRY(avx512, SimdAvx512, SIMD_TARGET_AVX512)
+#endif
+#undef STENCIL_3D_TIMETILE_ENTRY
+SIMD_ABI_END
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int tile_z,
+    const int depth,
+    typename T>
+__host__
+void stencil_3d_cpu_timetiled(
+    const T* A,
+    T* out,
+    T* tmp,
+    const long3 lens,
+    const int iterations)
+{
+    static_assert(depth >= 1, "temporal block depth must be at least one step\n");
+    typedef void (*TileFun)(const T*, T*, const long3,
+            const long, const long, const long, const long, const long, const long, const int);
+    static const TileFun tile_fun = []{
+        switch(host_isa_for<T>()){
+#if HOST_SIMD
+            case ISA_AVX512: return TileFun(stencil_3d_timetile_avx512<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y,tile_z,depth>);
+            case ISA_AVX2: return TileFun(stencil_3d_timetile_avx2<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y,tile_z,depth>);
+            case ISA_SSE42: return TileFun(stencil_3d_timetile_sse42<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y,tile_z,depth>);
+#endif
+            default: return TileFun(stencil_3d_timetile_scalar<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,tile_x,tile_y,tile_z,depth>);
+        }
+    }();
+
+    const int n_blocks = divUp(iterations, depth);
+    const T* src = A;
+    T* dst = (n_blocks & 1) ? out : tmp;
+    for(int t = 0; t < iterations; t += depth){
+        const int steps = min(depth, iterations - t);
+        for_each_tile_3d<tile_x,tile_y,tile_z>(lens, [&](
+                const long x_start, const long x_end,
+                const long y_start, const long y_end,
+                const long z_start, const long z_end){
+            tile_fun(src, dst, lens, x_start, x_end, y_start, y_end, z_start, z_end, steps);
+        });
+        src = dst;
+        dst = (dst == out) ? tmp : out;
+    }
+    if(iterations <= 0){ memcpy(out, A, lens.x*lens.y*lens.z*sizeof(T)); }
+}
+
+// stencil_3d_cpu_iterate in cache-oblivious order (see cpu-zoid.h).
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
+__host__
+void stencil_3d_cpu_zoid(
+    const T* A,
+    T* out,
+    T* tmp,
+    const long3 lens,
+    const int iterations)
+{
+    if(iterations <= 0){ memcpy(out, A, lens.x*lens.y*lens.z*sizeof(T)); return; }
+    // level 0 is A, level t > 0 is in out when it has the parity of iterations.
+    T* const levels[2] = { (iterations & 1) ? tmp : out, (iterations & 1) ? out : tmp };
+    const Tile3dFun<T> tile_fun = stencil_3d_simd_tile_fun<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,T>();
+    const long len[3] = { lens.x, lens.y, lens.z };
+    const long sigma[3] = { zoid_slope(amin_x, amax_x), zoid_slope(amin_y, amax_y), zoid_slope(amin_z, amax_z) };
+    zoid_run<3>(len, sigma, iterations, [&](const long t, const long* lo, const long* hi){
+        const T* src = t == 0 ? A : levels[t & 1];
+        tile_fun(src, levels[(t + 1) & 1], lens, lo[0], hi[0], lo[1], hi[1], lo[2], hi[2]);
+    });
+}
+
+/*******************************************************************************
+ * Box mean from running sums (see cpu-box.h).
+ * A tile column marches through z keeping the 2d box sums (built as in
+ * stencil_2d_box_tile) of the last range.z planes plus their running total;
+ * each step adds the entering plane and drops the leaving one. Not for
+ * Jacobi3D. Validate with reassociation_tolerance(total_range).
+ */
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
+__host__
+inline
+void stencil_3d_box_tile(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end)
+{
+    constexpr int3 range = {
+        amax_x - amin_x + 1,
+        amax_y - amin_y + 1,
+        amax_z - amin_z + 1};
+    constexpr int total_range = range.x * range.y * range.z;
+    constexpr int ring_size = range.z + 1;
+
+    const long width = x_end - x_start;
+    const long height = y_end - y_start;
+    const long plane = width * height;
+    const long n_rows = height + range.y - 1;
+    static thread_local std::vector<double> buf_store;
+    buf_store.resize(n_rows * width + (ring_size + 1) * plane);
+    double* const row_sums = buf_store.data();
+    double* const z_sums = row_sums + n_rows * width;
+    double* const ring = z_sums + plane;
+
+    // the 2d box sums of plane z_start + amin_z + p.
+    auto plane_sums = [&](const long p, double* dst){
+        const long z = bound<(amin_z<0),long>(z_start + amin_z + p, lens.z - 1);
+        for(long r = 0; r < n_rows; r++){
+            const long y = bound<(amin_y<0),long>(y_start + amin_y + r, lens.y - 1);
+            box_line_sums<amin_x,amax_x>
+                (A + (z*lens.y + y)*lens.x, lens.x - 1, x_start, x_end, row_sums + r*width);
+        }
+        box_slide_rows<range.y>(row_sums, dst, height, width, width);
+    };
+
+    for(long i = 0; i < plane; i++){ z_sums[i] = 0; }
+    for(int p = 0; p < range.z; p++){
+        double* const cur = ring + p*plane;
+        plane_sums(p, cur);
+        for(long i = 0; i < plane; i++){ z_sums[i] += cur[i]; }
+    }
+    for(long r = 0; ; r++){
+        const long gidz = z_start + r;
+        for(long y = 0; y < height; y++){
+            T* const out_row = out + (gidz*lens.y + y_start + y)*lens.x + x_start;
+            for(long x = 0; x < width; x++){
+                out_row[x] = T(z_sums[y*width + x] / double(total_range));
+            }
+        }
+        if(gidz + 1 >= z_end){ break; }
+
+        const double* const leave = ring + (r % ring_size)*plane;
+        double* const enter = ring + ((r + range.z) % ring_size)*plane;
+        plane_sums(r + range.z, enter);
+        for(long i = 0; i < plane; i++){ z_sums[i] = (z_sums[i] + enter[i]) - leave[i]; }
+    }
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int march_z,
+    typename T>
+__host__
+void stencil_3d_cpu_box(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    for_each_tile_3d<tile_x,tile_y,march_z>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end,
+            const long z_start, const long z_end){
+        stencil_3d_box_tile
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z>
+            (A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+/*******************************************************************************
+ * Separable execution (see cpu-separable.h).
+ * A tile column marches through z keeping the x and y passes of the last
+ * range.z planes in a ring; each output plane is the weighted z pass across
+ * the ring.
+ */
+
+// stencil_fun_3d is a full box, and so separable, unless the Jacobi3D star
+// spans two axes or more.
+template<const int range_x, const int range_y, const int range_z>
+__host__
+constexpr bool stencil_3d_is_separable(){
+#ifdef Jacobi3D
+    return (range_x == 1) + (range_y == 1) + (range_z == 1) >= 2;
+#else
+    return true;
+#endif
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
+__host__
+inline
+void stencil_3d_separable_tile(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const SeparableWeights<ElemAcc<T> >& w,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end)
+{
+    constexpr int range_y = amax_y - amin_y + 1;
+    constexpr int range_z = amax_z - amin_z + 1;
+    const long width = x_end - x_start;
+    const long height = y_end - y_start;
+    const long plane = width * height;
+    const long n_rows = height + range_y - 1;
+    typedef ElemAcc<T> V;
+    const V norm = w.norm;
+    static thread_local std::vector<V> buf_store;
+    buf_store.resize(n_rows * width + (range_z + 1) * plane);
+    V* const rows = buf_store.data();
+    V* const acc = rows + n_rows * width;
+    V* const planes = acc + plane;
+
+    // the x and y passes of plane z_start + amin_z + p.
+    auto xy_pass = [&](const long p, V* dst){
+        const long z = bound<(amin_z<0),long>(z_start + amin_z + p, lens.z - 1);
+        for(long r = 0; r < n_rows; r++){
+            const long y = bound<(amin_y<0),long>(y_start + amin_y + r, lens.y - 1);
+            separable_line_pass<amin_x,amax_x>
+                (A + (z*lens.y + y)*lens.x, lens.x - 1, x_start, x_end, w.x, rows + r*width);
+        }
+        for(long r = 0; r < height; r++){
+            const V* window[range_y];
+            for(int j = 0; j < range_y; j++){
+                window[j] = rows + (r + j)*width;
+            }
+            separable_ring_pass<range_y>(window, w.y, dst + r*width, width);
+        }
+    };
+    for(int i = 0; i < range_z; i++){
+        xy_pass(i, planes + i*plane);
+    }
+    for(long r = 0; z_start + r < z_end; r++){
+        const V* ring[range_z];
+        for(int i = 0; i < range_z; i++){
+            ring[i] = planes + ((r + i) % range_z)*plane;
+        }
+        separable_ring_pass<range_z>(ring, w.z, acc, plane);
+        for(long y = 0; y < height; y++){
+            T* const out_row = out + ((z_start + r)*lens.y + y_start + y)*lens.x + x_start;
+            for(long x = 0; x < width; x++){
+                out_row[x] = T(acc[y*width + x] / norm);
+            }
+        }
+        if(z_start + r + 1 < z_end){
+            xy_pass(r + range_z, planes + (r % range_z)*plane);
+        }
+    }
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int march_z,
+    typename T>
+__host__
+void stencil_3d_cpu_separable(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const SeparableWeights<ElemAcc<T> >& w)
+{
+    for_each_tile_3d<tile_x,tile_y,march_z>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end,
+            const long z_start, const long z_end){
+        stencil_3d_separable_tile
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z>
+            (A, out, lens, w, x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+// the mean of stencil_fun_3d, separable whenever the shape allows it and
+// otherwise on the simd engine. tile_x, tile_y and march_z size the planes of
+// the separable path only; the simd engine keeps its own CPU_TILE_X/Y/Z tiles.
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int tile_x, const int tile_y, const int march_z,
+    typename T>
+__host__
+void stencil_3d_cpu_separable_mean(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    constexpr int range_x = amax_x - amin_x + 1;
+    constexpr int range_y = amax_y - amin_y + 1;
+    constexpr int range_z = amax_z - amin_z + 1;
+    if(stencil_3d_is_separable<range_x,range_y,range_z>()){
+        stencil_3d_cpu_separable
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,tile_x,tile_y,march_z>
+            (A, out, lens, separable_mean_weights<range_x,range_y,range_z,ElemAcc<T> >());
+    }
+    else {
+        stencil_3d_cpu_simd
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,elem_scaled<T>(CPU_TILE_X),CPU_TILE_Y,CPU_TILE_Z>
+            (A, out, lens);
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef CPU_NUMA
+#define CPU_NUMA
+
+#include <string.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+#include "constants.h"
+#include "threadpool.h"
+
+/*******************************************************************************
+ * Numa placement of the host grids.
+ * Linux places a page on the node of the thread that first writes it, so a
+ * grid that the main thread allocates and fills lands on a single node, and
+ * workers on the other nodes read it remotely. Here each grid is split into
+ * one contiguous share per pool worker (worker_share), which is also the share
+ * of tiles the schedulers give each worker first (for_each_tile_*). Every
+ * worker first-touches its own share. With pinned workers the shares are also
+ * bound to the node of their worker, so the placement holds even when another
+ * thread touches a page first.
+ */
+
+// [begin, end) of the n elements that worker w of n_workers owns.
+__host__
+inline
+void worker_share(const long n, const int w, const int n_workers, long& begin, long& end){
+    begin = n*w / n_workers;
+    end = n*(w + 1) / n_workers;
+}
+
+// prefers node for the whole pages of [p, p + bytes).
+__host__
+inline
+void bind_to_node(char* p, const long bytes, const int node){
+#if defined(__linux__) && defined(SYS_mbind)
+    const long page = sysconf(_SC_PAGESIZE);
+    const unsigned long start = (((unsigned long)p) + page - 1) / page * page;
+    const unsigned long end = ((unsigned long)(p + bytes)) / page * page;
+    if(end <= start || node >= 64){ return; }
+    const unsigned long nodemask = 1UL << node;
+    const int mpol_preferred = 1;
+    syscall(SYS_mbind, start, end - start, mpol_preferred, &nodemask, 64, 0);
+#else
+    (void)p; (void)bytes; (void)node;
+#endif
+}
+
+// count grids of len elements, back to back: each is zeroed share by share by
+// the pool workers, so its pages are first touched on their nodes.
+template<typename T>
+__host__
+inline
+void place_grids(T* grids, const long len, const int count){
+    ThreadPool& pool = host_pool();
+    pool.for_each_worker([&](const long, const int w){
+        for(int g = 0; g < count; g++){
+            long begin, end;
+            worker_share(len, w, pool.size(), begin, end);
+            T* share = grids + g*len + begin;
+            if(pool.n_nodes() > 1){
+                bind_to_node((char*)share, (end - begin)*sizeof(T), pool.node_of_worker(w));
+            }
+            memset(share, 0, (end - begin)*sizeof(T));
+        }
+    });
+}
+
+#endif
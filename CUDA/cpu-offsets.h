@@ -0,0 +1,143 @@
+#ifndef CPU_OFFSETS
+#define CPU_OFFSETS
+
+#include "constants.h"
+#include "cpu-simd.h"
+#include "offsets.h"
+#include "cpu-kernels-1d.h"
+#include "cpu-kernels-2d.h"
+#include "cpu-kernels-3d.h"
+
+/*******************************************************************************
+ * Host simd engines for offset lists (offsets.h) and weighted lists
+ * (weights.h). In the rows of a tile whose y and z windows lie inside the
+ * grid, the outputs whose x window does too take Ops::width at a time through
+ * apply_ops, the others go through read_write_offsets. Both sum in the order
+ * of the list, so the result is bit-identical to the host reference.
+ * 1d and 2d grids run as 3d grids with the outer lens at 1.
+ */
+SIMD_ABI_BEGIN
+template<typename Ops, typename Offs>
+SIMD_INLINE
+void stencil_offsets_simd_tile(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end)
+{
+    const long sy = lens.x;
+    const long sz = lens.x * lens.y;
+    const long vec_start = min(x_end, max(x_start, long(-Offs::min_x)));
+    const long vec_end = max(vec_start, min(x_end, lens.x - Offs::max_x));
+    for(long gid_z = z_start; gid_z < z_end; gid_z++){
+        const bool inner_z = in_bounds(gid_z + Offs::min_z, long(Offs::max_z - Offs::min_z + 1), lens.z - 1);
+        for(long gid_y = y_start; gid_y < y_end; gid_y++){
+            const bool inner_y = in_bounds(gid_y + Offs::min_y, long(Offs::max_y - Offs::min_y + 1), lens.y - 1);
+            long gid_x = x_start;
+            if(inner_z && inner_y){
+                for(; gid_x < vec_start; gid_x++){
+                    read_write_offsets<Offs>(A, out, lens, gid_x, gid_y, gid_z);
+                }
+                const long row = (gid_z * lens.y + gid_y) * lens.x;
+                for(; gid_x + Ops::width <= vec_end; gid_x += Ops::width){
+                    Ops::store(out + row + gid_x, Offs::template apply_ops<Ops>(A + row + gid_x, sy, sz));
+                }
+            }
+            for(; gid_x < x_end; gid_x++){
+                read_write_offsets<Offs>(A, out, lens, gid_x, gid_y, gid_z);
+            }
+        }
+    }
+}
+
+#if HOST_SIMD
+#define STENCIL_OFFSETS_SIMD_ENTRY(isa, Ops, target) \
+template<typename Offs> \
+target void stencil_offsets_simd_tile_##isa( \
+    const T* A, T* out, const long3 lens, \
+    const long x_start, const long x_end, \
+    const long y_start, const long y_end, \
+    const long z_start, const long z_end){ \
+    stencil_offsets_simd_tile<Ops,Offs> \
+        (A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end); \
+}
+STENCIL_OFFSETS_SIMD_ENTRY(sse42, SimdSse42, SIMD_TARGET_SSE42)
+STENCIL_OFFSETS_SIMD_ENTRY(avx2, SimdAvx2, SIMD_TARGET_AVX2)
+STENCIL_OFFSETS_SIMD_ENTRY(avx512, SimdAvx512, SIMD_TARGET_AVX512)
+#undef STENCIL_OFFSETS_SIMD_ENTRY
+#endif
+SIMD_ABI_END
+
+template<typename Offs>
+__host__
+void stencil_offsets_scalar_tile(
+    const T* A, T* out, const long3 lens,
+    const long x_start, const long x_end,
+    const long y_start, const long y_end,
+    const long z_start, const long z_end)
+{
+    stencil_offsets_simd_tile<SimdScalar,Offs>
+        (A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end);
+}
+
+typedef void (*TileOffsetsFun)(const T*, T*, const long3,
+    const long, const long, const long, const long, const long, const long);
+
+// the simd tile for the ISA of this cpu, picked once per list.
+template<typename Offs>
+__host__
+TileOffsetsFun stencil_offsets_simd_tile_fun()
+{
+    static const TileOffsetsFun tile_fun = []{
+        switch(host_isa()){
+#if HOST_SIMD
+            case ISA_AVX512: return TileOffsetsFun(stencil_offsets_simd_tile_avx512<Offs>);
+            case ISA_AVX2: return TileOffsetsFun(stencil_offsets_simd_tile_avx2<Offs>);
+            case ISA_SSE42: return TileOffsetsFun(stencil_offsets_simd_tile_sse42<Offs>);
+#endif
+            default: return TileOffsetsFun(stencil_offsets_scalar_tile<Offs>);
+        }
+    }();
+    return tile_fun;
+}
+
+template<typename Offs, const int tile_x>
+__host__
+void stencil_1d_cpu_offsets_simd(const T* A, T* out, const long nx)
+{
+    const TileOffsetsFun tile_fun = stencil_offsets_simd_tile_fun<Offs>();
+    const long3 lens = { nx, 1, 1 };
+    for_each_tile_1d<tile_x>(nx, [&](const long x_start, const long x_end){
+        tile_fun(A, out, lens, x_start, x_end, 0, 1, 0, 1);
+    });
+}
+
+template<typename Offs, const int tile_x, const int tile_y>
+__host__
+void stencil_2d_cpu_offsets_simd(const T* A, T* out, const long2 lens)
+{
+    const TileOffsetsFun tile_fun = stencil_offsets_simd_tile_fun<Offs>();
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    for_each_tile_2d<tile_x,tile_y>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end){
+        tile_fun(A, out, lens3, x_start, x_end, y_start, y_end, 0, 1);
+    });
+}
+
+template<typename Offs, const int tile_x, const int tile_y, const int tile_z>
+__host__
+void stencil_3d_cpu_offsets_simd(const T* A, T* out, const long3 lens)
+{
+    const TileOffsetsFun tile_fun = stencil_offsets_simd_tile_fun<Offs>();
+    for_each_tile_3d<tile_x,tile_y,tile_z>(lens, [&](
+            const long x_start, const long x_end,
+            const long y_start, const long y_end,
+            const long z_start, const long z_end){
+        tile_fun(A, out, lens, x_start, x_end, y_start, y_end, z_start, z_end);
+    });
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef CPU_SEPARABLE
+#define CPU_SEPARABLE
+
+#include <vector>
+#include "constants.h"
+
+/*******************************************************************************
+ * Passes for the separable host engines.
+ * A stencil whose weight is w_x[k] * w_y[j] * w_z[i] over an axis-aligned box
+ * (every shape of the tests, with all weights 1 and norm = total_range for the
+ * mean) factors into one 1d pass per axis: O(rx + ry + rz) work per output
+ * instead of O(rx * ry * rz). The engines sweep x along rows into a small
+ * ring of rows/planes that stays in cache, then y and z across the ring.
+ *
+ * The taps are summed per axis, so results differ from stencil_fun_* by
+ * rounding only; validate with reassociation_tolerance(total_range).
+ */
+
+// a weighted stencil that factors per axis; missing axes are unused. The
+// weights and the passes are in the accumulation type V of the elements.
+template<typename V>
+struct SeparableWeights {
+    const V* x;
+    const V* y;
+    const V* z;
+    V norm;
+};
+
+// weights of 1 and a final division by the box volume: the unweighted mean of
+// stencil_fun_*.
+template<const int range_x, const int range_y, const int range_z, typename V>
+__host__
+inline
+SeparableWeights<V> separable_mean_weights(){
+    static const std::vector<V> ones(max(range_x, max(range_y, range_z)), V(1));
+    return { ones.data(), ones.data(), ones.data(), V(range_x * range_y * range_z) };
+}
+
+// dst[i - start] = sum over k of w[k] * line[bound(i + amin + k)], for i in
+// [start, end). The clamped window is gathered once, so the tap loops are
+// contiguous.
+template<
+    const int amin,
+    const int amax,
+    typename T,
+    typename V>
+__host__
+inline
+void separable_line_pass(
+    const T* line,
+    const long max_ix,
+    const long start, const long end,
+    const V* w,
+    V* dst)
+{
+    constexpr int range = amax - amin + 1;
+    const long n = end - start;
+    static thread_local std::vector<V> window_store;
+    window_store.resize(n + range - 1);
+    V* const window = window_store.data();
+
+    for(long i = 0; i < n + range - 1; i++){
+        window[i] = line[bound<(amin<0),long>(start + amin + i, max_ix)];
+    }
+    for(long i = 0; i < n; i++){
+        dst[i] = 0;
+    }
+    for(int k = 0; k < range; k++){
+        const V wk = w[k];
+        for(long i = 0; i < n; i++){
+            dst[i] += wk * window[i + k];
+        }
+    }
+}
+
+// dst = sum over k of w[k] * src[k], n values each: the pass across a ring of
+// rows or planes, src[k] being the k-th of the window.
+template<const int range, typename V>
+__host__
+inline
+void separable_ring_pass(
+    const V* const src[range],
+    const V* w,
+    V* dst,
+    const long n)
+{
+    for(long i = 0; i < n; i++){
+        dst[i] = 0;
+    }
+    for(int k = 0; k < range; k++){
+        const V wk = w[k];
+        const V* const s = src[k];
+        for(long i = 0; i < n; i++){
+            dst[i] += wk * s[i];
+        }
+    }
+}
+
+#endif
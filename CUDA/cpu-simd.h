@@ -0,0 +1,163 @@
+#ifndef CPU_SIMD
+#define CPU_SIMD
+
+#include <stdlib.h>
+#include <string.h>
+#include "constants.h"
+
+/*******************************************************************************
+ * Vector ops for the host engines.
+ * Each ISA gets a small ops struct (vector type, width, loads/stores and the
+ * arithmetic stencil_fun_* needs). The engines are written once against these
+ * structs and instantiated inside functions carrying the matching target
+ * attribute, so one binary holds the SSE4.2, AVX2 and AVX-512 versions and
+ * host_isa() picks one at startup from CPUID.
+ *
+ * Only adds and a final division are used, lane by lane in the same order as
+ * the scalar stencil_fun_*, so the vector engines are bit-identical to them.
+ * The weighted lists (weights.h) add subtractions and products with their
+ * coefficients, again in the order of their scalar version, which stay
+ * bit-identical as long as the build does not contract them (see Makefile).
+ * Define NO_HOST_SIMD to build the scalar engines only.
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(NO_HOST_SIMD)
+#define HOST_SIMD 1
+#else
+#define HOST_SIMD 0
+#endif
+
+enum HostIsa {
+    ISA_SCALAR = 0,
+    ISA_SSE42 = 1,
+    ISA_AVX2 = 2,
+    ISA_AVX512 = 3
+};
+
+static inline const char* host_isa_name(const HostIsa isa){
+    switch(isa){
+        case ISA_SSE42: return "sse4.2";
+        case ISA_AVX2: return "avx2";
+        case ISA_AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+// the widest ISA this cpu supports; STENCIL_ISA=scalar|sse4.2|avx2|avx512 can
+// lower it (e.g. to compare the variants on one node).
+static inline HostIsa host_isa(){
+    static const HostIsa isa = []{
+        HostIsa best = ISA_SCALAR;
+#if HOST_SIMD
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("sse4.2")){ best = ISA_SSE42; }
+        if(__builtin_cpu_supports("avx2")){ best = ISA_AVX2; }
+        if(__builtin_cpu_supports("avx512f")){ best = ISA_AVX512; }
+#endif
+        const char* env = getenv("STENCIL_ISA");
+        if(env){
+            for(int i = ISA_SCALAR; i <= ISA_AVX512; i++){
+                if(strcmp(env, host_isa_name(HostIsa(i))) == 0 && i < best){
+                    best = HostIsa(i);
+                }
+            }
+        }
+        return best;
+    }();
+    return isa;
+}
+
+// the ops are inlined into the per-ISA entry points, never called across an
+// ABI boundary, but gcc checks the vector ABI of the calls before inlining
+// them into the entry points that enable the ISA. The code written against
+// the ops goes between SIMD_ABI_BEGIN and SIMD_ABI_END, which hide that
+// warning there and keep it on for the code around.
+#if defined(__GNUC__)
+#define SIMD_INLINE __attribute__((always_inline)) inline
+#define SIMD_ABI_BEGIN _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wpsabi\"")
+#define SIMD_ABI_END _Pragma("GCC diagnostic pop")
+#else
+#define SIMD_INLINE inline
+#define SIMD_ABI_BEGIN
+#define SIMD_ABI_END
+#endif
+
+// one lane, for engines that are written against the ops and also have to run
+// where no vector ISA is available. Elements are loaded into and stored from
+// their accumulation type (ElemTraits).
+template<typename E>
+struct SimdScalarOf {
+    typedef ElemAcc<E> V;
+    static constexpr int width = 1;
+    static constexpr int unroll = 1;
+    static inline V zero(){ return V(0); }
+    static inline V load(const E* p){ return V(*p); }
+    static inline void store(E* p, const V a){ *p = E(a); }
+    static inline V add(const V a, const V b){ return a + b; }
+    static inline V sub(const V a, const V b){ return a - b; }
+    static inline V mul(const V a, const V w){ return a * w; }
+    static inline V div(const V a, const V d){ return a / d; }
+};
+typedef SimdScalarOf<T> SimdScalar;
+
+// the vector ops hold floats; the engines for other element types run the
+// scalar ops of their type in the same per-ISA entry points.
+template<typename Ops, typename E> struct SimdOpsFor { typedef SimdScalarOf<E> type; };
+template<typename Ops> struct SimdOpsFor<Ops, float> { typedef Ops type; };
+template<typename Ops, typename E> using SimdOpsOf = typename SimdOpsFor<Ops, E>::type;
+
+// the ISA the host engines dispatch on for elements E.
+template<typename E> inline HostIsa host_isa_for(){ return ISA_SCALAR; }
+template<> inline HostIsa host_isa_for<float>(){ return host_isa(); }
+
+#if HOST_SIMD
+#include <immintrin.h>
+
+SIMD_ABI_BEGIN
+
+#define SIMD_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+
+// SSE registers hold 4 floats; two are processed per step to give 8 outputs.
+struct SimdSse42 {
+    typedef __m128 V;
+    static constexpr int width = 4;
+    static constexpr int unroll = 2;
+    SIMD_TARGET_SSE42 static inline V zero(){ return _mm_setzero_ps(); }
+    SIMD_TARGET_SSE42 static inline V load(const T* p){ return _mm_loadu_ps(p); }
+    SIMD_TARGET_SSE42 static inline void store(T* p, const V a){ _mm_storeu_ps(p, a); }
+    SIMD_TARGET_SSE42 static inline V add(const V a, const V b){ return _mm_add_ps(a, b); }
+    SIMD_TARGET_SSE42 static inline V sub(const V a, const V b){ return _mm_sub_ps(a, b); }
+    SIMD_TARGET_SSE42 static inline V mul(const V a, const T w){ return _mm_mul_ps(a, _mm_set1_ps(w)); }
+    SIMD_TARGET_SSE42 static inline V div(const V a, const T d){ return _mm_div_ps(a, _mm_set1_ps(d)); }
+};
+
+struct SimdAvx2 {
+    typedef __m256 V;
+    static constexpr int width = 8;
+    static constexpr int unroll = 1;
+    SIMD_TARGET_AVX2 static inline V zero(){ return _mm256_setzero_ps(); }
+    SIMD_TARGET_AVX2 static inline V load(const T* p){ return _mm256_loadu_ps(p); }
+    SIMD_TARGET_AVX2 static inline void store(T* p, const V a){ _mm256_storeu_ps(p, a); }
+    SIMD_TARGET_AVX2 static inline V add(const V a, const V b){ return _mm256_add_ps(a, b); }
+    SIMD_TARGET_AVX2 static inline V sub(const V a, const V b){ return _mm256_sub_ps(a, b); }
+    SIMD_TARGET_AVX2 static inline V mul(const V a, const T w){ return _mm256_mul_ps(a, _mm256_set1_ps(w)); }
+    SIMD_TARGET_AVX2 static inline V div(const V a, const T d){ return _mm256_div_ps(a, _mm256_set1_ps(d)); }
+};
+
+struct SimdAvx512 {
+    typedef __m512 V;
+    static constexpr int width = 16;
+    static constexpr int unroll = 1;
+    SIMD_TARGET_AVX512 static inline V zero(){ return _mm512_setzero_ps(); }
+    SIMD_TARGET_AVX512 static inline V load(const T* p){ return _mm512_loadu_ps(p); }
+    SIMD_TARGET_AVX512 static inline void store(T* p, const V a){ _mm512_storeu_ps(p, a); }
+    SIMD_TARGET_AVX512 static inline V add(const V a, const V b){ return _mm512_add_ps(a, b); }
+    SIMD_TARGET_AVX512 static inline V sub(const V a, const V b){ return _mm512_sub_ps(a, b); }
+    SIMD_TARGET_AVX512 static inline V mul(const V a, const T w){ return _mm512_mul_ps(a, _mm512_set1_ps(w)); }
+    SIMD_TARGET_AVX512 static inline V div(const V a, const T d){ return _mm512_div_ps(a, _mm512_set1_ps(d)); }
+};
+SIMD_ABI_END
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef CPU_STEAL
+#define CPU_STEAL
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "constants.h"
+#include "threadpool.h"
+#include "cpu-numa.h"
+
+/*******************************************************************************
+ * Work-stealing execution of a virtual tile grid on the host pool.
+ * This is the host counterpart of the virtual_addcarry_* kernels. Those map a
+ * virtual grid onto num_phys_groups workers with a fixed stride, which is
+ * balanced only when every tile costs the same. Here each worker owns a
+ * contiguous run of the tiles as its deque and pops tiles from its front. A
+ * worker whose deque is empty steals the back half of a victim's deque.
+ * With the tiles in row-major order a worker starts on the rows it has
+ * first-touched (cpu-numa.h). In Morton (Z-curve) order a run covers a compact
+ * block of the grid, so the initial share and every stolen half both touch
+ * neighbouring tiles.
+ */
+
+// interleaves the low 32 bits of v with zeros: bit i moves to bit 2i.
+__host__
+inline
+unsigned long morton_spread_2(unsigned long v){
+    v &= 0xffffffffUL;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffUL;
+    v = (v | (v <<  8)) & 0x00ff00ff00ff00ffUL;
+    v = (v | (v <<  4)) & 0x0f0f0f0f0f0f0f0fUL;
+    v = (v | (v <<  2)) & 0x3333333333333333UL;
+    v = (v | (v <<  1)) & 0x5555555555555555UL;
+    return v;
+}
+
+// interleaves the low 21 bits of v with pairs of zeros: bit i moves to bit 3i.
+__host__
+inline
+unsigned long morton_spread_3(unsigned long v){
+    v &= 0x1fffffUL;
+    v = (v | (v << 32)) & 0x001f00000000ffffUL;
+    v = (v | (v << 16)) & 0x001f0000ff0000ffUL;
+    v = (v | (v <<  8)) & 0x100f00f00f00f00fUL;
+    v = (v | (v <<  4)) & 0x10c30c30c30c30c3UL;
+    v = (v | (v <<  2)) & 0x1249249249249249UL;
+    return v;
+}
+
+__host__
+inline
+unsigned long morton_key(const long x, const long y){
+    return morton_spread_2(x) | (morton_spread_2(y) << 1);
+}
+
+__host__
+inline
+unsigned long morton_key(const long x, const long y, const long z){
+    return morton_spread_3(x) | (morton_spread_3(y) << 1) | (morton_spread_3(z) << 2);
+}
+
+// the flat (row-major, x fastest) ids of a tile grid in Z-curve order. Grids
+// that are not powers of two just skip the codes outside of them.
+__host__
+inline
+std::vector<long> morton_order(const long2 tile_grid){
+    std::vector<std::pair<unsigned long,long> > keyed;
+    keyed.reserve(tile_grid.x * tile_grid.y);
+    for(long y = 0; y < tile_grid.y; y++){
+        for(long x = 0; x < tile_grid.x; x++){
+            keyed.push_back(std::make_pair(morton_key(x, y), y*tile_grid.x + x));
+        }
+    }
+    std::sort(keyed.begin(), keyed.end());
+    std::vector<long> order(keyed.size());
+    for(size_t i = 0; i < keyed.size(); i++){
+        order[i] = keyed[i].second;
+    }
+    return order;
+}
+
+__host__
+inline
+std::vector<long> morton_order(const long3 tile_grid){
+    std::vector<std::pair<unsigned long,long> > keyed;
+    keyed.reserve(tile_grid.x * tile_grid.y * tile_grid.z);
+    for(long z = 0; z < tile_grid.z; z++){
+        for(long y = 0; y < tile_grid.y; y++){
+            for(long x = 0; x < tile_grid.x; x++){
+                keyed.push_back(std::make_pair(morton_key(x, y, z),
+                    (z*tile_grid.y + y)*tile_grid.x + x));
+            }
+        }
+    }
+    std::sort(keyed.begin(), keyed.end());
+    std::vector<long> order(keyed.size());
+    for(size_t i = 0; i < keyed.size(); i++){
+        order[i] = keyed[i].second;
+    }
+    return order;
+}
+
+// the run [head, tail) of the tiles a worker still owns. Padded so the
+// deques of different workers do not share a cache line.
+struct StealDeque {
+    std::mutex mtx;
+    long head;
+    long tail;
+    char pad[64];
+};
+
+/*
+ * Runs fun(i) for every i in [0, n) on the host pool. Worker w starts with
+ * its worker_share of [0, n); after that the work moves by stealing. Stolen
+ * work is installed in the thief's own deque, so it can be stolen again. The
+ * deques only shrink apart from that, so a worker that finds every deque empty
+ * can stop: anything still in flight belongs to a running thief.
+ */
+template<typename F>
+__host__
+void steal_for_each(const long n, const F& fun)
+{
+    if(n <= 0){ return; }
+    ThreadPool& pool = host_pool();
+    const int n_deques = pool.size();
+    std::vector<StealDeque> deques(n_deques);
+    for(int w = 0; w < n_deques; w++){
+        worker_share(n, w, n_deques, deques[w].head, deques[w].tail);
+    }
+
+    pool.for_each_worker([&](const long self, const int){
+        StealDeque& own = deques[self];
+        for(;;){
+            long i;
+            {
+                std::lock_guard<std::mutex> lock(own.mtx);
+                i = own.head < own.tail ? own.head++ : -1;
+            }
+            if(i >= 0){
+                fun(i);
+                continue;
+            }
+
+            long stolen_head = 0, stolen_tail = 0;
+            for(int k = 1; k < n_deques && stolen_head == stolen_tail; k++){
+                StealDeque& victim = deques[(self + k) % n_deques];
+                std::lock_guard<std::mutex> lock(victim.mtx);
+                const long left = victim.tail - victim.head;
+                if(left > 0){
+                    stolen_tail = victim.tail;
+                    stolen_head = victim.tail - divUp(left, 2L);
+                    victim.tail = stolen_head;
+                }
+            }
+            if(stolen_head == stolen_tail){ return; }
+            std::lock_guard<std::mutex> lock(own.mtx);
+            own.head = stolen_head;
+            own.tail = stolen_tail;
+        }
+    });
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef CPU_ZOID
+#define CPU_ZOID
+
+#include "constants.h"
+#include "threadpool.h"
+
+/*******************************************************************************
+ * Cache-oblivious space-time recursion (Frigo & Strumpen trapezoids) for the
+ * iterative host stencils.
+ * A zoid is a box in space that moves over [t0, t1): along each axis it covers
+ * [x0 + dx0*s, x1 + dx1*s) at step t0 + s, with edge slopes of 0 (grid border)
+ * or +-sigma, the reach of the stencil along that axis. A zoid is cut in space
+ * along a line of slope -sigma while it is wide enough, otherwise in time, so
+ * the working set halves at every level of the recursion and each cache level
+ * gets reuse without a tile size tuned for it.
+ *
+ * The points are computed as by a plain sweep from the same inputs, only in
+ * another order, so the result is bit-identical to the ping-pong engines. Two
+ * grids hold the time levels: writing level t + 1 over level t - 1 is safe as
+ * the slopes keep every reader of level t - 1 ahead of the writers.
+ */
+
+// the reach of a stencil along one axis, which bounds the zoid slopes.
+__host__
+constexpr long zoid_slope(const int amin, const int amax){
+    return -amin > amax ? (-amin > 0 ? -amin : 0) : (amax > 0 ? amax : 0);
+}
+
+// along one axis the zoid covers [x0 + dx0*s, x1 + dx1*s) at step t0 + s.
+struct ZoidAxis {
+    long x0, dx0;
+    long x1, dx1;
+};
+
+template<const int D>
+struct Zoid {
+    ZoidAxis axis[D];
+};
+
+// base(t, lo, hi) advances the box [lo, hi) (one bound per axis, x first)
+// from level t to level t + 1.
+template<const int D, typename F>
+__host__
+void zoid_walk(
+    const long t0, const long t1,
+    const Zoid<D>& z,
+    const long sigma[D],
+    const F& base)
+{
+    const long dt = t1 - t0;
+
+    long volume = dt;
+    for(int d = 0; d < D; d++){
+        const ZoidAxis& a = z.axis[d];
+        volume *= max(a.x1 - a.x0, (a.x1 + a.dx1*dt) - (a.x0 + a.dx0*dt));
+    }
+    if(dt == 1 || volume <= CPU_ZOID_BASE){
+        for(long t = t0; t < t1; t++){
+            const long s = t - t0;
+            long lo[D], hi[D];
+            bool empty = false;
+            for(int d = 0; d < D; d++){
+                lo[d] = z.axis[d].x0 + z.axis[d].dx0*s;
+                hi[d] = z.axis[d].x1 + z.axis[d].dx1*s;
+                empty = empty || lo[d] >= hi[d];
+            }
+            if(!empty){ base(t, lo, hi); }
+        }
+        return;
+    }
+
+    // space cut, outermost axis first; x is kept wide for the vector loops.
+    for(int d = D - 1; d >= 0; d--){
+        const ZoidAxis& a = z.axis[d];
+        const long s = sigma[d];
+        const long widths = 2*(a.x1 - a.x0) + (a.dx1 - a.dx0)*dt;
+        const long min_width = d == 0 ? CPU_ZOID_MIN_X : 2;
+        if(widths >= 4*s*dt && widths >= 2*min_width){
+            const long xm = (2*(a.x0 + a.x1) + (2*s + a.dx0 + a.dx1)*dt) / 4;
+            Zoid<D> left = z;
+            Zoid<D> right = z;
+            left.axis[d].x1 = xm;
+            left.axis[d].dx1 = -s;
+            right.axis[d].x0 = xm;
+            right.axis[d].dx0 = -s;
+            zoid_walk<D>(t0, t1, left, sigma, base);
+            zoid_walk<D>(t0, t1, right, sigma, base);
+            return;
+        }
+    }
+
+    // time cut
+    const long half = dt / 2;
+    Zoid<D> upper = z;
+    for(int d = 0; d < D; d++){
+        upper.axis[d].x0 += z.axis[d].dx0*half;
+        upper.axis[d].x1 += z.axis[d].dx1*half;
+    }
+    zoid_walk<D>(t0, t0 + half, z, sigma, base);
+    zoid_walk<D>(t0 + half, t1, upper, sigma, base);
+}
+
+/*
+ * Runs steps time steps over the grid lens on the host pool. The outermost
+ * axis is split into one slab per worker; per block of time the upright zoids
+ * of the slabs (shrinking towards the top) are independent and run in
+ * parallel, then the inverted zoids between them, which depend on both
+ * neighbours. The block height is the most the slab width allows.
+ */
+template<const int D, typename F>
+__host__
+void zoid_run(
+    const long lens[D],
+    const long sigma[D],
+    const long steps,
+    const F& base)
+{
+    constexpr int d = D - 1;
+    const long n = lens[d];
+    const long s = sigma[d];
+    long slabs = host_pool().size();
+    if(s > 0){ slabs = min(slabs, max(1L, n / (2*s))); }
+    slabs = min(slabs, n);
+
+    Zoid<D> root;
+    for(int i = 0; i < D; i++){
+        root.axis[i] = { 0, 0, lens[i], 0 };
+    }
+    for(long t0 = 0; t0 < steps; ){
+        long dt = steps - t0;
+        if(slabs > 1 && s > 0){
+            dt = min(dt, max(1L, (n / slabs) / (2*s)));
+        }
+        host_pool().parallel_for(slabs, [&](const long i, const int){
+            Zoid<D> z = root;
+            z.axis[d] = {
+                n*i / slabs, i > 0 ? s : 0,
+                n*(i + 1) / slabs, i < slabs - 1 ? -s : 0 };
+            zoid_walk<D>(t0, t0 + dt, z, sigma, base);
+        });
+        host_pool().parallel_for(slabs - 1, [&](const long i, const int){
+            Zoid<D> z = root;
+            const long b = n*(i + 1) / slabs;
+            z.axis[d] = { b, -s, b, s };
+            zoid_walk<D>(t0, t0 + dt, z, sigma, base);
+        });
+        t0 += dt;
+    }
+}
+
+#endif
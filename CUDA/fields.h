@@ -0,0 +1,562 @@
+#ifndef STENCIL_FIELDS
+#define STENCIL_FIELDS
+
+#include <cuda_runtime.h>
+#include "constants.h"
+#include "offsets.h"
+
+/*******************************************************************************
+ * Coupled stencils over several fields stored as separate grids (struct of
+ * arrays). Every output is a sum of terms, each an offset or weighted list
+ * (offsets.h, weights.h) over one of the n_in input fields, e.g. for the
+ * fields u, v, p:
+ *     typedef Coupled<3
+ *         ,Output<Term<0, laplace>, Term<2, minus_ddx>>
+ *         ,Output<Term<1, laplace>, Term<2, minus_ddy>>
+ *         ,Output<Term<0, minus_ddx>, Term<1, minus_ddy>>
+ *         > update;
+ * The terms of an output are summed in their order. The big tile kernels
+ * load the halo of every input at once, each only as wide as the terms that
+ * read it, and write all outputs after a single barrier, so that the update
+ * is one sweep over memory instead of one pass per term.
+ * big_tile_2d/3d_terms run the same update the other way, one pass per term
+ * adding into its output, with the same result.
+ */
+template<const int field, typename Offs>
+struct Term {
+    static constexpr int input = field;
+    typedef Offs List;
+};
+
+// the extents of a list along an axis, 0 for x.
+template<typename Offs>
+MACROLIKE constexpr int list_min(const int axis){
+    return axis == 0 ? Offs::min_x : axis == 1 ? Offs::min_y : Offs::min_z;
+}
+template<typename Offs>
+MACROLIKE constexpr int list_max(const int axis){
+    return axis == 0 ? Offs::max_x : axis == 1 ? Offs::max_y : Offs::max_z;
+}
+MACROLIKE constexpr int min_of(const int a, const int b){ return a < b ? a : b; }
+MACROLIKE constexpr int max_of(const int a, const int b){ return a < b ? b : a; }
+
+template<typename... Terms>
+struct Output;
+
+template<>
+struct Output<> {
+    static constexpr int size = 0;
+    // the extents of the points the terms read of a field, of all fields for
+    // field -1.
+    MACROLIKE static constexpr int lo(const int, const int){ return OFFSETS_NONE; }
+    MACROLIKE static constexpr int hi(const int, const int){ return -OFFSETS_NONE; }
+    MACROLIKE static constexpr int lo_x(const int, const int, const int, const int, const int){ return OFFSETS_NONE; }
+    MACROLIKE static constexpr int hi_x(const int, const int, const int, const int, const int){ return -OFFSETS_NONE; }
+    MACROLIKE static constexpr bool reads(const int){ return false; }
+
+    template<typename Read>
+    MACROLIKE static void accumulate(T&, const Read&){}
+};
+
+template<typename T0, typename... Ts>
+struct Output<T0, Ts...> {
+    typedef Output<Ts...> Rest;
+    typedef typename T0::List L;
+    static constexpr int size = 1 + Rest::size;
+
+    MACROLIKE static constexpr bool of(const int field){ return field < 0 || field == T0::input; }
+    MACROLIKE static constexpr int lo(const int field, const int axis){
+        return min_of(of(field) ? list_min<L>(axis) : OFFSETS_NONE, Rest::lo(field, axis));
+    }
+    MACROLIKE static constexpr int hi(const int field, const int axis){
+        return max_of(of(field) ? list_max<L>(axis) : -OFFSETS_NONE, Rest::hi(field, axis));
+    }
+    MACROLIKE static constexpr int lo_x(const int field, const int y0, const int y1, const int z0, const int z1){
+        return min_of(of(field) ? L::lo_x(y0, y1, z0, z1) : OFFSETS_NONE, Rest::lo_x(field, y0, y1, z0, z1));
+    }
+    MACROLIKE static constexpr int hi_x(const int field, const int y0, const int y1, const int z0, const int z1){
+        return max_of(of(field) ? L::hi_x(y0, y1, z0, z1) : -OFFSETS_NONE, Rest::hi_x(field, y0, y1, z0, z1));
+    }
+    MACROLIKE static constexpr bool reads(const int field){ return field == T0::input || Rest::reads(field); }
+
+    // the term at a point, read.at<field>(dx, dy, dz) giving the value of
+    // the field at the offset.
+    template<typename Read>
+    MACROLIKE static T term(const Read& read){
+        return L::apply([&](const int dx, const int dy, const int dz){
+            return read.template at<T0::input>(dx, dy, dz); });
+    }
+
+    template<typename Read>
+    MACROLIKE static void accumulate(T& acc, const Read& read){
+        acc += term(read);
+        Rest::accumulate(acc, read);
+    }
+
+    template<typename Read>
+    MACROLIKE static T apply(const Read& read){
+        T acc = term(read);
+        Rest::accumulate(acc, read);
+        return acc;
+    }
+};
+
+template<typename... Outs>
+struct outputs_cat;
+
+template<>
+struct outputs_cat<> {
+    typedef Output<> type;
+};
+
+template<typename... As, typename... Rest>
+struct outputs_cat<Output<As...>, Rest...> {
+    template<typename B>
+    struct prepend;
+    template<typename... Bs>
+    struct prepend<Output<Bs...>> { typedef Output<As..., Bs...> type; };
+    typedef typename prepend<typename outputs_cat<Rest...>::type>::type type;
+};
+
+template<const int m, typename... Outs>
+struct output_at;
+
+template<typename O0, typename... Outs>
+struct output_at<0, O0, Outs...> { typedef O0 type; };
+
+template<const int m, typename O0, typename... Outs>
+struct output_at<m, O0, Outs...> { typedef typename output_at<m - 1, Outs...>::type type; };
+
+// the points a field is read at, as the offset list its tile and halo are
+// made for; field -1 for all fields.
+template<typename Terms, const int field>
+struct FieldFootprint {
+    static constexpr int min_x = Terms::lo(field, 0);
+    static constexpr int min_y = Terms::lo(field, 1);
+    static constexpr int min_z = Terms::lo(field, 2);
+    static constexpr int max_x = Terms::hi(field, 0);
+    static constexpr int max_y = Terms::hi(field, 1);
+    static constexpr int max_z = Terms::hi(field, 2);
+
+    MACROLIKE static constexpr int lo_x(const int y0, const int y1, const int z0, const int z1){
+        return Terms::lo_x(field, y0, y1, z0, z1);
+    }
+    MACROLIKE static constexpr int hi_x(const int y0, const int y1, const int z0, const int z1){
+        return Terms::hi_x(field, y0, y1, z0, z1);
+    }
+};
+
+template<const int n_in, typename... Outs>
+struct Coupled {
+    static constexpr int n_inputs = n_in;
+    static constexpr int n_outputs = sizeof...(Outs);
+    typedef typename outputs_cat<Outs...>::type Terms;
+    typedef FieldFootprint<Terms, -1> Union;
+
+    MACROLIKE static constexpr bool reads_from(const int field){
+        return field == n_in || (Terms::reads(field) && reads_from(field + 1));
+    }
+    static_assert(n_outputs > 0, "a coupled stencil needs an output");
+    static_assert(reads_from(0), "every input needs a term that reads it");
+
+    template<const int field>
+    using Footprint = FieldFootprint<Terms, field>;
+    template<const int m>
+    using Out = typename output_at<m, Outs...>::type;
+};
+
+/*******************************************************************************
+ * The fields' tiles of a block, one after the other in shared memory, each
+ * an OffsetsTile of the field's footprint.
+ */
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z, const int field = C::n_inputs>
+struct FieldsTile {
+    typedef FieldsTile<C,group_size_x,group_size_y,group_size_z,field - 1> Before;
+    typedef OffsetsTile<typename C::template Footprint<field - 1>,group_size_x,group_size_y,group_size_z> Last;
+    // where the tile of field - 1 starts, and the size of all tiles below field.
+    static constexpr int offset = Before::size;
+    static constexpr int size = offset + Last::size;
+};
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+struct FieldsTile<C,group_size_x,group_size_y,group_size_z,0> {
+    static constexpr int size = 0;
+};
+
+template<typename C, const int field, const int group_size_x, const int group_size_y, const int group_size_z>
+MACROLIKE constexpr int field_tile_offset(){
+    return FieldsTile<C,group_size_x,group_size_y,group_size_z,field>::size;
+}
+
+/*
+ * Reads of the fields at a point, from the grids with clamps at the border
+ * or from the block's tiles.
+ */
+template<typename C, const bool clamp>
+struct GridFieldsRead {
+    const FieldPtrs<C::n_inputs>& in;
+    const long3 lens;
+    const long gid_x, gid_y, gid_z;
+
+    template<const int field>
+    MACROLIKE T at(const int dx, const int dy, const int dz) const {
+        const long z = bound_if<clamp,true,long>(gid_z + dz, lens.z - 1);
+        const long y = bound_if<clamp,true,long>(gid_y + dy, lens.y - 1);
+        const long x = bound_if<clamp,true,long>(gid_x + dx, lens.x - 1);
+        return in.at[field][(z * lens.y + y) * lens.x + x];
+    }
+};
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+struct TileFieldsRead {
+    const T* tile;
+    const int3 local;
+
+    template<const int field>
+    MACROLIKE T at(const int dx, const int dy, const int dz) const {
+        typedef typename C::template Footprint<field> F;
+        typedef OffsetsTile<F,group_size_x,group_size_y,group_size_z> Tile;
+        const T* t = tile + field_tile_offset<C,field,group_size_x,group_size_y,group_size_z>();
+        return t[((local.z - F::min_z + dz) * Tile::size_y + (local.y - F::min_y + dy)) * Tile::size_x
+                 + (local.x - F::min_x + dx)];
+    }
+};
+
+/*******************************************************************************
+ * One pass per term: the big tile of the term's list over its input, which
+ * sets the output for the first term of an output and adds to it after.
+ */
+template<typename Offs, const bool add, const int group_size_x, const int group_size_y, const int group_size_z>
+__device__
+__forceinline__
+void term_load_and_write(
+    T* tile,
+    const T* A,
+    T* out,
+    const long3 lens,
+    const int3 local,
+    const long3 block_offset)
+{
+    typedef OffsetsTile<Offs,group_size_x,group_size_y,group_size_z> Tile;
+    offsets_tile_loader<Offs,group_size_x,group_size_y,group_size_z>(A, tile, lens, local, block_offset);
+    __syncthreads();
+    const long gid_x = block_offset.x + local.x;
+    const long gid_y = block_offset.y + local.y;
+    const long gid_z = block_offset.z + local.z;
+    if(gid_x < lens.x && gid_y < lens.y && gid_z < lens.z){
+        const int base = ((local.z - Offs::min_z) * Tile::size_y + (local.y - Offs::min_y)) * Tile::size_x
+                       + (local.x - Offs::min_x);
+        const long gid = (gid_z * lens.y + gid_y) * lens.x + gid_x;
+        const T value = Offs::apply([&](const int dx, const int dy, const int dz){
+            return tile[base + (dz * Tile::size_y + dy) * Tile::size_x + dx]; });
+        out[gid] = add ? out[gid] + value : value;
+    }
+}
+
+template<typename Offs, const bool add, const int group_size_x, const int group_size_y>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_2d_term(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    __shared__ T tile[OffsetsTile<Offs,group_size_x,group_size_y,1>::size];
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    const int3 local = { int(threadIdx.x), int(threadIdx.y), 0 };
+    const long3 block_offset = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        0 };
+    term_load_and_write<Offs,add,group_size_x,group_size_y,1>(tile, A, out, lens3, local, block_offset);
+}
+
+template<typename Offs, const bool add, const int group_size_x, const int group_size_y, const int group_size_z>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_3d_term(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    __shared__ T tile[OffsetsTile<Offs,group_size_x,group_size_y,group_size_z>::size];
+    const int3 local = { int(threadIdx.x), int(threadIdx.y), int(threadIdx.z) };
+    const long3 block_offset = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        long(blockIdx.z) * group_size_z };
+    term_load_and_write<Offs,add,group_size_x,group_size_y,group_size_z>(tile, A, out, lens, local, block_offset);
+}
+
+// the passes of the terms of an output, in order.
+template<typename Out, const int group_size_x, const int group_size_y, const int group_size_z, const bool add = false>
+struct term_passes;
+
+template<const int group_size_x, const int group_size_y, const int group_size_z, const bool add>
+struct term_passes<Output<>,group_size_x,group_size_y,group_size_z,add> {
+    template<typename L>
+    __host__ static void launch(T* const*, T*, const L, const dim3, const dim3){}
+};
+
+template<typename T0, typename... Ts, const int group_size_x, const int group_size_y, const int group_size_z, const bool add>
+struct term_passes<Output<T0, Ts...>,group_size_x,group_size_y,group_size_z,add> {
+    typedef term_passes<Output<Ts...>,group_size_x,group_size_y,group_size_z,true> Rest;
+
+    __host__
+    static void launch(T* const* in, T* out, const long2 lens, const dim3 grid, const dim3 block){
+        void (*kfun)(const T*, T*, const long2) = big_tile_2d_term<typename T0::List,add,group_size_x,group_size_y>;
+        LAUNCH(kfun, grid, block, 0)(in[T0::input], out, lens);
+        Rest::launch(in, out, lens, grid, block);
+    }
+    __host__
+    static void launch(T* const* in, T* out, const long3 lens, const dim3 grid, const dim3 block){
+        void (*kfun)(const T*, T*, const long3) = big_tile_3d_term<typename T0::List,add,group_size_x,group_size_y,group_size_z>;
+        LAUNCH(kfun, grid, block, 0)(in[T0::input], out, lens);
+        Rest::launch(in, out, lens, grid, block);
+    }
+};
+
+// compile-time loops over the inputs and over the outputs.
+template<typename C, const int field = 0, const bool done = (field == C::n_inputs)>
+struct inputs_loop {
+    template<const int group_size_x, const int group_size_y, const int group_size_z>
+    __device__
+    __forceinline__
+    static void load(
+        const FieldPtrs<C::n_inputs>& in,
+        T* tile,
+        const long3 lens,
+        const int3 local,
+        const long3 block_offset)
+    {
+        offsets_tile_loader<typename C::template Footprint<field>,group_size_x,group_size_y,group_size_z>
+            (in.at[field], tile + field_tile_offset<C,field,group_size_x,group_size_y,group_size_z>()
+            ,lens, local, block_offset);
+        inputs_loop<C, field + 1>::template load<group_size_x,group_size_y,group_size_z>
+            (in, tile, lens, local, block_offset);
+    }
+};
+
+template<typename C, const int field>
+struct inputs_loop<C, field, true> {
+    template<const int group_size_x, const int group_size_y, const int group_size_z>
+    __device__
+    __forceinline__
+    static void load(const FieldPtrs<C::n_inputs>&, T*, const long3, const int3, const long3){}
+};
+
+template<typename C, const int m = 0, const bool done = (m == C::n_outputs)>
+struct outputs_loop {
+    template<typename Read>
+    MACROLIKE static void write(const FieldPtrs<C::n_outputs>& out, const long gid, const Read& read){
+        out.at[m][gid] = C::template Out<m>::apply(read);
+        outputs_loop<C, m + 1>::write(out, gid, read);
+    }
+
+    template<const int group_size_x, const int group_size_y, const int group_size_z, typename L>
+    __host__
+    static void passes(
+        const FieldPtrs<C::n_inputs>& in,
+        const FieldPtrs<C::n_outputs>& out,
+        const L lens,
+        const dim3 grid,
+        const dim3 block)
+    {
+        term_passes<typename C::template Out<m>,group_size_x,group_size_y,group_size_z>
+            ::launch(in.at, out.at[m], lens, grid, block);
+        outputs_loop<C, m + 1>::template passes<group_size_x,group_size_y,group_size_z>
+            (in, out, lens, grid, block);
+    }
+};
+
+template<typename C, const int m>
+struct outputs_loop<C, m, true> {
+    template<typename Read>
+    MACROLIKE static void write(const FieldPtrs<C::n_outputs>&, const long, const Read&){}
+
+    template<const int group_size_x, const int group_size_y, const int group_size_z, typename L>
+    __host__
+    static void passes(const FieldPtrs<C::n_inputs>&, const FieldPtrs<C::n_outputs>&, const L, const dim3, const dim3){}
+};
+
+template<typename C>
+MACROLIKE
+void read_write_fields(
+    const FieldPtrs<C::n_inputs>& in,
+    const FieldPtrs<C::n_outputs>& out,
+    const long3 lens,
+    const long gid_x, const long gid_y, const long gid_z)
+{
+    typedef typename C::Union U;
+    const bool interior =
+           in_bounds(gid_x + U::min_x, long(U::max_x - U::min_x + 1), lens.x - 1)
+        && in_bounds(gid_y + U::min_y, long(U::max_y - U::min_y + 1), lens.y - 1)
+        && in_bounds(gid_z + U::min_z, long(U::max_z - U::min_z + 1), lens.z - 1);
+    const long gid = (gid_z * lens.y + gid_y) * lens.x + gid_x;
+    if(interior){
+        const GridFieldsRead<C,false> read = { in, lens, gid_x, gid_y, gid_z };
+        outputs_loop<C>::write(out, gid, read);
+    }
+    else {
+        const GridFieldsRead<C,true> read = { in, lens, gid_x, gid_y, gid_z };
+        outputs_loop<C>::write(out, gid, read);
+    }
+}
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+__device__
+__forceinline__
+void fields_load_and_write(
+    T* tile,
+    const FieldPtrs<C::n_inputs>& in,
+    const FieldPtrs<C::n_outputs>& out,
+    const long3 lens,
+    const int3 local,
+    const long3 block_offset)
+{
+    inputs_loop<C>::template load<group_size_x,group_size_y,group_size_z>(in, tile, lens, local, block_offset);
+    __syncthreads();
+    const long gid_x = block_offset.x + local.x;
+    const long gid_y = block_offset.y + local.y;
+    const long gid_z = block_offset.z + local.z;
+    if(gid_x < lens.x && gid_y < lens.y && gid_z < lens.z){
+        const TileFieldsRead<C,group_size_x,group_size_y,group_size_z> read = { tile, local };
+        outputs_loop<C>::write(out, (gid_z * lens.y + gid_y) * lens.x + gid_x, read);
+    }
+}
+
+/*******************************************************************************
+ * Kernels, with the grids and blocks of the offset list kernels.
+ */
+template<typename C, const int group_size_x, const int group_size_y>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void global_reads_2d_fields(
+    const FieldPtrs<C::n_inputs> in,
+    const FieldPtrs<C::n_outputs> out,
+    const long2 lens)
+{
+    const long gid_x = long(blockIdx.x) * group_size_x + threadIdx.x;
+    const long gid_y = long(blockIdx.y) * group_size_y + threadIdx.y;
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    if(gid_x < lens.x && gid_y < lens.y){
+        read_write_fields<C>(in, out, lens3, gid_x, gid_y, 0);
+    }
+}
+
+template<typename C, const int group_size_x, const int group_size_y>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_2d_fields(
+    const FieldPtrs<C::n_inputs> in,
+    const FieldPtrs<C::n_outputs> out,
+    const long2 lens)
+{
+    __shared__ T tile[FieldsTile<C,group_size_x,group_size_y,1>::size];
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    const int3 local = { int(threadIdx.x), int(threadIdx.y), 0 };
+    const long3 block_offset = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        0 };
+    fields_load_and_write<C,group_size_x,group_size_y,1>(tile, in, out, lens3, local, block_offset);
+}
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void global_reads_3d_fields(
+    const FieldPtrs<C::n_inputs> in,
+    const FieldPtrs<C::n_outputs> out,
+    const long3 lens)
+{
+    const long gid_x = long(blockIdx.x) * group_size_x + threadIdx.x;
+    const long gid_y = long(blockIdx.y) * group_size_y + threadIdx.y;
+    const long gid_z = long(blockIdx.z) * group_size_z + threadIdx.z;
+    if(gid_x < lens.x && gid_y < lens.y && gid_z < lens.z){
+        read_write_fields<C>(in, out, lens, gid_x, gid_y, gid_z);
+    }
+}
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_3d_fields(
+    const FieldPtrs<C::n_inputs> in,
+    const FieldPtrs<C::n_outputs> out,
+    const long3 lens)
+{
+    __shared__ T tile[FieldsTile<C,group_size_x,group_size_y,group_size_z>::size];
+    const int3 local = { int(threadIdx.x), int(threadIdx.y), int(threadIdx.z) };
+    const long3 block_offset = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        long(blockIdx.z) * group_size_z };
+    fields_load_and_write<C,group_size_x,group_size_y,group_size_z>(tile, in, out, lens, local, block_offset);
+}
+
+// the update as one pass per term, for the grid and block of the kernels above.
+template<typename C, const int group_size_x, const int group_size_y>
+__host__
+void big_tile_2d_terms(
+    const FieldPtrs<C::n_inputs> in,
+    const FieldPtrs<C::n_outputs> out,
+    const long2 lens)
+{
+    const dim3 block(group_size_x, group_size_y);
+    const dim3 grid(
+        divUp(lens.x, long(group_size_x)),
+        divUp(lens.y, long(group_size_y)));
+    outputs_loop<C>::template passes<group_size_x,group_size_y,1>(in, out, lens, grid, block);
+}
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+__host__
+void big_tile_3d_terms(
+    const FieldPtrs<C::n_inputs> in,
+    const FieldPtrs<C::n_outputs> out,
+    const long3 lens)
+{
+    const dim3 block(group_size_x, group_size_y, group_size_z);
+    const dim3 grid(
+        divUp(lens.x, long(group_size_x)),
+        divUp(lens.y, long(group_size_y)),
+        divUp(lens.z, long(group_size_z)));
+    outputs_loop<C>::template passes<group_size_x,group_size_y,group_size_z>(in, out, lens, grid, block);
+}
+
+/*******************************************************************************
+ * Host references, one row of the grid per task.
+ */
+template<typename C>
+__host__
+void stencil_2d_cpu_fields(
+    const FieldPtrs<C::n_inputs> in,
+    const FieldPtrs<C::n_outputs> out,
+    const long2 lens)
+{
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    host_pool().parallel_for(lens.y, [&](const long gid_y, const int){
+        for(long gid_x = 0; gid_x < lens.x; gid_x++){
+            read_write_fields<C>(in, out, lens3, gid_x, gid_y, 0);
+        }
+    });
+}
+
+template<typename C>
+__host__
+void stencil_3d_cpu_fields(
+    const FieldPtrs<C::n_inputs> in,
+    const FieldPtrs<C::n_outputs> out,
+    const long3 lens)
+{
+    host_pool().parallel_for(lens.z * lens.y, [&](const long row, const int){
+        const long gid_z = row / lens.y;
+        const long gid_y = row % lens.y;
+        for(long gid_x = 0; gid_x < lens.x; gid_x++){
+            read_write_fields<C>(in, out, lens, gid_x, gid_y, gid_z);
+        }
+    });
+}
+
+#endif
@@ -0,0 +1,484 @@
+#ifndef STENCIL_GRAPH
+#define STENCIL_GRAPH
+
+#include <stdio.h>
+#include <vector>
+#include <cuda_runtime.h>
+#include "constants.h"
+#include "threadpool.h"
+#include "cpu-arena.h"
+#include "chain.h"
+
+/*******************************************************************************
+ * Lazy graphs of stencils and pointwise operations on the host.
+ *     StencilGraph g(lens);
+ *     const int a = g.input(A);
+ *     const int b = g.stencil<gauss>(a);
+ *     g.output(g.sub(a, b), out);
+ *     g.evaluate();
+ * Recording a node computes nothing. evaluate() partitions the nodes that
+ * reach an output into fusion groups, walking back from the outputs: a node
+ * whose consumers all lie in one group joins it if computing it over the
+ * region the group reads of it, tile plus the halos below it, costs no more
+ * than writing it to a grid and reading it back (GraphOptions::pass_cost,
+ * in loads per point). Outputs, nodes read by several groups and nodes too
+ * costly to recompute end their group and are written to a grid.
+ *
+ * A group runs as one pass of tiles. Each tile loads the regions it reads of
+ * the grids outside the group, then computes its nodes in order into scratch
+ * buffers of the worker, which are recycled as soon as their last reader in
+ * the group has run; the last node is stored to its grid. The grids between
+ * groups come from the host arena and go back to it after the last group that
+ * reads them, so a graph holds a handful of grids instead of one per node.
+ *
+ * As in chain.h, every buffer holds the values of its node at the positions
+ * clamped to the grid, so the results are bit-identical to evaluating node by
+ * node through full grids.
+ */
+typedef void (*GraphFun)(const T* const*, const ChainRegion*, T*, const ChainRegion, const long3);
+
+template<typename L>
+__host__
+void graph_stencil_region(const T* const* src, const ChainRegion* rs, T* dst, const ChainRegion rd, const long3 lens)
+{
+    if(chain_region_inside(rd, lens)){
+        chain_stage_bounded<L,false>(src[0], rs[0], dst, rd, lens, 0, 1);
+    }
+    else {
+        chain_stage_bounded<L,true>(src[0], rs[0], dst, rd, lens, 0, 1);
+    }
+}
+
+template<typename Op, const bool clamp>
+__host__
+void graph_map_bounded(const T* const* src, const ChainRegion* rs, T* dst, const ChainRegion rd, const long3 lens)
+{
+    const int n = rd.size.x * rd.size.y * rd.size.z;
+    for(int i = 0; i < n; i++){
+        const long z = bound_if<clamp,true,long>(rd.org.z + i / rd.size.x / rd.size.y, lens.z - 1);
+        const long y = bound_if<clamp,true,long>(rd.org.y + i / rd.size.x % rd.size.y, lens.y - 1);
+        const long x = bound_if<clamp,true,long>(rd.org.x + i % rd.size.x, lens.x - 1);
+        T v[Op::arity];
+        for(int k = 0; k < Op::arity; k++){
+            const ChainRegion r = rs[k];
+            v[k] = src[k][((z - r.org.z) * r.size.y + (y - r.org.y)) * r.size.x + (x - r.org.x)];
+        }
+        dst[i] = Op::apply(v);
+    }
+}
+
+template<typename Op>
+__host__
+void graph_map_region(const T* const* src, const ChainRegion* rs, T* dst, const ChainRegion rd, const long3 lens)
+{
+    if(chain_region_inside(rd, lens)){
+        graph_map_bounded<Op,false>(src, rs, dst, rd, lens);
+    }
+    else {
+        graph_map_bounded<Op,true>(src, rs, dst, rd, lens);
+    }
+}
+
+// pointwise operations, applied to the values of their inputs at a point.
+struct GraphAdd {
+    static constexpr int arity = 2;
+    static T apply(const T* v){ return v[0] + v[1]; }
+};
+struct GraphSub {
+    static constexpr int arity = 2;
+    static T apply(const T* v){ return v[0] - v[1]; }
+};
+struct GraphMul {
+    static constexpr int arity = 2;
+    static T apply(const T* v){ return v[0] * v[1]; }
+};
+
+struct GraphOptions {
+    int3 tile;        // zero picks the tiles of the host engines
+    float pass_cost;  // a grid written and read back, in loads per point
+    bool fuse;        // false writes every node to a grid
+    GraphOptions() : tile(make_int3(0, 0, 0)), pass_cost(8), fuse(true) {}
+};
+
+struct GraphStats {
+    int nodes;        // nodes that reach an output
+    int groups;       // passes over the grid
+    int grids;        // grids written between groups
+    int peak_grids;   // of those, the most held at once
+    long scratch;     // scratch elements per worker
+    double computed;  // points computed per point of the computed nodes
+};
+
+class StencilGraph {
+    public :
+        explicit StencilGraph(const long nx) { const long3 l = { nx, 1, 1 }; lens = l; }
+        explicit StencilGraph(const long2 l2) { const long3 l = { l2.x, l2.y, 1 }; lens = l; }
+        explicit StencilGraph(const long3 l3) : lens(l3) {}
+
+        int input(const T* A){
+            Node n = node(0, 0);
+            n.grid = A;
+            return add_node(n);
+        }
+        template<typename L>
+        int stencil(const int a){
+            Node n = node(graph_stencil_region<L>, L::size);
+            n.min = make_int3(L::min_x, L::min_y, L::min_z);
+            n.max = make_int3(L::max_x, L::max_y, L::max_z);
+            n.srcs.push_back(a);
+            return add_node(n);
+        }
+        template<typename Op>
+        int map(const int a){
+            static_assert(Op::arity == 1, "map(a) takes a unary operation");
+            Node n = node(graph_map_region<Op>, Op::arity);
+            n.srcs.push_back(a);
+            return add_node(n);
+        }
+        template<typename Op>
+        int map(const int a, const int b){
+            static_assert(Op::arity == 2, "map(a, b) takes a binary operation");
+            Node n = node(graph_map_region<Op>, Op::arity);
+            n.srcs.push_back(a);
+            n.srcs.push_back(b);
+            return add_node(n);
+        }
+        int add(const int a, const int b){ return map<GraphAdd>(a, b); }
+        int sub(const int a, const int b){ return map<GraphSub>(a, b); }
+        int mul(const int a, const int b){ return map<GraphMul>(a, b); }
+
+        void output(const int a, T* out){
+            if(nodes[a].fun == 0){
+                fprintf(stderr, ">>> an input of the graph cannot be an output\n");
+                exit(1);
+            }
+            nodes[a].out = out;
+        }
+
+        // the fusion groups for opt, without running them.
+        __host__
+        GraphStats plan(const GraphOptions& opt = GraphOptions()){
+            make_plan(opt);
+            return stats;
+        }
+
+        __host__
+        GraphStats evaluate(const GraphOptions& opt = GraphOptions()){
+            make_plan(opt);
+            std::vector<T*> grids(nodes.size(), (T*)0);
+            for(size_t g = 0; g < groups.size(); g++){
+                const Group& group = groups[g];
+                const int root = group.ops.back().node;
+                grids[root] = nodes[root].out ? nodes[root].out : host_arena().acquire(tlen());
+                run_group(group, grids);
+                for(size_t i = 0; i < group.loads.size(); i++){
+                    const int src = group.loads[i].node;
+                    if(last_group[src] == int(g) && nodes[src].fun && !nodes[src].out){
+                        host_arena().release(grids[src]);
+                    }
+                }
+            }
+            return stats;
+        }
+
+    private :
+        struct Node {
+            GraphFun fun;      // 0 for inputs
+            int reads;         // per point computed
+            int3 min, max;
+            std::vector<int> srcs;
+            const T* grid;     // of an input
+            T* out;            // of an output
+        };
+        // a node as a group holds it: the region it takes around the tile,
+        // its scratch slot and, for the computed ones, the items it reads.
+        struct Item {
+            int node;
+            int3 lo, hi;
+            int slot = -1;     // until the slots are handed out
+            std::vector<int> srcs;
+        };
+        struct Group {
+            std::vector<Item> loads;
+            std::vector<Item> ops;  // in order, the stored node last
+            int n_slots;
+            int slot_size;
+        };
+
+        long3 lens;
+        std::vector<Node> nodes;
+        std::vector<Group> groups;
+        std::vector<int> last_group;
+        std::vector<std::vector<T> > scratch;
+        int3 tile;
+        GraphStats stats;
+
+        long tlen() const { return lens.x * lens.y * lens.z; }
+
+        static Node node(GraphFun fun, const int reads){
+            Node n;
+            n.fun = fun;
+            n.reads = reads;
+            n.min = make_int3(0, 0, 0);
+            n.max = make_int3(0, 0, 0);
+            n.grid = 0;
+            n.out = 0;
+            return n;
+        }
+        int add_node(const Node& n){
+            for(size_t i = 0; i < n.srcs.size(); i++){
+                if(n.srcs[i] < 0 || n.srcs[i] >= int(nodes.size())){
+                    fprintf(stderr, ">>> graph node %zu reads unknown node %d\n", nodes.size(), n.srcs[i]);
+                    exit(1);
+                }
+            }
+            nodes.push_back(n);
+            return nodes.size() - 1;
+        }
+
+        long region_volume(const int3 lo, const int3 hi) const {
+            return long(tile.x + hi.x - lo.x) * (tile.y + hi.y - lo.y) * (tile.z + hi.z - lo.z);
+        }
+
+        __host__
+        void make_plan(const GraphOptions& opt){
+            const int n_nodes = nodes.size();
+            tile = opt.tile;
+            if(tile.x <= 0 || tile.y <= 0 || tile.z <= 0){
+                tile = lens.y == 1 && lens.z == 1 ? make_int3(CPU_TILE_1D, 1, 1)
+                     : lens.z == 1 ? make_int3(CPU_TILE_X, CPU_TILE_Y, 1)
+                     : make_int3(CPU_TILE_X, CPU_TILE_Y, CPU_TILE_Z);
+            }
+            tile = make_int3(int(min(long(tile.x), lens.x)), int(min(long(tile.y), lens.y)), int(min(long(tile.z), lens.z)));
+
+            std::vector<std::vector<int> > consumers(n_nodes);
+            for(int n = 0; n < n_nodes; n++){
+                for(size_t i = 0; i < nodes[n].srcs.size(); i++){
+                    consumers[nodes[n].srcs[i]].push_back(n);
+                }
+            }
+
+            // walking back from the outputs, every live node joins the group of
+            // its consumers or starts its own.
+            std::vector<bool> live(n_nodes, false);
+            std::vector<int> group_of(n_nodes, -1);
+            std::vector<int3> lo(n_nodes), hi(n_nodes);
+            std::vector<int> roots;
+            const long tile_volume = long(tile.x) * tile.y * tile.z;
+            for(int n = n_nodes - 1; n >= 0; n--){
+                const Node& nd = nodes[n];
+                int g = -1;
+                bool shared = false;
+                int3 l = make_int3(0, 0, 0), h = make_int3(0, 0, 0);
+                for(size_t i = 0; i < consumers[n].size(); i++){
+                    const int c = consumers[n][i];
+                    if(!live[c]){ continue; }
+                    if(g >= 0 && group_of[c] != g){ shared = true; }
+                    g = group_of[c];
+                    l = make_int3(min(l.x, lo[c].x + nodes[c].min.x), min(l.y, lo[c].y + nodes[c].min.y), min(l.z, lo[c].z + nodes[c].min.z));
+                    h = make_int3(max(h.x, hi[c].x + nodes[c].max.x), max(h.y, hi[c].y + nodes[c].max.y), max(h.z, hi[c].z + nodes[c].max.z));
+                }
+                live[n] = nd.out || g >= 0;
+                if(!live[n] || !nd.fun){ continue; }
+                const double recompute = double(region_volume(l, h)) / tile_volume - 1;
+                if(opt.fuse && !nd.out && !shared && recompute * nd.reads <= opt.pass_cost){
+                    group_of[n] = g;
+                    lo[n] = l;
+                    hi[n] = h;
+                }
+                else {
+                    group_of[n] = roots.size();
+                    lo[n] = make_int3(0, 0, 0);
+                    hi[n] = make_int3(0, 0, 0);
+                    roots.push_back(n);
+                }
+            }
+
+            // the groups in the order of their stored nodes, which reads only
+            // grids stored before.
+            const int n_groups = roots.size();
+            std::vector<int> order(n_groups);
+            for(int g = 0; g < n_groups; g++){ order[g] = n_groups - 1 - g; }
+            groups.assign(n_groups, Group());
+            last_group.assign(n_nodes, -1);
+            stats.nodes = 0;
+            stats.grids = 0;
+            stats.peak_grids = 0;
+            stats.scratch = 0;
+            double points = 0, computed = 0;
+            for(int k = 0; k < n_groups; k++){
+                const int g = order[k];
+                Group& group = groups[k];
+                std::vector<int> item_of(n_nodes, -1);
+                for(int n = 0; n < n_nodes; n++){
+                    if(group_of[n] != g){ continue; }
+                    Item it;
+                    it.node = n;
+                    it.lo = lo[n];
+                    it.hi = hi[n];
+                    for(size_t i = 0; i < nodes[n].srcs.size(); i++){
+                        const int s = nodes[n].srcs[i];
+                        if(group_of[s] == g){
+                            it.srcs.push_back(item_of[s]);
+                            continue;
+                        }
+                        // a grid outside the group, loaded over the union of
+                        // the regions its readers in the group take.
+                        const int3 l = make_int3(lo[n].x + nodes[n].min.x, lo[n].y + nodes[n].min.y, lo[n].z + nodes[n].min.z);
+                        const int3 h = make_int3(hi[n].x + nodes[n].max.x, hi[n].y + nodes[n].max.y, hi[n].z + nodes[n].max.z);
+                        if(item_of[s] < 0){
+                            Item load;
+                            load.node = s;
+                            load.lo = l;
+                            load.hi = h;
+                            item_of[s] = -2 - int(group.loads.size());
+                            group.loads.push_back(load);
+                            last_group[s] = k;
+                        }
+                        else {
+                            Item& load = group.loads[-2 - item_of[s]];
+                            load.lo = make_int3(min(load.lo.x, l.x), min(load.lo.y, l.y), min(load.lo.z, l.z));
+                            load.hi = make_int3(max(load.hi.x, h.x), max(load.hi.y, h.y), max(load.hi.z, h.z));
+                        }
+                        it.srcs.push_back(item_of[s]);
+                    }
+                    item_of[n] = group.ops.size();
+                    group.ops.push_back(it);
+                    points += tlen();
+                    computed += double(tlen()) * region_volume(lo[n], hi[n]) / tile_volume;
+                    stats.nodes++;
+                }
+                assign_slots(group);
+                stats.scratch = max(stats.scratch, long(group.n_slots) * group.slot_size);
+            }
+
+            // the grids written between groups, held from their group to the
+            // last group that loads them.
+            int held = 0;
+            for(int k = 0; k < n_groups; k++){
+                const int root = groups[k].ops.back().node;
+                if(!nodes[root].out){
+                    held++;
+                    stats.grids++;
+                }
+                stats.peak_grids = max(stats.peak_grids, held);
+                for(size_t i = 0; i < groups[k].loads.size(); i++){
+                    const int src = groups[k].loads[i].node;
+                    if(last_group[src] == k && nodes[src].fun && !nodes[src].out){ held--; }
+                }
+            }
+            stats.groups = n_groups;
+            stats.computed = points > 0 ? computed / points : 0;
+        }
+
+        // loads take their slots first; each op takes a free slot and frees
+        // the slots of the items it was the last to read.
+        __host__
+        void assign_slots(Group& group){
+            const int n_loads = group.loads.size();
+            const int n_ops = group.ops.size();
+            std::vector<int> last_read(n_loads + n_ops, -1);
+            for(int k = 0; k < n_ops; k++){
+                const std::vector<int>& srcs = group.ops[k].srcs;
+                for(size_t i = 0; i < srcs.size(); i++){
+                    last_read[srcs[i] >= 0 ? n_loads + srcs[i] : -2 - srcs[i]] = k;
+                }
+            }
+            std::vector<int> free_slots;
+            group.n_slots = 0;
+            group.slot_size = 0;
+            for(int i = 0; i < n_loads; i++){
+                Item& it = group.loads[i];
+                it.slot = group.n_slots++;
+                group.slot_size = max(group.slot_size, int(region_volume(it.lo, it.hi)));
+            }
+            for(int k = 0; k < n_ops; k++){
+                Item& it = group.ops[k];
+                if(free_slots.empty()){
+                    it.slot = group.n_slots++;
+                }
+                else {
+                    it.slot = free_slots.back();
+                    free_slots.pop_back();
+                }
+                group.slot_size = max(group.slot_size, int(region_volume(it.lo, it.hi)));
+                for(size_t i = 0; i < it.srcs.size(); i++){
+                    const int s = it.srcs[i];
+                    const int flat = s >= 0 ? n_loads + s : -2 - s;
+                    if(last_read[flat] == k){
+                        free_slots.push_back(s >= 0 ? group.ops[s].slot : group.loads[-2 - s].slot);
+                        last_read[flat] = -1;
+                    }
+                }
+            }
+        }
+
+        __host__
+        void run_group(const Group& group, const std::vector<T*>& grids){
+            ThreadPool& pool = host_pool();
+            if(int(scratch.size()) < pool.size()){ scratch.resize(pool.size()); }
+            const long3 tile_grid = {
+                divUp(lens.x, long(tile.x)),
+                divUp(lens.y, long(tile.y)),
+                divUp(lens.z, long(tile.z))};
+            pool.parallel_for(tile_grid.x * tile_grid.y * tile_grid.z, [&](const long tile_id, const int worker){
+                std::vector<T>& buffers = scratch[worker];
+                const size_t need = size_t(group.n_slots) * group.slot_size;
+                if(buffers.size() < need){ buffers.resize(need); }
+                const long3 org = {
+                    tile_id % tile_grid.x * tile.x,
+                    tile_id / tile_grid.x % tile_grid.y * tile.y,
+                    tile_id / tile_grid.x / tile_grid.y * tile.z };
+                const int3 size = {
+                    int(min(org.x + tile.x, lens.x) - org.x),
+                    int(min(org.y + tile.y, lens.y) - org.y),
+                    int(min(org.z + tile.z, lens.z) - org.z) };
+                for(size_t i = 0; i < group.loads.size(); i++){
+                    const Item& it = group.loads[i];
+                    const int node = it.node;
+                    const T* A = nodes[node].fun ? grids[node] : nodes[node].grid;
+                    const ChainRegion r = item_region(it, org, size);
+                    T* dst = buffers.data() + size_t(it.slot) * group.slot_size;
+                    if(chain_region_inside(r, lens)){
+                        chain_load_bounded<false>(A, dst, r, lens, 0, 1);
+                    }
+                    else {
+                        chain_load_bounded<true>(A, dst, r, lens, 0, 1);
+                    }
+                }
+                const T* src[8];
+                ChainRegion rs[8];
+                for(size_t k = 0; k < group.ops.size(); k++){
+                    const Item& it = group.ops[k];
+                    for(size_t i = 0; i < it.srcs.size(); i++){
+                        const int s = it.srcs[i];
+                        const Item& from = s >= 0 ? group.ops[s] : group.loads[-2 - s];
+                        src[i] = buffers.data() + size_t(from.slot) * group.slot_size;
+                        rs[i] = item_region(from, org, size);
+                    }
+                    nodes[it.node].fun(src, rs, buffers.data() + size_t(it.slot) * group.slot_size
+                        , item_region(it, org, size), lens);
+                }
+                // the stored node covers the tile exactly.
+                const Item& last = group.ops.back();
+                const T* res = buffers.data() + size_t(last.slot) * group.slot_size;
+                T* out = grids[last.node];
+                for(int z = 0; z < size.z; z++){
+                    for(int y = 0; y < size.y; y++){
+                        const T* row = res + (z * size.y + y) * size.x;
+                        T* dst = out + ((org.z + z) * lens.y + org.y + y) * lens.x + org.x;
+                        for(int x = 0; x < size.x; x++){ dst[x] = row[x]; }
+                    }
+                }
+            });
+        }
+
+        static ChainRegion item_region(const Item& it, const long3 org, const int3 size){
+            const ChainRegion r = {
+                { org.x + it.lo.x, org.y + it.lo.y, org.z + it.lo.z },
+                { size.x + it.hi.x - it.lo.x, size.y + it.hi.y - it.lo.y, size.z + it.hi.z - it.lo.z } };
+            return r;
+        }
+};
+
+#endif
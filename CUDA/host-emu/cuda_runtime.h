@@ -0,0 +1,381 @@
+#ifndef CUDA_HOST_EMULATION
+#define CUDA_HOST_EMULATION
+
+/*******************************************************************************
+ * Host emulation of the part of the CUDA runtime the prototypes use, for
+ * machines without a GPU. It is picked up instead of the real <cuda_runtime.h>
+ * by the emu targets of the Makefile:
+ *     g++ -x c++ -DHOST_EMULATION -Ihost-emu -I. stencil-2d.cu
+ * With LAUNCH and EXTERN_SHARED from constants.h, kernels-*.h, runners.h and
+ * the drivers then compile and validate unchanged.
+ *
+ * The blocks of a launch are spread over the host pool. Inside a block every
+ * cuda thread is a fiber with its own stack. __syncthreads() switches back to
+ * the block scheduler, which runs all fibers of the block up to their next
+ * barrier before resuming any of them. Shared memory is thread_local storage
+ * of the host worker that runs the block.
+ *
+ * Built with COUNT_TRAFFIC the global and shared memory accesses are counted
+ * as well (traffic.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <cmath>
+#include <vector>
+#include <functional>
+#include "../threadpool.h"
+
+#define __global__
+#define __device__
+#define __host__
+#define __constant__
+#define __forceinline__ inline
+#define __launch_bounds__(...)
+// aligned like shared memory on a gpu, so that an address gives the bank.
+#define __shared__ alignas(128) thread_local
+
+// limits of the emulated device. A block gets EMU_MAX_SHARED_BYTES of static
+// shared storage per array, of which a launch may ask for EMU_MAX_DYNAMIC_SHARED
+// bytes of dynamic shared memory, as on the gpus the kernels were written for.
+#define EMU_MAX_BLOCK_THREADS 1024
+#define EMU_MAX_SHARED_BYTES 0x18000
+#define EMU_MAX_DYNAMIC_SHARED 0xc000
+#define EMU_FIBER_STACK_BYTES (64*1024)
+
+struct int2  { int x, y; };
+struct int3  { int x, y, z; };
+struct long2 { long x, y; };
+struct long3 { long x, y, z; };
+struct uint3 { unsigned x, y, z; };
+static inline int3 make_int3(const int x, const int y, const int z){ const int3 v = { x, y, z }; return v; }
+struct dim3 {
+    unsigned x, y, z;
+    constexpr dim3(const unsigned vx = 1, const unsigned vy = 1, const unsigned vz = 1)
+        : x(vx), y(vy), z(vz) {}
+};
+
+#define EMU_MIN_MAX(L) \
+    static inline L min(const L a, const L b){ return a < b ? a : b; } \
+    static inline L max(const L a, const L b){ return a < b ? b : a; }
+EMU_MIN_MAX(int)
+EMU_MIN_MAX(long)
+EMU_MIN_MAX(unsigned)
+EMU_MIN_MAX(unsigned long)
+EMU_MIN_MAX(float)
+EMU_MIN_MAX(double)
+#undef EMU_MIN_MAX
+
+static thread_local uint3 threadIdx;
+static thread_local uint3 blockIdx;
+static thread_local dim3 blockDim;
+static thread_local dim3 gridDim;
+
+#ifdef COUNT_TRAFFIC
+#include "traffic.h"
+#else
+#define EMU_UNCOUNTED
+namespace emu {
+static inline void traffic_add_global(const void*, const size_t){}
+static inline void traffic_remove_global(const void*){}
+static inline void traffic_enter_block(const void*, const size_t){}
+static inline void traffic_leave_block(){}
+static inline void traffic_lane(const int){}
+static inline void traffic_round(const int){}
+}
+#endif
+
+/*******************************************************************************
+ * Fibers
+ */
+#if defined(__x86_64__)
+// saves the callee-saved registers on the current stack, stores the stack
+// pointer in *from and continues on the stack `to` (made by the same routine).
+extern "C" void emu_ctx_switch(void** from, void* to);
+asm(
+    ".text\n"
+    ".weak emu_ctx_switch\n"
+    ".hidden emu_ctx_switch\n"
+    ".type emu_ctx_switch,@function\n"
+    "emu_ctx_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size emu_ctx_switch,.-emu_ctx_switch\n");
+#else
+#include <ucontext.h>
+#endif
+
+namespace emu {
+
+class BlockRunner {
+    public :
+        BlockRunner(void) : body(nullptr), current(0) {
+            const size_t bytes = size_t(EMU_MAX_BLOCK_THREADS) * EMU_FIBER_STACK_BYTES;
+            stacks = (char*)mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if(stacks == MAP_FAILED){
+                fprintf(stderr, ">>> host emulation: could not map fiber stacks\n");
+                exit(1);
+            }
+            fibers.resize(EMU_MAX_BLOCK_THREADS);
+            finished.resize(EMU_MAX_BLOCK_THREADS);
+        }
+        ~BlockRunner(void){
+            munmap(stacks, size_t(EMU_MAX_BLOCK_THREADS) * EMU_FIBER_STACK_BYTES);
+        }
+
+        EMU_UNCOUNTED
+        static BlockRunner& get(){
+            static thread_local BlockRunner runner;
+            return runner;
+        }
+
+        EMU_UNCOUNTED
+        void run_block(
+                const std::function<void()>& kernel_body
+                , const dim3 grid
+                , const dim3 block
+                , const long block_flat)
+        {
+            const int n_threads = int(block.x * block.y * block.z);
+            body = &kernel_body;
+            traffic_enter_block(this, sizeof(*this));
+            gridDim = grid;
+            blockDim = block;
+            blockIdx.x = unsigned(block_flat % grid.x);
+            blockIdx.y = unsigned((block_flat / grid.x) % grid.y);
+            blockIdx.z = unsigned(block_flat / (long(grid.x) * grid.y));
+            for(int t = 0; t < n_threads; t++){
+                init_fiber(t);
+                finished[t] = 0;
+            }
+            int live = n_threads;
+            while(live > 0){
+                // one round runs every live fiber up to its next barrier.
+                for(int t = 0; t < n_threads; t++){
+                    if(finished[t]){ continue; }
+                    current = t;
+                    threadIdx.x = unsigned(t % block.x);
+                    threadIdx.y = unsigned((t / block.x) % block.y);
+                    threadIdx.z = unsigned(t / (block.x * block.y));
+                    traffic_lane(t);
+                    switch_to_fiber(t);
+                    if(finished[t]){ live--; }
+                }
+                traffic_round(n_threads);
+            }
+            traffic_leave_block();
+            body = nullptr;
+        }
+
+        EMU_UNCOUNTED
+        void sync_threads(){ switch_to_scheduler(); }
+
+    private :
+        char* stacks;
+        const std::function<void()>* body;
+        int current;
+        std::vector<char> finished;
+#if defined(__x86_64__)
+        std::vector<void*> fibers;
+        void* scheduler;
+
+        void init_fiber(const int t){
+            char* top = stacks + size_t(t + 1) * EMU_FIBER_STACK_BYTES;
+            void** sp = (void**)top - 8;
+            for(int i = 0; i < 8; i++){ sp[i] = nullptr; }
+            sp[6] = (void*)&fiber_entry; // popped by the ret of emu_ctx_switch
+            fibers[t] = (void*)sp;
+        }
+        void switch_to_fiber(const int t){ emu_ctx_switch(&scheduler, fibers[t]); }
+        void switch_to_scheduler(){ emu_ctx_switch(&fibers[current], scheduler); }
+#else
+        std::vector<ucontext_t> fibers;
+        ucontext_t scheduler;
+
+        void init_fiber(const int t){
+            getcontext(&fibers[t]);
+            fibers[t].uc_stack.ss_sp = stacks + size_t(t) * EMU_FIBER_STACK_BYTES;
+            fibers[t].uc_stack.ss_size = EMU_FIBER_STACK_BYTES;
+            fibers[t].uc_link = nullptr;
+            makecontext(&fibers[t], &fiber_entry, 0);
+        }
+        void switch_to_fiber(const int t){ swapcontext(&scheduler, &fibers[t]); }
+        void switch_to_scheduler(){ swapcontext(&fibers[current], &scheduler); }
+#endif
+
+        EMU_UNCOUNTED
+        static void fiber_entry(){
+            BlockRunner& runner = get();
+            (*runner.body)();
+            runner.finished[runner.current] = 1;
+            runner.switch_to_scheduler();
+            __builtin_unreachable();
+        }
+};
+
+/*******************************************************************************
+ * Runtime state and launches
+ */
+static int& last_error(){
+    static int err = 0;
+    return err;
+}
+
+static void run_grid(
+        const std::function<void()>& kernel_body
+        , const dim3 grid
+        , const dim3 block
+        , const size_t sh_size_bytes)
+{
+    const long block_threads = long(block.x) * block.y * block.z;
+    const long grid_flat = long(grid.x) * grid.y * grid.z;
+    if(block_threads < 1 || block_threads > EMU_MAX_BLOCK_THREADS || grid_flat < 1){
+        last_error() = 9; // cudaErrorInvalidConfiguration
+        return;
+    }
+    if(sh_size_bytes > EMU_MAX_DYNAMIC_SHARED){
+        last_error() = 1; // cudaErrorInvalidValue
+        return;
+    }
+    host_pool().parallel_for(grid_flat, [&](const long block_flat, const int){
+        BlockRunner::get().run_block(kernel_body, grid, block, block_flat);
+    });
+}
+
+template<typename... P>
+class Launch {
+    public :
+        Launch(void (*kernel)(P...), const dim3 g, const dim3 b, const size_t sh)
+            : k(kernel), grid(g), block(b), sh_size_bytes(sh) {}
+
+        template<typename... A>
+        void operator()(A... args) const {
+            void (*kernel)(P...) = k;
+            const std::function<void()> body = [=]{ kernel(args...); };
+            run_grid(body, grid, block, sh_size_bytes);
+        }
+    private :
+        void (*k)(P...);
+        const dim3 grid;
+        const dim3 block;
+        const size_t sh_size_bytes;
+};
+
+template<typename... P>
+Launch<P...> launch(void (*kernel)(P...), const dim3 grid, const dim3 block, const size_t sh_size_bytes = 0){
+    return Launch<P...>(kernel, grid, block, sh_size_bytes);
+}
+
+} // namespace emu
+
+EMU_UNCOUNTED
+static inline void __syncthreads(){ emu::BlockRunner::get().sync_threads(); }
+
+/*******************************************************************************
+ * Runtime api stand-ins. Device memory is host memory, so every copy is a
+ * memcpy and launches are synchronous.
+ */
+enum cudaError_t {
+    cudaSuccess = 0,
+    cudaErrorInvalidValue = 1,
+    cudaErrorMemoryAllocation = 2,
+    cudaErrorInvalidConfiguration = 9
+};
+typedef enum cudaError_t cudaError;
+
+enum cudaMemcpyKind {
+    cudaMemcpyHostToHost = 0,
+    cudaMemcpyHostToDevice = 1,
+    cudaMemcpyDeviceToHost = 2,
+    cudaMemcpyDeviceToDevice = 3,
+    cudaMemcpyDefault = 4
+};
+
+struct cudaDeviceProp {
+    char name[256];
+    size_t totalGlobalMem;
+    size_t sharedMemPerBlock;
+    size_t sharedMemPerMultiprocessor;
+    int maxThreadsPerBlock;
+    int maxThreadsPerMultiProcessor;
+    int multiProcessorCount;
+    int warpSize;
+};
+
+static inline const char* cudaGetErrorString(const cudaError_t err){
+    switch(err){
+        case cudaSuccess: return "no error";
+        case cudaErrorInvalidValue: return "invalid argument";
+        case cudaErrorMemoryAllocation: return "out of memory";
+        case cudaErrorInvalidConfiguration: return "invalid configuration argument";
+    }
+    return "unknown error";
+}
+
+static inline cudaError_t cudaGetLastError(void){
+    const int err = emu::last_error();
+    emu::last_error() = 0;
+    return cudaError_t(err);
+}
+static inline cudaError_t cudaPeekAtLastError(void){ return cudaError_t(emu::last_error()); }
+static inline cudaError_t cudaDeviceSynchronize(void){ return cudaSuccess; }
+
+// aligned like cudaMalloc, so that the sectors of a warp load are those of a gpu.
+static inline cudaError_t cudaMalloc(void** ptr, const size_t size){
+    if(posix_memalign(ptr, 256, size == 0 ? 1 : size) != 0){ *ptr = nullptr; }
+    if(*ptr){ emu::traffic_add_global(*ptr, size); }
+    return *ptr ? cudaSuccess : cudaErrorMemoryAllocation;
+}
+static inline cudaError_t cudaFree(void* ptr){
+    emu::traffic_remove_global(ptr);
+    free(ptr);
+    return cudaSuccess;
+}
+static inline cudaError_t cudaMemcpy(void* dst, const void* src, const size_t count, const cudaMemcpyKind){
+    memmove(dst, src, count);
+    return cudaSuccess;
+}
+static inline cudaError_t cudaMemset(void* ptr, const int value, const size_t count){
+    memset(ptr, value, count);
+    return cudaSuccess;
+}
+template<typename S>
+cudaError_t cudaMemcpyToSymbol(
+        S& symbol, const void* src, const size_t count
+        , const size_t offset = 0, const cudaMemcpyKind = cudaMemcpyHostToDevice){
+    if(offset + count > sizeof(S)){ return cudaErrorInvalidValue; }
+    memcpy((char*)&symbol + offset, src, count);
+    return cudaSuccess;
+}
+
+// one emulated multiprocessor per host worker.
+static inline cudaError_t cudaGetDeviceProperties(cudaDeviceProp* prop, const int){
+    memset(prop, 0, sizeof(cudaDeviceProp));
+    snprintf(prop->name, sizeof(prop->name), "host emulation (%d workers)", host_pool().size());
+    prop->totalGlobalMem = size_t(1) << 34;
+    prop->sharedMemPerBlock = EMU_MAX_DYNAMIC_SHARED;
+    prop->sharedMemPerMultiprocessor = EMU_MAX_SHARED_BYTES;
+    prop->maxThreadsPerBlock = EMU_MAX_BLOCK_THREADS;
+    prop->maxThreadsPerMultiProcessor = 2*EMU_MAX_BLOCK_THREADS;
+    prop->multiProcessorCount = host_pool().size();
+    prop->warpSize = 32;
+    return cudaSuccess;
+}
+
+#endif
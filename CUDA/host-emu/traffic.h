@@ -0,0 +1,468 @@
+#ifndef CUDA_HOST_EMULATION_TRAFFIC
+#define CUDA_HOST_EMULATION_TRAFFIC
+
+/*******************************************************************************
+ * Memory traffic accounting for the host emulation, built by the traffic
+ * targets of the Makefile:
+ *     g++ ... -DHOST_EMULATION -DCOUNT_TRAFFIC -fsanitize=kernel-address ...
+ * With the kernel address sanitizer the compiler calls __asan_loadN_noabort or
+ * __asan_storeN_noabort before every access to memory it can not prove local.
+ * The hooks below do no checking, they classify the address:
+ *  - global: inside a cudaMalloc buffer or a host grid of the arena.
+ *  - shared: inside the static thread local storage of the worker while it
+ *    runs a block, which is where EXTERN_SHARED and __shared__ arrays live.
+ *    The builtin index variables are left out, on a gpu they are registers,
+ *    and so is the block runner.
+ * Copies through memcpy count as reads of the source and writes of the
+ * destination. Anything else (fiber stacks, the emulator itself) is not
+ * counted, nor are accesses the compiler proves in bounds, like tile[0].
+ * Accesses are counted as issued, before any cache, so global reads of a tile
+ * that neighbouring threads share count once per thread.
+ *
+ * The shared range is the static TLS block of the executable, which the x86-64
+ * ABI puts right below the thread pointer.
+ *
+ * The global loads of a block are also replayed per warp of 32 lanes, to see
+ * how well they coalesce. A round of the block scheduler runs every lane up to
+ * its next barrier, and the n-th execution of a load instruction by each lane
+ * of a warp in that round is taken as one request of the warp. The instruction
+ * is the return address of the hook. That is exact for loaders whose lanes run
+ * the same loop, where bound checks at most drop the lanes of a trip.
+ * A request costs the distinct 32 byte sectors and 128 byte lines its lanes
+ * touch. Sector efficiency is the bytes the lanes asked for over the bytes of
+ * the sectors moved.
+ *
+ * Shared accesses are replayed the same way for bank conflicts, a request
+ * takes as many wavefronts as the most distinct 4 byte words it asks of a
+ * single one of the 32 banks. Lanes reading the same word are a broadcast and
+ * cost nothing more. Emulated shared arrays are aligned to 128 bytes, so their
+ * banks are those of a gpu.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <link.h>
+#include <sys/mman.h>
+
+#define EMU_UNCOUNTED __attribute__((no_sanitize_address))
+// at most this many threads and global buffers are tracked.
+#define EMU_TRAFFIC_THREADS 1024
+#define EMU_TRAFFIC_RANGES 64
+// global loads and shared accesses of a lane per round that are replayed,
+// further ones are not.
+#define EMU_REPLAY_LOADS 256
+#define EMU_WARP_LANES 32
+#define EMU_SECTOR_BYTES 32
+#define EMU_LINE_BYTES 128
+#define EMU_SHARED_BANKS 32
+#define EMU_BANK_BYTES 4
+
+namespace emu {
+
+// bytes moved, replayed warp loads and replayed shared accesses, summed over
+// all workers. The shared ones are indexed by is_write, and the worst case is
+// a maximum instead of a sum.
+struct alignas(64) TrafficCounts {
+    long global_read, global_write;
+    long shared_read, shared_write;
+    long requests, sectors, lines, requested;
+    long bank_requests[2], wavefronts[2], worst_wavefronts[2];
+};
+
+// a global load or a shared access of a lane, by the instruction at pc.
+struct LaneAccess {
+    const char* addr;
+    const void* pc;
+    int bytes;
+    bool is_write;
+};
+
+// an access of a warp replay, with the executions of its instruction by the
+// lane before it.
+struct WarpAccess {
+    const void* pc;
+    int nth;
+    const LaneAccess* access;
+};
+
+struct TrafficThread {
+    TrafficCounts* counts;
+    const char* tls_lo;
+    const char* tls_hi;
+    bool in_block;
+    // the block runner, which is thread local as well.
+    const char* runner_lo;
+    const char* runner_hi;
+    // the global loads and shared accesses of each lane of the block in the
+    // current round.
+    int lane;
+    int* n_loads;
+    LaneAccess* loads;
+    int* n_shared;
+    LaneAccess* shared;
+    WarpAccess* replay;
+};
+
+struct TrafficState {
+    volatile int enabled;
+    int n_threads;
+    int n_ranges;
+    long tls_bytes;
+    const char* range_lo[EMU_TRAFFIC_RANGES];
+    const char* range_hi[EMU_TRAFFIC_RANGES];
+    TrafficCounts counts[EMU_TRAFFIC_THREADS];
+    // the last finished measurement.
+    TrafficCounts total;
+    long outputs;
+    long elem_bytes;
+};
+
+static TrafficState traffic_state;
+static thread_local TrafficThread traffic_thread;
+
+static int tls_size_of_main(struct dl_phdr_info* info, size_t, void* bytes){
+    for(int i = 0; i < info->dlpi_phnum; i++){
+        const ElfW(Phdr)& ph = info->dlpi_phdr[i];
+        if(ph.p_type == PT_TLS){
+            const long align = ph.p_align ? long(ph.p_align) : 1L;
+            *(long*)bytes = (long(ph.p_memsz) + align - 1) / align * align;
+        }
+    }
+    return 1; // the executable comes first
+}
+
+EMU_UNCOUNTED
+static void traffic_add_global(const void* p, const size_t bytes){
+    TrafficState& s = traffic_state;
+    if(s.n_ranges == EMU_TRAFFIC_RANGES){
+        fprintf(stderr, ">>> traffic accounting: more than %d global buffers\n", EMU_TRAFFIC_RANGES);
+        exit(1);
+    }
+    s.range_lo[s.n_ranges] = (const char*)p;
+    s.range_hi[s.n_ranges] = (const char*)p + bytes;
+    s.n_ranges++;
+}
+
+EMU_UNCOUNTED
+static void traffic_remove_global(const void* p){
+    TrafficState& s = traffic_state;
+    for(int i = 0; i < s.n_ranges; i++){
+        if(s.range_lo[i] == (const char*)p){
+            s.n_ranges--;
+            s.range_lo[i] = s.range_lo[s.n_ranges];
+            s.range_hi[i] = s.range_hi[s.n_ranges];
+            return;
+        }
+    }
+}
+
+// room for EMU_REPLAY_LOADS accesses of every lane of a block, paged in as used.
+EMU_UNCOUNTED
+static LaneAccess* map_lane_log(){
+    const size_t log_bytes = sizeof(LaneAccess) * EMU_MAX_BLOCK_THREADS * EMU_REPLAY_LOADS;
+    void* log = mmap(NULL, log_bytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(log == MAP_FAILED){
+        fprintf(stderr, ">>> traffic accounting: could not map the access log\n");
+        exit(1);
+    }
+    return (LaneAccess*)log;
+}
+
+EMU_UNCOUNTED
+static void traffic_enter_block(const void* runner, const size_t bytes){
+    TrafficThread& t = traffic_thread;
+    t.in_block = true;
+    t.runner_lo = (const char*)runner;
+    t.runner_hi = (const char*)runner + bytes;
+    if(t.loads == nullptr){
+        t.loads = map_lane_log();
+        t.n_loads = (int*)calloc(EMU_MAX_BLOCK_THREADS, sizeof(int));
+        t.shared = map_lane_log();
+        t.n_shared = (int*)calloc(EMU_MAX_BLOCK_THREADS, sizeof(int));
+        t.replay = (WarpAccess*)malloc(sizeof(WarpAccess) * EMU_WARP_LANES * EMU_REPLAY_LOADS);
+        if(t.replay == nullptr || t.n_loads == nullptr || t.n_shared == nullptr){
+            fprintf(stderr, ">>> traffic accounting: could not map the access log\n");
+            exit(1);
+        }
+    }
+}
+
+EMU_UNCOUNTED
+static void traffic_lane(const int lane){ traffic_thread.lane = lane; }
+
+// the distinct values of v[0, n), which it sorts.
+EMU_UNCOUNTED
+static long count_distinct(long* v, const int n){
+    for(int i = 1; i < n; i++){
+        const long x = v[i];
+        int j = i;
+        for(; j > 0 && v[j - 1] > x; j--){ v[j] = v[j - 1]; }
+        v[j] = x;
+    }
+    long distinct = 0;
+    for(int i = 0; i < n; i++){
+        if(i == 0 || v[i] != v[i - 1]){ distinct++; }
+    }
+    return distinct;
+}
+
+EMU_UNCOUNTED
+static int by_instruction(const void* a, const void* b){
+    const WarpAccess& x = *(const WarpAccess*)a;
+    const WarpAccess& y = *(const WarpAccess*)b;
+    if(x.pc != y.pc){ return x.pc < y.pc ? -1 : 1; }
+    return x.nth - y.nth;
+}
+
+// groups the logged accesses of the lanes [warp_start, warp_end) into warp
+// requests and calls cost(first, n) with the n accesses of each.
+template<typename Cost>
+EMU_UNCOUNTED
+static void replay_warp(
+    const LaneAccess* log, const int* n_log,
+    const int warp_start, const int warp_end, Cost cost)
+{
+    WarpAccess* replay = traffic_thread.replay;
+    int n = 0;
+    for(int l = warp_start; l < warp_end; l++){
+        const LaneAccess* lane = log + long(l)*EMU_REPLAY_LOADS;
+        for(int k = 0; k < n_log[l]; k++){
+            int nth = 0;
+            for(int j = 0; j < k; j++){ nth += lane[j].pc == lane[k].pc; }
+            replay[n].pc = lane[k].pc;
+            replay[n].nth = nth;
+            replay[n].access = &lane[k];
+            n++;
+        }
+    }
+    qsort(replay, n, sizeof(WarpAccess), &by_instruction);
+    for(int i = 0; i < n; ){
+        int j = i + 1;
+        while(j < n && by_instruction(&replay[i], &replay[j]) == 0){ j++; }
+        cost(replay + i, j - i);
+        i = j;
+    }
+}
+
+// the sectors and lines of a warp load.
+EMU_UNCOUNTED
+static void cost_load(const WarpAccess* request, const int n_lanes){
+    TrafficCounts& c = *traffic_thread.counts;
+    // wider accesses are counted by their first four sectors.
+    long sectors[4*EMU_WARP_LANES];
+    long lines[4*EMU_WARP_LANES];
+    int n = 0;
+    long requested = 0;
+    for(int i = 0; i < n_lanes; i++){
+        const LaneAccess& ld = *request[i].access;
+        const long first = long(ld.addr) / EMU_SECTOR_BYTES;
+        const long last = min(first + 3, (long(ld.addr) + ld.bytes - 1) / EMU_SECTOR_BYTES);
+        for(long sec = first; sec <= last; sec++){
+            sectors[n] = sec;
+            lines[n] = sec / (EMU_LINE_BYTES / EMU_SECTOR_BYTES);
+            n++;
+        }
+        requested += ld.bytes;
+    }
+    c.requests++;
+    c.sectors += count_distinct(sectors, n);
+    c.lines += count_distinct(lines, n);
+    c.requested += requested;
+}
+
+// the wavefronts of a warp access to shared memory.
+EMU_UNCOUNTED
+static void cost_banks(const WarpAccess* request, const int n_lanes){
+    TrafficCounts& c = *traffic_thread.counts;
+    // wider accesses are counted by their first four words.
+    long words[4*EMU_WARP_LANES];
+    int n = 0;
+    for(int i = 0; i < n_lanes; i++){
+        const LaneAccess& acc = *request[i].access;
+        const long first = long(acc.addr) / EMU_BANK_BYTES;
+        const long last = min(first + 3, (long(acc.addr) + acc.bytes - 1) / EMU_BANK_BYTES);
+        for(long w = first; w <= last; w++){ words[n++] = w; }
+    }
+    count_distinct(words, n);
+    int per_bank[EMU_SHARED_BANKS] = {0};
+    long wavefronts = 1;
+    for(int i = 0; i < n; i++){
+        if(i > 0 && words[i] == words[i - 1]){ continue; }
+        const int bank = int(words[i] % EMU_SHARED_BANKS);
+        wavefronts = max(wavefronts, long(++per_bank[bank]));
+    }
+    const int w = request[0].access->is_write;
+    c.bank_requests[w]++;
+    c.wavefronts[w] += wavefronts;
+    c.worst_wavefronts[w] = max(c.worst_wavefronts[w], wavefronts);
+}
+
+// replays the logged accesses of the n_lanes lanes of the block as warp
+// requests.
+EMU_UNCOUNTED
+static void traffic_round(const int n_lanes){
+    TrafficThread& t = traffic_thread;
+    if(!traffic_state.enabled || t.counts == nullptr || t.loads == nullptr){ return; }
+    for(int warp_start = 0; warp_start < n_lanes; warp_start += EMU_WARP_LANES){
+        const int warp_end = min(n_lanes, warp_start + EMU_WARP_LANES);
+        replay_warp(t.loads, t.n_loads, warp_start, warp_end, &cost_load);
+        replay_warp(t.shared, t.n_shared, warp_start, warp_end, &cost_banks);
+    }
+    for(int l = 0; l < n_lanes; l++){
+        t.n_loads[l] = 0;
+        t.n_shared[l] = 0;
+    }
+}
+
+EMU_UNCOUNTED
+static void traffic_leave_block(){ traffic_thread.in_block = false; }
+
+EMU_UNCOUNTED
+static void traffic_begin(){
+    TrafficState& s = traffic_state;
+    if(s.tls_bytes == 0){ dl_iterate_phdr(&tls_size_of_main, &s.tls_bytes); }
+    memset(s.counts, 0, sizeof(s.counts));
+    asm volatile("" ::: "memory");
+    s.enabled = 1;
+}
+
+// stops counting and keeps the sums for traffic_report.
+EMU_UNCOUNTED
+static void traffic_end(const long outputs, const long elem_bytes){
+    TrafficState& s = traffic_state;
+    s.enabled = 0;
+    // the hooks are builtins to the compiler, which takes them to leave our
+    // variables alone.
+    asm volatile("" ::: "memory");
+    memset(&s.total, 0, sizeof(s.total));
+    for(int i = 0; i < EMU_TRAFFIC_THREADS; i++){
+        s.total.global_read += s.counts[i].global_read;
+        s.total.global_write += s.counts[i].global_write;
+        s.total.shared_read += s.counts[i].shared_read;
+        s.total.shared_write += s.counts[i].shared_write;
+        s.total.requests += s.counts[i].requests;
+        s.total.sectors += s.counts[i].sectors;
+        s.total.lines += s.counts[i].lines;
+        s.total.requested += s.counts[i].requested;
+        for(int w = 0; w < 2; w++){
+            s.total.bank_requests[w] += s.counts[i].bank_requests[w];
+            s.total.wavefronts[w] += s.counts[i].wavefronts[w];
+            s.total.worst_wavefronts[w] = max(s.total.worst_wavefronts[w], s.counts[i].worst_wavefronts[w]);
+        }
+    }
+    s.outputs = outputs;
+    s.elem_bytes = elem_bytes;
+}
+
+// prints the last measurement per output element and forgets it.
+EMU_UNCOUNTED
+static void traffic_report(){
+    TrafficState& s = traffic_state;
+    if(s.outputs <= 0){ return; }
+    const double per = double(s.outputs) * s.elem_bytes;
+    const double g_read = s.total.global_read / per;
+    const double g_write = s.total.global_write / per;
+    printf("   traffic per output: global %.2f reads %.2f writes - shared %.2f reads %.2f writes"
+           " - %.2f redundant halo loads - %.1f global B/output\n"
+           , g_read, g_write
+           , s.total.shared_read / per, s.total.shared_write / per
+           , g_read > 1 ? g_read - 1 : 0.0
+           , (s.total.global_read + s.total.global_write) / double(s.outputs));
+    if(s.total.requests > 0){
+        const double requests = double(s.total.requests);
+        printf("   coalescing per warp load: %.2f 32B sectors %.2f 128B lines - %.1f%% sector efficiency"
+               " - %ld requests\n"
+               , s.total.sectors / requests, s.total.lines / requests
+               , 100.0 * s.total.requested / (double(s.total.sectors) * EMU_SECTOR_BYTES)
+               , s.total.requests);
+    }
+    const TrafficCounts& c = s.total;
+    if(c.bank_requests[0] + c.bank_requests[1] > 0){
+        printf("   shared wavefronts per warp access: reads %.2f avg %ld worst - writes %.2f avg %ld worst\n"
+               , c.bank_requests[0] ? c.wavefronts[0] / double(c.bank_requests[0]) : 0.0, c.worst_wavefronts[0]
+               , c.bank_requests[1] ? c.wavefronts[1] / double(c.bank_requests[1]) : 0.0, c.worst_wavefronts[1]);
+    }
+    s.outputs = 0;
+}
+
+// the counts of the last finished measurement.
+EMU_UNCOUNTED
+static const TrafficCounts& traffic_last(){ return traffic_state.total; }
+
+EMU_UNCOUNTED
+inline
+void traffic_count(const void* p, const long bytes, const bool is_write, const void* pc){
+    TrafficState& s = traffic_state;
+    if(!s.enabled){ return; }
+    TrafficThread& t = traffic_thread;
+    if(t.counts == nullptr){
+        const int slot = __atomic_fetch_add(&s.n_threads, 1, __ATOMIC_RELAXED);
+        if(slot >= EMU_TRAFFIC_THREADS){
+            fprintf(stderr, ">>> traffic accounting: more than %d threads\n", EMU_TRAFFIC_THREADS);
+            exit(1);
+        }
+        t.counts = &s.counts[slot];
+        t.tls_hi = (const char*)__builtin_thread_pointer();
+        t.tls_lo = t.tls_hi - s.tls_bytes;
+    }
+    const char* a = (const char*)p;
+    for(int i = 0; i < s.n_ranges; i++){
+        if(s.range_lo[i] <= a && a < s.range_hi[i]){
+            (is_write ? t.counts->global_write : t.counts->global_read) += bytes;
+            if(t.in_block && !is_write && t.n_loads[t.lane] < EMU_REPLAY_LOADS){
+                LaneAccess& ld = t.loads[long(t.lane)*EMU_REPLAY_LOADS + t.n_loads[t.lane]++];
+                ld.addr = a;
+                ld.pc = pc;
+                ld.bytes = int(bytes);
+                ld.is_write = false;
+            }
+            return;
+        }
+    }
+    if(t.in_block && t.tls_lo <= a && a < t.tls_hi){
+        const bool builtin =
+               (a >= (const char*)&threadIdx && a < (const char*)(&threadIdx + 1))
+            || (a >= (const char*)&blockIdx && a < (const char*)(&blockIdx + 1))
+            || (a >= (const char*)&blockDim && a < (const char*)(&blockDim + 1))
+            || (a >= (const char*)&gridDim && a < (const char*)(&gridDim + 1))
+            || (a >= t.runner_lo && a < t.runner_hi);
+        if(!builtin){
+            (is_write ? t.counts->shared_write : t.counts->shared_read) += bytes;
+            if(t.n_shared[t.lane] < EMU_REPLAY_LOADS){
+                LaneAccess& acc = t.shared[long(t.lane)*EMU_REPLAY_LOADS + t.n_shared[t.lane]++];
+                acc.addr = a;
+                acc.pc = pc;
+                acc.bytes = int(bytes);
+                acc.is_write = is_write;
+            }
+        }
+    }
+}
+
+} // namespace emu
+
+extern "C" {
+#define EMU_TRAFFIC_HOOKS(n) \
+    EMU_UNCOUNTED void __asan_load##n##_noabort(void* p){ emu::traffic_count(p, n, false, __builtin_return_address(0)); } \
+    EMU_UNCOUNTED void __asan_store##n##_noabort(void* p){ emu::traffic_count(p, n, true, __builtin_return_address(0)); }
+EMU_TRAFFIC_HOOKS(1)
+EMU_TRAFFIC_HOOKS(2)
+EMU_TRAFFIC_HOOKS(4)
+EMU_TRAFFIC_HOOKS(8)
+EMU_TRAFFIC_HOOKS(16)
+#undef EMU_TRAFFIC_HOOKS
+EMU_UNCOUNTED void __asan_loadN_noabort(void* p, size_t n){ emu::traffic_count(p, long(n), false, __builtin_return_address(0)); }
+EMU_UNCOUNTED void __asan_storeN_noabort(void* p, size_t n){ emu::traffic_count(p, long(n), true, __builtin_return_address(0)); }
+EMU_UNCOUNTED void __asan_handle_no_return(void){}
+EMU_UNCOUNTED void __asan_before_dynamic_init(const void*){}
+EMU_UNCOUNTED void __asan_after_dynamic_init(void){}
+// the sanitizer leaves calls to memcpy alone, so they are counted here.
+EMU_UNCOUNTED void* memcpy(void* dst, const void* src, size_t n) throw(){
+    emu::traffic_count(src, long(n), false, __builtin_return_address(0));
+    emu::traffic_count(dst, long(n), true, __builtin_return_address(0));
+    return memmove(dst, src, n);
+}
+}
+
+#endif
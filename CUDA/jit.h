@@ -0,0 +1,282 @@
+#ifndef STENCIL_JIT
+#define STENCIL_JIT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <errno.h>
+#include <dlfcn.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "constants.h"
+#include "cpu-simd.h"
+#include "shapes.h"
+
+/*******************************************************************************
+ * Host engines specialized at run time on a shape that no template in the
+ * program covers. jit_host_1d/2d/3d write a translation unit that instantiates
+ * the named strategy, e.g. stencil_3d_cpu_simd, on the exact shape, compile it
+ * to a shared object with the local compiler and dlopen it:
+ *     $(STENCIL_JIT_CXX) -O3 -std=c++11 -march=native -fPIC -shared -DHOST_EMULATION ...
+ * The objects are kept in STENCIL_JIT_CACHE (by default ~/.cache/stencil-jit),
+ * named by rank, strategy, shape, element type, host ISA and a hash of the
+ * source, the command and the build of this program, so a later run loads
+ * them without compiling and a rebuild never picks up a stale one. Writing an
+ * object removes those of the same name with another hash, left by earlier
+ * builds. The output of the compiler is kept next to the object, as the same
+ * name with .log, and printed only when the compile fails.
+ * The headers are found in STENCIL_JIT_SRC, or the STENCIL_SRC_DIR the program
+ * was built with. A loaded engine has a host_pool of its own, which idles
+ * when the engine does not run.
+ */
+
+#ifndef STENCIL_SRC_DIR
+#define STENCIL_SRC_DIR "."
+#endif
+
+// a host strategy: its template, the tile arguments after the shape, and
+// whether it reassociates the sum (and so needs a tolerance to validate).
+struct JitStrategy {
+    const char* name;
+    int rank;
+    const char* engine;
+    const char* tiles;
+    bool reassociates;
+};
+
+static const JitStrategy jit_strategies[] = {
+    {"tiled",     1, "stencil_1d_cpu_tiled",          "CPU_TILE_1D",                  false},
+    {"simd",      1, "stencil_1d_cpu_simd",           "CPU_TILE_1D",                  false},
+    {"box",       1, "stencil_1d_cpu_box",            "CPU_TILE_1D",                  true},
+    {"tiled",     2, "stencil_2d_cpu_tiled",          "CPU_TILE_X,CPU_TILE_Y",        false},
+    {"simd",      2, "stencil_2d_cpu_simd",           "CPU_TILE_X,CPU_TILE_Y",        false},
+    {"steal",     2, "stencil_2d_cpu_simd_steal",     "CPU_TILE_X,CPU_TILE_Y",        false},
+    {"sliding",   2, "stencil_2d_cpu_sliding",        "CPU_TILE_X,CPU_STRIP_Y",       false},
+    {"separable", 2, "stencil_2d_cpu_separable_mean", "CPU_TILE_X,CPU_STRIP_Y",       true},
+#ifndef Jacobi2D
+    {"box",       2, "stencil_2d_cpu_box",            "CPU_TILE_X,CPU_BOX_Y",         true},
+#endif
+    {"tiled",     3, "stencil_3d_cpu_tiled",          "CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z", false},
+    {"simd",      3, "stencil_3d_cpu_simd",           "CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z", false},
+    {"steal",     3, "stencil_3d_cpu_simd_steal",     "CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z", false},
+    {"zmarch",    3, "stencil_3d_cpu_zmarch",         "CPU_PLANE_X,CPU_PLANE_Y,CPU_MARCH_Z", false},
+    {"separable", 3, "stencil_3d_cpu_separable_mean", "CPU_PLANE_X,CPU_PLANE_Y,CPU_MARCH_Z", true},
+#ifndef Jacobi3D
+    {"box",       3, "stencil_3d_cpu_box",            "CPU_PLANE_X,CPU_PLANE_Y,CPU_MARCH_Z", true},
+#endif
+};
+
+inline __host__
+const JitStrategy* find_jit_strategy(const char* name, const int rank)
+{
+    for(const JitStrategy& s : jit_strategies){
+        if(s.rank == rank && strcmp(s.name, name) == 0){ return &s; }
+    }
+    return nullptr;
+}
+
+// how an engine was obtained, for reports.
+struct JitInfo {
+    bool compiled;
+    long micros;
+    std::string path;
+};
+
+inline __host__
+unsigned long jit_hash(const std::string& text, unsigned long h = 14695981039346656037UL)
+{
+    for(const char c : text){
+        h = (h ^ (unsigned char)c) * 1099511628211UL;
+    }
+    return h;
+}
+
+// mkdir -p; true when the directory exists afterwards.
+inline __host__
+bool jit_make_dirs(const std::string& dir)
+{
+    for(size_t i = 1; i <= dir.size(); i++){
+        if(i == dir.size() || dir[i] == '/'){
+            const std::string prefix = dir.substr(0, i);
+            if(mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST){ return false; }
+        }
+    }
+    struct stat st;
+    return stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+inline __host__
+std::string jit_cache_dir()
+{
+    const char* env = getenv("STENCIL_JIT_CACHE");
+    if(env){ return env; }
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    if(xdg){ return std::string(xdg) + "/stencil-jit"; }
+    const char* home = getenv("HOME");
+    if(home){ return std::string(home) + "/.cache/stencil-jit"; }
+    return "/tmp/stencil-jit";
+}
+
+// removes the objects and logs of dir named prefix, a hash and .so or .log,
+// but for those of the hash kept. Objects being written (with a pid after the
+// hash) are left alone, and a program still running a removed object keeps
+// its mapping of it.
+inline __host__
+void jit_prune(const std::string& dir, const std::string& prefix, const char* keep)
+{
+    DIR* d = opendir(dir.c_str());
+    if(d == nullptr){ return; }
+    const size_t hash_len = strlen(keep);
+    while(struct dirent* e = readdir(d)){
+        const std::string name = e->d_name;
+        if(name.size() != prefix.size() + hash_len + 3 && name.size() != prefix.size() + hash_len + 4){ continue; }
+        if(name.compare(0, prefix.size(), prefix) != 0){ continue; }
+        const std::string hash = name.substr(prefix.size(), hash_len);
+        const std::string ext = name.substr(prefix.size() + hash_len);
+        if(hash == keep || (ext != ".so" && ext != ".log")){ continue; }
+        if(hash.find_first_not_of("0123456789abcdef") != std::string::npos){ continue; }
+        unlink((dir + "/" + name).c_str());
+    }
+    closedir(d);
+}
+
+// the engine of the strategy for the shape on elements of type T, as a
+// function of the host engine type of its rank, or nullptr when it can not be
+// built. Its tiles are widened for narrow elements as in the drivers.
+template<typename T>
+inline __host__
+void* jit_host_engine(const char* strategy, const StencilShape& shape, JitInfo* info)
+{
+    const JitStrategy* s = find_jit_strategy(strategy, shape.rank);
+    if(s == nullptr){
+        fprintf(stderr, ">>> jit: no %dd host strategy '%s'\n", shape.rank, strategy);
+        return nullptr;
+    }
+    static const char* lens_types[] = { "", "long", "long2", "long3" };
+    const int mins[3] = { shape.amin.x, shape.amin.y, shape.amin.z };
+    const int maxs[3] = { shape.amax.x, shape.amax.y, shape.amax.z };
+    std::string args, shape_name;
+    for(int a = 0; a < shape.rank; a++){
+        args += std::to_string(mins[a]) + ",";
+    }
+    for(int a = 0; a < shape.rank; a++){
+        args += std::to_string(maxs[a]) + ",";
+    }
+    for(int a = shape.rank - 1; a >= 0; a--){
+        shape_name += std::to_string(mins[a]) + "." + std::to_string(maxs[a]) + (a ? "_" : "");
+    }
+    for(char& c : shape_name){ if(c == '-'){ c = 'm'; } }
+    const std::string elem = ElemTraits<T>::type_name();
+    const std::string tiles = s->tiles;
+    const size_t tile_x_end = tiles.find(',');
+    const std::string tiles_scaled = "elem_scaled<" + elem + ">(" + tiles.substr(0, tile_x_end) + ")"
+        + (tile_x_end == std::string::npos ? "" : tiles.substr(tile_x_end));
+
+    const std::string source =
+        "#include <cuda_runtime.h>\n"
+        "#include \"cpu-kernels-" + std::to_string(shape.rank) + "d.h\"\n"
+        "extern \"C\" void stencil_jit_entry(const " + elem + "* A, " + elem + "* out, const " + lens_types[shape.rank] + " lens){\n"
+        "    " + s->engine + "<" + args + tiles_scaled + ">(A, out, lens);\n"
+        "}\n";
+
+    const char* src_env = getenv("STENCIL_JIT_SRC");
+    const std::string src_dir = src_env ? src_env : STENCIL_SRC_DIR;
+    const char* cxx_env = getenv("STENCIL_JIT_CXX");
+    std::string flags = "-O3 -std=c++11 -march=native -fPIC -shared -DHOST_EMULATION";
+#ifdef Jacobi2D
+    flags += " -DJacobi2D";
+#endif
+#ifdef Jacobi3D
+    flags += " -DJacobi3D";
+#endif
+    flags += " -I'" + src_dir + "' -I'" + src_dir + "/host-emu'";
+    const std::string cxx = cxx_env ? cxx_env : "c++";
+
+    const unsigned long hash = jit_hash(source + cxx + flags + __DATE__ " " __TIME__);
+    char hash_text[20];
+    snprintf(hash_text, sizeof(hash_text), "%016lx", hash);
+    const std::string dir = jit_cache_dir();
+    const std::string prefix = std::to_string(shape.rank) + "d-" + s->name + "-" + shape_name
+        + "-" + ElemTraits<T>::name() + "-" + host_isa_name(host_isa_for<T>()) + "-";
+    const std::string base = dir + "/" + prefix + hash_text;
+    const std::string so_path = base + ".so";
+
+    struct timeval start, end, diff;
+    gettimeofday(&start, NULL);
+    bool compiled = false;
+    if(access(so_path.c_str(), R_OK) != 0){
+        if(!jit_make_dirs(dir)){
+            fprintf(stderr, ">>> jit: can not create %s\n", dir.c_str());
+            return nullptr;
+        }
+        // private names until the object is complete, so that programs
+        // sharing the cache never load half of one.
+        const std::string tmp = base + "." + std::to_string(getpid());
+        FILE* f = fopen((tmp + ".cpp").c_str(), "w");
+        if(f == nullptr){
+            fprintf(stderr, ">>> jit: can not write %s.cpp\n", tmp.c_str());
+            return nullptr;
+        }
+        fputs(source.c_str(), f);
+        fclose(f);
+        // the diagnostics go to a log, shown only when the compile fails.
+        const std::string log_path = base + ".log";
+        const std::string command = cxx + " " + flags + " -o '" + tmp + ".so' '" + tmp + ".cpp' -lpthread";
+        const int status = system((command + " > '" + tmp + ".log' 2>&1").c_str());
+        unlink((tmp + ".cpp").c_str());
+        rename((tmp + ".log").c_str(), log_path.c_str());
+        if(status != 0 || rename((tmp + ".so").c_str(), so_path.c_str()) != 0){
+            fprintf(stderr, ">>> jit: failed: %s\n", command.c_str());
+            FILE* log = fopen(log_path.c_str(), "r");
+            if(log){
+                char line[512];
+                while(fgets(line, sizeof(line), log)){ fputs(line, stderr); }
+                fclose(log);
+            }
+            unlink((tmp + ".so").c_str());
+            return nullptr;
+        }
+        jit_prune(dir, prefix, hash_text);
+        compiled = true;
+    }
+    void* handle = dlopen(so_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    void* entry = handle ? dlsym(handle, "stencil_jit_entry") : nullptr;
+    if(entry == nullptr){
+        fprintf(stderr, ">>> jit: can not load %s: %s\n", so_path.c_str(), dlerror());
+        return nullptr;
+    }
+    gettimeofday(&end, NULL);
+    timeval_subtract(&diff, &end, &start);
+    if(info){
+        info->compiled = compiled;
+        info->micros = diff.tv_sec*1e6 + diff.tv_usec;
+        info->path = so_path;
+    }
+    return entry;
+}
+
+template<typename T>
+inline __host__
+Kernel1dHostOf<T> jit_host_1d(const char* strategy, const StencilShape& shape, JitInfo* info = nullptr)
+{
+    return (Kernel1dHostOf<T>)jit_host_engine<T>(strategy, shape, info);
+}
+
+template<typename T>
+inline __host__
+Kernel2dHostOf<T> jit_host_2d(const char* strategy, const StencilShape& shape, JitInfo* info = nullptr)
+{
+    return (Kernel2dHostOf<T>)jit_host_engine<T>(strategy, shape, info);
+}
+
+template<typename T>
+inline __host__
+Kernel3dHostOf<T> jit_host_3d(const char* strategy, const StencilShape& shape, JitInfo* info = nullptr)
+{
+    return (Kernel3dHostOf<T>)jit_host_engine<T>(strategy, shape, info);
+}
+
+#endif
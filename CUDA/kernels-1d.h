@@ -9,24 +9,27 @@
  */
 template<
     const int amin_x,
-    const int amax_x>
+    const int amax_x,
+    typename T>
 __device__ __host__
 __forceinline__
 T stencil_fun_1d(const T arr[]){
     constexpr int range = amax_x - amin_x + 1;
 
-    T sum_acc = 0;
+    ElemAcc<T> sum_acc = 0;
     for(int k=0; k < range; k++){
         sum_acc += arr[k];
     }
-    sum_acc /= (T)range;
-    return sum_acc;
+    sum_acc /= (ElemAcc<T>)range;
+    return T(sum_acc);
 }
 
-template<int amin_x, int sh_size_flat, int group_size>
+template<int amin_x, int sh_size_flat, int group_size,
+    const bool clamp,
+    typename T>
 __device__
 __forceinline__
-void bigtile_flat_loader(
+void bigtile_flat_loader_bounded(
     const T* A,
     T tile[sh_size_flat],
     const long lens,
@@ -42,14 +45,37 @@ void bigtile_flat_loader(
         const long gx = long(local_x) + block_offset + long(amin_x);
         if (local_x < sh_size_flat)
         {
-            tile[local_x] = A[bound<(amin_x<0),long>(gx, max_ix)];
+            tile[local_x] = A[bound_if<clamp,(amin_x<0),long>(gx, max_ix)];
         }
     }
 }
 
+// only the blocks whose tile hangs over an end of the array clamp; the test
+// is uniform over the block.
+template<int amin_x, int sh_size_flat, int group_size, typename T>
+__device__
+__forceinline__
+void bigtile_flat_loader(
+    const T* A,
+    T tile[sh_size_flat],
+    const long lens,
+    const int locals,
+    const long block_offset)
+{
+    if(in_bounds(block_offset + amin_x, long(sh_size_flat), lens - 1)){
+        bigtile_flat_loader_bounded<amin_x,sh_size_flat,group_size,false>
+            (A, tile, lens, locals, block_offset);
+    }
+    else {
+        bigtile_flat_loader_bounded<amin_x,sh_size_flat,group_size,true>
+            (A, tile, lens, locals, block_offset);
+    }
+}
+
 template<
     const int amin_x, const int amax_x
     ,const int sh_size_flat
+    , typename T
     >
 __device__
 __forceinline__
@@ -76,7 +102,44 @@ void write_from_shared_flat(
     }
 }
 
-template<long ix_min, long ix_max, int group_size>
+template<long ix_min, long ix_max, const bool clamp, typename T>
+__device__
+__forceinline__
+void read_write_from_global_1d_bounded(
+    const T* A,
+    T* out,
+    const long nx,
+    const long gid)
+{
+    const long max_ix = nx - 1;
+    const int range = (ix_max - ix_min) + 1;
+    T vals[range];
+    for (int i = 0; i < range; ++i){
+        const long loc_x = bound_if<clamp,(ix_min<0),long>(gid + long(i + ix_min), max_ix);
+        vals[i] = A[loc_x];
+    }
+    out[gid] = stencil_fun_1d<ix_min,ix_max>(vals);
+}
+
+// only points whose window reaches over an end of the array pay for the clamps.
+template<long ix_min, long ix_max, typename T>
+__device__
+__forceinline__
+void read_write_from_global_1d(
+    const T* A,
+    T* out,
+    const long nx,
+    const long gid)
+{
+    if(in_bounds(gid + ix_min, ix_max - ix_min + 1, nx - 1)){
+        read_write_from_global_1d_bounded<ix_min,ix_max,false>(A, out, nx, gid);
+    }
+    else {
+        read_write_from_global_1d_bounded<ix_min,ix_max,true>(A, out, nx, gid);
+    }
+}
+
+template<long ix_min, long ix_max, int group_size, typename T>
 __global__
 __launch_bounds__(BLOCKSIZE)
 void global_read_1d_inline(
@@ -86,21 +149,14 @@ void global_read_1d_inline(
     )
 {
     const long gid = long(blockIdx.x)*long(group_size) + long(threadIdx.x);
-    const long max_ix = nx - 1;
-    const int range = (ix_max - ix_min) + 1;
-    T vals[range];
     const bool should_write = gid < nx;
     if (should_write)
     {
-        for (int i = 0; i < range; ++i){
-            const long loc_x = bound<(ix_min<0),long>(gid + long(i + ix_min), max_ix);
-            vals[i] = A[loc_x];
-        }
-        out[gid] = stencil_fun_1d<ix_min,ix_max>(vals);
+        read_write_from_global_1d<ix_min,ix_max>(A, out, nx, gid);
     }
 }
 
-template<long ix_min, long ix_max, int group_size, int strip_x>
+template<long ix_min, long ix_max, int group_size, int strip_x, typename T>
 __global__
 __launch_bounds__(BLOCKSIZE)
 void global_read_1d_inline_strip(
@@ -109,27 +165,20 @@ void global_read_1d_inline_strip(
     const long nx
     )
 {
-    const long max_ix = nx - 1;
-    const int range = (ix_max - ix_min) + 1;
     const int strip_length = group_size*strip_x;
     const long start_gid_offset = long(blockIdx.x)*long(strip_length) + long(threadIdx.x);
     for (int x__ = 0; x__ < strip_x; ++x__)
     {
-        T vals[range];
         const long gid = start_gid_offset + long(x__*group_size);
         const bool should_write = gid < nx;
         if (should_write)
         {
-            for (int i = 0; i < range; ++i){
-                const long loc_x = bound<(ix_min<0),long>(gid + long(i + ix_min), max_ix);
-                vals[i] = A[loc_x];
-            }
-            out[gid] = stencil_fun_1d<ix_min,ix_max>(vals);
+            read_write_from_global_1d<ix_min,ix_max>(A, out, nx, gid);
         }
     }
 }
 
-template<long ix_min, long ix_max, int group_size>
+template<long ix_min, long ix_max, int group_size, typename T>
 __global__
 __launch_bounds__(BLOCKSIZE)
 void small_tile_1d_inline(
@@ -143,7 +192,7 @@ void small_tile_1d_inline(
     const long gid = offset + long(threadIdx.x + ix_min);
     const long max_ix = nx - 1;
     const int range = wasted + 1;
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     tile[long(threadIdx.x)] = A[bound<(ix_min<0),long>(gid, max_ix)];
     __syncthreads();
     T vals[range];
@@ -157,7 +206,7 @@ void small_tile_1d_inline(
     }
 }
 
-template<int amin_x, int amax_x, int group_size>
+template<int amin_x, int amax_x, int group_size, typename T>
 __global__
 __launch_bounds__(BLOCKSIZE)
 void big_tile_1d_inline(
@@ -168,7 +217,7 @@ void big_tile_1d_inline(
 {
     const long block_offset = long(blockIdx.x)*long(group_size);
     const int shared_size = group_size + (amax_x - amin_x);
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
 
     bigtile_flat_loader
         <amin_x
@@ -191,6 +240,7 @@ template
 < const int amin_x, const int amax_x
 , const int group_size_x
 , const int strip_x
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -270,7 +320,7 @@ void big_tile_1d_inline(
     const long shared_len
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     const long writeSet_offset = blockIdx.x*blockDim.x;
     const long gid = writeSet_offset + threadIdx.x;
     { // load tile
@@ -10,7 +10,8 @@
  */
 template<
     const int amin_x, const int amin_y,
-    const int amax_x, const int amax_y>
+    const int amax_x, const int amax_y,
+    typename T>
 __device__ __host__
 __forceinline__
 T stencil_fun_2d(const T arr[]){
@@ -19,7 +20,7 @@ T stencil_fun_2d(const T arr[]){
         amax_y - amin_y + 1};
     constexpr int total_range = range.x * range.y;
 
-    T sum_acc = 0;
+    ElemAcc<T> sum_acc = 0;
     for(int j=0; j < range.y; j++){
         for(int k=0; k < range.x; k++){
 #ifdef Jacobi2D
@@ -32,16 +33,33 @@ T stencil_fun_2d(const T arr[]){
                 sum_acc += arr[j*range.x + k];
         }
     }
-    sum_acc /= (T)total_range;
-    return sum_acc;
+    sum_acc /= (ElemAcc<T>)total_range;
+    return T(sum_acc);
+}
+
+// true when the block's tile, shifted by amin, lies inside the grid, so that
+// none of its loads has to be clamped.
+template<
+    const int amin_x, const int amin_y,
+    const int sh_size_x, const int sh_size_y>
+__device__ __host__
+__forceinline__
+bool tile_in_bounds(
+    const long len_x, const long len_y,
+    const long block_offset_x, const long block_offset_y)
+{
+    return in_bounds(block_offset_x + amin_x, long(sh_size_x), len_x - 1)
+        && in_bounds(block_offset_y + amin_y, long(sh_size_y), len_y - 1);
 }
 
 template<
     const int amin_x, const int amin_y,
-    const int amax_x, const int amax_y>
+    const int amax_x, const int amax_y,
+    const bool clamp,
+    typename T>
 __device__
 __forceinline__
-void read_write_from_global(
+void read_write_from_global_bounded(
     const T* A,
     T* out,
     const long lens_x, const long lens_y,
@@ -59,8 +77,8 @@ void read_write_from_global(
     T vals[total_range];
     for(int j=0; j < range.y; j++){
         for(int k=0; k < range.x; k++){
-            const long y = bound<(amin_y<0),long>(gid_y + (j + amin_y), max_idx_y);
-            const long x = bound<(amin_x<0),long>(gid_x + (k + amin_x), max_idx_x);
+            const long y = bound_if<clamp,(amin_y<0),long>(gid_y + (j + amin_y), max_idx_y);
+            const long x = bound_if<clamp,(amin_x<0),long>(gid_x + (k + amin_x), max_idx_x);
             const long index = y*lens_x + x;
             const int flat_idx = j*range.x + k;
             vals[flat_idx] = A[index];
@@ -69,13 +87,41 @@ void read_write_from_global(
     out[gindex] = stencil_fun_2d<amin_x, amin_y, amax_x, amax_y>(vals);
 }
 
+// only points whose window reaches over the grid border pay for the clamps.
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    typename T>
+__device__
+__forceinline__
+void read_write_from_global(
+    const T* A,
+    T* out,
+    const long lens_x, const long lens_y,
+    const long gid_x, const long gid_y)
+{
+    const bool interior =
+           in_bounds(gid_x + amin_x, long(amax_x - amin_x + 1), lens_x - 1L)
+        && in_bounds(gid_y + amin_y, long(amax_y - amin_y + 1), lens_y - 1L);
+    if(interior){
+        read_write_from_global_bounded<amin_x,amin_y,amax_x,amax_y,false>
+            (A, out, lens_x, lens_y, gid_x, gid_y);
+    }
+    else {
+        read_write_from_global_bounded<amin_x,amin_y,amax_x,amax_y,true>
+            (A, out, lens_x, lens_y, gid_x, gid_y);
+    }
+}
+
 template<
     const int amin_x, const int amin_y,
     const int sh_size_x, const int sh_size_flat,
-    const int group_size_x,  const int group_size_y>
+    const int group_size_x,  const int group_size_y,
+    const bool clamp,
+    typename T>
 __device__
 __forceinline__
-void bigtile_flat_loader_addcarry(
+void bigtile_flat_loader_addcarry_bounded(
     const T* A,
     T *tile,
     const long len_x, const long len_y,
@@ -100,8 +146,8 @@ void bigtile_flat_loader_addcarry(
     constexpr int add_x = blockDimFlat % sh_span_y;
 
     for(int i = 0; i < iters; i++){
-        const long gx = bound<(amin_x<0),long>((local_x + block_offset_x), max_ix_x);
-        const long gy = bound<(amin_y<0),long>((local_y + block_offset_y), max_ix_y);
+        const long gx = bound_if<clamp,(amin_x<0),long>((local_x + block_offset_x), max_ix_x);
+        const long gy = bound_if<clamp,(amin_y<0),long>((local_y + block_offset_y), max_ix_y);
 
         const long index = gy * len_x + gx;
         if(i < (iters-1) || loc_flat < last_iter){
@@ -121,11 +167,40 @@ void bigtile_flat_loader_addcarry(
     }
 }
 
+// the interior test is uniform over the block, so there is no divergence.
+template<
+    const int amin_x, const int amin_y,
+    const int sh_size_x, const int sh_size_flat,
+    const int group_size_x,  const int group_size_y,
+    typename T>
+__device__
+__forceinline__
+void bigtile_flat_loader_addcarry(
+    const T* A,
+    T *tile,
+    const long len_x, const long len_y,
+    const int loc_flat,
+    const long block_offset_x, const long block_offset_y)
+{
+    constexpr int sh_size_y = divUp(sh_size_flat, sh_size_x);
+    const bool interior = tile_in_bounds<amin_x,amin_y,sh_size_x,sh_size_y>
+        (len_x, len_y, block_offset_x, block_offset_y);
+    if(interior){
+        bigtile_flat_loader_addcarry_bounded<amin_x,amin_y,sh_size_x,sh_size_flat,group_size_x,group_size_y,false>
+            (A, tile, len_x, len_y, loc_flat, block_offset_x, block_offset_y);
+    }
+    else {
+        bigtile_flat_loader_addcarry_bounded<amin_x,amin_y,sh_size_x,sh_size_flat,group_size_x,group_size_y,true>
+            (A, tile, len_x, len_y, loc_flat, block_offset_x, block_offset_y);
+    }
+}
+
 
 template<
     const int amin_x, const int amin_y,
     const int amax_x, const int amax_y,
-    const int sh_size_x>
+    const int sh_size_x,
+    typename T>
 __device__
 __forceinline__
 void write_from_shared_flat(
@@ -162,15 +237,18 @@ void write_from_shared_flat(
     }
 }
 
+// pad_x unused words end every tile row, to move the rows to other banks.
 template<
     const int amin_x, const int amin_y,
     const int amax_x, const int amax_y
     , const int sh_size_x,  const int sh_size_y
+    , const int pad_x = 0
+    , typename T
     >
 __device__
 __forceinline__
 void write_from_shared_cube(
-    const T tile2d[sh_size_y][sh_size_x],
+    const T tile2d[sh_size_y][sh_size_x + pad_x],
     T* out,
     const long len_x, const long len_y,
     const int local_x, const int local_y,
@@ -204,10 +282,12 @@ void write_from_shared_cube(
 template<
     const int amin_x, const int amin_y,
     const int sh_size_x, const int sh_size_flat,
-    const int group_size_x,  const int group_size_y>
+    const int group_size_x,  const int group_size_y,
+    const bool clamp,
+    typename T>
 __device__
 __forceinline__
-void bigtile_flat_loader_divrem(
+void bigtile_flat_loader_divrem_bounded(
     const T* A,
     T tile[sh_size_flat],
     const long len_x, const long len_y,
@@ -230,8 +310,8 @@ void bigtile_flat_loader_divrem(
         const int local_y = local_ix / sh_size_x;
         const int local_x = local_ix % sh_size_x;
 
-        const long gy = bound<(amin_y<0),long>((long(local_y) + view_offset_y), max_ix_y);
-        const long gx = bound<(amin_x<0),long>((long(local_x) + view_offset_x), max_ix_x);
+        const long gy = bound_if<clamp,(amin_y<0),long>((long(local_y) + view_offset_y), max_ix_y);
+        const long gx = bound_if<clamp,(amin_x<0),long>((long(local_x) + view_offset_x), max_ix_x);
 
         const long index = gy * len_x + gx;
         if(i < (iters-1) || local_ix < sh_size_flat){
@@ -240,15 +320,44 @@ void bigtile_flat_loader_divrem(
     }
 }
 
+template<
+    const int amin_x, const int amin_y,
+    const int sh_size_x, const int sh_size_flat,
+    const int group_size_x,  const int group_size_y,
+    typename T>
+__device__
+__forceinline__
+void bigtile_flat_loader_divrem(
+    const T* A,
+    T tile[sh_size_flat],
+    const long len_x, const long len_y,
+    const int loc_flat,
+    const long block_offset_x, const long block_offset_y)
+{
+    constexpr int sh_size_y = divUp(sh_size_flat, sh_size_x);
+    const bool interior = tile_in_bounds<amin_x,amin_y,sh_size_x,sh_size_y>
+        (len_x, len_y, block_offset_x, block_offset_y);
+    if(interior){
+        bigtile_flat_loader_divrem_bounded<amin_x,amin_y,sh_size_x,sh_size_flat,group_size_x,group_size_y,false>
+            (A, tile, len_x, len_y, loc_flat, block_offset_x, block_offset_y);
+    }
+    else {
+        bigtile_flat_loader_divrem_bounded<amin_x,amin_y,sh_size_x,sh_size_flat,group_size_x,group_size_y,true>
+            (A, tile, len_x, len_y, loc_flat, block_offset_x, block_offset_y);
+    }
+}
+
 template<
     const int amin_x, const int amin_y,
     const int sh_size_x, const int sh_size_y,
-    const int group_size_x,  const int group_size_y>
+    const int group_size_x,  const int group_size_y,
+    const bool clamp, const int pad_x = 0,
+    typename T>
 __device__
 __forceinline__
-void bigtile_cube_loader(
+void bigtile_cube_loader_bounded(
     const T* A,
-    T tile2d[sh_size_y][sh_size_x],
+    T tile2d[sh_size_y][sh_size_x + pad_x],
     const long lens_x, const long lens_y,
     const int locals_x, const int locals_y,
     const long block_offsets_x, const long block_offsets_y)
@@ -261,12 +370,12 @@ void bigtile_cube_loader(
 
     for(int i = 0; i < y_iters; i++){
         const int local_y = locals_y + i*group_size_y;
-        const long gy = bound<(amin_y<0),long>( long(local_y) + block_offsets_y + long(amin_y), max_y_ix)
+        const long gy = bound_if<clamp,(amin_y<0),long>( long(local_y) + block_offsets_y + long(amin_y), max_y_ix)
                      * lens_x;
 
         for(int j = 0; j < x_iters; j++){
             const int local_x = locals_x + j*group_size_x;
-            const long gx = bound<(amin_x<0),long>( long(local_x) + block_offsets_x + long(amin_x), max_x_ix);
+            const long gx = bound_if<clamp,(amin_x<0),long>( long(local_x) + block_offsets_x + long(amin_x), max_x_ix);
             if(local_x < sh_size_x && local_y < sh_size_y){
                 tile2d[local_y][local_x] = A[gx + gy];
             }
@@ -274,6 +383,33 @@ void bigtile_cube_loader(
     }
 }
 
+template<
+    const int amin_x, const int amin_y,
+    const int sh_size_x, const int sh_size_y,
+    const int group_size_x,  const int group_size_y,
+    const int pad_x = 0,
+    typename T>
+__device__
+__forceinline__
+void bigtile_cube_loader(
+    const T* A,
+    T tile2d[sh_size_y][sh_size_x + pad_x],
+    const long lens_x, const long lens_y,
+    const int locals_x, const int locals_y,
+    const long block_offsets_x, const long block_offsets_y)
+{
+    const bool interior = tile_in_bounds<amin_x,amin_y,sh_size_x,sh_size_y>
+        (lens_x, lens_y, block_offsets_x, block_offsets_y);
+    if(interior){
+        bigtile_cube_loader_bounded<amin_x,amin_y,sh_size_x,sh_size_y,group_size_x,group_size_y,false,pad_x>
+            (A, tile2d, lens_x, lens_y, locals_x, locals_y, block_offsets_x, block_offsets_y);
+    }
+    else {
+        bigtile_cube_loader_bounded<amin_x,amin_y,sh_size_x,sh_size_y,group_size_x,group_size_y,true,pad_x>
+            (A, tile2d, lens_x, lens_y, locals_x, locals_y, block_offsets_x, block_offsets_y);
+    }
+}
+
 /*******************************************************************************
  * Versions where the indices are inlined.
  * The function is taking the average.
@@ -282,6 +418,7 @@ template
 < const int amin_x, const int amin_y
 , const int amax_x, const int amax_y
 , const int group_size_x,  const int group_size_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -308,6 +445,7 @@ template
 < const int amin_x, const int amin_y
 , const int amax_x, const int amax_y
 , const int group_size_x,  const int group_size_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -342,6 +480,7 @@ template
 < const int amin_x, const int amin_y
 , const int amax_x, const int amax_y
 , const int group_size_x,  const int group_size_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -355,7 +494,7 @@ void big_tile_2d_inlined_flat_divrem_singleDim(
     constexpr int sh_size_x =  group_size_x + (amax_x - amin_x);
     constexpr int sh_size_y =  group_size_y + (amax_y - amin_y);
     constexpr int sh_size_flat = sh_size_x * sh_size_y;
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
 
     const int loc_flat = threadIdx.x;
     const int loc_y = loc_flat / group_size_x;
@@ -387,6 +526,8 @@ template
 < const int amin_x, const int amin_y
 , const int amax_x, const int amax_y
 , const int group_size_x,  const int group_size_y
+, const int pad_x = 0
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -402,7 +543,7 @@ void big_tile_2d_inlined_cube_singleDim(
     const int sh_size_x = group_size_x + waste_x;
     const int sh_size_y = group_size_y + waste_y;
 
-    __shared__ T tile2d[sh_size_y][sh_size_x];
+    __shared__ T tile2d[sh_size_y][sh_size_x + pad_x];
 
     const int loc_flat = threadIdx.x;
     const int loc_y = loc_flat / group_size_x;
@@ -417,7 +558,8 @@ void big_tile_2d_inlined_cube_singleDim(
     bigtile_cube_loader
         <amin_x,amin_y
         ,sh_size_x,sh_size_y
-        ,group_size_x,group_size_y>
+        ,group_size_x,group_size_y
+        ,pad_x>
         (A, tile2d, lens.x, lens.y, loc_x,loc_y, writeSet_x,writeSet_y);
 
     __syncthreads();
@@ -425,7 +567,8 @@ void big_tile_2d_inlined_cube_singleDim(
     write_from_shared_cube
         <amin_x,amin_y
         ,amax_x,amax_y
-        ,sh_size_x,sh_size_y>
+        ,sh_size_x,sh_size_y
+        ,pad_x>
         (tile2d, out, lens.x,lens.y, loc_x,loc_y, writeSet_x,writeSet_y);
 
 }
@@ -434,6 +577,7 @@ template
 < const int amin_x, const int amin_y
 , const int amax_x, const int amax_y
 , const int group_size_x,  const int group_size_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -447,7 +591,7 @@ void big_tile_2d_inlined_flat_addcarry_singleDim(
     constexpr int sh_size_x = group_size_x + (amax_x - amin_x);
     constexpr int sh_size_y = group_size_y + (amax_y - amin_y);
     constexpr int sh_size_flat = sh_size_x * sh_size_y;
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
 
     const int loc_flat = threadIdx.x;
     const int loc_y = loc_flat / group_size_x;
@@ -480,6 +624,7 @@ template
 , const int amax_x, const int amax_y
 , const int group_size_x,  const int group_size_y
 , const int strip_x, const int strip_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -490,7 +635,7 @@ void stripmine_big_tile_2d_inlined_flat_addcarry_singleDim(
     const int2 strip_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = strip_x*group_size_x + (amax_x - amin_x);
     constexpr int sh_size_y = strip_y*group_size_y + (amax_y - amin_y);
     constexpr int sh_size_flat = sh_size_x * sh_size_y;
@@ -546,6 +691,7 @@ template
 , const int amax_x, const int amax_y
 , const int group_size_flat
 , const int windows_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -556,7 +702,7 @@ void sliding_tile_flat_smalltile_singleDim(
     const int2 strip_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = group_size_flat;
     constexpr int range_exc_x = amax_x - amin_x;
     constexpr int range_exc_y = amax_y - amin_y;
@@ -647,6 +793,7 @@ template
 , const int amax_x, const int amax_y
 , const int group_size_x, const int group_size_y
 , const int windows_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -657,7 +804,7 @@ void sliding_tile_smalltile_singleDim(
     const int2 strip_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int range_exc_x = amax_x - amin_x;
     constexpr int range_exc_y = amax_y - amin_y;
     constexpr int2 range = {
@@ -763,6 +910,7 @@ template
 < const int amin_x, const int amin_y
 , const int amax_x, const int amax_y
 , const int group_size_x,  const int group_size_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -777,7 +925,7 @@ void virtual_addcarry_big_tile_2d_inlined_flat_addcarry_singleDim(
     constexpr int sh_size_x = group_size_x + (amax_x - amin_x);
     constexpr int sh_size_y = group_size_y + (amax_y - amin_y);
     constexpr int sh_size_flat = sh_size_x * sh_size_y;
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
 
     const int virtual_grid_flat = virtual_grid.x * virtual_grid.y;
     const int iters_per_phys = divUp(virtual_grid_flat, num_phys_groups);
@@ -830,6 +978,7 @@ template
 , const int amax_x, const int amax_y
 , const int group_size_x,  const int group_size_y
 , const int strip_x, const int strip_y
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -845,7 +994,7 @@ void virtual_addcarry_stripmine_big_tile_2d_inlined_flat_addcarry_singleDim(
     constexpr int sh_size_x = strips.x*group_size_x + (amax_x - amin_x);
     constexpr int sh_size_y = strips.y*group_size_y + (amax_y - amin_y);
     constexpr int sh_size_flat = sh_size_x * sh_size_y;
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
 
     constexpr long strip_size_x = group_size_x*strip_x;
     constexpr long strip_size_y = group_size_y*strip_y;
@@ -10,7 +10,8 @@
  */
 template<
     const int amin_x, const int amin_y, const int amin_z,
-    const int amax_x, const int amax_y, const int amax_z>
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
 __device__ __host__
 __forceinline__
 T stencil_fun_3d(const T arr[]){
@@ -20,7 +21,7 @@ T stencil_fun_3d(const T arr[]){
         amax_z - amin_z + 1};
     constexpr int total_range = range.x * range.y * range.z;
 
-    T sum_acc = 0;
+    ElemAcc<T> sum_acc = 0;
     for(int i=0; i < range.z; i++){
         for(int j=0; j < range.y; j++){
             for(int k=0; k < range.x; k++){
@@ -37,16 +38,34 @@ T stencil_fun_3d(const T arr[]){
             }
         }
     }
-    sum_acc /= (T)total_range;
-    return sum_acc;
+    sum_acc /= (ElemAcc<T>)total_range;
+    return T(sum_acc);
 }
 
+// true when the block's tile, shifted by amin, lies inside the grid, so that
+// none of its loads has to be clamped.
 template<
     const int amin_x, const int amin_y, const int amin_z,
-    const int amax_x, const int amax_y, const int amax_z>
+    const int sh_size_x,  const int sh_size_y,  const int sh_size_z>
+__device__ __host__
+__forceinline__
+bool tile_in_bounds(
+    const long len_x, const long len_y, const long len_z,
+    const long block_offset_x, const long block_offset_y, const long block_offset_z)
+{
+    return in_bounds(block_offset_x + amin_x, long(sh_size_x), len_x - 1)
+        && in_bounds(block_offset_y + amin_y, long(sh_size_y), len_y - 1)
+        && in_bounds(block_offset_z + amin_z, long(sh_size_z), len_z - 1);
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const bool clamp,
+    typename T>
 __device__
 __forceinline__
-void read_write_from_global(
+void read_write_from_global_bounded(
     const T* A,
     T* out,
     const long lens_x, const long lens_y, const long lens_z,
@@ -67,9 +86,9 @@ void read_write_from_global(
     for(int i=0; i < range.z; i++){
         for(int j=0; j < range.y; j++){
             for(int k=0; k < range.x; k++){
-                const long z = bound<(amin_z<0),long>(gid_z + (i + amin_z), max_idx_z);
-                const long y = bound<(amin_y<0),long>(gid_y + (j + amin_y), max_idx_y);
-                const long x = bound<(amin_x<0),long>(gid_x + (k + amin_x), max_idx_x);
+                const long z = bound_if<clamp,(amin_z<0),long>(gid_z + (i + amin_z), max_idx_z);
+                const long y = bound_if<clamp,(amin_y<0),long>(gid_y + (j + amin_y), max_idx_y);
+                const long x = bound_if<clamp,(amin_x<0),long>(gid_x + (k + amin_x), max_idx_x);
                 const long index = (z*lens_y + y)*lens_x + x;
                 const int flat_idx = (i*range.y + j)*range.x + k;
                 vals[flat_idx] = A[index];
@@ -79,10 +98,38 @@ void read_write_from_global(
     out[gindex] = stencil_fun_3d<amin_x, amin_y, amin_z, amax_x, amax_y, amax_z>(vals);
 }
 
+// only points whose window reaches over the grid border pay for the clamps.
 template<
     const int amin_x, const int amin_y, const int amin_z,
     const int amax_x, const int amax_y, const int amax_z,
-    const int sh_size_x,  const int sh_size_y,  const int sh_size_flat>
+    typename T>
+__device__
+__forceinline__
+void read_write_from_global(
+    const T* A,
+    T* out,
+    const long lens_x, const long lens_y, const long lens_z,
+    const long gid_x, const long gid_y, const long gid_z)
+{
+    const bool interior =
+           in_bounds(gid_x + amin_x, long(amax_x - amin_x + 1), lens_x - 1L)
+        && in_bounds(gid_y + amin_y, long(amax_y - amin_y + 1), lens_y - 1L)
+        && in_bounds(gid_z + amin_z, long(amax_z - amin_z + 1), lens_z - 1L);
+    if(interior){
+        read_write_from_global_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,false>
+            (A, out, lens_x, lens_y, lens_z, gid_x, gid_y, gid_z);
+    }
+    else {
+        read_write_from_global_bounded<amin_x,amin_y,amin_z,amax_x,amax_y,amax_z,true>
+            (A, out, lens_x, lens_y, lens_z, gid_x, gid_y, gid_z);
+    }
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int sh_size_x,  const int sh_size_y,  const int sh_size_flat,
+    typename T>
 __device__
 __forceinline__
 void write_from_shared_flat(
@@ -126,10 +173,12 @@ void write_from_shared_flat(
 template<
     const int amin_x, const int amin_y, const int amin_z,
     const int sh_size_x,  const int sh_size_y,  const int sh_size_z,
-    const int group_size_x,  const int group_size_y, const int group_size_z>
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    const bool clamp,
+    typename T>
 __device__
 __forceinline__
-void bigtile_cube_block_loader(
+void bigtile_cube_block_loader_bounded(
     const T* A,
     T tile[],
     const long len_x, const long len_y, const long len_z,
@@ -151,13 +200,13 @@ void bigtile_cube_block_loader(
 
     for(int i = 0; i < iters.z; i++){
         const int lz = local_z + i*group_size_z;
-        const long gid_z = len_y * bound<(amin_z<0),long>((lz + view_offset.z), max_idx.z);
+        const long gid_z = len_y * bound_if<clamp,(amin_z<0),long>((lz + view_offset.z), max_idx.z);
         for(int j = 0; j < iters.y; j++){
             const int ly = local_y + j*group_size_y;
-            const long gid_zy = len_x * (gid_z + bound<(amin_y<0),long>((ly + view_offset.y), max_idx.y));
+            const long gid_zy = len_x * (gid_z + bound_if<clamp,(amin_y<0),long>((ly + view_offset.y), max_idx.y));
             for (int k = 0; k < iters.x; k++){
                 const int lx = local_x + k*group_size_x;
-                const long gid_zyx = gid_zy + bound<(amin_x<0),long>((lx + view_offset.x), max_idx.x);
+                const long gid_zyx = gid_zy + bound_if<clamp,(amin_x<0),long>((lx + view_offset.x), max_idx.x);
                 const int local_flat = (lz * sh_size_y + ly) * sh_size_x + lx;
                 if(lz < sh_size_z && ly < sh_size_y && lx < sh_size_x){
                     tile[local_flat] = A[gid_zyx];
@@ -167,13 +216,42 @@ void bigtile_cube_block_loader(
     }
 }
 
+// the interior test is uniform over the block, so there is no divergence.
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int sh_size_x,  const int sh_size_y,  const int sh_size_z,
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    typename T>
+__device__
+__forceinline__
+void bigtile_cube_block_loader(
+    const T* A,
+    T tile[],
+    const long len_x, const long len_y, const long len_z,
+    const int local_x, const int local_y, const int local_z,
+    const long block_offset_x, const long block_offset_y, const long block_offset_z)
+{
+    const bool interior = tile_in_bounds<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z>
+        (len_x, len_y, len_z, block_offset_x, block_offset_y, block_offset_z);
+    if(interior){
+        bigtile_cube_block_loader_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z,group_size_x,group_size_y,group_size_z,false>
+            (A, tile, len_x, len_y, len_z, local_x, local_y, local_z, block_offset_x, block_offset_y, block_offset_z);
+    }
+    else {
+        bigtile_cube_block_loader_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z,group_size_x,group_size_y,group_size_z,true>
+            (A, tile, len_x, len_y, len_z, local_x, local_y, local_z, block_offset_x, block_offset_y, block_offset_z);
+    }
+}
+
 template<
     const int amin_x, const int amin_y, const int amin_z,
     const int sh_size_x,  const int sh_size_y,  const int sh_size_flat,
-    const int group_size_x,  const int group_size_y, const int group_size_z>
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    const bool clamp,
+    typename T>
 __device__
 __forceinline__
-void bigtile_flat_loader_divrem(
+void bigtile_flat_loader_divrem_bounded(
     const T* A,
     T tile[sh_size_flat],
     const long len_x, const long len_y, const long len_z,
@@ -203,9 +281,9 @@ void bigtile_flat_loader_divrem(
         const int local_y = rem_z / ly_span;
         const int local_x = rem_z % ly_span;
 
-        const long gz = bound<(amin_z<0),long>((local_z + view_offset_z), max_ix_z);
-        const long gy = bound<(amin_y<0),long>((local_y + view_offset_y), max_ix_y);
-        const long gx = bound<(amin_x<0),long>((local_x + view_offset_x), max_ix_x);
+        const long gz = bound_if<clamp,(amin_z<0),long>((local_z + view_offset_z), max_ix_z);
+        const long gy = bound_if<clamp,(amin_y<0),long>((local_y + view_offset_y), max_ix_y);
+        const long gx = bound_if<clamp,(amin_x<0),long>((local_x + view_offset_x), max_ix_x);
 
         const long index = (gz * len_y + gy) * len_x + gx;
         if(local_ix < sh_size_flat){
@@ -217,10 +295,39 @@ void bigtile_flat_loader_divrem(
 template<
     const int amin_x, const int amin_y, const int amin_z,
     const int sh_size_x,  const int sh_size_y,  const int sh_size_flat,
-    const int group_size_x,  const int group_size_y, const int group_size_z>
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    typename T>
 __device__
 __forceinline__
-void bigtile_flat_loader_addcarry(
+void bigtile_flat_loader_divrem(
+    const T* A,
+    T tile[sh_size_flat],
+    const long len_x, const long len_y, const long len_z,
+    const int local_flat,
+    const long block_offset_x, const long block_offset_y, const long block_offset_z)
+{
+    constexpr int sh_size_z = divUp(sh_size_flat, sh_size_x * sh_size_y);
+    const bool interior = tile_in_bounds<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z>
+        (len_x, len_y, len_z, block_offset_x, block_offset_y, block_offset_z);
+    if(interior){
+        bigtile_flat_loader_divrem_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_flat,group_size_x,group_size_y,group_size_z,false>
+            (A, tile, len_x, len_y, len_z, local_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+    else {
+        bigtile_flat_loader_divrem_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_flat,group_size_x,group_size_y,group_size_z,true>
+            (A, tile, len_x, len_y, len_z, local_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int sh_size_x,  const int sh_size_y,  const int sh_size_flat,
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    const bool clamp,
+    typename T>
+__device__
+__forceinline__
+void bigtile_flat_loader_addcarry_bounded(
     const T* A,
     T tile[sh_size_flat],
     const long len_x, const long len_y, const long len_z,
@@ -251,9 +358,9 @@ void bigtile_flat_loader_addcarry(
     constexpr int add_x = arz % sh_span_y;
 
     for(int i = 0; i < iters; i++){
-        const long gx = bound<(amin_x<0),long>((local_x + block_offset_x), max_ix_x);
-        const long gy = bound<(amin_y<0),long>((local_y + block_offset_y), max_ix_y);
-        const long gz = bound<(amin_z<0),long>((local_z + block_offset_z), max_ix_z);
+        const long gx = bound_if<clamp,(amin_x<0),long>((local_x + block_offset_x), max_ix_x);
+        const long gy = bound_if<clamp,(amin_y<0),long>((local_y + block_offset_y), max_ix_y);
+        const long gz = bound_if<clamp,(amin_z<0),long>((local_z + block_offset_z), max_ix_z);
 
         const long index = (gz * len_y + gy) * len_x + gx;
         if(local_flat < sh_size_flat){
@@ -278,13 +385,42 @@ void bigtile_flat_loader_addcarry(
     }
 }
 
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int sh_size_x,  const int sh_size_y,  const int sh_size_flat,
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    typename T>
+__device__
+__forceinline__
+void bigtile_flat_loader_addcarry(
+    const T* A,
+    T tile[sh_size_flat],
+    const long len_x, const long len_y, const long len_z,
+    const int loc_flat,
+    const long block_offset_x, const long block_offset_y, const long block_offset_z)
+{
+    constexpr int sh_size_z = divUp(sh_size_flat, sh_size_x * sh_size_y);
+    const bool interior = tile_in_bounds<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z>
+        (len_x, len_y, len_z, block_offset_x, block_offset_y, block_offset_z);
+    if(interior){
+        bigtile_flat_loader_addcarry_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_flat,group_size_x,group_size_y,group_size_z,false>
+            (A, tile, len_x, len_y, len_z, loc_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+    else {
+        bigtile_flat_loader_addcarry_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_flat,group_size_x,group_size_y,group_size_z,true>
+            (A, tile, len_x, len_y, len_z, loc_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+}
+
 template<
     const int amin_x, const int amin_y, const int amin_z,
     const int sh_size_x,  const int sh_size_y,  const int sh_size_z,
-    const int group_size_x,  const int group_size_y, const int group_size_z>
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    const bool clamp,
+    typename T>
 __device__
 __forceinline__
-void bigtile_flat_loader_transactionAligned(
+void bigtile_flat_loader_transactionAligned_bounded(
     const T* A,
     T tile[],
     const long len_x, const long len_y, const long len_z,
@@ -330,8 +466,8 @@ void bigtile_flat_loader_transactionAligned(
     const long boam_x = block_offset_x + amin_x;
 
     for(int i = 0; i < iters; i++){
-        const long gz = bound<(amin_z<0),long>((tnx_id_z + boam_z), max_ix_z);
-        const long gy = bound<(amin_y<0),long>((tnx_id_y + boam_y), max_ix_y);
+        const long gz = bound_if<clamp,(amin_z<0),long>((tnx_id_z + boam_z), max_ix_z);
+        const long gy = bound_if<clamp,(amin_y<0),long>((tnx_id_y + boam_y), max_ix_y);
         const long index_zy = (gz * len_y + gy) * len_x;
         const long index_bzyx = index_zy + boam_x;
         const int gxtr_diff = index_bzyx - (index_bzyx & and_round_down_32);
@@ -340,7 +476,7 @@ void bigtile_flat_loader_transactionAligned(
         const int sh_id_x = sh_id_x_noff - gxtr_diff;
 
         const long ugx = boam_x + sh_id_x;
-        const long gx = bound<(amin_x<0),long>(ugx, max_ix_x);
+        const long gx = bound_if<clamp,(amin_x<0),long>(ugx, max_ix_x);
         const long index = index_zy + gx;
 
         const int sh_id_flat = (tnx_id_z * sh_size_y + tnx_id_y) * sh_size_x + sh_id_x;
@@ -368,10 +504,44 @@ void bigtile_flat_loader_transactionAligned(
 template<
     const int amin_x, const int amin_y, const int amin_z,
     const int sh_size_x,  const int sh_size_y,  const int sh_size_z,
-    const int group_size_x,  const int group_size_y, const int group_size_z>
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    typename T>
 __device__
 __forceinline__
-void big_tile_3d_inlined_flat_forced_coalesced_loader(
+void bigtile_flat_loader_transactionAligned(
+    const T* A,
+    T tile[],
+    const long len_x, const long len_y, const long len_z,
+    const int loc_flat,
+    const long block_offset_x, const long block_offset_y, const long block_offset_z)
+{
+    constexpr int n_warps = (group_size_x * group_size_y * group_size_z) / 32;
+    constexpr int chunks_per_row = 1 + divUp((sh_size_x - 1), 32);
+    constexpr int chunk_span_z = sh_size_y * chunks_per_row;
+    constexpr int iters = divUp(sh_size_z * chunk_span_z, n_warps);
+    // the last round of warps may run past the tile in z and still loads.
+    constexpr int rows_z = divUp(iters * n_warps, chunk_span_z);
+    const bool interior = tile_in_bounds<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,rows_z>
+        (len_x, len_y, len_z, block_offset_x, block_offset_y, block_offset_z);
+    if(interior){
+        bigtile_flat_loader_transactionAligned_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z,group_size_x,group_size_y,group_size_z,false>
+            (A, tile, len_x, len_y, len_z, loc_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+    else {
+        bigtile_flat_loader_transactionAligned_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z,group_size_x,group_size_y,group_size_z,true>
+            (A, tile, len_x, len_y, len_z, loc_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int sh_size_x,  const int sh_size_y,  const int sh_size_z,
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    const bool clamp,
+    typename T>
+__device__
+__forceinline__
+void big_tile_3d_inlined_flat_forced_coalesced_loader_bounded(
     const T* A,
     T tile[],
     const long len_x, const long len_y, const long len_z,
@@ -402,7 +572,7 @@ void big_tile_3d_inlined_flat_forced_coalesced_loader(
     const long view_offset_x = block_offset_x + amin_x;
 
     for(int i = 0; i < iters; i++){
-        const int chunk_ix = (i * warp_size) + warp_id;
+        const int chunk_ix = (i * n_warps) + warp_id;
         if(chunk_ix >= n_chunks){ break; }
 
         // div/rem
@@ -414,9 +584,9 @@ void big_tile_3d_inlined_flat_forced_coalesced_loader(
         const int sh_id_x = lane_id + (tnx_id_x * warp_size);
         const int sh_id_flat = (tnx_id_z * sh_size_y + tnx_id_y) * sh_size_x + sh_id_x;
 
-        const long gz = bound<(amin_z<0),long>((tnx_id_z + view_offset_z), max_ix_z);
-        const long gy = bound<(amin_y<0),long>((tnx_id_y + view_offset_y), max_ix_y);
-        const long gx = bound<(amin_x<0),long>(( sh_id_x + view_offset_x), max_ix_x);
+        const long gz = bound_if<clamp,(amin_z<0),long>((tnx_id_z + view_offset_z), max_ix_z);
+        const long gy = bound_if<clamp,(amin_y<0),long>((tnx_id_y + view_offset_y), max_ix_y);
+        const long gx = bound_if<clamp,(amin_x<0),long>(( sh_id_x + view_offset_x), max_ix_x);
         const long index = (gz * len_y + gy) * len_x + gx;
 
         if(sh_id_x < sh_size_x){
@@ -428,10 +598,38 @@ void big_tile_3d_inlined_flat_forced_coalesced_loader(
 template<
     const int amin_x, const int amin_y, const int amin_z,
     const int sh_size_x,  const int sh_size_y,  const int sh_size_z,
-    const int group_size_x,  const int group_size_y, const int group_size_z>
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    typename T>
 __device__
 __forceinline__
-void bigtile_cube_reshape_loader(
+void big_tile_3d_inlined_flat_forced_coalesced_loader(
+    const T* A,
+    T tile[],
+    const long len_x, const long len_y, const long len_z,
+    const int loc_flat,
+    const long block_offset_x, const long block_offset_y, const long block_offset_z)
+{
+    const bool interior = tile_in_bounds<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z>
+        (len_x, len_y, len_z, block_offset_x, block_offset_y, block_offset_z);
+    if(interior){
+        big_tile_3d_inlined_flat_forced_coalesced_loader_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z,group_size_x,group_size_y,group_size_z,false>
+            (A, tile, len_x, len_y, len_z, loc_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+    else {
+        big_tile_3d_inlined_flat_forced_coalesced_loader_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z,group_size_x,group_size_y,group_size_z,true>
+            (A, tile, len_x, len_y, len_z, loc_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+}
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int sh_size_x,  const int sh_size_y,  const int sh_size_z,
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    const bool clamp,
+    typename T>
+__device__
+__forceinline__
+void bigtile_cube_reshape_loader_bounded(
     const T* A,
     T tile[],
     const long len_x, const long len_y, const long len_z,
@@ -470,9 +668,9 @@ void bigtile_cube_reshape_loader(
 
         const int sh_id_flat = (row_z * sh_size_y + row_y) * sh_size_x + loc_x;
 
-        const long gz = bound<(amin_z<0),long>((row_z + view_offset_z), max_ix_z);
-        const long gy = bound<(amin_y<0),long>((row_y + view_offset_y), max_ix_y);
-        const long gx = bound<(amin_x<0),long>((loc_x + view_offset_x), max_ix_x);
+        const long gz = bound_if<clamp,(amin_z<0),long>((row_z + view_offset_z), max_ix_z);
+        const long gy = bound_if<clamp,(amin_y<0),long>((row_y + view_offset_y), max_ix_y);
+        const long gx = bound_if<clamp,(amin_x<0),long>((loc_x + view_offset_x), max_ix_x);
         const long index = (gz * len_y + gy) * len_x + gx;
 
         if(loc_x < sh_size_x){
@@ -481,6 +679,32 @@ void bigtile_cube_reshape_loader(
     }
 }
 
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int sh_size_x,  const int sh_size_y,  const int sh_size_z,
+    const int group_size_x,  const int group_size_y, const int group_size_z,
+    typename T>
+__device__
+__forceinline__
+void bigtile_cube_reshape_loader(
+    const T* A,
+    T tile[],
+    const long len_x, const long len_y, const long len_z,
+    const int loc_flat,
+    const long block_offset_x, const long block_offset_y, const long block_offset_z)
+{
+    const bool interior = tile_in_bounds<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z>
+        (len_x, len_y, len_z, block_offset_x, block_offset_y, block_offset_z);
+    if(interior){
+        bigtile_cube_reshape_loader_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z,group_size_x,group_size_y,group_size_z,false>
+            (A, tile, len_x, len_y, len_z, loc_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+    else {
+        bigtile_cube_reshape_loader_bounded<amin_x,amin_y,amin_z,sh_size_x,sh_size_y,sh_size_z,group_size_x,group_size_y,group_size_z,true>
+            (A, tile, len_x, len_y, len_z, loc_flat, block_offset_x, block_offset_y, block_offset_z);
+    }
+}
+
 /*******************************************************************************
  * Versions where the indices are inlined and we are provided a
  * associative and commutative operator with a neutral element
@@ -491,6 +715,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -517,6 +742,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -554,6 +780,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -586,6 +813,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -594,7 +822,7 @@ void big_tile_3d_inlined(
     T* out,
     const long3 lens)
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int3 waste = {
         int(-amin_x + amax_x),
         int(-amin_y + amax_y),
@@ -636,6 +864,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -644,7 +873,7 @@ void big_tile_3d_inlined_flat(
     T* out,
     const long3 lens)
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int3 shared_size = {
         int(group_size_x + (-amin_x + amax_x)),
         int(group_size_y + (-amin_y + amax_y)),
@@ -683,6 +912,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -691,7 +921,7 @@ void big_tile_3d_inlined_trx_align(
     T* out,
     const long3 lens)
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int3 shared_size = {
         int(group_size_x + (-amin_x + amax_x)),
         int(group_size_y + (-amin_y + amax_y)),
@@ -730,6 +960,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -738,7 +969,7 @@ void big_tile_3d_inlined_flat_forced_coalesced(
     T* out,
     const long3 lens)
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int3 shared_size = {
         int(group_size_x + (-amin_x + amax_x)),
         int(group_size_y + (-amin_y + amax_y)),
@@ -777,6 +1008,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -785,7 +1017,7 @@ void big_tile_3d_inlined_cube_reshape(
     T* out,
     const long3 lens)
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int3 shared_size = {
         int(group_size_x + (-amin_x + amax_x)),
         int(group_size_y + (-amin_y + amax_y)),
@@ -825,6 +1057,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -834,7 +1067,7 @@ void big_tile_3d_inlined_flat_singleDim(
     const long3 lens,
     const int3 grid)
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int3 shared_size = {
         int(group_size_x + (-amin_x + amax_x)),
         int(group_size_y + (-amin_y + amax_y)),
@@ -886,6 +1119,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -895,7 +1129,7 @@ void big_tile_3d_inlined_flat_addcarry_singleDim(
     const long3 lens,
     const int3 grid)
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int3 shared_size = {
         int(group_size_x + (-amin_x + amax_x)),
         int(group_size_y + (-amin_y + amax_y)),
@@ -948,6 +1182,7 @@ template
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
 , const int strip_x, const int strip_y, const int strip_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -958,7 +1193,7 @@ void stripmine_big_tile_3d_inlined_flat_addcarry_singleDim(
     const int3 strip_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = -amin_x + strip_x*group_size_x + amax_x;
     constexpr int sh_size_y = -amin_y + strip_y*group_size_y + amax_y;
     constexpr int sh_size_z = -amin_z + strip_z*group_size_z + amax_z;
@@ -1026,6 +1261,7 @@ template
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
 , const int strip_x, const int strip_y, const int strip_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -1036,7 +1272,7 @@ void stripmine_big_tile_3d_inlined_cube_singleDim(
     const int3 strip_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = -amin_x + strip_x*group_size_x + amax_x;
     constexpr int sh_size_y = -amin_y + strip_y*group_size_y + amax_y;
     constexpr int sh_size_z = -amin_z + strip_z*group_size_z + amax_z;
@@ -1110,6 +1346,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -1179,6 +1416,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -1190,7 +1428,7 @@ void virtual_addcarry_big_tile_3d_inlined_flat_divrem_MultiDim(
     const int3 virtual_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = -amin_x + group_size_x + amax_x;
     constexpr int sh_size_y = -amin_y + group_size_y + amax_y;
     constexpr int sh_size_z = -amin_z + group_size_z + amax_z;
@@ -1269,6 +1507,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -1280,7 +1519,7 @@ void virtual_divrem_big_tile_3d_inlined_flat_divrem_singleDim(
     const int3 virtual_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = -amin_x + group_size_x + amax_x;
     constexpr int sh_size_y = -amin_y + group_size_y + amax_y;
     constexpr int sh_size_z = -amin_z + group_size_z + amax_z;
@@ -1339,6 +1578,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -1350,7 +1590,7 @@ void virtual_addcarry_big_tile_3d_inlined_flat_divrem_singleDim(
     const int3 virtual_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = -amin_x + group_size_x + amax_x;
     constexpr int sh_size_y = -amin_y + group_size_y + amax_y;
     constexpr int sh_size_z = -amin_z + group_size_z + amax_z;
@@ -1430,6 +1670,7 @@ template
 < const int amin_x, const int amin_y, const int amin_z
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -1441,7 +1682,7 @@ void virtual_addcarry_big_tile_3d_inlined_flat_addcarry_singleDim(
     const int3 virtual_grid
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = -amin_x + group_size_x + amax_x;
     constexpr int sh_size_y = -amin_y + group_size_y + amax_y;
     constexpr int sh_size_z = -amin_z + group_size_z + amax_z;
@@ -1521,6 +1762,7 @@ template
 , const int amax_x, const int amax_y, const int amax_z
 , const int group_size_x,  const int group_size_y, const int group_size_z
 , const int strip_x, const int strip_y, const int strip_z
+, typename T
 >
 __global__
 __launch_bounds__(BLOCKSIZE)
@@ -1532,7 +1774,7 @@ void virtual_addcarry_stripmine_big_tile_3d_inlined_flat_addcarry_singleDim(
     const int3 virtual_strip
     )
 {
-    extern __shared__ T tile[];
+    EXTERN_SHARED(T, tile);
     constexpr int sh_size_x = -amin_x + strip_x*group_size_x + amax_x;
     constexpr int sh_size_y = -amin_y + strip_y*group_size_y + amax_y;
     constexpr int sh_size_z = -amin_z + strip_z*group_size_z + amax_z;
@@ -0,0 +1,386 @@
+#ifndef STENCIL_OFFSETS
+#define STENCIL_OFFSETS
+
+#include <cuda_runtime.h>
+#include "constants.h"
+#include "cpu-simd.h"
+#include "threadpool.h"
+
+/*******************************************************************************
+ * Stencils given as a compile-time list of offsets instead of a dense box,
+ *     typedef Offsets<O<0,-1>, O<-1,0>, O<0,0>, O<1,0>, O<0,1>> star_2d_r1;
+ * O<x,y,z> is one point, x first as in the template arguments of the box
+ * kernels. The halo is the bounding box of the offsets and no wider, the tile
+ * loaders fetch only the part of each tile row that some thread of the block
+ * reads (and skip rows none reads, e.g. the corners of a star), and the
+ * gather is unrolled over the list. The result is the mean of the points,
+ * summed in the order of the list.
+ * Kernels and engines take any list with the members of Offsets, size, the
+ * extents, lo_x/hi_x and apply/apply_ops, e.g. the weighted lists of
+ * weights.h.
+ */
+
+// the extent of an empty set of offsets.
+#define OFFSETS_NONE (1 << 30)
+
+template<const int x, const int y = 0, const int z = 0>
+struct O {
+    static constexpr int dx = x;
+    static constexpr int dy = y;
+    static constexpr int dz = z;
+};
+
+SIMD_ABI_BEGIN
+template<typename... Os>
+struct Offsets;
+
+template<>
+struct Offsets<> {
+    static constexpr int size = 0;
+    static constexpr int min_x = OFFSETS_NONE;
+    static constexpr int min_y = OFFSETS_NONE;
+    static constexpr int min_z = OFFSETS_NONE;
+    static constexpr int max_x = -OFFSETS_NONE;
+    static constexpr int max_y = -OFFSETS_NONE;
+    static constexpr int max_z = -OFFSETS_NONE;
+
+    MACROLIKE static constexpr int lo_x(const int, const int, const int, const int, const int lo = OFFSETS_NONE){ return lo; }
+    MACROLIKE static constexpr int hi_x(const int, const int, const int, const int, const int hi = -OFFSETS_NONE){ return hi; }
+
+    template<typename Read>
+    MACROLIKE static void accumulate(T&, Read){}
+    template<typename Ops>
+    SIMD_INLINE static void accumulate_ops(typename Ops::V&, const T*, const long, const long){}
+};
+
+template<typename P, typename... Ps>
+struct Offsets<P, Ps...> {
+    typedef Offsets<Ps...> Rest;
+    static constexpr int size = 1 + Rest::size;
+    static constexpr int min_x = P::dx < Rest::min_x ? P::dx : Rest::min_x;
+    static constexpr int min_y = P::dy < Rest::min_y ? P::dy : Rest::min_y;
+    static constexpr int min_z = P::dz < Rest::min_z ? P::dz : Rest::min_z;
+    static constexpr int max_x = P::dx > Rest::max_x ? P::dx : Rest::max_x;
+    static constexpr int max_y = P::dy > Rest::max_y ? P::dy : Rest::max_y;
+    static constexpr int max_z = P::dz > Rest::max_z ? P::dz : Rest::max_z;
+
+    MACROLIKE static constexpr bool in_rows(const int y0, const int y1, const int z0, const int z1){
+        return y0 <= P::dy && P::dy <= y1 && z0 <= P::dz && P::dz <= z1;
+    }
+    // the least and greatest dx of the offsets with dy in [y0, y1] and dz in
+    // [z0, z1], OFFSETS_NONE and -OFFSETS_NONE when there are none.
+    MACROLIKE static constexpr int lo_x(const int y0, const int y1, const int z0, const int z1, const int lo = OFFSETS_NONE){
+        return Rest::lo_x(y0, y1, z0, z1, in_rows(y0, y1, z0, z1) && P::dx < lo ? P::dx : lo);
+    }
+    MACROLIKE static constexpr int hi_x(const int y0, const int y1, const int z0, const int z1, const int hi = -OFFSETS_NONE){
+        return Rest::hi_x(y0, y1, z0, z1, in_rows(y0, y1, z0, z1) && P::dx > hi ? P::dx : hi);
+    }
+
+    // acc += read(dx, dy, dz) for every offset, in order.
+    template<typename Read>
+    MACROLIKE static void accumulate(T& acc, Read read){
+        acc += read(P::dx, P::dy, P::dz);
+        Rest::accumulate(acc, read);
+    }
+
+    // the same over Ops::width points at p in a row, the grid strides sy, sz.
+    template<typename Ops>
+    SIMD_INLINE static void accumulate_ops(typename Ops::V& acc, const T* p, const long sy, const long sz){
+        acc = Ops::add(acc, Ops::load(p + P::dz * sz + P::dy * sy + P::dx));
+        Rest::template accumulate_ops<Ops>(acc, p, sy, sz);
+    }
+
+    // the stencil at a point, read(dx, dy, dz) giving the value at the offset.
+    template<typename Read>
+    MACROLIKE static T apply(Read read){
+        T acc = 0;
+        accumulate(acc, read);
+        return acc / (T)size;
+    }
+
+    template<typename Ops>
+    SIMD_INLINE static typename Ops::V apply_ops(const T* p, const long sy, const long sz){
+        typename Ops::V acc = Ops::zero();
+        accumulate_ops<Ops>(acc, p, sy, sz);
+        return Ops::div(acc, (T)size);
+    }
+};
+SIMD_ABI_END
+
+/*******************************************************************************
+ * Tiles of a block of group_size_x * y * z points and its halo, flat with x
+ * innermost. 1d and 2d stencils use them with the outer sizes and lens at 1.
+ */
+template<typename Offs, const int group_size_x, const int group_size_y, const int group_size_z>
+struct OffsetsTile {
+    static constexpr int size_x = group_size_x + Offs::max_x - Offs::min_x;
+    static constexpr int size_y = group_size_y + Offs::max_y - Offs::min_y;
+    static constexpr int size_z = group_size_z + Offs::max_z - Offs::min_z;
+    static constexpr int size = size_x * size_y * size_z;
+};
+
+template<
+    typename Offs,
+    const int group_size_x, const int group_size_y, const int group_size_z,
+    const bool clamp>
+__device__
+__forceinline__
+void offsets_tile_loader_bounded(
+    const T* A,
+    T* tile,
+    const long3 lens,
+    const int3 local,
+    const long3 block_offset)
+{
+    typedef OffsetsTile<Offs,group_size_x,group_size_y,group_size_z> Tile;
+
+    for(int k = local.z; k < Tile::size_z; k += group_size_z){
+        const long z = bound_if<clamp,(Offs::min_z<0),long>(block_offset.z + Offs::min_z + k, lens.z - 1);
+        for(int j = local.y; j < Tile::size_y; j += group_size_y){
+            const long y = bound_if<clamp,(Offs::min_y<0),long>(block_offset.y + Offs::min_y + j, lens.y - 1);
+            // the offsets that land on this row from some row of the block
+            const int y0 = j + Offs::min_y - (group_size_y - 1);
+            const int z0 = k + Offs::min_z - (group_size_z - 1);
+            const int y1 = j + Offs::min_y;
+            const int z1 = k + Offs::min_z;
+            const int lo = Offs::lo_x(y0, y1, z0, z1) - Offs::min_x;
+            const int hi = Offs::hi_x(y0, y1, z0, z1) - Offs::min_x + group_size_x;
+            const long row = (z * lens.y + y) * lens.x;
+            T* tile_row = &tile[(k * Tile::size_y + j) * Tile::size_x];
+            for(int i = lo + local.x; i < hi; i += group_size_x){
+                const long x = bound_if<clamp,(Offs::min_x<0),long>(block_offset.x + Offs::min_x + i, lens.x - 1);
+                tile_row[i] = A[row + x];
+            }
+        }
+    }
+}
+
+template<typename Offs, const int group_size_x, const int group_size_y, const int group_size_z>
+__device__
+__forceinline__
+void offsets_tile_loader(
+    const T* A,
+    T* tile,
+    const long3 lens,
+    const int3 local,
+    const long3 block_offset)
+{
+    typedef OffsetsTile<Offs,group_size_x,group_size_y,group_size_z> Tile;
+    const bool interior =
+           in_bounds(block_offset.x + Offs::min_x, long(Tile::size_x), lens.x - 1)
+        && in_bounds(block_offset.y + Offs::min_y, long(Tile::size_y), lens.y - 1)
+        && in_bounds(block_offset.z + Offs::min_z, long(Tile::size_z), lens.z - 1);
+    if(interior){
+        offsets_tile_loader_bounded<Offs,group_size_x,group_size_y,group_size_z,false>
+            (A, tile, lens, local, block_offset);
+    }
+    else {
+        offsets_tile_loader_bounded<Offs,group_size_x,group_size_y,group_size_z,true>
+            (A, tile, lens, local, block_offset);
+    }
+}
+
+template<typename Offs, const int group_size_x, const int group_size_y, const int group_size_z>
+__device__
+__forceinline__
+void write_from_offsets_tile(
+    const T* tile,
+    T* out,
+    const long3 lens,
+    const int3 local,
+    const long3 block_offset)
+{
+    typedef OffsetsTile<Offs,group_size_x,group_size_y,group_size_z> Tile;
+    const long gid_x = block_offset.x + local.x;
+    const long gid_y = block_offset.y + local.y;
+    const long gid_z = block_offset.z + local.z;
+    if(gid_x < lens.x && gid_y < lens.y && gid_z < lens.z){
+        const int base = ((local.z - Offs::min_z) * Tile::size_y + (local.y - Offs::min_y)) * Tile::size_x
+                       + (local.x - Offs::min_x);
+        out[(gid_z * lens.y + gid_y) * lens.x + gid_x] = Offs::apply(
+            [&](const int dx, const int dy, const int dz){
+                return tile[base + (dz * Tile::size_y + dy) * Tile::size_x + dx]; });
+    }
+}
+
+// only points whose offsets reach over the grid border pay for the clamps.
+template<typename Offs>
+__device__ __host__
+__forceinline__
+void read_write_offsets(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const long gid_x, const long gid_y, const long gid_z)
+{
+    const bool interior =
+           in_bounds(gid_x + Offs::min_x, long(Offs::max_x - Offs::min_x + 1), lens.x - 1)
+        && in_bounds(gid_y + Offs::min_y, long(Offs::max_y - Offs::min_y + 1), lens.y - 1)
+        && in_bounds(gid_z + Offs::min_z, long(Offs::max_z - Offs::min_z + 1), lens.z - 1);
+    const long gid = (gid_z * lens.y + gid_y) * lens.x + gid_x;
+    if(interior){
+        out[gid] = Offs::apply([&](const int dx, const int dy, const int dz){
+            return A[gid + (dz * lens.y + dy) * lens.x + dx]; });
+    }
+    else {
+        out[gid] = Offs::apply([&](const int dx, const int dy, const int dz){
+            const long z = bound<true>(gid_z + dz, lens.z - 1);
+            const long y = bound<true>(gid_y + dy, lens.y - 1);
+            const long x = bound<true>(gid_x + dx, lens.x - 1);
+            return A[(z * lens.y + y) * lens.x + x]; });
+    }
+}
+
+/*******************************************************************************
+ * Kernels, with the grids and blocks of the multiDim kernels of the box
+ * stencils.
+ */
+template<typename Offs, const int group_size>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void global_reads_1d_offsets(
+    const T* A,
+    T* out,
+    const long nx)
+{
+    const long gid = long(blockIdx.x) * group_size + threadIdx.x;
+    const long3 lens = { nx, 1, 1 };
+    if(gid < nx){
+        read_write_offsets<Offs>(A, out, lens, gid, 0, 0);
+    }
+}
+
+template<typename Offs, const int group_size>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_1d_offsets(
+    const T* A,
+    T* out,
+    const long nx)
+{
+    __shared__ T tile[OffsetsTile<Offs,group_size,1,1>::size];
+    const long3 lens = { nx, 1, 1 };
+    const int3 local = { int(threadIdx.x), 0, 0 };
+    const long3 block_offset = { long(blockIdx.x) * group_size, 0, 0 };
+
+    offsets_tile_loader<Offs,group_size,1,1>(A, tile, lens, local, block_offset);
+    __syncthreads();
+    write_from_offsets_tile<Offs,group_size,1,1>(tile, out, lens, local, block_offset);
+}
+
+template<typename Offs, const int group_size_x, const int group_size_y>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void global_reads_2d_offsets(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    const long gid_x = long(blockIdx.x) * group_size_x + threadIdx.x;
+    const long gid_y = long(blockIdx.y) * group_size_y + threadIdx.y;
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    if(gid_x < lens.x && gid_y < lens.y){
+        read_write_offsets<Offs>(A, out, lens3, gid_x, gid_y, 0);
+    }
+}
+
+template<typename Offs, const int group_size_x, const int group_size_y>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_2d_offsets(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    __shared__ T tile[OffsetsTile<Offs,group_size_x,group_size_y,1>::size];
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    const int3 local = { int(threadIdx.x), int(threadIdx.y), 0 };
+    const long3 block_offset = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        0 };
+
+    offsets_tile_loader<Offs,group_size_x,group_size_y,1>(A, tile, lens3, local, block_offset);
+    __syncthreads();
+    write_from_offsets_tile<Offs,group_size_x,group_size_y,1>(tile, out, lens3, local, block_offset);
+}
+
+template<typename Offs, const int group_size_x, const int group_size_y, const int group_size_z>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void global_reads_3d_offsets(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    const long gid_x = long(blockIdx.x) * group_size_x + threadIdx.x;
+    const long gid_y = long(blockIdx.y) * group_size_y + threadIdx.y;
+    const long gid_z = long(blockIdx.z) * group_size_z + threadIdx.z;
+    if(gid_x < lens.x && gid_y < lens.y && gid_z < lens.z){
+        read_write_offsets<Offs>(A, out, lens, gid_x, gid_y, gid_z);
+    }
+}
+
+template<typename Offs, const int group_size_x, const int group_size_y, const int group_size_z>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_3d_offsets(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    __shared__ T tile[OffsetsTile<Offs,group_size_x,group_size_y,group_size_z>::size];
+    const int3 local = { int(threadIdx.x), int(threadIdx.y), int(threadIdx.z) };
+    const long3 block_offset = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        long(blockIdx.z) * group_size_z };
+
+    offsets_tile_loader<Offs,group_size_x,group_size_y,group_size_z>(A, tile, lens, local, block_offset);
+    __syncthreads();
+    write_from_offsets_tile<Offs,group_size_x,group_size_y,group_size_z>(tile, out, lens, local, block_offset);
+}
+
+/*******************************************************************************
+ * Host references, one row of the grid per task.
+ */
+template<typename Offs>
+__host__
+void stencil_1d_cpu_offsets(const T* A, T* out, const long nx)
+{
+    const long3 lens = { nx, 1, 1 };
+    const long rows = divUp(nx, long(CPU_TILE_1D));
+    host_pool().parallel_for(rows, [&](const long row, const int){
+        const long end = min(nx, (row + 1) * CPU_TILE_1D);
+        for(long gid = row * CPU_TILE_1D; gid < end; gid++){
+            read_write_offsets<Offs>(A, out, lens, gid, 0, 0);
+        }
+    });
+}
+
+template<typename Offs>
+__host__
+void stencil_2d_cpu_offsets(const T* A, T* out, const long2 lens)
+{
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    host_pool().parallel_for(lens.y, [&](const long gid_y, const int){
+        for(long gid_x = 0; gid_x < lens.x; gid_x++){
+            read_write_offsets<Offs>(A, out, lens3, gid_x, gid_y, 0);
+        }
+    });
+}
+
+template<typename Offs>
+__host__
+void stencil_3d_cpu_offsets(const T* A, T* out, const long3 lens)
+{
+    host_pool().parallel_for(lens.z * lens.y, [&](const long row, const int){
+        const long gid_z = row / lens.y;
+        const long gid_y = row % lens.y;
+        for(long gid_x = 0; gid_x < lens.x; gid_x++){
+            read_write_offsets<Offs>(A, out, lens, gid_x, gid_y, gid_z);
+        }
+    });
+}
+
+#endif
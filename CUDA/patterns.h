@@ -0,0 +1,269 @@
+#ifndef STENCIL_PATTERNS
+#define STENCIL_PATTERNS
+
+#include <cuda_runtime.h>
+#include <type_traits>
+#include "constants.h"
+#include "offsets.h"
+
+/*******************************************************************************
+ * Families of symmetric stencils, chosen per kernel instead of per build as
+ * with Jacobi2D/Jacobi3D:
+ *     Box<rx,ry,rz>       every point of [-r..r] per axis
+ *     Star<rx,ry,rz>      the axes through the centre, the Jacobi cross
+ *     Diagonal<rx,ry,rz>  the diagonals through the centre, equal radii
+ * An axis with radius 0 is not used, e.g. Star<1,1> is the 5 point star.
+ * Every pattern is an offset list (offsets.h), in the z, y, x order in which
+ * stencil_fun_* sums the box, and takes the mean of its points; the box
+ * pattern gives the result of the box stencils of a build without Jacobi.
+ *
+ * big_tile_2d/3d_pattern stage a star in a tile without corners: the rows of
+ * the block with the x arms, and the y and z arms only where they leave the
+ * block, so neither the loads nor the shared memory cover the corners of the
+ * bounding box. The other patterns use the tile of their offset list.
+ */
+template<const int rx, const int ry = 0, const int rz = 0>
+struct Box {
+    static constexpr int radius_x = rx, radius_y = ry, radius_z = rz;
+    MACROLIKE static constexpr bool keep(const int, const int, const int){ return true; }
+};
+
+template<const int rx, const int ry = 0, const int rz = 0>
+struct Star {
+    static constexpr int radius_x = rx, radius_y = ry, radius_z = rz;
+    MACROLIKE static constexpr bool keep(const int x, const int y, const int z){
+        return (y == 0 && z == 0) || (x == 0 && z == 0) || (x == 0 && y == 0);
+    }
+};
+
+template<const int rx, const int ry = 0, const int rz = 0>
+struct Diagonal {
+    static_assert((ry == 0 || ry == rx) && (rz == 0 || rz == rx), "the diagonals need equal radii");
+    static constexpr int radius_x = rx, radius_y = ry, radius_z = rz;
+    MACROLIKE static constexpr int abs_of(const int a){ return a < 0 ? -a : a; }
+    MACROLIKE static constexpr bool keep(const int x, const int y, const int z){
+        return (ry == 0 || abs_of(y) == abs_of(x)) && (rz == 0 || abs_of(z) == abs_of(x));
+    }
+};
+
+template<typename A, typename B>
+struct offsets_cat;
+
+template<typename... As, typename... Bs>
+struct offsets_cat<Offsets<As...>, Offsets<Bs...>> {
+    typedef Offsets<As..., Bs...> type;
+};
+
+// the kept points among the ones with flat index in [begin, end) of the
+// bounding box, split in halves to keep the instantiation depth logarithmic.
+template<typename Pattern, const int begin, const int end, const bool leaf = (end - begin == 1)>
+struct pattern_points {
+    typedef typename offsets_cat
+        <typename pattern_points<Pattern, begin, (begin + end) / 2>::type
+        ,typename pattern_points<Pattern, (begin + end) / 2, end>::type
+        >::type type;
+};
+
+template<typename Pattern, const int begin, const int end>
+struct pattern_points<Pattern, begin, end, true> {
+    static constexpr int range_x = 2 * Pattern::radius_x + 1;
+    static constexpr int range_y = 2 * Pattern::radius_y + 1;
+    static constexpr int x = begin % range_x - Pattern::radius_x;
+    static constexpr int y = begin / range_x % range_y - Pattern::radius_y;
+    static constexpr int z = begin / range_x / range_y - Pattern::radius_z;
+    typedef typename std::conditional<Pattern::keep(x, y, z), Offsets<O<x,y,z>>, Offsets<>>::type type;
+};
+
+template<typename Pattern>
+struct pattern_offsets {
+    static constexpr int box_size =
+          (2 * Pattern::radius_x + 1)
+        * (2 * Pattern::radius_y + 1)
+        * (2 * Pattern::radius_z + 1);
+    typedef typename pattern_points<Pattern, 0, box_size>::type type;
+};
+
+/*******************************************************************************
+ * Tiles. PatternTile<Pattern, ...>::load_and_write stages the block's tile
+ * and writes its outputs; between the two the block synchronizes.
+ */
+template<typename Pattern, const int group_size_x, const int group_size_y, const int group_size_z>
+struct PatternTile {
+    typedef typename pattern_offsets<Pattern>::type Offs;
+    typedef OffsetsTile<Offs,group_size_x,group_size_y,group_size_z> Tile;
+    static constexpr int size = Tile::size;
+
+    __device__
+    static void load_and_write(
+        T* tile,
+        const T* A,
+        T* out,
+        const long3 lens,
+        const int3 local,
+        const long3 block_offset)
+    {
+        offsets_tile_loader<Offs,group_size_x,group_size_y,group_size_z>(A, tile, lens, local, block_offset);
+        __syncthreads();
+        write_from_offsets_tile<Offs,group_size_x,group_size_y,group_size_z>(tile, out, lens, local, block_offset);
+    }
+};
+
+/*
+ * The star tile in three parts, each flat with x innermost:
+ *   rows   the block's rows with the x arms, [gz][gy][gx + 2rx]
+ *   arms_y the rows of the y arms outside the block, [gz][2ry][gx]
+ *   arms_z the rows of the z arms outside the block, [2rz][gy][gx]
+ * Of a radius 4 star on a 32x4x2 block that is 1856 elements against the
+ * 4800 of its bounding box.
+ */
+template<const int rx, const int ry, const int rz, const int group_size_x, const int group_size_y, const int group_size_z>
+struct PatternTile<Star<rx,ry,rz>,group_size_x,group_size_y,group_size_z> {
+    typedef typename pattern_offsets<Star<rx,ry,rz>>::type Offs;
+    static constexpr int row_x = group_size_x + 2 * rx;
+    static constexpr int rows_size = group_size_z * group_size_y * row_x;
+    static constexpr int arms_y_size = group_size_z * 2 * ry * group_size_x;
+    static constexpr int arms_z_size = 2 * rz * group_size_y * group_size_x;
+    static constexpr int size = rows_size + arms_y_size + arms_z_size;
+    static constexpr int group_size = group_size_x * group_size_y * group_size_z;
+    // the arm rows per block row, 1 rather than 0 to divide by.
+    static constexpr int arm_rows_y = ry > 0 ? 2 * ry : 1;
+
+    // clamps every coordinate with clamp, as the edge blocks may also reach
+    // past the end of the grid inside the block.
+    template<const bool clamp>
+    __device__
+    __forceinline__
+    static void load(
+        T* tile,
+        const T* A,
+        const long3 lens,
+        const int local_flat,
+        const long3 block_offset)
+    {
+        T* rows = tile;
+        T* arms_y = rows + rows_size;
+        T* arms_z = arms_y + arms_y_size;
+        const long max_x = lens.x - 1;
+        const long max_y = lens.y - 1;
+        const long max_z = lens.z - 1;
+        for(int i = local_flat; i < rows_size; i += group_size){
+            const int x = i % row_x;
+            const int y = i / row_x % group_size_y;
+            const int z = i / row_x / group_size_y;
+            const long gx = bound_if<clamp,true,long>(block_offset.x + x - rx, max_x);
+            const long gy = bound_if<clamp,true,long>(block_offset.y + y, max_y);
+            const long gz = bound_if<clamp,true,long>(block_offset.z + z, max_z);
+            rows[i] = A[(gz * lens.y + gy) * lens.x + gx];
+        }
+        for(int i = local_flat; i < arms_y_size; i += group_size){
+            const int x = i % group_size_x;
+            const int j = i / group_size_x % arm_rows_y;
+            const int z = i / group_size_x / arm_rows_y;
+            const int y = j < ry ? j - ry : group_size_y + j - ry;
+            const long gx = bound_if<clamp,true,long>(block_offset.x + x, max_x);
+            const long gy = bound_if<clamp,true,long>(block_offset.y + y, max_y);
+            const long gz = bound_if<clamp,true,long>(block_offset.z + z, max_z);
+            arms_y[i] = A[(gz * lens.y + gy) * lens.x + gx];
+        }
+        for(int i = local_flat; i < arms_z_size; i += group_size){
+            const int x = i % group_size_x;
+            const int y = i / group_size_x % group_size_y;
+            const int k = i / group_size_x / group_size_y;
+            const int z = k < rz ? k - rz : group_size_z + k - rz;
+            const long gx = bound_if<clamp,true,long>(block_offset.x + x, max_x);
+            const long gy = bound_if<clamp,true,long>(block_offset.y + y, max_y);
+            const long gz = bound_if<clamp,true,long>(block_offset.z + z, max_z);
+            arms_z[i] = A[(gz * lens.y + gy) * lens.x + gx];
+        }
+    }
+
+    __device__
+    static void load_and_write(
+        T* tile,
+        const T* A,
+        T* out,
+        const long3 lens,
+        const int3 local,
+        const long3 block_offset)
+    {
+        const int local_flat = (local.z * group_size_y + local.y) * group_size_x + local.x;
+        const bool interior =
+               in_bounds(block_offset.x - rx, long(row_x), lens.x - 1)
+            && in_bounds(block_offset.y - ry, long(group_size_y + 2 * ry), lens.y - 1)
+            && in_bounds(block_offset.z - rz, long(group_size_z + 2 * rz), lens.z - 1);
+        if(interior){
+            load<false>(tile, A, lens, local_flat, block_offset);
+        }
+        else {
+            load<true>(tile, A, lens, local_flat, block_offset);
+        }
+        __syncthreads();
+
+        const long gid_x = block_offset.x + local.x;
+        const long gid_y = block_offset.y + local.y;
+        const long gid_z = block_offset.z + local.z;
+        if(gid_x < lens.x && gid_y < lens.y && gid_z < lens.z){
+            const T* rows = tile;
+            const T* arms_y = rows + rows_size;
+            const T* arms_z = arms_y + arms_y_size;
+            const int row = (local.z * group_size_y + local.y) * row_x + rx + local.x;
+            out[(gid_z * lens.y + gid_y) * lens.x + gid_x] = Offs::apply(
+                [&](const int dx, const int dy, const int dz){
+                    if(dy != 0){
+                        const int y = local.y + dy;
+                        if(0 <= y && y < group_size_y){ return rows[row + dy * row_x]; }
+                        const int j = y < 0 ? y + ry : y - group_size_y + ry;
+                        return arms_y[(local.z * 2 * ry + j) * group_size_x + local.x];
+                    }
+                    if(dz != 0){
+                        const int z = local.z + dz;
+                        if(0 <= z && z < group_size_z){ return rows[row + dz * group_size_y * row_x]; }
+                        const int k = z < 0 ? z + rz : z - group_size_z + rz;
+                        return arms_z[(k * group_size_y + local.y) * group_size_x + local.x];
+                    }
+                    return rows[row + dx]; });
+        }
+    }
+};
+
+/*******************************************************************************
+ * Kernels, with the grids and blocks of the offset list kernels.
+ */
+template<typename Pattern, const int group_size_x, const int group_size_y>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_2d_pattern(
+    const T* A,
+    T* out,
+    const long2 lens)
+{
+    typedef PatternTile<Pattern,group_size_x,group_size_y,1> Tile;
+    __shared__ T tile[Tile::size];
+    const long3 lens3 = { lens.x, lens.y, 1 };
+    const int3 local = { int(threadIdx.x), int(threadIdx.y), 0 };
+    const long3 block_offset = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        0 };
+    Tile::load_and_write(tile, A, out, lens3, local, block_offset);
+}
+
+template<typename Pattern, const int group_size_x, const int group_size_y, const int group_size_z>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_3d_pattern(
+    const T* A,
+    T* out,
+    const long3 lens)
+{
+    typedef PatternTile<Pattern,group_size_x,group_size_y,group_size_z> Tile;
+    __shared__ T tile[Tile::size];
+    const int3 local = { int(threadIdx.x), int(threadIdx.y), int(threadIdx.z) };
+    const long3 block_offset = {
+        long(blockIdx.x) * group_size_x,
+        long(blockIdx.y) * group_size_y,
+        long(blockIdx.z) * group_size_z };
+    Tile::load_and_write(tile, A, out, lens, local, block_offset);
+}
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef RUNNERS
 #define RUNNERS
 
+#include <string.h>
+#include <limits>
 #include"constants.h"
+#include "cpu-arena.h"
 
 #define GPU_RUN_INIT \
     struct timeval t_startpar, t_endpar, t_diffpar;\
@@ -90,12 +93,56 @@ void measure_memset_bandwidth(const int mem_size){
     CUDASSERT(cudaFree(gpu_array_in));\
 }
 
-bool validate(const T* A, const T* B, unsigned int sizeAB){
+// copies in to out share by share, once with the workers of each numa node
+// alone and once with all of them; in and out are placed by place_grids.
+template<typename T>
+void measure_host_bandwidth_per_node(const T* in, T* out, const long len){
+    struct timeval t_startpar, t_endpar, t_diffpar;
+    ThreadPool& pool = host_pool();
+    const unsigned RUNS = 20;
+    printf("## Benchmark host copy per numa node - %d nodes - %d threads ##\n", pool.n_nodes(), pool.size());
+    for(int node = -1; node < pool.n_nodes(); node++){
+        long bytes = 0;
+        int threads = 0;
+        for(int w = 0; w < pool.size(); w++){
+            if(node >= 0 && pool.node_of_worker(w) != node){ continue; }
+            long begin, end;
+            worker_share(len, w, pool.size(), begin, end);
+            bytes += (end - begin)*sizeof(T);
+            threads++;
+        }
+        gettimeofday(&t_startpar, NULL);
+        for(unsigned x = 0; x < RUNS; x++){
+            pool.for_each_worker([&](const long, const int w){
+                if(node >= 0 && pool.node_of_worker(w) != node){ return; }
+                long begin, end;
+                worker_share(len, w, pool.size(), begin, end);
+                memcpy(out + begin, in + begin, (end - begin)*sizeof(T));
+            });
+        }
+        gettimeofday(&t_endpar, NULL);
+        timeval_subtract(&t_diffpar, &t_endpar, &t_startpar);
+        unsigned long elapsed = t_diffpar.tv_sec*1e6+t_diffpar.tv_usec;
+        elapsed /= RUNS;
+        const int n_reads_writes = 1 + 1;
+        const double GBperSec = double(bytes) * n_reads_writes / max(elapsed, 1UL) / 1e3;
+        if(node < 0){ printf("    all nodes"); }
+        else { printf("    node %d", node); }
+        printf(" (%d threads): mean %lu microseconds, %lf GiBs\n", threads, elapsed, GBperSec);
+    }
+}
+
+// rel_tol > 0 is for engines that sum in another order than stencil_fun_*;
+// their results may then differ from the reference by its rounding error.
+// Elements are compared as doubles, whatever their type.
+template<typename E>
+bool validate(const E* A, const E* B, unsigned int sizeAB, const double rel_tol = 0){
     int c = 0;
     for(unsigned i = 0; i < sizeAB; i++){
-        const T va = A[i];
-        const T vb = B[i];
-        if (fabs(va - vb) > 0.00001 || std::isnan(va) || std::isinf(va) || std::isnan(vb) || std::isinf(vb)){
+        const double va = double(A[i]);
+        const double vb = double(B[i]);
+        const double tol = max(0.00001, rel_tol * fabs(va));
+        if (fabs(va - vb) > tol || std::isnan(va) || std::isinf(va) || std::isnan(vb) || std::isinf(vb)){
                     printf("INVALID RESULT at index %d: (expected, actual) == (%f, %f)\n",
                             i, va, vb);
             c++;
@@ -106,6 +153,29 @@ bool validate(const T* A, const T* B, unsigned int sizeAB){
     return c == 0;
 }
 
+// relative error bound of the reference when summing n values, e.g. for
+// engines that compute the same mean from exact running sums. Types stored
+// narrower than they sum add the rounding of their store.
+template<typename E = T>
+inline __host__
+double reassociation_tolerance(const int n){
+    const double acc_eps = ElemTraits<ElemAcc<E> >::epsilon();
+    const double store_eps = ElemTraits<E>::epsilon();
+    return double(n + 1) * acc_eps + (store_eps > acc_eps ? store_eps : 0);
+}
+
+// test data: rand() as always for float and double, and for the narrow types
+// integers they hold exactly.
+template<typename E>
+inline __host__
+E elem_random(){ return E(rand()); }
+template<>
+inline __host__
+int8_t elem_random<int8_t>(){ return int8_t(rand() % 256 - 128); }
+template<>
+inline __host__
+half_t elem_random<half_t>(){ return half_t(float(rand() % 2048)); }
+
 template<int D>
 inline __host__
 T stencil_fun_cpu(const T* tmp)
@@ -120,27 +190,49 @@ T stencil_fun_cpu(const T* tmp)
     return acc;
 }
 
-using Kernel1dVirtual = void (*)(const T*, T*, const long, const int, const int);
-using Kernel1dPhysMultiDim = void(*)(const T*, T*, const long);
-using Kernel1dPhysStripDim = void(*)(const T*, T*, const long);
+template<typename E> using Kernel1dVirtualOf = void (*)(const E*, E*, const long, const int, const int);
+template<typename E> using Kernel1dPhysMultiDimOf = void(*)(const E*, E*, const long);
+template<typename E> using Kernel1dPhysStripDimOf = void(*)(const E*, E*, const long);
+template<typename E> using Kernel1dHostOf = void(*)(const E*, E*, const long);
+
+template<typename E> using Kernel2dVirtualOf = void (*)(const E*, E*, const long2, const int, const int2);
+template<typename E> using Kernel2dPhysMultiDimOf = void(*)(const E*, E*, const long2);
+template<typename E> using Kernel2dPhysSingleDimOf = void(*)(const E*, E*, const long2, const int2);
+template<typename E> using Kernel2dHostOf = void(*)(const E*, E*, const long2);
+
+template<typename E> using Kernel3dVirtualOf = void (*)(const E*, E*, const long3, const int, const int3);
+template<typename E> using Kernel3dPhysMultiDimOf = void(*)(const E*, E*, const long3);
+template<typename E> using Kernel3dPhysSingleDimOf = void(*)(const E*, E*, const long3, const int3);
+template<typename E> using Kernel3dHostOf = void(*)(const E*, E*, const long3);
 
-using Kernel2dVirtual = void (*)(const T*, T*, const long2, const int, const int2);
-using Kernel2dPhysMultiDim = void(*)(const T*, T*, const long2);
-using Kernel2dPhysSingleDim = void(*)(const T*, T*, const long2, const int2);
+using Kernel1dVirtual = Kernel1dVirtualOf<T>;
+using Kernel1dPhysMultiDim = Kernel1dPhysMultiDimOf<T>;
+using Kernel1dPhysStripDim = Kernel1dPhysStripDimOf<T>;
+using Kernel1dHost = Kernel1dHostOf<T>;
+
+using Kernel2dVirtual = Kernel2dVirtualOf<T>;
+using Kernel2dPhysMultiDim = Kernel2dPhysMultiDimOf<T>;
+using Kernel2dPhysSingleDim = Kernel2dPhysSingleDimOf<T>;
+using Kernel2dHost = Kernel2dHostOf<T>;
+
+using Kernel3dVirtual = Kernel3dVirtualOf<T>;
+using Kernel3dPhysMultiDim = Kernel3dPhysMultiDimOf<T>;
+using Kernel3dPhysSingleDim = Kernel3dPhysSingleDimOf<T>;
+using Kernel3dHost = Kernel3dHostOf<T>;
 
-using Kernel3dVirtual = void (*)(const T*, T*, const long3, const int, const int3);
-using Kernel3dPhysMultiDim = void(*)(const T*, T*, const long3);
-using Kernel3dPhysSingleDim = void(*)(const T*, T*, const long3, const int3);
 template<
     typename L,
     typename I,
     typename KV,
     typename KPMD,
-    typename KPSD>
+    typename KPSD,
+    typename KH,
+    typename T = DefaultElem>
 class Globs {
     public :
         struct timeval start_stamp, end_stamp;
         long RUNS;
+        long HOST_RUNS;
         long mem_size;
         long tlen;
         L lens;
@@ -150,16 +242,21 @@ class Globs {
         T* gpu_array_in;
 
         __host__
-        Globs(L arrlens, const long totallen, const long runsv){
+        Globs(L arrlens, const long totallen, const long runsv, const long host_runsv){
             lens = arrlens;
             tlen = totallen;
             RUNS = runsv;
+#ifdef HOST_EMULATION
+            // emulated kernel times say nothing about a gpu; one run validates.
+            RUNS = 1;
+#endif
+            HOST_RUNS = host_runsv;
             mem_size = tlen*sizeof(T);
             const long out_start = 2*tlen;
             const long alloc_sizes = mem_size*3;
-            arr_in = (T*)malloc(alloc_sizes);
+            arr_in = host_arena().acquire<T>(tlen, 3);
             srand(1);
-            for(int i=0; i<tlen; i++){ arr_in[i] = (T)rand(); }
+            for(int i=0; i<tlen; i++){ arr_in[i] = elem_random<T>(); }
             CUDASSERT(cudaMalloc((void **) &gpu_array_in, alloc_sizes));
             CUDASSERT(cudaGetLastError()); // check cuda for errors
             arr_out = &arr_in[out_start];
@@ -172,7 +269,7 @@ class Globs {
         }
         __host__
         ~Globs(void){
-            free(arr_in);
+            host_arena().release(arr_in);
             CUDASSERT(cudaFree(gpu_array_in));
         }
         __host__
@@ -196,17 +293,20 @@ class Globs {
         }
 
         __host__
-        void check_output(const T* cpu_out, const bool should_print, const long elapsed){
-            CUDASSERT(cudaMemcpy(arr_out, gpu_array_out, mem_size, cudaMemcpyDeviceToHost));
-            CUDASSERT(cudaDeviceSynchronize());
-            const long average_elapsed = elapsed / RUNS;
+        void report_output(const T* cpu_out, const bool should_print, const long average_elapsed, const double rel_tol = 0){
             if(should_print){
                 printf(" : mean %ld microseconds\n", average_elapsed);
-                if (!validate(cpu_out,arr_out,tlen)){
+                TRAFFIC_REPORT();
+                if (!validate(cpu_out,arr_out,tlen,rel_tol)){
                     printf("%s\n", "   FAILED TO VALIDATE");
                 }
             }
-
+        }
+        __host__
+        void check_output(const T* cpu_out, const bool should_print, const long elapsed){
+            CUDASSERT(cudaMemcpy(arr_out, gpu_array_out, mem_size, cudaMemcpyDeviceToHost));
+            CUDASSERT(cudaDeviceSynchronize());
+            report_output(cpu_out, should_print, elapsed / RUNS);
         }
         __host__
         void do_run_multiDim(
@@ -218,13 +318,15 @@ class Globs {
                 , const bool should_print=true){
             reset_output();
             long time_acc = 0;
+            TRAFFIC_BEGIN();
             for(unsigned x = 0; x < RUNS; x++){
                 startTimer();
-                call<<<grid,block,sh_size_bytes>>>(gpu_array_in, gpu_array_out, lens);
+                LAUNCH(call, grid, block, sh_size_bytes)(gpu_array_in, gpu_array_out, lens);
                 CUDASSERT(cudaGetLastError()); // check cuda for errors
                 CUDASSERT(cudaDeviceSynchronize());
                 time_acc += endTimer();
             }
+            TRAFFIC_END(RUNS*tlen);
             check_output(cpu_out, should_print, time_acc);
         };
         __host__
@@ -238,13 +340,15 @@ class Globs {
                 , bool should_print=true){
             reset_output();
             long time_acc = 0;
+            TRAFFIC_BEGIN();
             for(unsigned x = 0; x < RUNS; x++){
                 startTimer();
-                call<<<grid_flat,block_flat, sh_size_bytes>>>(gpu_array_in, gpu_array_out, lens, grid);
+                LAUNCH(call, grid_flat, block_flat, sh_size_bytes)(gpu_array_in, gpu_array_out, lens, grid);
                 CUDASSERT(cudaGetLastError()); // check cuda for errors
                 CUDASSERT(cudaDeviceSynchronize());
                 time_acc += endTimer();
             }
+            TRAFFIC_END(RUNS*tlen);
             check_output(cpu_out, should_print, time_acc);
         };
         __host__
@@ -256,13 +360,15 @@ class Globs {
                 , bool should_print=true){
             reset_output();
             long time_acc = 0;
+            TRAFFIC_BEGIN();
             for(unsigned x = 0; x < RUNS; x++){
                 startTimer();
-                call<<<grid_flat,block_flat>>>(gpu_array_in, gpu_array_out, lens);
+                LAUNCH(call, grid_flat, block_flat, 0)(gpu_array_in, gpu_array_out, lens);
                 CUDASSERT(cudaGetLastError()); // check cuda for errors
                 CUDASSERT(cudaDeviceSynchronize());
                 time_acc += endTimer();
             }
+            TRAFFIC_END(RUNS*tlen);
             check_output(cpu_out, should_print, time_acc);
         };
 
@@ -277,17 +383,58 @@ class Globs {
                 , bool should_print=true){
             reset_output();
             long time_acc = 0;
+            TRAFFIC_BEGIN();
             for(unsigned x = 0; x < RUNS; x++){
                 startTimer();
 
-                call<<<num_phys_groups,blocksize, sh_size_bytes>>>
+                LAUNCH(call, num_phys_groups, blocksize, sh_size_bytes)
                     (gpu_array_in, gpu_array_out, lens, num_phys_groups, virtual_grid);
                 CUDASSERT(cudaGetLastError()); // check cuda for errors
                 CUDASSERT(cudaDeviceSynchronize());
                 time_acc += endTimer();
             }
+            TRAFFIC_END(RUNS*tlen);
             check_output(cpu_out, should_print, time_acc);
         };
+
+        template<typename Launch>
+        __host__
+        void do_run_launch( // launches picked at run time, e.g. by shape (shapes.h)
+                Launch launch
+                , const T* cpu_out
+                , bool should_print=true){
+            reset_output();
+            long time_acc = 0;
+            TRAFFIC_BEGIN();
+            for(unsigned x = 0; x < RUNS; x++){
+                startTimer();
+                launch(gpu_array_in, gpu_array_out, lens);
+                CUDASSERT(cudaGetLastError()); // check cuda for errors
+                CUDASSERT(cudaDeviceSynchronize());
+                time_acc += endTimer();
+            }
+            TRAFFIC_END(RUNS*tlen);
+            check_output(cpu_out, should_print, time_acc);
+        };
+
+        template<typename Call = KH>
+        __host__
+        void do_run_host( // host engines read arr_in and write arr_out directly
+                Call call
+                , const T* cpu_out
+                , bool should_print=true
+                , const double rel_tol=0){
+            memset(arr_out, 0, mem_size);
+            long time_acc = 0;
+            TRAFFIC_BEGIN();
+            for(unsigned x = 0; x < HOST_RUNS; x++){
+                startTimer();
+                call(arr_in, arr_out, lens);
+                time_acc += endTimer();
+            }
+            TRAFFIC_END(HOST_RUNS*tlen);
+            report_output(cpu_out, should_print, time_acc / HOST_RUNS, rel_tol);
+        };
 };
 
 template<const int blocksize_flat>
@@ -331,4 +478,129 @@ int getPhysicalBlockCount(void){
     return runningBlocksTotal;
 }
 
+/*
+ * The grids of a coupled stencil (fields.h), n_in inputs of random values and
+ * n_out outputs, on the host and the gpu. Every output is validated.
+ */
+template<typename L, const int n_in, const int n_out>
+class FieldGlobs {
+    public :
+        struct timeval start_stamp, end_stamp;
+        long RUNS;
+        long HOST_RUNS;
+        long mem_size;
+        long tlen;
+        L lens;
+        T* arr;
+        T* gpu_arr;
+        FieldPtrs<n_in> in;
+        FieldPtrs<n_out> out;
+        FieldPtrs<n_in> gpu_in;
+        FieldPtrs<n_out> gpu_out;
+
+        __host__
+        FieldGlobs(L arrlens, const long totallen, const long runsv, const long host_runsv){
+            lens = arrlens;
+            tlen = totallen;
+            RUNS = runsv;
+#ifdef HOST_EMULATION
+            RUNS = 1;
+#endif
+            HOST_RUNS = host_runsv;
+            mem_size = tlen*sizeof(T);
+            arr = host_arena().acquire(tlen, n_in + n_out);
+            CUDASSERT(cudaMalloc((void **) &gpu_arr, mem_size*(n_in + n_out)));
+            for(int f = 0; f < n_in; f++){
+                in.at[f] = arr + f*tlen;
+                gpu_in.at[f] = gpu_arr + f*tlen;
+            }
+            for(int f = 0; f < n_out; f++){
+                out.at[f] = arr + (n_in + f)*tlen;
+                gpu_out.at[f] = gpu_arr + (n_in + f)*tlen;
+            }
+            srand(1);
+            for(long i=0; i<n_in*tlen; i++){ arr[i] = (T)rand(); }
+            CUDASSERT(cudaMemcpy(gpu_arr, arr, n_in*mem_size, cudaMemcpyHostToDevice));
+            reset_output();
+        }
+        __host__
+        ~FieldGlobs(void){
+            host_arena().release(arr);
+            CUDASSERT(cudaFree(gpu_arr));
+        }
+        __host__
+        void reset_output(){
+            CUDASSERT(cudaMemset(gpu_out.at[0], 0, n_out*mem_size));
+            CUDASSERT(cudaDeviceSynchronize());
+        }
+
+        __host__
+        inline
+        void startTimer(){
+            gettimeofday(&start_stamp, NULL);
+        }
+        __host__
+        inline
+        long endTimer(){
+            gettimeofday(&end_stamp, NULL);
+            struct timeval time_diff;
+            timeval_subtract(&time_diff, &end_stamp, &start_stamp);
+            return time_diff.tv_sec*1e6+time_diff.tv_usec;
+        }
+
+        __host__
+        void report_output(const FieldPtrs<n_out>& cpu_out, const bool should_print, const long average_elapsed){
+            if(should_print){
+                printf(" : mean %ld microseconds\n", average_elapsed);
+                TRAFFIC_REPORT();
+                for(int f = 0; f < n_out; f++){
+                    if (!validate(cpu_out.at[f],out.at[f],tlen)){
+                        printf("   FAILED TO VALIDATE output %d\n", f);
+                    }
+                }
+            }
+        }
+
+        // launch(gpu_in, gpu_out, lens) runs the stencil once on the gpu.
+        template<typename Launch>
+        __host__
+        void do_run_launch(
+                Launch launch
+                , const FieldPtrs<n_out>& cpu_out
+                , bool should_print=true){
+            reset_output();
+            long time_acc = 0;
+            TRAFFIC_BEGIN();
+            for(unsigned x = 0; x < RUNS; x++){
+                startTimer();
+                launch(gpu_in, gpu_out, lens);
+                CUDASSERT(cudaGetLastError()); // check cuda for errors
+                CUDASSERT(cudaDeviceSynchronize());
+                time_acc += endTimer();
+            }
+            TRAFFIC_END(RUNS*n_out*tlen);
+            CUDASSERT(cudaMemcpy(out.at[0], gpu_out.at[0], n_out*mem_size, cudaMemcpyDeviceToHost));
+            CUDASSERT(cudaDeviceSynchronize());
+            report_output(cpu_out, should_print, time_acc / RUNS);
+        };
+
+        template<typename Call>
+        __host__
+        void do_run_host( // host engines read in and write out directly
+                Call call
+                , const FieldPtrs<n_out>& cpu_out
+                , bool should_print=true){
+            memset(out.at[0], 0, n_out*mem_size);
+            long time_acc = 0;
+            TRAFFIC_BEGIN();
+            for(unsigned x = 0; x < HOST_RUNS; x++){
+                startTimer();
+                call(in, out, lens);
+                time_acc += endTimer();
+            }
+            TRAFFIC_END(HOST_RUNS*n_out*tlen);
+            report_output(cpu_out, should_print, time_acc / HOST_RUNS);
+        };
+};
+
 #endif
@@ -0,0 +1,605 @@
+#ifndef STENCIL_SHAPES
+#define STENCIL_SHAPES
+
+#include <stdio.h>
+#include <cuda_runtime.h>
+#include "constants.h"
+#include "threadpool.h"
+#include "kernels-1d.h"
+#include "kernels-2d.h"
+#include "kernels-3d.h"
+
+/*******************************************************************************
+ * Stencil shapes chosen at run time, e.g. read from a config file.
+ * stencil_1d/2d/3d look the shape up in a registry of precompiled kernels,
+ * the big tile kernels fully specialized on the shape, and fall back to
+ * kernels that take the radius as an argument otherwise. Those stage a block's
+ * tile in dynamic shared memory when it fits SHAPE_MAX_SHARED_BYTES and read
+ * straight from global memory when it does not.
+ * All of them sum the window in the order of stencil_fun_*, so the result of
+ * a shape is the same down to the bit whichever path runs it.
+ *
+ * A shape is written outermost axis first, as the drivers print it:
+ *     "-1..1,-1..1,-1..1"  3d, z y x
+ *     "0..2,-1..1"         2d, y x
+ *     "-3..3"              1d
+ * New precompiled shapes go into the SHAPES_*D lists below.
+ */
+
+// blocks of the shape kernels, and the most shared memory a tile may take.
+#define SHAPE_GROUP_1D 256
+#define SHAPE_GROUP_X 32
+#define SHAPE_GROUP_2D_Y 8
+#define SHAPE_GROUP_3D_Y 4
+#define SHAPE_GROUP_3D_Z 2
+#define SHAPE_MAX_SHARED_BYTES (48 << 10)
+
+// amin..amax per axis; the axes beyond the rank are 0..0.
+struct StencilShape {
+    int rank;
+    int3 amin;
+    int3 amax;
+};
+
+inline __host__
+bool operator==(const StencilShape& a, const StencilShape& b){
+    return a.rank == b.rank
+        && a.amin.x == b.amin.x && a.amin.y == b.amin.y && a.amin.z == b.amin.z
+        && a.amax.x == b.amax.x && a.amax.y == b.amax.y && a.amax.z == b.amax.z;
+}
+
+inline __host__ __device__
+int3 shape_range(const int3 amin, const int3 amax){
+    const int3 range = {
+        amax.x - amin.x + 1,
+        amax.y - amin.y + 1,
+        amax.z - amin.z + 1};
+    return range;
+}
+
+// parses "min..max" per axis, outermost first and comma separated. Returns
+// false on anything else, or when an axis has min > max.
+inline __host__
+bool parse_stencil_shape(const char* text, StencilShape& shape)
+{
+    int mins[3], maxs[3];
+    int rank = 0;
+    const char* p = text;
+    while(rank < 3){
+        int used = 0;
+        if(sscanf(p, " %d .. %d %n", &mins[rank], &maxs[rank], &used) != 2 || mins[rank] > maxs[rank]){
+            return false;
+        }
+        rank++;
+        p += used;
+        if(*p != ','){ break; }
+        p++;
+    }
+    if(*p != '\0'){ return false; }
+
+    const int3 zero = {0, 0, 0};
+    shape.rank = rank;
+    shape.amin = zero;
+    shape.amax = zero;
+    int* amin[3] = { &shape.amin.x, &shape.amin.y, &shape.amin.z };
+    int* amax[3] = { &shape.amax.x, &shape.amax.y, &shape.amax.z };
+    for(int a = 0; a < rank; a++){
+        *amin[a] = mins[rank - 1 - a];
+        *amax[a] = maxs[rank - 1 - a];
+    }
+    return true;
+}
+
+inline __host__
+void print_stencil_shape(const StencilShape& shape)
+{
+    const int mins[3] = { shape.amin.z, shape.amin.y, shape.amin.x };
+    const int maxs[3] = { shape.amax.z, shape.amax.y, shape.amax.x };
+    for(int a = 3 - shape.rank; a < 3; a++){
+        printf("%s%d..%d", a > 3 - shape.rank ? "," : "", mins[a], maxs[a]);
+    }
+}
+
+/*******************************************************************************
+ * The stencil functions with the shape as arguments. read(i, j, k) is the
+ * value at offset (amin.z + i, amin.y + j, amin.x + k) of the window.
+ */
+template<typename T, typename Read>
+__device__ __host__
+__forceinline__
+T stencil_fun_1d_runtime(const int range, Read read){
+    ElemAcc<T> sum_acc = 0;
+    for(int k=0; k < range; k++){
+        sum_acc += read(0, 0, k);
+    }
+    sum_acc /= (ElemAcc<T>)range;
+    return T(sum_acc);
+}
+
+template<typename T, typename Read>
+__device__ __host__
+__forceinline__
+T stencil_fun_2d_runtime(const int3 range, Read read){
+    ElemAcc<T> sum_acc = 0;
+    for(int j=0; j < range.y; j++){
+        for(int k=0; k < range.x; k++){
+#ifdef Jacobi2D
+            const bool yn = j == range.y / 2;
+            const bool xn = k == range.x / 2;
+            if(yn || xn)
+#endif
+                sum_acc += read(0, j, k);
+        }
+    }
+    sum_acc /= (ElemAcc<T>)(range.x * range.y);
+    return T(sum_acc);
+}
+
+template<typename T, typename Read>
+__device__ __host__
+__forceinline__
+T stencil_fun_3d_runtime(const int3 range, Read read){
+    ElemAcc<T> sum_acc = 0;
+    for(int i=0; i < range.z; i++){
+        for(int j=0; j < range.y; j++){
+            for(int k=0; k < range.x; k++){
+#ifdef Jacobi3D
+                const bool zn = i == range.z / 2;
+                const bool yn = j == range.y / 2;
+                const bool xn = k == range.x / 2;
+                if((zn && yn) || (zn && xn) || (yn && xn))
+#endif
+                    sum_acc += read(i, j, k);
+            }
+        }
+    }
+    sum_acc /= (ElemAcc<T>)(range.x * range.y * range.z);
+    return T(sum_acc);
+}
+
+/*******************************************************************************
+ * Runtime radius kernels. The big tile ones load the block's tile with a flat
+ * div/rem loader and need range-1 more elements per axis than the block of
+ * dynamic shared memory.
+ */
+template<typename T>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_1d_runtime(
+    const T* A,
+    T* out,
+    const long nx,
+    const int3 amin, const int3 amax)
+{
+    EXTERN_SHARED(T, tile);
+    const int range = amax.x - amin.x + 1;
+    const int sh_size = int(blockDim.x) + range - 1;
+    const long block_offset = long(blockIdx.x) * long(blockDim.x);
+
+    for(int i = threadIdx.x; i < sh_size; i += blockDim.x){
+        tile[i] = A[bound<true>(block_offset + amin.x + i, nx - 1)];
+    }
+    __syncthreads();
+
+    const long gid = block_offset + threadIdx.x;
+    if(gid < nx){
+        const T* window = tile + threadIdx.x;
+        out[gid] = stencil_fun_1d_runtime<T>(range,
+            [=](const int, const int, const int k){ return window[k]; });
+    }
+}
+
+template<typename T>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void global_reads_1d_runtime(
+    const T* A,
+    T* out,
+    const long nx,
+    const int3 amin, const int3 amax)
+{
+    const long gid = long(blockIdx.x) * long(blockDim.x) + threadIdx.x;
+    if(gid < nx){
+        out[gid] = stencil_fun_1d_runtime<T>(amax.x - amin.x + 1,
+            [=](const int, const int, const int k){
+                return A[bound<true>(gid + amin.x + k, nx - 1)]; });
+    }
+}
+
+template<typename T>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_2d_runtime(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const int3 amin, const int3 amax)
+{
+    EXTERN_SHARED(T, tile);
+    const int3 range = shape_range(amin, amax);
+    const int2 sh_size = {
+        int(blockDim.x) + range.x - 1,
+        int(blockDim.y) + range.y - 1};
+    const int sh_size_flat = product(sh_size);
+    const long2 block_offset = {
+        long(blockIdx.x) * long(blockDim.x),
+        long(blockIdx.y) * long(blockDim.y)};
+    const int block_flat = blockDim.x * blockDim.y;
+    const int loc_flat = threadIdx.y * blockDim.x + threadIdx.x;
+
+    for(int i = loc_flat; i < sh_size_flat; i += block_flat){
+        const int y = i / sh_size.x;
+        const int x = i % sh_size.x;
+        const long gy = bound<true>(block_offset.y + amin.y + y, lens.y - 1);
+        const long gx = bound<true>(block_offset.x + amin.x + x, lens.x - 1);
+        tile[i] = A[gy * lens.x + gx];
+    }
+    __syncthreads();
+
+    const long gid_x = block_offset.x + threadIdx.x;
+    const long gid_y = block_offset.y + threadIdx.y;
+    if(gid_x < lens.x && gid_y < lens.y){
+        const T* window = tile + threadIdx.y * sh_size.x + threadIdx.x;
+        const int row = sh_size.x;
+        out[gid_y * lens.x + gid_x] = stencil_fun_2d_runtime<T>(range,
+            [=](const int, const int j, const int k){ return window[j * row + k]; });
+    }
+}
+
+template<typename T>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void global_reads_2d_runtime(
+    const T* A,
+    T* out,
+    const long2 lens,
+    const int3 amin, const int3 amax)
+{
+    const long gid_x = long(blockIdx.x) * long(blockDim.x) + threadIdx.x;
+    const long gid_y = long(blockIdx.y) * long(blockDim.y) + threadIdx.y;
+    if(gid_x < lens.x && gid_y < lens.y){
+        out[gid_y * lens.x + gid_x] = stencil_fun_2d_runtime<T>(shape_range(amin, amax),
+            [=](const int, const int j, const int k){
+                const long y = bound<true>(gid_y + amin.y + j, lens.y - 1);
+                const long x = bound<true>(gid_x + amin.x + k, lens.x - 1);
+                return A[y * lens.x + x]; });
+    }
+}
+
+template<typename T>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void big_tile_3d_runtime(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const int3 amin, const int3 amax)
+{
+    EXTERN_SHARED(T, tile);
+    const int3 range = shape_range(amin, amax);
+    const int3 sh_size = {
+        int(blockDim.x) + range.x - 1,
+        int(blockDim.y) + range.y - 1,
+        int(blockDim.z) + range.z - 1};
+    const int sh_size_xy = sh_size.x * sh_size.y;
+    const int sh_size_flat = product(sh_size);
+    const long3 block_offset = {
+        long(blockIdx.x) * long(blockDim.x),
+        long(blockIdx.y) * long(blockDim.y),
+        long(blockIdx.z) * long(blockDim.z)};
+    const int block_flat = blockDim.x * blockDim.y * blockDim.z;
+    const int loc_flat = (threadIdx.z * blockDim.y + threadIdx.y) * blockDim.x + threadIdx.x;
+
+    for(int i = loc_flat; i < sh_size_flat; i += block_flat){
+        const int z = i / sh_size_xy;
+        const int r = i % sh_size_xy;
+        const int y = r / sh_size.x;
+        const int x = r % sh_size.x;
+        const long gz = bound<true>(block_offset.z + amin.z + z, lens.z - 1);
+        const long gy = bound<true>(block_offset.y + amin.y + y, lens.y - 1);
+        const long gx = bound<true>(block_offset.x + amin.x + x, lens.x - 1);
+        tile[i] = A[(gz * lens.y + gy) * lens.x + gx];
+    }
+    __syncthreads();
+
+    const long gid_x = block_offset.x + threadIdx.x;
+    const long gid_y = block_offset.y + threadIdx.y;
+    const long gid_z = block_offset.z + threadIdx.z;
+    if(gid_x < lens.x && gid_y < lens.y && gid_z < lens.z){
+        const T* window = tile + (threadIdx.z * sh_size.y + threadIdx.y) * sh_size.x + threadIdx.x;
+        const int row = sh_size.x;
+        out[(gid_z * lens.y + gid_y) * lens.x + gid_x] = stencil_fun_3d_runtime<T>(range,
+            [=](const int i, const int j, const int k){ return window[i * sh_size_xy + j * row + k]; });
+    }
+}
+
+template<typename T>
+__global__
+__launch_bounds__(BLOCKSIZE)
+void global_reads_3d_runtime(
+    const T* A,
+    T* out,
+    const long3 lens,
+    const int3 amin, const int3 amax)
+{
+    const long gid_x = long(blockIdx.x) * long(blockDim.x) + threadIdx.x;
+    const long gid_y = long(blockIdx.y) * long(blockDim.y) + threadIdx.y;
+    const long gid_z = long(blockIdx.z) * long(blockDim.z) + threadIdx.z;
+    if(gid_x < lens.x && gid_y < lens.y && gid_z < lens.z){
+        out[(gid_z * lens.y + gid_y) * lens.x + gid_x] = stencil_fun_3d_runtime<T>(shape_range(amin, amax),
+            [=](const int i, const int j, const int k){
+                const long z = bound<true>(gid_z + amin.z + i, lens.z - 1);
+                const long y = bound<true>(gid_y + amin.y + j, lens.y - 1);
+                const long x = bound<true>(gid_x + amin.x + k, lens.x - 1);
+                return A[(z * lens.y + y) * lens.x + x]; });
+    }
+}
+
+/*******************************************************************************
+ * Host references for any shape, one row of the grid per task.
+ */
+template<typename T>
+inline __host__
+void stencil_1d_cpu_runtime(const T* A, T* out, const long nx, const StencilShape& shape)
+{
+    const int range = shape.amax.x - shape.amin.x + 1;
+    const int amin_x = shape.amin.x;
+    const long rows = divUp(nx, long(CPU_TILE_1D));
+    host_pool().parallel_for(rows, [&](const long row, const int){
+        const long end = min(nx, (row + 1) * CPU_TILE_1D);
+        for(long gid = row * CPU_TILE_1D; gid < end; gid++){
+            out[gid] = stencil_fun_1d_runtime<T>(range,
+                [&](const int, const int, const int k){
+                    return A[bound<true>(gid + amin_x + k, nx - 1)]; });
+        }
+    });
+}
+
+template<typename T>
+inline __host__
+void stencil_2d_cpu_runtime(const T* A, T* out, const long2 lens, const StencilShape& shape)
+{
+    const int3 range = shape_range(shape.amin, shape.amax);
+    const int3 amin = shape.amin;
+    host_pool().parallel_for(lens.y, [&](const long gid_y, const int){
+        for(long gid_x = 0; gid_x < lens.x; gid_x++){
+            out[gid_y * lens.x + gid_x] = stencil_fun_2d_runtime<T>(range,
+                [&](const int, const int j, const int k){
+                    const long y = bound<true>(gid_y + amin.y + j, lens.y - 1);
+                    const long x = bound<true>(gid_x + amin.x + k, lens.x - 1);
+                    return A[y * lens.x + x]; });
+        }
+    });
+}
+
+template<typename T>
+inline __host__
+void stencil_3d_cpu_runtime(const T* A, T* out, const long3 lens, const StencilShape& shape)
+{
+    const int3 range = shape_range(shape.amin, shape.amax);
+    const int3 amin = shape.amin;
+    host_pool().parallel_for(lens.z * lens.y, [&](const long row, const int){
+        const long gid_z = row / lens.y;
+        const long gid_y = row % lens.y;
+        for(long gid_x = 0; gid_x < lens.x; gid_x++){
+            out[(gid_z * lens.y + gid_y) * lens.x + gid_x] = stencil_fun_3d_runtime<T>(range,
+                [&](const int i, const int j, const int k){
+                    const long z = bound<true>(gid_z + amin.z + i, lens.z - 1);
+                    const long y = bound<true>(gid_y + amin.y + j, lens.y - 1);
+                    const long x = bound<true>(gid_x + amin.x + k, lens.x - 1);
+                    return A[(z * lens.y + y) * lens.x + x]; });
+        }
+    });
+}
+
+/*******************************************************************************
+ * The registry. Every entry launches the big tile kernel of one shape on gpu
+ * buffers; the lists give amin,amax per axis, outermost first.
+ */
+#define SHAPES_1D(X) \
+    X(-1,1) X(-2,2) X(-3,3) X(-4,4) X(-5,5) X(0,1) X(-1,0)
+
+#define SHAPES_2D(X) \
+    X(-1,1, -1,1) X(-2,2, -2,2) X(-3,3, -3,3) \
+    X( 0,1,  0,1) X(-1,1,  0,1) X(-1,2, -1,1) X(-1,2, -1,2) X(-2,2, -1,2) \
+    X(-1,1,  0,0) X( 0,0, -1,1)
+
+#define SHAPES_3D(X) \
+    X(-1,1, -1,1, -1,1) X(-2,2, -2,2, -2,2) \
+    X( 0,1,  0,1,  0,1) X(-1,1,  0,1,  0,1) X(-1,1, -1,1,  0,1) \
+    X(-1,2, -1,1, -1,1) X(-1,2, -1,2, -1,2) X(-1,3, -1,3, -1,3) \
+    X(-1,1,  0,0,  0,0) X(-2,2,  0,0,  0,0) \
+    X(-1,1, -1,1,  0,0) X(-1,1,  0,0, -1,1)
+
+template<typename E> using ShapeLaunch1dOf = void (*)(const E*, E*, const long);
+template<typename E> using ShapeLaunch2dOf = void (*)(const E*, E*, const long2);
+template<typename E> using ShapeLaunch3dOf = void (*)(const E*, E*, const long3);
+
+template<const int amin_x, const int amax_x, typename T>
+__host__
+void launch_shape_1d(const T* A, T* out, const long nx)
+{
+    constexpr int sh_size_bytes = (SHAPE_GROUP_1D + amax_x - amin_x) * sizeof(T);
+    const int grid = divUp(nx, long(SHAPE_GROUP_1D));
+    LAUNCH((big_tile_1d_inline<amin_x,amax_x,SHAPE_GROUP_1D,T>), grid, SHAPE_GROUP_1D, sh_size_bytes)(A, out, nx);
+}
+
+template<
+    const int amin_y, const int amax_y,
+    const int amin_x, const int amax_x,
+    typename T>
+__host__
+void launch_shape_2d(const T* A, T* out, const long2 lens)
+{
+    constexpr int sh_size_bytes = (SHAPE_GROUP_X + amax_x - amin_x) * (SHAPE_GROUP_2D_Y + amax_y - amin_y) * sizeof(T);
+    const int2 grid = {
+        int(divUp(lens.x, long(SHAPE_GROUP_X))),
+        int(divUp(lens.y, long(SHAPE_GROUP_2D_Y)))};
+    LAUNCH((big_tile_2d_inlined_cube_singleDim
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,SHAPE_GROUP_X,SHAPE_GROUP_2D_Y,0
+            ,T>)
+        , grid.x * grid.y, SHAPE_GROUP_X * SHAPE_GROUP_2D_Y, sh_size_bytes)(A, out, lens, grid);
+}
+
+template<
+    const int amin_z, const int amax_z,
+    const int amin_y, const int amax_y,
+    const int amin_x, const int amax_x,
+    typename T>
+__host__
+void launch_shape_3d(const T* A, T* out, const long3 lens)
+{
+    constexpr int sh_size_bytes = (SHAPE_GROUP_X + amax_x - amin_x)
+        * (SHAPE_GROUP_3D_Y + amax_y - amin_y) * (SHAPE_GROUP_3D_Z + amax_z - amin_z) * sizeof(T);
+    const dim3 block(SHAPE_GROUP_X, SHAPE_GROUP_3D_Y, SHAPE_GROUP_3D_Z);
+    const dim3 grid(
+        divUp(lens.x, long(SHAPE_GROUP_X)),
+        divUp(lens.y, long(SHAPE_GROUP_3D_Y)),
+        divUp(lens.z, long(SHAPE_GROUP_3D_Z)));
+    LAUNCH((big_tile_3d_inlined
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,SHAPE_GROUP_X,SHAPE_GROUP_3D_Y,SHAPE_GROUP_3D_Z
+            ,T>)
+        , grid, block, sh_size_bytes)(A, out, lens);
+}
+
+template<typename Launch>
+struct ShapeEntry {
+    StencilShape shape;
+    Launch launch;
+};
+
+#define SHAPE_ENTRY_1D(mx,Mx) \
+    { {1, {mx,0,0}, {Mx,0,0}}, &launch_shape_1d<mx,Mx,T> },
+#define SHAPE_ENTRY_2D(my,My, mx,Mx) \
+    { {2, {mx,my,0}, {Mx,My,0}}, &launch_shape_2d<my,My,mx,Mx,T> },
+#define SHAPE_ENTRY_3D(mz,Mz, my,My, mx,Mx) \
+    { {3, {mx,my,mz}, {Mx,My,Mz}}, &launch_shape_3d<mz,Mz,my,My,mx,Mx,T> },
+
+template<typename Launch, int n>
+__host__
+Launch find_shape(const ShapeEntry<Launch> (&registry)[n], const StencilShape& shape)
+{
+    for(int i = 0; i < n; i++){
+        if(registry[i].shape == shape){ return registry[i].launch; }
+    }
+    return nullptr;
+}
+
+// the precompiled launch of a shape for elements of type T, or nullptr.
+template<typename T>
+__host__
+ShapeLaunch1dOf<T> find_shape_1d(const StencilShape& shape)
+{
+    static const ShapeEntry<ShapeLaunch1dOf<T> > registry[] = { SHAPES_1D(SHAPE_ENTRY_1D) };
+    return find_shape(registry, shape);
+}
+
+template<typename T>
+__host__
+ShapeLaunch2dOf<T> find_shape_2d(const StencilShape& shape)
+{
+    static const ShapeEntry<ShapeLaunch2dOf<T> > registry[] = { SHAPES_2D(SHAPE_ENTRY_2D) };
+    return find_shape(registry, shape);
+}
+
+template<typename T>
+__host__
+ShapeLaunch3dOf<T> find_shape_3d(const StencilShape& shape)
+{
+    static const ShapeEntry<ShapeLaunch3dOf<T> > registry[] = { SHAPES_3D(SHAPE_ENTRY_3D) };
+    return find_shape(registry, shape);
+}
+
+#undef SHAPE_ENTRY_1D
+#undef SHAPE_ENTRY_2D
+#undef SHAPE_ENTRY_3D
+
+/*******************************************************************************
+ * Entry points on gpu buffers. The *_runtime ones always take the runtime
+ * radius kernels; the others return true when a precompiled kernel ran.
+ */
+template<typename T>
+inline __host__
+void stencil_1d_runtime(const T* A, T* out, const long nx, const StencilShape& shape)
+{
+    const int grid = divUp(nx, long(SHAPE_GROUP_1D));
+    const long sh_size_bytes = (SHAPE_GROUP_1D + shape.amax.x - shape.amin.x) * sizeof(T);
+    if(sh_size_bytes <= SHAPE_MAX_SHARED_BYTES){
+        LAUNCH(big_tile_1d_runtime<T>, grid, SHAPE_GROUP_1D, sh_size_bytes)(A, out, nx, shape.amin, shape.amax);
+    }
+    else {
+        LAUNCH(global_reads_1d_runtime<T>, grid, SHAPE_GROUP_1D, 0)(A, out, nx, shape.amin, shape.amax);
+    }
+}
+
+template<typename T>
+inline __host__
+void stencil_2d_runtime(const T* A, T* out, const long2 lens, const StencilShape& shape)
+{
+    const int3 range = shape_range(shape.amin, shape.amax);
+    const dim3 block(SHAPE_GROUP_X, SHAPE_GROUP_2D_Y);
+    const dim3 grid(divUp(lens.x, long(SHAPE_GROUP_X)), divUp(lens.y, long(SHAPE_GROUP_2D_Y)));
+    const long sh_size_bytes = long(SHAPE_GROUP_X + range.x - 1) * (SHAPE_GROUP_2D_Y + range.y - 1) * sizeof(T);
+    if(sh_size_bytes <= SHAPE_MAX_SHARED_BYTES){
+        LAUNCH(big_tile_2d_runtime<T>, grid, block, sh_size_bytes)(A, out, lens, shape.amin, shape.amax);
+    }
+    else {
+        LAUNCH(global_reads_2d_runtime<T>, grid, block, 0)(A, out, lens, shape.amin, shape.amax);
+    }
+}
+
+template<typename T>
+inline __host__
+void stencil_3d_runtime(const T* A, T* out, const long3 lens, const StencilShape& shape)
+{
+    const int3 range = shape_range(shape.amin, shape.amax);
+    const dim3 block(SHAPE_GROUP_X, SHAPE_GROUP_3D_Y, SHAPE_GROUP_3D_Z);
+    const dim3 grid(
+        divUp(lens.x, long(SHAPE_GROUP_X)),
+        divUp(lens.y, long(SHAPE_GROUP_3D_Y)),
+        divUp(lens.z, long(SHAPE_GROUP_3D_Z)));
+    const long sh_size_bytes = long(SHAPE_GROUP_X + range.x - 1)
+        * (SHAPE_GROUP_3D_Y + range.y - 1) * (SHAPE_GROUP_3D_Z + range.z - 1) * sizeof(T);
+    if(sh_size_bytes <= SHAPE_MAX_SHARED_BYTES){
+        LAUNCH(big_tile_3d_runtime<T>, grid, block, sh_size_bytes)(A, out, lens, shape.amin, shape.amax);
+    }
+    else {
+        LAUNCH(global_reads_3d_runtime<T>, grid, block, 0)(A, out, lens, shape.amin, shape.amax);
+    }
+}
+
+template<typename T>
+inline __host__
+bool stencil_1d(const T* A, T* out, const long nx, const StencilShape& shape)
+{
+    const ShapeLaunch1dOf<T> launch = find_shape_1d<T>(shape);
+    if(launch){ launch(A, out, nx); }
+    else { stencil_1d_runtime(A, out, nx, shape); }
+    return launch != nullptr;
+}
+
+template<typename T>
+inline __host__
+bool stencil_2d(const T* A, T* out, const long2 lens, const StencilShape& shape)
+{
+    const ShapeLaunch2dOf<T> launch = find_shape_2d<T>(shape);
+    if(launch){ launch(A, out, lens); }
+    else { stencil_2d_runtime(A, out, lens, shape); }
+    return launch != nullptr;
+}
+
+template<typename T>
+inline __host__
+bool stencil_3d(const T* A, T* out, const long3 lens, const StencilShape& shape)
+{
+    const ShapeLaunch3dOf<T> launch = find_shape_3d<T>(shape);
+    if(launch){ launch(A, out, lens); }
+    else { stencil_3d_runtime(A, out, lens, shape); }
+    return launch != nullptr;
+}
+
+#endif
@@ -7,6 +7,7 @@
 
 #include "runners.h"
 #include "kernels-1d.h"
+#include "cpu-kernels-1d.h"
 
 using namespace std;
 #include <iostream>
@@ -14,66 +15,50 @@ using std::cout;
 using std::endl;
 
 static constexpr long n_runs = 1000;
+static constexpr long n_host_runs = 10;
 static constexpr long lens = (1 << 24) + 2;
 
-static Globs
+template<typename T> using Globs1d = Globs
     <long,long
-    ,Kernel1dVirtual
-    ,Kernel1dPhysMultiDim
-    ,Kernel1dPhysStripDim
-    > G(lens, lens, n_runs);
-
-template<
-    const int amin_x,
-    const int amax_x>
-__host__
-void stencil_1d_cpu(
-    const T* A,
-    T* out)
-{
-    constexpr int range = amax_x - amin_x + 1;
-
-    const int max_ix_x = lens - 1;
-    for (int gidx = 0; gidx < lens; ++gidx){
-        T arr[range];
-        for(int k=0; k < range; k++){
-            const int x = bound<(amin_x<0),int>(gidx + (k + amin_x), max_ix_x);
-            arr[k] = A[x];
-        }
-        out[gidx] = stencil_fun_1d<amin_x,amax_x>(arr);
-
-    }
-}
+    ,Kernel1dVirtualOf<T>
+    ,Kernel1dPhysMultiDimOf<T>
+    ,Kernel1dPhysStripDimOf<T>
+    ,Kernel1dHostOf<T>
+    ,T>;
 
-template<int ix_min, int ix_max>
+template<int ix_min, int ix_max, typename T>
 void run_cpu_1d(T* cpu_out)
 {
-    T* cpu_in  = (T*)malloc(lens*sizeof(T));
+    constexpr int tile_x = elem_scaled<T>(CPU_TILE_1D);
+    T* cpu_in  = host_arena().acquire<T>(lens);
     srand(1);
     for (int i = 0; i < lens; ++i)
     {
-        cpu_in[i] = (T)rand();
+        cpu_in[i] = elem_random<T>();
     }
 
     struct timeval t_startpar, t_endpar, t_diffpar;
     gettimeofday(&t_startpar, NULL);
     {
-        stencil_1d_cpu<ix_min, ix_max>(cpu_in,cpu_out);
+        stencil_1d_cpu_tiled<ix_min,ix_max,tile_x>(cpu_in,cpu_out,lens);
     }
     gettimeofday(&t_endpar, NULL);
     timeval_subtract(&t_diffpar, &t_endpar, &t_startpar);
     const unsigned long elapsed = (t_diffpar.tv_sec*1e6+t_diffpar.tv_usec) / 1000;
     const unsigned long seconds = elapsed / 1000;
     const unsigned long microseconds = elapsed % 1000;
-    printf("cpu c 1d for 1 run : %lu.%03lu seconds\n", seconds, microseconds);
+    printf("cpu c 1d for 1 run : %lu.%03lu seconds (%d threads)\n", seconds, microseconds, host_pool().size());
 
-    free(cpu_in);
+    host_arena().release(cpu_in);
 }
 
-template<int ixs_len, int gps_x, int ix_min, int ix_max, int strip_pow_x>
-void doTest_1D()
+template<int ixs_len, int gps_x, int ix_min, int ix_max, int strip_pow_x, typename T>
+void doTest_1D(Globs1d<T>& G)
 {
-    T* cpu_out = (T*)malloc(lens*sizeof(T));
+    // tiles and strips are sized for floats, narrower elements get longer ones.
+    constexpr int tile_x = elem_scaled<T>(CPU_TILE_1D);
+    const char* elem = ElemTraits<T>::name();
+    T* cpu_out = host_arena().acquire<T>(lens);
     run_cpu_1d<ix_min, ix_max>(cpu_out);
 
     cout << "ixs[" << ix_min << "..." << ix_max << "]" << endl;
@@ -89,11 +74,32 @@ void doTest_1D()
     constexpr int smallSingleDim_grid = divUp(smallWork,smallBlock); // the flattening happens in the before the kernel call.
 
     {
+        {
+            cout << "## Benchmark 1d cpu - tiled: ";
+            printf("tile=[%d]%s - %d threads ##", tile_x, elem, host_pool().size());
+            Kernel1dHostOf<T> kfun = stencil_1d_cpu_tiled
+                <ix_min,ix_max,tile_x>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            cout << "## Benchmark 1d cpu - simd: ";
+            printf("tile=[%d]%s - %s - %d threads ##", tile_x, elem, host_isa_name(host_isa_for<T>()), host_pool().size());
+            Kernel1dHostOf<T> kfun = stencil_1d_cpu_simd
+                <ix_min,ix_max,tile_x>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            cout << "## Benchmark 1d cpu - box running sum: ";
+            printf("tile=[%d]%s - f64 sums - %d threads ##", tile_x, elem, host_pool().size());
+            Kernel1dHostOf<T> kfun = stencil_1d_cpu_box
+                <ix_min,ix_max,tile_x>;
+            G.do_run_host(kfun, cpu_out, true, reassociation_tolerance<T>(ix_max - ix_min + 1));
+        }
 
         /*{
 
             cout << "## Benchmark 1d global read inline ixs ##";
-            Kernel1dPhysMultiDim kfun = global_read_1d_inline
+            Kernel1dPhysMultiDimOf<T> kfun = global_read_1d_inline
                 <ix_min,ix_max,gps_x>;
             G.do_run_multiDim(kfun, cpu_out, singleDim_grid, singleDim_block, 1, false); // warmup as it is the first kernel
             G.do_run_multiDim(kfun, cpu_out, singleDim_grid, singleDim_block, 1);
@@ -104,14 +110,14 @@ void doTest_1D()
 
         {
             cout << "## Benchmark 1d big tile inline ixs ##";
-            Kernel1dPhysMultiDim kfun = big_tile_1d_inline
+            Kernel1dPhysMultiDimOf<T> kfun = big_tile_1d_inline
                 <ix_min,ix_max,gps_x>;
             G.do_run_multiDim(kfun, cpu_out, singleDim_grid, singleDim_block, shared_size);
         }
 
         {
             cout << "## Benchmark 1d small tile inline ixs ##";
-            Kernel1dPhysMultiDim kfun = small_tile_1d_inline
+            Kernel1dPhysMultiDimOf<T> kfun = small_tile_1d_inline
                 <ix_min,ix_max,gps_x>;
             G.do_run_multiDim(kfun, cpu_out, smallSingleDim_grid, singleDim_block, small_shared_size);
         }*/
@@ -119,7 +125,7 @@ void doTest_1D()
 
         {
 
-            constexpr int strip_x = 1 << strip_pow_x;
+            constexpr int strip_x = elem_scaled<T>(1 << strip_pow_x);
 
             constexpr int strip_size_x = gps_x*strip_x;
 
@@ -134,8 +140,8 @@ void doTest_1D()
 
             {
                 cout << "## Benchmark 1d big tile - inlined idxs - stripmined: ";
-                printf("strip_size=[%d]f32 ", strip_size_x);
-                Kernel1dPhysStripDim kfun = stripmine_big_tile_1d_inlined
+                printf("strip_size=[%d]%s ", strip_size_x, elem);
+                Kernel1dPhysStripDimOf<T> kfun = stripmine_big_tile_1d_inlined
                     <ix_min
                     ,ix_max
                     ,gps_x
@@ -146,8 +152,8 @@ void doTest_1D()
             }
             {
                 cout << "## Benchmark 1d global read unrolled/stripmined - inlined idxs: ";
-                printf("strip_size=[%d]f32 \n", strip_size_x);
-                Kernel1dPhysStripDim kfun = global_read_1d_inline_strip
+                printf("strip_size=[%d]%s \n", strip_size_x, elem);
+                Kernel1dPhysStripDimOf<T> kfun = global_read_1d_inline_strip
                     <ix_min
                     ,ix_max
                     ,gps_x
@@ -158,9 +164,61 @@ void doTest_1D()
         }
     }
 
-    free(cpu_out);
+    host_arena().release(cpu_out);
 }
 
+// the stripmine sweep for one element type, on grids of that type.
+template<typename T>
+void doTests_1D()
+{
+    Globs1d<T> G(lens, lens, n_runs, n_host_runs);
+    cout << "element type " << ElemTraits<T>::name() << endl;
+    measure_host_bandwidth_per_node(G.arr_in, G.arr_out, G.tlen);
+
+    doTest_1D<2,256,0,1,0>(G);
+    doTest_1D<3,256,-1,1,0>(G);
+    doTest_1D<5,256,-2,2,0>(G);
+    doTest_1D<7,256,-3,3,0>(G);
+    doTest_1D<9,256,-4,4,0>(G);
+    doTest_1D<11,256,-5,5,0>(G);
+    doTest_1D<13,256,-6,6,0>(G);
+    doTest_1D<15,256,-7,7,0>(G);
+    doTest_1D<17,256,-8,8,0>(G);
+    doTest_1D<25,256,-12,12,0>(G);
+
+    doTest_1D<2,256,0,1,1>(G);
+    doTest_1D<3,256,-1,1,1>(G);
+    doTest_1D<5,256,-2,2,1>(G);
+    doTest_1D<7,256,-3,3,1>(G);
+    doTest_1D<9,256,-4,4,1>(G);
+    doTest_1D<11,256,-5,5,1>(G);
+    doTest_1D<13,256,-6,6,1>(G);
+    doTest_1D<15,256,-7,7,1>(G);
+    doTest_1D<17,256,-8,8,1>(G);
+    doTest_1D<25,256,-12,12,1>(G);
+
+    doTest_1D<2,256,0,1,2>(G);
+    doTest_1D<3,256,-1,1,2>(G);
+    doTest_1D<5,256,-2,2,2>(G);
+    doTest_1D<7,256,-3,3,2>(G);
+    doTest_1D<9,256,-4,4,2>(G);
+    doTest_1D<11,256,-5,5,2>(G);
+    doTest_1D<13,256,-6,6,2>(G);
+    doTest_1D<15,256,-7,7,2>(G);
+    doTest_1D<17,256,-8,8,2>(G);
+    doTest_1D<25,256,-12,12,2>(G);
+
+    doTest_1D<2,256,0,1,3>(G);
+    doTest_1D<3,256,-1,1,3>(G);
+    doTest_1D<5,256,-2,2,3>(G);
+    doTest_1D<7,256,-3,3,3>(G);
+    doTest_1D<9,256,-4,4,3>(G);
+    doTest_1D<11,256,-5,5,3>(G);
+    doTest_1D<13,256,-6,6,3>(G);
+    doTest_1D<15,256,-7,7,3>(G);
+    doTest_1D<17,256,-8,8,3>(G);
+    doTest_1D<25,256,-12,12,3>(G);
+}
 
 int main()
 {
@@ -281,49 +339,10 @@ int main()
     doTest_1D<25,1024,-12,12,0>();
     */
 
-    doTest_1D<2,256,0,1,0>();
-    doTest_1D<3,256,-1,1,0>();
-    doTest_1D<5,256,-2,2,0>();
-    doTest_1D<7,256,-3,3,0>();
-    doTest_1D<9,256,-4,4,0>();
-    doTest_1D<11,256,-5,5,0>();
-    doTest_1D<13,256,-6,6,0>();
-    doTest_1D<15,256,-7,7,0>();
-    doTest_1D<17,256,-8,8,0>();
-    doTest_1D<25,256,-12,12,0>();
-
-    doTest_1D<2,256,0,1,1>();
-    doTest_1D<3,256,-1,1,1>();
-    doTest_1D<5,256,-2,2,1>();
-    doTest_1D<7,256,-3,3,1>();
-    doTest_1D<9,256,-4,4,1>();
-    doTest_1D<11,256,-5,5,1>();
-    doTest_1D<13,256,-6,6,1>();
-    doTest_1D<15,256,-7,7,1>();
-    doTest_1D<17,256,-8,8,1>();
-    doTest_1D<25,256,-12,12,1>();
-
-    doTest_1D<2,256,0,1,2>();
-    doTest_1D<3,256,-1,1,2>();
-    doTest_1D<5,256,-2,2,2>();
-    doTest_1D<7,256,-3,3,2>();
-    doTest_1D<9,256,-4,4,2>();
-    doTest_1D<11,256,-5,5,2>();
-    doTest_1D<13,256,-6,6,2>();
-    doTest_1D<15,256,-7,7,2>();
-    doTest_1D<17,256,-8,8,2>();
-    doTest_1D<25,256,-12,12,2>();
-
-    doTest_1D<2,256,0,1,3>();
-    doTest_1D<3,256,-1,1,3>();
-    doTest_1D<5,256,-2,2,3>();
-    doTest_1D<7,256,-3,3,3>();
-    doTest_1D<9,256,-4,4,3>();
-    doTest_1D<11,256,-5,5,3>();
-    doTest_1D<13,256,-6,6,3>();
-    doTest_1D<15,256,-7,7,3>();
-    doTest_1D<17,256,-8,8,3>();
-    doTest_1D<25,256,-12,12,3>();
+    doTests_1D<float>();
+    doTests_1D<double>();
+    doTests_1D<int8_t>();
+    doTests_1D<half_t>();
 
     return 0;
 }
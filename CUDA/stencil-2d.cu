@@ -11,6 +11,7 @@ using std::endl;
 
 #include "runners.h"
 #include "kernels-2d.h"
+#include "cpu-kernels-2d.h"
 
 static constexpr long2 lens = {
    (1 << 12)+2,
@@ -18,88 +19,63 @@ static constexpr long2 lens = {
 static constexpr int lens_flat = lens.x * lens.y;
 
 static constexpr long n_runs = 100;
+static constexpr long n_host_runs = 10;
 
-static Globs
+template<typename T> using Globs2d = Globs
     <long2,int2
-    ,Kernel2dVirtual
-    ,Kernel2dPhysMultiDim
-    ,Kernel2dPhysSingleDim
-    > G(lens, lens_flat, n_runs);
+    ,Kernel2dVirtualOf<T>
+    ,Kernel2dPhysMultiDimOf<T>
+    ,Kernel2dPhysSingleDimOf<T>
+    ,Kernel2dHostOf<T>
+    ,T>;
 
 template<
     const int amin_x, const int amin_y,
-    const int amax_x, const int amax_y>
-__host__
-void stencil_2d_cpu(
-    const T* start,
-    T* out)
-{
-    constexpr int2 range = {
-        amax_x - amin_x + 1,
-        amax_y - amin_y + 1};
-    constexpr int total_range = range.x * range.y;
-
-    const int max_ix_y = lens.y - 1;
-    const int max_ix_x = lens.x - 1;
-    for (int gidy = 0; gidy < lens.y; ++gidy){
-        for (int gidx = 0; gidx < lens.x; ++gidx){
-            T arr[total_range];
-            for(int j=0; j < range.y; j++){
-                for(int k=0; k < range.x; k++){
-                    const int y = bound<(amin_y<0),int>(gidy + (j + amin_y), max_ix_y);
-                    const int x = bound<(amin_x<0),int>(gidx + (k + amin_x), max_ix_x);
-                    const int index = y*lens.x + x;
-                    const int flat_idx = j*range.x + k;
-                    arr[flat_idx] = start[index];
-                }
-            }
-            out[gidy* lens.x + gidx] = stencil_fun_2d<amin_x,amin_y,amax_x,amax_y>(arr);
-        }
-    }
-}
-
-template<
-    const int amin_x, const int amin_y,
-    const int amax_x, const int amax_y>
+    const int amax_x, const int amax_y,
+    typename T>
 __host__
 void run_cpu_2d(T* cpu_out)
 {
-    T* cpu_in = (T*)malloc(lens_flat*sizeof(T));
+    constexpr int tile_x = elem_scaled<T>(CPU_TILE_X);
+    T* cpu_in = host_arena().acquire<T>(lens_flat);
     srand(1);
     for (int i = 0; i < lens_flat; ++i)
     {
-        cpu_in[i] = (T)rand();
+        cpu_in[i] = elem_random<T>();
     }
 
     struct timeval t_startpar, t_endpar, t_diffpar;
     gettimeofday(&t_startpar, NULL);
     {
-        stencil_2d_cpu<amin_x,amin_y,amax_x,amax_y>(cpu_in,cpu_out);
+        stencil_2d_cpu_tiled
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,tile_x,CPU_TILE_Y>
+            (cpu_in,cpu_out,lens);
     }
     gettimeofday(&t_endpar, NULL);
     timeval_subtract(&t_diffpar, &t_endpar, &t_startpar);
     const unsigned long elapsed = (t_diffpar.tv_sec*1e6+t_diffpar.tv_usec) / 1000;
     const unsigned long seconds = elapsed / 1000;
     const unsigned long microseconds = elapsed % 1000;
-    printf("cpu c 2d for 1 run : %lu.%03lu seconds\n", seconds, microseconds);
+    printf("cpu c 2d for 1 run : %lu.%03lu seconds (%d threads)\n", seconds, microseconds, host_pool().size());
 
-    free(cpu_in);
+    host_arena().release(cpu_in);
 }
 
 template<
     const int amin_y, const int amax_y,
     const int amin_x, const int amax_x,
     const int group_size_x,  const int group_size_y,
-    const int strip_pow_x_pre, const int strip_pow_y_pre
+    const int strip_pow_x_pre, const int strip_pow_y_pre,
+    typename T
     >
-void doTest_2D(const int physBlocks)
+void doTest_2D(Globs2d<T>& G, const int physBlocks)
 {
-    constexpr int strip_x_pre = 1 << strip_pow_x_pre;
+    constexpr int strip_x = elem_scaled<T>(1 << strip_pow_x_pre);
     constexpr int strip_y = 1 << strip_pow_y_pre;
-    constexpr int fsz = sizeof(float);
-    constexpr int esz = sizeof(T);
-    constexpr int ub_strip_x = (fsz <= esz) ? (strip_x_pre/(esz/fsz)) : (strip_x_pre*(fsz/esz));
-    constexpr int strip_x = (1 <= ub_strip_x) ? ub_strip_x : 1;
+    constexpr int tile_x = elem_scaled<T>(CPU_TILE_X);
+    const char* elem = ElemTraits<T>::name();
     const int y_range = (amax_y - amin_y) + 1;
     const int x_range = (amax_x - amin_x) + 1;
 #ifdef Jacobi2D
@@ -112,7 +88,7 @@ void doTest_2D(const int physBlocks)
     cout << "const int ixs[" << ixs_len << "]: ";
     cout << "y= " << amin_y << "..." << amax_y << ", x= " << amin_x << "..." << amax_x << endl;
 
-    T* cpu_out = (T*)malloc(lens_flat*sizeof(T));
+    T* cpu_out = host_arena().acquire<T>(lens_flat);
     run_cpu_2d<amin_x,amin_y,amax_x,amax_y>(cpu_out);
 
     constexpr int  singleDim_block = group_size_x * group_size_y;
@@ -130,10 +106,67 @@ void doTest_2D(const int physBlocks)
     constexpr int std_sh_size_bytes = std_sh_size_flat * sizeof(T);
 
     {
+        {
+            cout << "## Benchmark 2d cpu - tiled: ";
+            printf("tile=[%d][%d]%s - %d threads ##", CPU_TILE_Y, tile_x, elem, host_pool().size());
+            Kernel2dHostOf<T> kfun = stencil_2d_cpu_tiled
+                <amin_x,amin_y
+                ,amax_x,amax_y
+                ,tile_x,CPU_TILE_Y>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            cout << "## Benchmark 2d cpu - simd: ";
+            printf("tile=[%d][%d]%s - %s - %d threads ##", CPU_TILE_Y, tile_x, elem, host_isa_name(host_isa_for<T>()), host_pool().size());
+            Kernel2dHostOf<T> kfun = stencil_2d_cpu_simd
+                <amin_x,amin_y
+                ,amax_x,amax_y
+                ,tile_x,CPU_TILE_Y>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            cout << "## Benchmark 2d cpu - simd, work stealing: ";
+            printf("tile=[%d][%d]%s - morton order - %s - %d threads ##", CPU_TILE_Y, tile_x, elem, host_isa_name(host_isa_for<T>()), host_pool().size());
+            Kernel2dHostOf<T> kfun = stencil_2d_cpu_simd_steal
+                <amin_x,amin_y
+                ,amax_x,amax_y
+                ,tile_x,CPU_TILE_Y>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            cout << "## Benchmark 2d cpu - sliding tile: ";
+            printf("strip=[%d][%d]%s - ring of %d rows - %s - %d threads ##", CPU_STRIP_Y, tile_x, elem, y_range, host_isa_name(host_isa_for<T>()), host_pool().size());
+            Kernel2dHostOf<T> kfun = stencil_2d_cpu_sliding
+                <amin_x,amin_y
+                ,amax_x,amax_y
+                ,tile_x,CPU_STRIP_Y>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            constexpr bool separable = stencil_2d_is_separable<x_range,y_range>();
+            cout << "## Benchmark 2d cpu - separable: ";
+            printf("strip=[%d][%d]%s - ring of %d rows - %s - %d threads ##", CPU_STRIP_Y, tile_x, elem, y_range, separable ? "x,y passes" : "not separable, simd", host_pool().size());
+            Kernel2dHostOf<T> kfun = stencil_2d_cpu_separable_mean
+                <amin_x,amin_y
+                ,amax_x,amax_y
+                ,tile_x,CPU_STRIP_Y>;
+            G.do_run_host(kfun, cpu_out, true, reassociation_tolerance<T>(ixs_len));
+        }
+#ifndef Jacobi2D
+        {
+            cout << "## Benchmark 2d cpu - box running sums: ";
+            printf("tile=[%d][%d]%s - f64 sums - %d threads ##", CPU_BOX_Y, tile_x, elem, host_pool().size());
+            Kernel2dHostOf<T> kfun = stencil_2d_cpu_box
+                <amin_x,amin_y
+                ,amax_x,amax_y
+                ,tile_x,CPU_BOX_Y>;
+            G.do_run_host(kfun, cpu_out, true, reassociation_tolerance<T>(ixs_len));
+        }
+#endif
 
         /*{
             cout << "## Benchmark 2d global read - inlined ixs - multiDim grid ##";
-            Kernel2dPhysMultiDim kfun = global_reads_2d_inline_multiDim
+            Kernel2dPhysMultiDimOf<T> kfun = global_reads_2d_inline_multiDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,group_size_x,group_size_y>;
@@ -143,7 +176,7 @@ void doTest_2D(const int physBlocks)
 
         {
             cout << "## Benchmark 2d global read - inlined ixs - singleDim grid ##";
-            Kernel2dPhysSingleDim kfun = global_reads_2d_inline_singleDim
+            Kernel2dPhysSingleDimOf<T> kfun = global_reads_2d_inline_singleDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,group_size_x,group_size_y>;
@@ -153,7 +186,7 @@ void doTest_2D(const int physBlocks)
 
         {
             cout << "## Benchmark 2d big tile - inlined idxs - cube2d load - singleDim grid ##";
-            Kernel2dPhysSingleDim kfun = big_tile_2d_inlined_cube_singleDim
+            Kernel2dPhysSingleDimOf<T> kfun = big_tile_2d_inlined_cube_singleDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,group_size_x,group_size_y>;
@@ -161,7 +194,7 @@ void doTest_2D(const int physBlocks)
         }
         {
             cout << "## Benchmark 2d big tile - inlined idxs - flat load (div/rem) - singleDim grid ##";
-            Kernel2dPhysSingleDim kfun = big_tile_2d_inlined_flat_divrem_singleDim
+            Kernel2dPhysSingleDimOf<T> kfun = big_tile_2d_inlined_flat_divrem_singleDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,group_size_x,group_size_y>;
@@ -169,7 +202,7 @@ void doTest_2D(const int physBlocks)
         }
         {
             cout << "## Benchmark 2d big tile - inlined idxs - flat load (add/carry) - singleDim grid ##";
-            Kernel2dPhysSingleDim kfun = big_tile_2d_inlined_flat_addcarry_singleDim
+            Kernel2dPhysSingleDimOf<T> kfun = big_tile_2d_inlined_flat_addcarry_singleDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,group_size_x,group_size_y>;
@@ -177,7 +210,7 @@ void doTest_2D(const int physBlocks)
         }
         {
             cout << "## Benchmark 2d virtual (add/carry) - big tile - inlined idxs - flat load (add/carry) - singleDim grid ##";
-            Kernel2dVirtual kfun = virtual_addcarry_big_tile_2d_inlined_flat_addcarry_singleDim
+            Kernel2dVirtualOf<T> kfun = virtual_addcarry_big_tile_2d_inlined_flat_addcarry_singleDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,group_size_x,group_size_y>;
@@ -207,9 +240,9 @@ void doTest_2D(const int physBlocks)
 
             {
                 cout << "## Benchmark 2d big tile - inlined idxs - stripmined: ";
-                printf("strip_size=[%d][%d]f32 ", strip_size_y, strip_size_x);
+                printf("strip_size=[%d][%d]%s ", strip_size_y, strip_size_x, elem);
                 cout << "- flat load (add/carry) - singleDim grid ##";
-                Kernel2dPhysSingleDim kfun = stripmine_big_tile_2d_inlined_flat_addcarry_singleDim
+                Kernel2dPhysSingleDimOf<T> kfun = stripmine_big_tile_2d_inlined_flat_addcarry_singleDim
                     <amin_x,amin_y
                     ,amax_x,amax_y
                     ,group_size_x,group_size_y
@@ -222,9 +255,9 @@ void doTest_2D(const int physBlocks)
 
             /*{
             cout << "## Benchmark 2d virtual (add/carry) - stripmined big tile, ";
-            printf("strip_size=[%d][%d]f32 ", strip_size_y, strip_size_x);
+            printf("strip_size=[%d][%d]%s ", strip_size_y, strip_size_x, elem);
             cout << "- inlined idxs - flat load (add/carry) - singleDim grid ##";
-            Kernel2dVirtual kfun = virtual_addcarry_stripmine_big_tile_2d_inlined_flat_addcarry_singleDim
+            Kernel2dVirtualOf<T> kfun = virtual_addcarry_stripmine_big_tile_2d_inlined_flat_addcarry_singleDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,group_size_x,group_size_y
@@ -258,9 +291,9 @@ void doTest_2D(const int physBlocks)
             //printf("shared memory per block: sliding = %d B\n", sh_total_mem_usage);
 
             cout << "## Benchmark 2d sliding (small-)tile - flat - inlined idxs: ";
-            printf("strip_size=[%d][%d]f32 ", window_length_y, working_x);
+            printf("strip_size=[%d][%d]%s ", window_length_y, working_x, elem);
             cout << "- singleDim grid ##";
-            Kernel2dPhysSingleDim kfun = sliding_tile_flat_smalltile_singleDim
+            Kernel2dPhysSingleDimOf<T> kfun = sliding_tile_flat_smalltile_singleDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,group_size_flat
@@ -291,9 +324,9 @@ void doTest_2D(const int physBlocks)
             //printf("range_y=%d, sh_y=%d\n",range_y,sh_y);
             //printf("shared memory per block: sliding = %d B\n", sh_total_mem_usage);
             cout << "## Benchmark 2d sliding (small-)tile - inlined idxs: ";
-            printf("strip_size=[%d][%d]f32 ", work_y, working_x);
+            printf("strip_size=[%d][%d]%s ", work_y, working_x, elem);
             cout << "- singleDim grid ##";
-            Kernel2dPhysSingleDim kfun = sliding_tile_smalltile_singleDim
+            Kernel2dPhysSingleDimOf<T> kfun = sliding_tile_smalltile_singleDim
                 <amin_x,amin_y
                 ,amax_x,amax_y
                 ,gpx,gpy
@@ -332,13 +365,101 @@ void doTest_2D(const int physBlocks)
         //GPU_RUN_END;
     }
 
-    free(cpu_out);
+    host_arena().release(cpu_out);
 
     // to avoid unused varible warning.
     (void)singleDim_grid_flat;
     (void)std_sh_size_bytes;
 }
 
+// the stripmine sweep for one element type, on grids of that type.
+template<typename T>
+void doTests_2D(const int physBlocks)
+{
+    Globs2d<T> G(lens, lens_flat, n_runs, n_host_runs);
+    cout << "element type " << ElemTraits<T>::name() << endl;
+    measure_host_bandwidth_per_node(G.arr_in, G.arr_out, G.tlen);
+
+    doTest_2D< 0,1, 0,1, 32,8,0,0>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,0,0>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,0,0>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,0,0>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,0,0>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,0,0>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,0,0>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,0,1>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,0,1>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,0,1>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,0,1>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,0,1>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,0,1>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,0,1>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,0,2>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,0,2>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,0,2>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,0,2>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,0,2>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,0,2>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,0,2>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,1,0>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,1,0>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,1,0>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,1,0>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,1,0>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,1,0>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,1,0>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,2,0>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,2,0>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,2,0>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,2,0>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,2,0>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,2,0>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,2,0>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,1,1>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,1,1>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,1,1>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,1,2>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,1,2>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,1,2>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,1,2>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,1,2>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,1,2>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,1,2>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,2,1>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,2,1>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,2,1>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,2,1>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,2,1>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,2,1>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,2,1>(G, physBlocks);
+
+    doTest_2D< 0,1, 0,1, 32,8,2,2>(G, physBlocks);
+    doTest_2D<-1,1, 0,1, 32,8,2,2>(G, physBlocks);
+    doTest_2D<-1,1,-1,1, 32,8,2,2>(G, physBlocks);
+    doTest_2D<-1,2,-1,1, 32,8,2,2>(G, physBlocks);
+    doTest_2D<-1,2,-1,2, 32,8,2,2>(G, physBlocks);
+    doTest_2D<-2,2,-1,2, 32,8,2,2>(G, physBlocks);
+    doTest_2D<-2,2,-2,2, 32,8,2,2>(G, physBlocks);
+}
 
 int main()
 {
@@ -473,85 +594,10 @@ int main()
     //doTest_2D<2,5,3,6, 32,8,1,1>(physBlocks);
     //doTest_2D<-5,-2,-6,-3, 32,8,1,1>(physBlocks);
     //stripmine tests
-    doTest_2D< 0,1, 0,1, 32,8,0,0>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,0,0>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,0,0>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,0,0>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,0,0>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,0,0>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,0,0>(physBlocks);
-
-    doTest_2D< 0,1, 0,1, 32,8,0,1>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,0,1>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,0,1>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,0,1>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,0,1>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,0,1>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,0,1>(physBlocks);
-
-    doTest_2D< 0,1, 0,1, 32,8,0,2>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,0,2>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,0,2>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,0,2>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,0,2>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,0,2>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,0,2>(physBlocks);
-
-    doTest_2D< 0,1, 0,1, 32,8,1,0>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,1,0>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,1,0>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,1,0>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,1,0>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,1,0>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,1,0>(physBlocks);
-
-    doTest_2D< 0,1, 0,1, 32,8,2,0>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,2,0>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,2,0>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,2,0>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,2,0>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,2,0>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,2,0>(physBlocks);
-
-    doTest_2D< 0,1, 0,1, 32,8,1,1>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,1,1>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,1,1>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,1,1>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,1,1>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,1,1>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,1,1>(physBlocks); 
-
-    doTest_2D< 0,1, 0,1, 32,8,1,1>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,1,1>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,1,1>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,1,1>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,1,1>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,1,1>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,1,1>(physBlocks); 
-
-    doTest_2D< 0,1, 0,1, 32,8,1,2>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,1,2>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,1,2>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,1,2>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,1,2>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,1,2>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,1,2>(physBlocks);
-
-    doTest_2D< 0,1, 0,1, 32,8,2,1>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,2,1>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,2,1>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,2,1>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,2,1>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,2,1>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,2,1>(physBlocks);
-
-    doTest_2D< 0,1, 0,1, 32,8,2,2>(physBlocks);
-    doTest_2D<-1,1, 0,1, 32,8,2,2>(physBlocks);
-    doTest_2D<-1,1,-1,1, 32,8,2,2>(physBlocks);
-    doTest_2D<-1,2,-1,1, 32,8,2,2>(physBlocks);
-    doTest_2D<-1,2,-1,2, 32,8,2,2>(physBlocks);
-    doTest_2D<-2,2,-1,2, 32,8,2,2>(physBlocks);
-    doTest_2D<-2,2,-2,2, 32,8,2,2>(physBlocks);
+    doTests_2D<float>(physBlocks);
+    doTests_2D<double>(physBlocks);
+    doTests_2D<int8_t>(physBlocks);
+    doTests_2D<half_t>(physBlocks);
 
     //stripmine tests
     //doTest_2D< 0,1, 0,1, gps_x,gps_y,0,0>(physBlocks);
@@ -11,6 +11,7 @@ using std::endl;
 
 #include "runners.h"
 #include "kernels-3d.h"
+#include "cpu-kernels-3d.h"
 
 static constexpr long3 lens = {
     ((1 << 8) + 2),
@@ -18,79 +19,47 @@ static constexpr long3 lens = {
     ((1 << 8) + 8)};
 static constexpr long lens_flat = lens.x * lens.y * lens.z;
 static constexpr long n_runs = 100;
-static Globs
+static constexpr long n_host_runs = 10;
+template<typename T> using Globs3d = Globs
     <long3,int3
-    ,Kernel3dVirtual
-    ,Kernel3dPhysMultiDim
-    ,Kernel3dPhysSingleDim
-    > G(lens, lens_flat, n_runs);
+    ,Kernel3dVirtualOf<T>
+    ,Kernel3dPhysMultiDimOf<T>
+    ,Kernel3dPhysSingleDimOf<T>
+    ,Kernel3dHostOf<T>
+    ,T>;
 
 template<
     const int amin_x, const int amin_y, const int amin_z,
-    const int amax_x, const int amax_y, const int amax_z>
-__host__
-void stencil_3d_cpu(
-    const T* start,
-    T* out)
-{
-    constexpr int3 range = {
-        amax_x - amin_x + 1,
-        amax_y - amin_y + 1,
-        amax_z - amin_z + 1};
-    constexpr int total_range = range.x * range.y * range.z;
-
-    const int max_x_idx = lens.x - 1;
-    const int max_y_idx = lens.y - 1;
-    const int max_z_idx = lens.z - 1;
-    for (int gidz = 0; gidz < lens.z; ++gidz){
-        for (int gidy = 0; gidy < lens.y; ++gidy){
-            for (int gidx = 0; gidx < lens.x; ++gidx){
-                T arr[total_range];
-                for(int i=0; i < range.z; i++){
-                    for(int j=0; j < range.y; j++){
-                        for(int k=0; k < range.x; k++){
-                            const long z = bound<(amin_z<0),long>(gidz + (i + amin_z), max_z_idx);
-                            const long y = bound<(amin_y<0),long>(gidy + (j + amin_y), max_y_idx);
-                            const long x = bound<(amin_x<0),long>(gidx + (k + amin_x), max_x_idx);
-                            const long index = (z*lens.y + y)*lens.x + x;
-                            const int flat_idx = (i*range.y + j)*range.x + k;
-                            arr[flat_idx] = start[index];
-                        }
-                    }
-                }
-                T lambda_res = stencil_fun_3d<amin_x, amin_y, amin_z, amax_x, amax_y, amax_z>(arr);
-                out[(gidz*lens.y + gidy)*lens.x + gidx] = lambda_res;
-            }
-        }
-    }
-}
-
-template<
-    const int amin_x, const int amin_y, const int amin_z,
-    const int amax_x, const int amax_y, const int amax_z>
+    const int amax_x, const int amax_y, const int amax_z,
+    typename T>
 __host__
 void run_cpu_3d(T* cpu_out)
 {
-    T* cpu_in = (T*)malloc(lens_flat*sizeof(T));
+    constexpr int tile_x = elem_scaled<T>(CPU_TILE_X);
+    T* cpu_in = host_arena().acquire<T>(lens_flat);
     srand(1);
     for (int i = 0; i < lens_flat; ++i)
     {
-        cpu_in[i] = (T)rand();
+        cpu_in[i] = elem_random<T>();
     }
 
     struct timeval t_startpar, t_endpar, t_diffpar;
     gettimeofday(&t_startpar, NULL);
     {
-        stencil_3d_cpu<amin_x, amin_y, amin_z, amax_x, amax_y, amax_z>(cpu_in,cpu_out);
+        stencil_3d_cpu_tiled
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,tile_x,CPU_TILE_Y,CPU_TILE_Z>
+            (cpu_in,cpu_out,lens);
     }
     gettimeofday(&t_endpar, NULL);
     timeval_subtract(&t_diffpar, &t_endpar, &t_startpar);
     const unsigned long elapsed = (t_diffpar.tv_sec*1e6+t_diffpar.tv_usec) / 1000;
     const unsigned long seconds = elapsed / 1000;
     const unsigned long microseconds = elapsed % 1000;
-    printf("cpu c 3d for 1 run : %lu.%03lu seconds\n", seconds, microseconds);
+    printf("cpu c 3d for 1 run : %lu.%03lu seconds (%d threads)\n", seconds, microseconds, host_pool().size());
 
-    free(cpu_in);
+    host_arena().release(cpu_in);
 }
 
 template<
@@ -98,9 +67,10 @@ template<
     const int amin_y, const int amax_y,
     const int amin_x, const int amax_x,
     const int group_size_x,  const int group_size_y, const int group_size_z,
-    const int strip_pow_x, const int strip_pow_y, const int strip_pow_z>
+    const int strip_pow_x, const int strip_pow_y, const int strip_pow_z,
+    typename T>
 __host__
-void doTest_3D(const int physBlocks)
+void doTest_3D(Globs3d<T>& G, const int physBlocks)
 {
     static_assert(amin_z <= amax_z, "invalid setup");
     static_assert(amin_y <= amax_y, "invalid setup");
@@ -118,7 +88,7 @@ void doTest_3D(const int physBlocks)
 
     constexpr long len = lens_flat;
 
-    T* cpu_out = (T*)malloc(len*sizeof(T));
+    T* cpu_out = host_arena().acquire<T>(len);
     run_cpu_3d<amin_x, amin_y, amin_z, amax_x, amax_y, amax_z>(cpu_out);
 
     constexpr int blockDim_flat = group_size_x * group_size_y * group_size_z;
@@ -138,12 +108,73 @@ void doTest_3D(const int physBlocks)
     constexpr int sh_size_flat = sh_size_x * sh_size_y * sh_size_z;
     constexpr int sh_mem_size_flat = sh_size_flat * sizeof(T);
 
+    constexpr int tile_x = elem_scaled<T>(CPU_TILE_X);
+    constexpr int plane_x = elem_scaled<T>(CPU_PLANE_X);
+    const char* elem = ElemTraits<T>::name();
+
     cout << "Blockdim z,y,x = " << group_size_z << ", " << group_size_y << ", " << group_size_x << endl;
     //printf("virtual number of blocks = %d\n", virtual_grid_flat);
     {
+        {
+            cout << "## Benchmark 3d cpu - tiled: ";
+            printf("tile=[%d][%d][%d]%s - %d threads ##", CPU_TILE_Z, CPU_TILE_Y, tile_x, elem, host_pool().size());
+            Kernel3dHostOf<T> kfun = stencil_3d_cpu_tiled
+                <amin_x,amin_y,amin_z
+                ,amax_x,amax_y,amax_z
+                ,tile_x,CPU_TILE_Y,CPU_TILE_Z>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            cout << "## Benchmark 3d cpu - simd: ";
+            printf("tile=[%d][%d][%d]%s - %s - %d threads ##", CPU_TILE_Z, CPU_TILE_Y, tile_x, elem, host_isa_name(host_isa_for<T>()), host_pool().size());
+            Kernel3dHostOf<T> kfun = stencil_3d_cpu_simd
+                <amin_x,amin_y,amin_z
+                ,amax_x,amax_y,amax_z
+                ,tile_x,CPU_TILE_Y,CPU_TILE_Z>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            cout << "## Benchmark 3d cpu - simd, work stealing: ";
+            printf("tile=[%d][%d][%d]%s - morton order - %s - %d threads ##", CPU_TILE_Z, CPU_TILE_Y, tile_x, elem, host_isa_name(host_isa_for<T>()), host_pool().size());
+            Kernel3dHostOf<T> kfun = stencil_3d_cpu_simd_steal
+                <amin_x,amin_y,amin_z
+                ,amax_x,amax_y,amax_z
+                ,tile_x,CPU_TILE_Y,CPU_TILE_Z>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            cout << "## Benchmark 3d cpu - z-marching: ";
+            printf("plane=[%d][%d]%s - ring of %d planes - march=%d - %s - %d threads ##", CPU_PLANE_Y, plane_x, elem, amax_z - amin_z + 1, CPU_MARCH_Z, host_isa_name(host_isa_for<T>()), host_pool().size());
+            Kernel3dHostOf<T> kfun = stencil_3d_cpu_zmarch
+                <amin_x,amin_y,amin_z
+                ,amax_x,amax_y,amax_z
+                ,plane_x,CPU_PLANE_Y,CPU_MARCH_Z>;
+            G.do_run_host(kfun, cpu_out);
+        }
+        {
+            constexpr bool separable = stencil_3d_is_separable<x_range,y_range,z_range>();
+            cout << "## Benchmark 3d cpu - separable: ";
+            printf("plane=[%d][%d]%s - march=%d - %s - %d threads ##", CPU_PLANE_Y, plane_x, elem, CPU_MARCH_Z, separable ? "x,y,z passes" : "not separable, simd", host_pool().size());
+            Kernel3dHostOf<T> kfun = stencil_3d_cpu_separable_mean
+                <amin_x,amin_y,amin_z
+                ,amax_x,amax_y,amax_z
+                ,plane_x,CPU_PLANE_Y,CPU_MARCH_Z>;
+            G.do_run_host(kfun, cpu_out, true, reassociation_tolerance<T>(ixs_len));
+        }
+#ifndef Jacobi3D
+        {
+            cout << "## Benchmark 3d cpu - box running sums: ";
+            printf("plane=[%d][%d]%s - f64 sums - march=%d - %d threads ##", CPU_PLANE_Y, plane_x, elem, CPU_MARCH_Z, host_pool().size());
+            Kernel3dHostOf<T> kfun = stencil_3d_cpu_box
+                <amin_x,amin_y,amin_z
+                ,amax_x,amax_y,amax_z
+                ,plane_x,CPU_PLANE_Y,CPU_MARCH_Z>;
+            G.do_run_host(kfun, cpu_out, true, reassociation_tolerance<T>(ixs_len));
+        }
+#endif
         /*{
             cout << "## Benchmark 3d global read - inlined ixs - multiDim grid ##";
-            Kernel3dPhysMultiDim kfun = global_reads_3d_inlined
+            Kernel3dPhysMultiDimOf<T> kfun = global_reads_3d_inlined
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -154,7 +185,7 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d global read - inlined ixs - singleDim grid - grid span ##";
-            Kernel3dPhysSingleDim kfun = global_reads_3d_inlined_singleDim_gridSpan
+            Kernel3dPhysSingleDimOf<T> kfun = global_reads_3d_inlined_singleDim_gridSpan
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -165,7 +196,7 @@ void doTest_3D(const int physBlocks)
             constexpr long lens_grid = divUp(lens_flat, long(blockDim_flat));
             constexpr int3 lens_spans = { 1, int(lens.x), int(lens.x*lens.y) };
             cout << "## Benchmark 3d global read - inlined ixs - singleDim grid - lens span ##";
-            Kernel3dPhysSingleDim kfun = global_reads_3d_inlined_singleDim_lensSpan
+            Kernel3dPhysSingleDimOf<T> kfun = global_reads_3d_inlined_singleDim_lensSpan
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -174,7 +205,7 @@ void doTest_3D(const int physBlocks)
 
         {
             cout << "## Benchmark 3d global read - inlined idxs - virtual (add/carry) - singleDim grid ##";
-            Kernel3dVirtual kfun = virtual_addcarry_global_read_3d_inlined_grid_span_singleDim
+            Kernel3dVirtualOf<T> kfun = virtual_addcarry_global_read_3d_inlined_grid_span_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -182,7 +213,7 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - cube load - multiDim grid ##";
-            Kernel3dPhysMultiDim kfun = big_tile_3d_inlined
+            Kernel3dPhysMultiDimOf<T> kfun = big_tile_3d_inlined
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -191,7 +222,7 @@ void doTest_3D(const int physBlocks)
 
         /*{
             cout << "## Benchmark 3d big tile - inlined idxs - transaction aligned loads - multiDim grid ##";
-            Kernel3dPhysMultiDim kfun = big_tile_3d_inlined_trx_align
+            Kernel3dPhysMultiDimOf<T> kfun = big_tile_3d_inlined_trx_align
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -200,7 +231,7 @@ void doTest_3D(const int physBlocks)
         /*
         {
             cout << "## Benchmark 3d big tile - inlined idxs - forced coalesced flat load (div/rem) - multiDim grid ##";
-            Kernel3dPhysMultiDim kfun = big_tile_3d_inlined_flat_forced_coalesced
+            Kernel3dPhysMultiDimOf<T> kfun = big_tile_3d_inlined_flat_forced_coalesced
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -209,7 +240,7 @@ void doTest_3D(const int physBlocks)
         */
         /*{
             cout << "## Benchmark 3d big tile - inlined idxs - cube reshape (div/rem) - multiDim grid ##";
-            Kernel3dPhysMultiDim kfun = big_tile_3d_inlined_cube_reshape
+            Kernel3dPhysMultiDimOf<T> kfun = big_tile_3d_inlined_cube_reshape
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -217,7 +248,7 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - flat load (div/rem) - multiDim grid ##";
-            Kernel3dPhysMultiDim kfun = big_tile_3d_inlined_flat
+            Kernel3dPhysMultiDimOf<T> kfun = big_tile_3d_inlined_flat
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -225,7 +256,7 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - flat load (div/rem) - singleDim grid ##";
-            Kernel3dPhysSingleDim kfun = big_tile_3d_inlined_flat_singleDim
+            Kernel3dPhysSingleDimOf<T> kfun = big_tile_3d_inlined_flat_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -233,7 +264,7 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - flat load (add/carry) - singleDim grid ##";
-            Kernel3dPhysSingleDim kfun = big_tile_3d_inlined_flat_addcarry_singleDim
+            Kernel3dPhysSingleDimOf<T> kfun = big_tile_3d_inlined_flat_addcarry_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -241,7 +272,7 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - virtual (add/carry) - flat load (div/rem) - multiDim grid ##";
-            Kernel3dVirtual kfun = virtual_addcarry_big_tile_3d_inlined_flat_divrem_MultiDim
+            Kernel3dVirtualOf<T> kfun = virtual_addcarry_big_tile_3d_inlined_flat_divrem_MultiDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -249,7 +280,7 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - virtual (add/carry) - flat load (div/rem) - singleDim grid ##";
-            Kernel3dVirtual kfun = virtual_addcarry_big_tile_3d_inlined_flat_divrem_singleDim
+            Kernel3dVirtualOf<T> kfun = virtual_addcarry_big_tile_3d_inlined_flat_divrem_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -257,7 +288,7 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - virtual (rem/div) - flat load (div/rem) - singleDim grid ##";
-            Kernel3dVirtual kfun = virtual_divrem_big_tile_3d_inlined_flat_divrem_singleDim
+            Kernel3dVirtualOf<T> kfun = virtual_divrem_big_tile_3d_inlined_flat_divrem_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
@@ -265,14 +296,14 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - virtual (add/carry) - flat load (add/carry) - singleDim grid ##";
-            Kernel3dVirtual kfun = virtual_addcarry_big_tile_3d_inlined_flat_addcarry_singleDim
+            Kernel3dVirtualOf<T> kfun = virtual_addcarry_big_tile_3d_inlined_flat_addcarry_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z>;
             G.do_run_virtual(kfun, cpu_out, physBlocks, block_3d_flat, virtual_grid, sh_mem_size_flat);
         }*/
 
-        constexpr int strip_x = 1 << strip_pow_x;
+        constexpr int strip_x = elem_scaled<T>(1 << strip_pow_x);
         constexpr int strip_y = 1 << strip_pow_y;
         constexpr int strip_z = 1 << strip_pow_z;
         constexpr int strip_size_x = group_size_x*strip_x;
@@ -298,9 +329,9 @@ void doTest_3D(const int physBlocks)
 
         {
             //cout << "## Benchmark 3d big tile - inlined idxs - stripmined: ";
-            //printf("strip_size=[%d][%d][%d]f32 ", strip_size_z, strip_size_y, strip_size_x);
+            //printf("strip_size=[%d][%d][%d]%s ", strip_size_z, strip_size_y, strip_size_x, elem);
             //cout << "- flat load (add/carry) - singleDim grid ##";
-            Kernel3dPhysSingleDim kfun = stripmine_big_tile_3d_inlined_flat_addcarry_singleDim
+            Kernel3dPhysSingleDimOf<T> kfun = stripmine_big_tile_3d_inlined_flat_addcarry_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z
@@ -311,9 +342,9 @@ void doTest_3D(const int physBlocks)
         }
         /*{
             cout << "## Benchmark 3d big tile - inlined idxs - stripmined: ";
-            printf("strip_size=[%d][%d][%d]f32 ", strip_size_z, strip_size_y, strip_size_x);
+            printf("strip_size=[%d][%d][%d]%s ", strip_size_z, strip_size_y, strip_size_x, elem);
             cout << "- cube loader - singleDim grid ##";
-            Kernel3dPhysSingleDim kfun = stripmine_big_tile_3d_inlined_cube_singleDim
+            Kernel3dPhysSingleDimOf<T> kfun = stripmine_big_tile_3d_inlined_cube_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z
@@ -323,9 +354,9 @@ void doTest_3D(const int physBlocks)
         }
         {
             cout << "## Benchmark 3d big tile - inlined idxs - stripmined: ";
-            printf("strip_size=[%d][%d][%d]f32 ", strip_size_z, strip_size_y, strip_size_x);
+            printf("strip_size=[%d][%d][%d]%s ", strip_size_z, strip_size_y, strip_size_x, elem);
             cout << "- virtual (add/carry) - flat load (add/carry) - singleDim grid ##";
-            Kernel3dVirtual kfun = virtual_addcarry_stripmine_big_tile_3d_inlined_flat_addcarry_singleDim
+            Kernel3dVirtualOf<T> kfun = virtual_addcarry_stripmine_big_tile_3d_inlined_flat_addcarry_singleDim
                 <amin_x,amin_y,amin_z
                 ,amax_x,amax_y,amax_z
                 ,group_size_x,group_size_y,group_size_z
@@ -335,7 +366,7 @@ void doTest_3D(const int physBlocks)
         }*/
     }
 
-    free(cpu_out);
+    host_arena().release(cpu_out);
 
     (void)block_3d;
     (void)block_3d_flat;
@@ -347,22 +378,53 @@ void doTest_3D(const int physBlocks)
 
 template
     <const int gx, const int gy, const int gz
-    ,const int sx, const int sy, const int sz>
+    ,const int sx, const int sy, const int sz
+    ,typename T>
 __host__
-void testStrips(const int physBlocks){
-    doTest_3D<-1,0, -1,0, -1,0, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,1, -1,0, -1,0, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,1, -1,1, -1,0, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,1, -1,0, -1,1, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,1, -1,1, -1,1, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,2, -1,1, -1,1, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,2, -1,2, -1,1, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,2, -1,1, -1,2, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,2, -1,2, -1,2, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,3, -1,2, -1,2, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,3, -1,3, -1,2, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,3, -1,2, -1,3, gx,gy,gz,sx,sy,sz>(physBlocks);
-    doTest_3D<-1,3, -1,3, -1,3, gx,gy,gz,sx,sy,sz>(physBlocks);
+void testStrips(Globs3d<T>& G, const int physBlocks){
+    doTest_3D<-1,0, -1,0, -1,0, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,1, -1,0, -1,0, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,1, -1,1, -1,0, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,1, -1,0, -1,1, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,1, -1,1, -1,1, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,2, -1,1, -1,1, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,2, -1,2, -1,1, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,2, -1,1, -1,2, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,2, -1,2, -1,2, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,3, -1,2, -1,2, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,3, -1,3, -1,2, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,3, -1,2, -1,3, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+    doTest_3D<-1,3, -1,3, -1,3, gx,gy,gz,sx,sy,sz>(G, physBlocks);
+}
+
+// the block size sweep for one element type, on grids of that type.
+template<typename T>
+__host__
+void doTests_3D(const int physBlocks)
+{
+    Globs3d<T> G(lens, lens_flat, n_runs, n_host_runs);
+    cout << "element type " << ElemTraits<T>::name() << endl;
+    measure_host_bandwidth_per_node(G.arr_in, G.arr_out, G.tlen);
+
+    doTest_3D<0,1,0,1,0,1, 32,2,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,0,1,0,1, 32,2,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,-1,1,0,1, 32,2,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,-1,1,-1,1, 32,2,2,0,0,0>(G, physBlocks);
+
+    doTest_3D<0,1,0,1,0,1, 32,4,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,0,1,0,1, 32,4,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,-1,1,0,1, 32,4,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,-1,1,-1,1, 32,4,2,0,0,0>(G, physBlocks);
+
+    doTest_3D<0,1,0,1,0,1, 32,8,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,0,1,0,1, 32,8,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,-1,1,0,1, 32,8,2,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,-1,1,-1,1, 32,8,2,0,0,0>(G, physBlocks);
+
+    doTest_3D<0,1,0,1,0,1, 32,8,4,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,0,1,0,1, 32,8,4,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,-1,1,0,1, 32,8,4,0,0,0>(G, physBlocks);
+    doTest_3D<-1,1,-1,1,-1,1, 32,8,4,0,0,0>(G, physBlocks);
 }
 
 __host__
@@ -413,25 +475,10 @@ int main()
     doTest_3D<-5,5,0,0,-5,5, gps_x,gps_y,gps_z,0,0,0>(physBlocks);
     */
     // all axis are in use
-    doTest_3D<0,1,0,1,0,1, 32,2,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,0,1,0,1, 32,2,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,-1,1,0,1, 32,2,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,-1,1,-1,1, 32,2,2,0,0,0>(physBlocks);
-
-    doTest_3D<0,1,0,1,0,1, 32,4,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,0,1,0,1, 32,4,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,-1,1,0,1, 32,4,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,-1,1,-1,1, 32,4,2,0,0,0>(physBlocks);
-
-    doTest_3D<0,1,0,1,0,1, 32,8,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,0,1,0,1, 32,8,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,-1,1,0,1, 32,8,2,0,0,0>(physBlocks);
-    doTest_3D<-1,1,-1,1,-1,1, 32,8,2,0,0,0>(physBlocks);
-
-    doTest_3D<0,1,0,1,0,1, 32,8,4,0,0,0>(physBlocks);
-    doTest_3D<-1,1,0,1,0,1, 32,8,4,0,0,0>(physBlocks);
-    doTest_3D<-1,1,-1,1,0,1, 32,8,4,0,0,0>(physBlocks);
-    doTest_3D<-1,1,-1,1,-1,1, 32,8,4,0,0,0>(physBlocks);
+    doTests_3D<float>(physBlocks);
+    doTests_3D<double>(physBlocks);
+    doTests_3D<int8_t>(physBlocks);
+    doTests_3D<half_t>(physBlocks);
     //blocksize test
     /*
     doTest_3D<0,1,0,1,0,1, 32,8,1,0,0,0>(physBlocks);
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "kernels-2d.h"
+#include "cpu-kernels-2d.h"
+
+#if !defined(HOST_EMULATION) || !defined(COUNT_TRAFFIC)
+#error "stencil-banks.cu replays shared accesses in the emulation, build it as trafficproject-banks"
+#endif
+
+/*******************************************************************************
+ * Shared memory bank conflicts of the 2d big tile kernels, per template
+ * configuration. Built as trafficproject-banks (host-emu/traffic.h) every
+ * benchmark line is followed by the wavefronts a warp's shared reads and
+ * writes take on average and at worst, 1 being free of conflicts.
+ * The cube tile is tried with 0 to BANK_PAD_MAX unused elements after every row,
+ * and the smallest padding with the fewest worst case wavefronts is suggested.
+ * The flat tiles are shown at their own row stride for comparison.
+ */
+static constexpr long2 lens = {
+   (1 << 8)+2,
+   (1 << 8)+4};
+static constexpr int lens_flat = lens.x * lens.y;
+static constexpr long n_runs = 1;
+static constexpr long n_host_runs = 1;
+static Globs
+    <long2,int2
+    ,Kernel2dVirtual
+    ,Kernel2dPhysMultiDim
+    ,Kernel2dPhysSingleDim
+    ,Kernel2dHost
+    > G(lens, lens_flat, n_runs, n_host_runs);
+
+#define BANK_PAD_MAX 31
+
+struct PadChoice {
+    int pad;
+    long worst;
+    double avg;
+};
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int group_size_x,  const int group_size_y,
+    const int pad, const bool done = (pad > BANK_PAD_MAX)>
+struct probe_pads {
+    __host__
+    static void run(const T* cpu_out, PadChoice& best)
+    {
+        constexpr int block = group_size_x * group_size_y;
+        constexpr int2 grid = {
+            divUp(lens.x, (long) group_size_x),
+            divUp(lens.y, (long) group_size_y)};
+        constexpr int grid_flat = grid.x * grid.y;
+        constexpr int sh_size_x = group_size_x + amax_x - amin_x;
+        constexpr int sh_size_y = group_size_y + amax_y - amin_y;
+        constexpr int sh_size_bytes = (sh_size_x + pad) * sh_size_y * sizeof(T);
+
+        cout << "## Benchmark 2d banks - cube, row stride " << sh_size_x << "+" << pad << " ##";
+        Kernel2dPhysSingleDim kfun = big_tile_2d_inlined_cube_singleDim
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,group_size_x,group_size_y
+            ,pad>;
+        G.do_run_singleDim(kfun, cpu_out, grid_flat, block, grid, sh_size_bytes);
+
+        const emu::TrafficCounts& c = emu::traffic_last();
+        const long worst = max(c.worst_wavefronts[0], c.worst_wavefronts[1]);
+        const long requests = c.bank_requests[0] + c.bank_requests[1];
+        const double avg = (c.wavefronts[0] + c.wavefronts[1]) / double(requests > 0 ? requests : 1);
+        if(best.pad < 0 || worst < best.worst || (worst == best.worst && avg < best.avg)){
+            best.pad = pad;
+            best.worst = worst;
+            best.avg = avg;
+        }
+        probe_pads<amin_x,amin_y,amax_x,amax_y,group_size_x,group_size_y,pad+1>::run(cpu_out, best);
+    }
+};
+
+template<
+    const int amin_x, const int amin_y,
+    const int amax_x, const int amax_y,
+    const int group_size_x,  const int group_size_y,
+    const int pad>
+struct probe_pads<amin_x,amin_y,amax_x,amax_y,group_size_x,group_size_y,pad,true> {
+    __host__
+    static void run(const T*, PadChoice&){}
+};
+
+template<
+    const int amin_y, const int amax_y,
+    const int amin_x, const int amax_x,
+    const int group_size_x,  const int group_size_y>
+__host__
+void doTest_banks()
+{
+    cout << "(yr,xr) = (" << amin_y << "..." << amax_y << ", " << amin_x << "..." << amax_x << ")";
+    cout << " - Blockdim y,x = " << group_size_y << ", " << group_size_x << endl;
+
+    T* cpu_out = host_arena().acquire(lens_flat);
+    stencil_2d_cpu_tiled
+        <amin_x,amin_y
+        ,amax_x,amax_y
+        ,CPU_TILE_X,CPU_TILE_Y>
+        (G.arr_in, cpu_out, lens);
+
+    constexpr int block = group_size_x * group_size_y;
+    constexpr int2 grid = {
+        divUp(lens.x, (long) group_size_x),
+        divUp(lens.y, (long) group_size_y)};
+    constexpr int grid_flat = grid.x * grid.y;
+    constexpr int sh_size_x = group_size_x + amax_x - amin_x;
+    constexpr int sh_size_y = group_size_y + amax_y - amin_y;
+    constexpr int sh_size_bytes = sh_size_x * sh_size_y * sizeof(T);
+
+    {
+        cout << "## Benchmark 2d banks - flat (div/rem), row stride " << sh_size_x << " ##";
+        Kernel2dPhysSingleDim kfun = big_tile_2d_inlined_flat_divrem_singleDim
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,group_size_x,group_size_y>;
+        G.do_run_singleDim(kfun, cpu_out, grid_flat, block, grid, sh_size_bytes);
+    }
+    {
+        cout << "## Benchmark 2d banks - flat (add/carry), row stride " << sh_size_x << " ##";
+        Kernel2dPhysSingleDim kfun = big_tile_2d_inlined_flat_addcarry_singleDim
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,group_size_x,group_size_y>;
+        G.do_run_singleDim(kfun, cpu_out, grid_flat, block, grid, sh_size_bytes);
+    }
+
+    PadChoice best = {-1, 0, 0.0};
+    probe_pads<amin_x,amin_y,amax_x,amax_y,group_size_x,group_size_y,0>::run(cpu_out, best);
+    printf("   suggested padding: +%d elements per tile row (stride %d) - %.2f avg %ld worst wavefronts\n"
+           , best.pad, sh_size_x + best.pad, best.avg, best.worst);
+
+    host_arena().release(cpu_out);
+}
+
+__host__
+int main()
+{
+#ifdef Jacobi2D
+    cout << "running Jacobi 2D" << endl;
+#else
+    cout << "running Dense stencil with mean" << endl;
+#endif
+    doTest_banks<-1,1,-1,1, 32,8>();
+    doTest_banks<-1,1,-1,1, 16,16>();
+    doTest_banks<-2,2,-2,2, 16,16>();
+    doTest_banks<-1,1,-1,1, 8,32>();
+    doTest_banks<-3,3,-1,1, 8,16>();
+    return 0;
+}
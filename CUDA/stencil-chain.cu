@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "weights.h"
+#include "chain.h"
+
+/*******************************************************************************
+ * Chains of stencils (chain.h): each chain runs stage by stage through
+ * temporary grids, on the device and on the host, and fused, through the big
+ * tile of the chain and the host engine. All are validated bit for bit
+ * against the host reference, which runs the stages one by one. Built as
+ * trafficproject-chain the traffic per output shows the intermediate grids
+ * that fusion does not write and read back.
+ */
+static constexpr long lens_1d = (1 << 22) + 2;
+static constexpr long2 lens_2d = {
+   (1 << 11)+2,
+   (1 << 11)+4};
+static constexpr long lens_2d_flat = lens_2d.x * lens_2d.y;
+static constexpr long3 lens_3d = {
+    ((1 << 8) + 2),
+    ((1 << 8) + 4),
+    ((1 << 8) + 8)};
+static constexpr long lens_3d_flat = lens_3d.x * lens_3d.y * lens_3d.z;
+static constexpr long n_runs = 100;
+static constexpr long n_host_runs = 1;
+
+static Globs
+    <long,long
+    ,Kernel1dVirtual
+    ,Kernel1dPhysMultiDim
+    ,Kernel1dPhysStripDim
+    ,Kernel1dHost
+    > G1(lens_1d, lens_1d, n_runs, n_host_runs);
+static Globs
+    <long2,int2
+    ,Kernel2dVirtual
+    ,Kernel2dPhysMultiDim
+    ,Kernel2dPhysSingleDim
+    ,Kernel2dHost
+    > G2(lens_2d, lens_2d_flat, n_runs, n_host_runs);
+static Globs
+    <long3,int3
+    ,Kernel3dVirtual
+    ,Kernel3dPhysMultiDim
+    ,Kernel3dPhysSingleDim
+    ,Kernel3dHost
+    > G3(lens_3d, lens_3d_flat, n_runs, n_host_runs);
+
+typedef Weights<W<O<-1>,1,4>, W<O<0>,2,4>, W<O<1>,1,4>> smooth_1d;
+typedef Table1d<-2,2, 12,
+    1, -8, 0, 8, -1> ddx_1d_o4;
+
+typedef Table2d<-1,-1, 1,1, 1,
+    0,  1, 0,
+    1, -4, 1,
+    0,  1, 0> laplace_2d;
+typedef Table2d<-1,-1, 1,1, 16,
+    1, 2, 1,
+    2, 4, 2,
+    1, 2, 1> gauss_2d_3x3;
+
+typedef Weights<
+    W<O<0,0,-1>,1>, W<O<0,-1,0>,1>, W<O<-1,0,0>,1>,
+    W<O<0,0,0>,-6>,
+    W<O<1,0,0>,1>, W<O<0,1,0>,1>, W<O<0,0,1>,1>> laplace_3d;
+typedef Offsets<O<0,0,-1>, O<0,-1,0>, O<-1,0,0>, O<0,0,0>, O<1,0,0>, O<0,1,0>, O<0,0,1>> mean_3d;
+
+typedef Chain<smooth_1d, ddx_1d_o4> smooth_ddx_1d;
+typedef Chain<gauss_2d_3x3, laplace_2d> log_2d;
+typedef Chain<gauss_2d_3x3, gauss_2d_3x3, gauss_2d_3x3, gauss_2d_3x3> blur4_2d;
+typedef Chain<laplace_3d, laplace_3d> biharmonic_3d;
+typedef Chain<mean_3d, mean_3d, mean_3d> mean3_3d;
+
+// the halo is printed outermost axis first, as shapes are.
+template<typename C>
+__host__
+void print_chain(const int rank, const char* name, const char* kernel, const int tile_size)
+{
+    printf("## Benchmark %dd chain %s (%d stages, halo ", rank, name, C::stages);
+    if(rank > 2){ printf("%d..%d,", C::min_z, C::max_z); }
+    if(rank > 1){ printf("%d..%d,", C::min_y, C::max_y); }
+    printf("%d..%d) - %s", C::min_x, C::max_x, kernel);
+    if(tile_size > 0){ printf(", tile %d elements", tile_size); }
+    printf(" ##");
+}
+
+template<typename C, const int group_size>
+__host__
+void doTest_chain_1d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_1d, 3);
+    T* cpu_tmp = cpu_out + lens_1d;
+    chain_unfused<C>(ChainPassHost(), G1.arr_in, cpu_out, cpu_tmp, cpu_tmp + lens_1d, lens_1d);
+
+    T* gpu_tmp;
+    CUDASSERT(cudaMalloc((void **) &gpu_tmp, 2*lens_1d*sizeof(T)));
+    const int grid = divUp(lens_1d, long(group_size));
+    {
+        print_chain<C>(1, name, "big tile per stage", 0);
+        G1.do_run_launch([&](const T* in, T* out, const long lens){
+            chain_unfused<C>(ChainPassKernels<group_size>(), in, out, gpu_tmp, gpu_tmp + lens_1d, lens); }, cpu_out);
+    }
+    {
+        print_chain<C>(1, name, "big tile fused", ChainTile<C,group_size,1,1>::size);
+        Kernel1dPhysMultiDim kfun = big_tile_1d_chain<C,group_size>;
+        G1.do_run_multiDim(kfun, cpu_out, grid, group_size, 0);
+    }
+    {
+        print_chain<C>(1, name, "host per stage", 0);
+        G1.do_run_host([&](const T* in, T* out, const long lens){
+            chain_unfused<C>(ChainPassHost(), in, out, cpu_tmp, cpu_tmp + lens_1d, lens); }, cpu_out);
+    }
+    {
+        print_chain<C>(1, name, "host fused", chain_region_size<C>(CPU_TILE_1D, 1, 1));
+        Kernel1dHost kfun = stencil_1d_cpu_chain<C,CPU_TILE_1D>;
+        G1.do_run_host(kfun, cpu_out);
+    }
+    CUDASSERT(cudaFree(gpu_tmp));
+    host_arena().release(cpu_out);
+}
+
+template<typename C, const int group_size_x, const int group_size_y>
+__host__
+void doTest_chain_2d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_2d_flat, 3);
+    T* cpu_tmp = cpu_out + lens_2d_flat;
+    chain_unfused<C>(ChainPassHost(), G2.arr_in, cpu_out, cpu_tmp, cpu_tmp + lens_2d_flat, lens_2d);
+
+    T* gpu_tmp;
+    CUDASSERT(cudaMalloc((void **) &gpu_tmp, 2*lens_2d_flat*sizeof(T)));
+    const dim3 block(group_size_x, group_size_y);
+    const dim3 grid(
+        divUp(lens_2d.x, long(group_size_x)),
+        divUp(lens_2d.y, long(group_size_y)));
+    {
+        print_chain<C>(2, name, "big tile per stage", 0);
+        G2.do_run_launch([&](const T* in, T* out, const long2 lens){
+            chain_unfused<C>(ChainPassKernels<group_size_x,group_size_y>()
+                , in, out, gpu_tmp, gpu_tmp + lens_2d_flat, lens); }, cpu_out);
+    }
+    {
+        print_chain<C>(2, name, "big tile fused", ChainTile<C,group_size_x,group_size_y,1>::size);
+        Kernel2dPhysMultiDim kfun = big_tile_2d_chain<C,group_size_x,group_size_y>;
+        G2.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_chain<C>(2, name, "host per stage", 0);
+        G2.do_run_host([&](const T* in, T* out, const long2 lens){
+            chain_unfused<C>(ChainPassHost(), in, out, cpu_tmp, cpu_tmp + lens_2d_flat, lens); }, cpu_out);
+    }
+    {
+        print_chain<C>(2, name, "host fused", chain_region_size<C>(CPU_TILE_X, CPU_TILE_Y, 1));
+        Kernel2dHost kfun = stencil_2d_cpu_chain<C,CPU_TILE_X,CPU_TILE_Y>;
+        G2.do_run_host(kfun, cpu_out);
+    }
+    CUDASSERT(cudaFree(gpu_tmp));
+    host_arena().release(cpu_out);
+}
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+__host__
+void doTest_chain_3d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_3d_flat, 3);
+    T* cpu_tmp = cpu_out + lens_3d_flat;
+    chain_unfused<C>(ChainPassHost(), G3.arr_in, cpu_out, cpu_tmp, cpu_tmp + lens_3d_flat, lens_3d);
+
+    T* gpu_tmp;
+    CUDASSERT(cudaMalloc((void **) &gpu_tmp, 2*lens_3d_flat*sizeof(T)));
+    const dim3 block(group_size_x, group_size_y, group_size_z);
+    const dim3 grid(
+        divUp(lens_3d.x, long(group_size_x)),
+        divUp(lens_3d.y, long(group_size_y)),
+        divUp(lens_3d.z, long(group_size_z)));
+    {
+        print_chain<C>(3, name, "big tile per stage", 0);
+        G3.do_run_launch([&](const T* in, T* out, const long3 lens){
+            chain_unfused<C>(ChainPassKernels<group_size_x,group_size_y,group_size_z>()
+                , in, out, gpu_tmp, gpu_tmp + lens_3d_flat, lens); }, cpu_out);
+    }
+    {
+        print_chain<C>(3, name, "big tile fused", ChainTile<C,group_size_x,group_size_y,group_size_z>::size);
+        Kernel3dPhysMultiDim kfun = big_tile_3d_chain<C,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_chain<C>(3, name, "host per stage", 0);
+        G3.do_run_host([&](const T* in, T* out, const long3 lens){
+            chain_unfused<C>(ChainPassHost(), in, out, cpu_tmp, cpu_tmp + lens_3d_flat, lens); }, cpu_out);
+    }
+    {
+        print_chain<C>(3, name, "host fused", chain_region_size<C>(CPU_TILE_X, CPU_TILE_Y, CPU_TILE_Z));
+        Kernel3dHost kfun = stencil_3d_cpu_chain<C,CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z>;
+        G3.do_run_host(kfun, cpu_out);
+    }
+    CUDASSERT(cudaFree(gpu_tmp));
+    host_arena().release(cpu_out);
+}
+
+__host__
+int main()
+{
+    doTest_chain_1d<smooth_ddx_1d, 256>("smooth, d/dx");
+
+    doTest_chain_2d<log_2d, 32,8>("gauss, laplacian");
+    doTest_chain_2d<blur4_2d, 32,8>("gauss x4");
+
+    doTest_chain_3d<biharmonic_3d, 32,4,2>("laplacian x2");
+    doTest_chain_3d<mean3_3d, 32,4,2>("mean x3");
+    return 0;
+}
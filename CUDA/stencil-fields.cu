@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "weights.h"
+#include "fields.h"
+
+/*******************************************************************************
+ * Coupled updates of several fields (fields.h): a velocity field diffuses and
+ * is pushed by the gradient of a pressure, which takes the divergence of the
+ * velocity. Each update runs as one sweep through global reads and the big
+ * tile of all inputs, and as one big tile pass per term; all are validated
+ * against the host reference. Built as trafficproject-fields the traffic per
+ * output shows what the single sweep saves.
+ */
+static constexpr long2 lens_2d = {
+   (1 << 11)+2,
+   (1 << 11)+4};
+static constexpr long lens_2d_flat = lens_2d.x * lens_2d.y;
+static constexpr long3 lens_3d = {
+    ((1 << 8) + 2),
+    ((1 << 8) + 4),
+    ((1 << 8) + 8)};
+static constexpr long lens_3d_flat = lens_3d.x * lens_3d.y * lens_3d.z;
+static constexpr long n_runs = 100;
+static constexpr long n_host_runs = 1;
+
+typedef Table2d<-1,-1, 1,1, 1,
+    0,  1, 0,
+    1, -4, 1,
+    0,  1, 0> laplace_2d;
+typedef Weights<W<O<0,0,-1>,1>, W<O<0,-1,0>,1>, W<O<-1,0,0>,1>, W<O<0,0,0>,-6>,
+    W<O<1,0,0>,1>, W<O<0,1,0>,1>, W<O<0,0,1>,1>> laplace_3d;
+// minus the central differences.
+typedef Weights<W<O<-1,0,0>,1,2>, W<O<1,0,0>,-1,2>> minus_ddx;
+typedef Weights<W<O<0,-1,0>,1,2>, W<O<0,1,0>,-1,2>> minus_ddy;
+typedef Weights<W<O<0,0,-1>,1,2>, W<O<0,0,1>,-1,2>> minus_ddz;
+
+// the fields u, v, p.
+typedef Coupled<3
+    ,Output<Term<0, laplace_2d>, Term<2, minus_ddx>>
+    ,Output<Term<1, laplace_2d>, Term<2, minus_ddy>>
+    ,Output<Term<0, minus_ddx>, Term<1, minus_ddy>>
+    > flow_2d;
+// the fields u, v, w, p.
+typedef Coupled<4
+    ,Output<Term<0, laplace_3d>, Term<3, minus_ddx>>
+    ,Output<Term<1, laplace_3d>, Term<3, minus_ddy>>
+    ,Output<Term<2, laplace_3d>, Term<3, minus_ddz>>
+    ,Output<Term<0, minus_ddx>, Term<1, minus_ddy>, Term<2, minus_ddz>>
+    > flow_3d;
+// two fields that only read each other.
+typedef Coupled<2
+    ,Output<Term<1, Offsets<O<-1,0>, O<1,0>>>>
+    ,Output<Term<0, Offsets<O<0,-1>, O<0,1>>>>
+    > swap_2d;
+
+template<typename C>
+__host__
+void print_fields(const int rank, const char* name, const char* kernel, const int tile_size)
+{
+    printf("## Benchmark %dd fields %s (%d in, %d out, %d terms) - %s", rank, name
+          , C::n_inputs, C::n_outputs, C::Terms::size, kernel);
+    if(tile_size > 0){ printf(", tile %d elements", tile_size); }
+    printf(" ##");
+}
+
+template<typename C, const int group_size_x, const int group_size_y>
+__host__
+void doTest_fields_2d(const char* name)
+{
+    static FieldGlobs<long2,C::n_inputs,C::n_outputs> G(lens_2d, lens_2d_flat, n_runs, n_host_runs);
+    FieldPtrs<C::n_outputs> cpu_out;
+    T* cpu_arr = host_arena().acquire(lens_2d_flat, C::n_outputs);
+    for(int f = 0; f < C::n_outputs; f++){ cpu_out.at[f] = cpu_arr + f*lens_2d_flat; }
+    stencil_2d_cpu_fields<C>(G.in, cpu_out, lens_2d);
+
+    typedef void (*Kernel)(const FieldPtrs<C::n_inputs>, const FieldPtrs<C::n_outputs>, const long2);
+    const dim3 block(group_size_x, group_size_y);
+    const dim3 grid(
+        divUp(lens_2d.x, long(group_size_x)),
+        divUp(lens_2d.y, long(group_size_y)));
+    {
+        print_fields<C>(2, name, "global reads", 0);
+        Kernel kfun = global_reads_2d_fields<C,group_size_x,group_size_y>;
+        G.do_run_launch([&](const FieldPtrs<C::n_inputs> in, const FieldPtrs<C::n_outputs> out, const long2 lens){
+            LAUNCH(kfun, grid, block, 0)(in, out, lens); }, cpu_out);
+    }
+    {
+        print_fields<C>(2, name, "big tile", FieldsTile<C,group_size_x,group_size_y,1>::size);
+        Kernel kfun = big_tile_2d_fields<C,group_size_x,group_size_y>;
+        G.do_run_launch([&](const FieldPtrs<C::n_inputs> in, const FieldPtrs<C::n_outputs> out, const long2 lens){
+            LAUNCH(kfun, grid, block, 0)(in, out, lens); }, cpu_out);
+    }
+    {
+        print_fields<C>(2, name, "big tile per term", 0);
+        G.do_run_launch(big_tile_2d_terms<C,group_size_x,group_size_y>, cpu_out);
+    }
+    host_arena().release(cpu_arr);
+}
+
+template<typename C, const int group_size_x, const int group_size_y, const int group_size_z>
+__host__
+void doTest_fields_3d(const char* name)
+{
+    static FieldGlobs<long3,C::n_inputs,C::n_outputs> G(lens_3d, lens_3d_flat, n_runs, n_host_runs);
+    FieldPtrs<C::n_outputs> cpu_out;
+    T* cpu_arr = host_arena().acquire(lens_3d_flat, C::n_outputs);
+    for(int f = 0; f < C::n_outputs; f++){ cpu_out.at[f] = cpu_arr + f*lens_3d_flat; }
+    stencil_3d_cpu_fields<C>(G.in, cpu_out, lens_3d);
+
+    typedef void (*Kernel)(const FieldPtrs<C::n_inputs>, const FieldPtrs<C::n_outputs>, const long3);
+    const dim3 block(group_size_x, group_size_y, group_size_z);
+    const dim3 grid(
+        divUp(lens_3d.x, long(group_size_x)),
+        divUp(lens_3d.y, long(group_size_y)),
+        divUp(lens_3d.z, long(group_size_z)));
+    {
+        print_fields<C>(3, name, "global reads", 0);
+        Kernel kfun = global_reads_3d_fields<C,group_size_x,group_size_y,group_size_z>;
+        G.do_run_launch([&](const FieldPtrs<C::n_inputs> in, const FieldPtrs<C::n_outputs> out, const long3 lens){
+            LAUNCH(kfun, grid, block, 0)(in, out, lens); }, cpu_out);
+    }
+    {
+        print_fields<C>(3, name, "big tile", FieldsTile<C,group_size_x,group_size_y,group_size_z>::size);
+        Kernel kfun = big_tile_3d_fields<C,group_size_x,group_size_y,group_size_z>;
+        G.do_run_launch([&](const FieldPtrs<C::n_inputs> in, const FieldPtrs<C::n_outputs> out, const long3 lens){
+            LAUNCH(kfun, grid, block, 0)(in, out, lens); }, cpu_out);
+    }
+    {
+        print_fields<C>(3, name, "big tile per term", 0);
+        G.do_run_launch(big_tile_3d_terms<C,group_size_x,group_size_y,group_size_z>, cpu_out);
+    }
+    host_arena().release(cpu_arr);
+}
+
+__host__
+int main()
+{
+    doTest_fields_2d<flow_2d, 32,8>("flow");
+    doTest_fields_2d<swap_2d, 32,8>("swap");
+
+    doTest_fields_3d<flow_3d, 32,4,2>("flow");
+    return 0;
+}
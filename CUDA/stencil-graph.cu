@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "weights.h"
+#include "graph.h"
+
+/*******************************************************************************
+ * Graphs of stencils and pointwise operations (graph.h), evaluated node by
+ * node and in the fusion groups evaluate() picks, on the host. The header of
+ * each run gives the plan: the passes over the grid, the grids written
+ * between them and the most held at once, and the points computed per point
+ * of the nodes. All runs are validated bit for bit against a reference that
+ * computes every node into a grid of its own.
+ */
+static constexpr long2 lens_2d = {
+   (1 << 11)+2,
+   (1 << 11)+4};
+static constexpr long lens_2d_flat = lens_2d.x * lens_2d.y;
+static constexpr long3 lens_3d = {
+    ((1 << 8) + 2),
+    ((1 << 8) + 4),
+    ((1 << 8) + 8)};
+static constexpr long lens_3d_flat = lens_3d.x * lens_3d.y * lens_3d.z;
+static constexpr long n_runs = 100;
+static constexpr long n_host_runs = 1;
+
+static Globs
+    <long2,int2
+    ,Kernel2dVirtual
+    ,Kernel2dPhysMultiDim
+    ,Kernel2dPhysSingleDim
+    ,Kernel2dHost
+    > G2(lens_2d, lens_2d_flat, n_runs, n_host_runs);
+static Globs
+    <long3,int3
+    ,Kernel3dVirtual
+    ,Kernel3dPhysMultiDim
+    ,Kernel3dPhysSingleDim
+    ,Kernel3dHost
+    > G3(lens_3d, lens_3d_flat, n_runs, n_host_runs);
+
+typedef Table2d<-1,-1, 1,1, 1,
+    0,  1, 0,
+    1, -4, 1,
+    0,  1, 0> laplace_2d;
+typedef Table2d<-1,-1, 1,1, 16,
+    1, 2, 1,
+    2, 4, 2,
+    1, 2, 1> gauss_2d_3x3;
+// a diffusion step of the 7 point Laplacian, dt/dx^2 = 1/8.
+typedef Weights<
+    W<O<0,0,-1>,1,8>, W<O<0,-1,0>,1,8>, W<O<-1,0,0>,1,8>,
+    W<O<0,0,0>,-6,8>,
+    W<O<1,0,0>,1,8>, W<O<0,1,0>,1,8>, W<O<0,0,1>,1,8>> diffuse_3d;
+
+/*******************************************************************************
+ * The graphs, recorded by build(g, A, out), and their references, every node
+ * into a grid of its own.
+ */
+// the difference of two blurs, sharpened: (g1 - g2) + laplace(A), with
+// g1 = gauss(A), g2 = gauss(g1); g1 and A are read twice.
+struct DogGraph {
+    static const char* name(){ return "difference of gaussians"; }
+    static void build(StencilGraph& g, const T* A, T* out){
+        const int a = g.input(A);
+        const int g1 = g.stencil<gauss_2d_3x3>(a);
+        const int g2 = g.stencil<gauss_2d_3x3>(g1);
+        const int d = g.sub(g1, g2);
+        const int l = g.stencil<laplace_2d>(a);
+        g.output(g.add(d, l), out);
+    }
+    static void reference(const T* A, T* out, const long2 lens){
+        const long len = lens.x * lens.y;
+        T* tmp = host_arena().acquire(len, 4);
+        T* g1 = tmp;
+        T* g2 = tmp + len;
+        T* d = tmp + 2*len;
+        T* l = tmp + 3*len;
+        stencil_2d_cpu_offsets<gauss_2d_3x3>(A, g1, lens);
+        stencil_2d_cpu_offsets<gauss_2d_3x3>(g1, g2, lens);
+        for(long i = 0; i < len; i++){ d[i] = g1[i] - g2[i]; }
+        stencil_2d_cpu_offsets<laplace_2d>(A, l, lens);
+        for(long i = 0; i < len; i++){ out[i] = d[i] + l[i]; }
+        host_arena().release(tmp);
+    }
+};
+
+// unsharp masking, A + (A - gauss(gauss(A))) * mask, the mask A * A.
+struct UnsharpGraph {
+    static const char* name(){ return "unsharp mask"; }
+    static void build(StencilGraph& g, const T* A, T* out){
+        const int a = g.input(A);
+        const int blur = g.stencil<gauss_2d_3x3>(g.stencil<gauss_2d_3x3>(a));
+        const int d = g.sub(a, blur);
+        const int m = g.mul(a, a);
+        g.output(g.add(a, g.mul(d, m)), out);
+    }
+    static void reference(const T* A, T* out, const long2 lens){
+        const long len = lens.x * lens.y;
+        T* tmp = host_arena().acquire(len, 4);
+        T* b1 = tmp;
+        T* b2 = tmp + len;
+        T* d = tmp + 2*len;
+        T* m = tmp + 3*len;
+        stencil_2d_cpu_offsets<gauss_2d_3x3>(A, b1, lens);
+        stencil_2d_cpu_offsets<gauss_2d_3x3>(b1, b2, lens);
+        for(long i = 0; i < len; i++){ d[i] = A[i] - b2[i]; }
+        for(long i = 0; i < len; i++){ m[i] = A[i] * A[i]; }
+        for(long i = 0; i < len; i++){ d[i] = d[i] * m[i]; }
+        for(long i = 0; i < len; i++){ out[i] = A[i] + d[i]; }
+        host_arena().release(tmp);
+    }
+};
+
+// explicit diffusion, u <- u + diffuse(u), steps times.
+template<const int steps>
+struct DiffusionGraph {
+    static const char* name(){ return "diffusion steps"; }
+    static void build(StencilGraph& g, const T* A, T* out){
+        int u = g.input(A);
+        for(int s = 0; s < steps; s++){
+            u = g.add(u, g.stencil<diffuse_3d>(u));
+        }
+        g.output(u, out);
+    }
+    static void reference(const T* A, T* out, const long3 lens){
+        const long len = lens.x * lens.y * lens.z;
+        T* tmp = host_arena().acquire(len, 2);
+        T* u = tmp;
+        T* d = tmp + len;
+        for(long i = 0; i < len; i++){ u[i] = A[i]; }
+        for(int s = 0; s < steps; s++){
+            stencil_3d_cpu_offsets<diffuse_3d>(u, d, lens);
+            for(long i = 0; i < len; i++){ u[i] = u[i] + d[i]; }
+        }
+        for(long i = 0; i < len; i++){ out[i] = u[i]; }
+        host_arena().release(tmp);
+    }
+};
+
+__host__
+void print_graph(const int rank, const char* name, const char* kernel, const GraphStats& s)
+{
+    printf("## Benchmark %dd graph %s (%d nodes) - %s, %d passes, %d grids written, %d held"
+           ", %.2f points computed per point, %ld scratch elements ##"
+          , rank, name, s.nodes, kernel, s.groups, s.grids, s.peak_grids, s.computed, s.scratch);
+}
+
+template<typename Graph, typename Glob, typename L>
+__host__
+void doTest_graph(Glob& G, const int rank, const L lens, const long len)
+{
+    T* cpu_out = host_arena().acquire(len);
+    Graph::reference(G.arr_in, cpu_out, lens);
+
+    StencilGraph g(lens);
+    Graph::build(g, G.arr_in, G.arr_out);
+    GraphOptions node_by_node;
+    node_by_node.fuse = false;
+    GraphOptions deep;
+    deep.pass_cost = 64;
+    const struct { const char* kernel; GraphOptions opt; } runs[] = {
+        { "node by node", node_by_node },
+        { "fused", GraphOptions() },
+        { "fused, pass cost 64", deep } };
+    for(int r = 0; r < 3; r++){
+        const GraphOptions opt = runs[r].opt;
+        g.evaluate(opt); // maps the grids between the passes
+        print_graph(rank, Graph::name(), runs[r].kernel, g.plan(opt));
+        G.do_run_host([&](const T*, T*, const L){ g.evaluate(opt); }, cpu_out);
+    }
+    host_arena().release(cpu_out);
+}
+
+__host__
+int main()
+{
+    doTest_graph<DogGraph>(G2, 2, lens_2d, lens_2d_flat);
+    doTest_graph<UnsharpGraph>(G2, 2, lens_2d, lens_2d_flat);
+
+    doTest_graph<DiffusionGraph<4> >(G3, 3, lens_3d, lens_3d_flat);
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "cpu-kernels-1d.h"
+#include "cpu-kernels-2d.h"
+#include "cpu-kernels-3d.h"
+
+/*******************************************************************************
+ * Iterative (Jacobi style) stencils on the host: out = stencil^n_iterations(in).
+ * The ping-pong sweeps are the reference; the time tiled runs advance each
+ * tile depth steps at a time while it is in cache and must match them exactly.
+ */
+static constexpr long lens_1d = (1 << 24) + 2;
+static constexpr long2 lens_2d = {
+   (1 << 12)+2,
+   (1 << 12)+4};
+static constexpr long lens_2d_flat = lens_2d.x * lens_2d.y;
+static constexpr long3 lens_3d = {
+    ((1 << 8) + 2),
+    ((1 << 8) + 4),
+    ((1 << 8) + 8)};
+static constexpr long lens_3d_flat = lens_3d.x * lens_3d.y * lens_3d.z;
+
+static constexpr int n_iterations = 32;
+static constexpr long n_host_runs = 3;
+
+using Kernel1dHostIter = void(*)(const T*, T*, T*, const long, const int);
+using Kernel2dHostIter = void(*)(const T*, T*, T*, const long2, const int);
+using Kernel3dHostIter = void(*)(const T*, T*, T*, const long3, const int);
+
+template<typename L, typename K>
+__host__
+void do_run_iterative(
+    K call,
+    const T* in,
+    const T* cpu_out,
+    const L lens,
+    const long len)
+{
+    T* out = host_arena().acquire(len);
+    T* tmp = host_arena().acquire(len);
+    memset(out, 0, len*sizeof(T));
+    struct timeval t_startpar, t_endpar, t_diffpar;
+    TRAFFIC_BEGIN();
+    gettimeofday(&t_startpar, NULL);
+    for(unsigned x = 0; x < n_host_runs; x++){
+        call(in, out, tmp, lens, n_iterations);
+    }
+    gettimeofday(&t_endpar, NULL);
+    TRAFFIC_END(n_host_runs*n_iterations*len);
+    timeval_subtract(&t_diffpar, &t_endpar, &t_startpar);
+    const unsigned long elapsed = (t_diffpar.tv_sec*1e6+t_diffpar.tv_usec) / n_host_runs;
+    printf(" : mean %lu microseconds (%lu per iteration)\n", elapsed, elapsed / n_iterations);
+    TRAFFIC_REPORT();
+    if (!validate(cpu_out, out, len)){
+        printf("%s\n", "   FAILED TO VALIDATE");
+    }
+    host_arena().release(out);
+    host_arena().release(tmp);
+}
+
+template<
+    const int amin_x, const int amax_x>
+__host__
+void doTest_iterative_1D()
+{
+    cout << "const int ixs[" << (amax_x - amin_x + 1) << "]: "
+         << "x= " << amin_x << "..." << amax_x
+         << " - " << n_iterations << " iterations" << endl;
+
+    T* cpu_in = host_arena().acquire(lens_1d);
+    T* cpu_out = host_arena().acquire(lens_1d);
+    T* cpu_tmp = host_arena().acquire(lens_1d);
+    srand(1);
+    for (long i = 0; i < lens_1d; ++i)
+    {
+        cpu_in[i] = (T)rand();
+    }
+    stencil_1d_cpu_iterate
+        <amin_x,amax_x,CPU_TILE_1D>
+        (cpu_in, cpu_out, cpu_tmp, lens_1d, n_iterations);
+
+    {
+        cout << "## Benchmark 1d cpu - iterative ping-pong: ";
+        printf("tile=[%d]f32 - %s - %d threads ##", CPU_TILE_1D, host_isa_name(host_isa()), host_pool().size());
+        Kernel1dHostIter kfun = stencil_1d_cpu_iterate
+            <amin_x,amax_x,CPU_TILE_1D>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_1d, lens_1d);
+    }
+    {
+        cout << "## Benchmark 1d cpu - cache-oblivious zoids: ";
+        printf("base=%d - %s - %d threads ##", CPU_ZOID_BASE, host_isa_name(host_isa()), host_pool().size());
+        Kernel1dHostIter kfun = stencil_1d_cpu_zoid
+            <amin_x,amax_x>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_1d, lens_1d);
+    }
+
+    host_arena().release(cpu_in);
+    host_arena().release(cpu_out);
+    host_arena().release(cpu_tmp);
+}
+
+template<
+    const int amin_y, const int amax_y,
+    const int amin_x, const int amax_x,
+    const int tile_x, const int tile_y>
+__host__
+void doTest_iterative_2D()
+{
+    cout << "const int ixs[" << (amax_y - amin_y + 1)*(amax_x - amin_x + 1) << "]: "
+         << "y= " << amin_y << "..." << amax_y << ", x= " << amin_x << "..." << amax_x
+         << " - " << n_iterations << " iterations" << endl;
+
+    T* cpu_in = host_arena().acquire(lens_2d_flat);
+    T* cpu_out = host_arena().acquire(lens_2d_flat);
+    T* cpu_tmp = host_arena().acquire(lens_2d_flat);
+    srand(1);
+    for (long i = 0; i < lens_2d_flat; ++i)
+    {
+        cpu_in[i] = (T)rand();
+    }
+    stencil_2d_cpu_iterate
+        <amin_x,amin_y
+        ,amax_x,amax_y
+        ,CPU_TILE_X,CPU_TILE_Y>
+        (cpu_in, cpu_out, cpu_tmp, lens_2d, n_iterations);
+
+    {
+        cout << "## Benchmark 2d cpu - iterative ping-pong: ";
+        printf("tile=[%d][%d]f32 - %s - %d threads ##", CPU_TILE_Y, CPU_TILE_X, host_isa_name(host_isa()), host_pool().size());
+        Kernel2dHostIter kfun = stencil_2d_cpu_iterate
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,CPU_TILE_X,CPU_TILE_Y>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_2d, lens_2d_flat);
+    }
+    {
+        cout << "## Benchmark 2d cpu - time tiled: ";
+        printf("tile=[%d][%d]f32 - depth=2 - %s - %d threads ##", tile_y, tile_x, host_isa_name(host_isa()), host_pool().size());
+        Kernel2dHostIter kfun = stencil_2d_cpu_timetiled
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,tile_x,tile_y,2>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_2d, lens_2d_flat);
+    }
+    {
+        cout << "## Benchmark 2d cpu - time tiled: ";
+        printf("tile=[%d][%d]f32 - depth=4 - %s - %d threads ##", tile_y, tile_x, host_isa_name(host_isa()), host_pool().size());
+        Kernel2dHostIter kfun = stencil_2d_cpu_timetiled
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,tile_x,tile_y,4>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_2d, lens_2d_flat);
+    }
+    {
+        cout << "## Benchmark 2d cpu - time tiled: ";
+        printf("tile=[%d][%d]f32 - depth=8 - %s - %d threads ##", tile_y, tile_x, host_isa_name(host_isa()), host_pool().size());
+        Kernel2dHostIter kfun = stencil_2d_cpu_timetiled
+            <amin_x,amin_y
+            ,amax_x,amax_y
+            ,tile_x,tile_y,8>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_2d, lens_2d_flat);
+    }
+    {
+        cout << "## Benchmark 2d cpu - cache-oblivious zoids: ";
+        printf("base=%d - %s - %d threads ##", CPU_ZOID_BASE, host_isa_name(host_isa()), host_pool().size());
+        Kernel2dHostIter kfun = stencil_2d_cpu_zoid
+            <amin_x,amin_y
+            ,amax_x,amax_y>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_2d, lens_2d_flat);
+    }
+
+    host_arena().release(cpu_in);
+    host_arena().release(cpu_out);
+    host_arena().release(cpu_tmp);
+}
+
+template<
+    const int amin_z, const int amax_z,
+    const int amin_y, const int amax_y,
+    const int amin_x, const int amax_x,
+    const int tile_x, const int tile_y, const int tile_z>
+__host__
+void doTest_iterative_3D()
+{
+    cout << "const int ixs[" << (amax_z - amin_z + 1)*(amax_y - amin_y + 1)*(amax_x - amin_x + 1) << "]: "
+         << "z= " << amin_z << "..." << amax_z << ", y= " << amin_y << "..." << amax_y
+         << ", x= " << amin_x << "..." << amax_x
+         << " - " << n_iterations << " iterations" << endl;
+
+    T* cpu_in = host_arena().acquire(lens_3d_flat);
+    T* cpu_out = host_arena().acquire(lens_3d_flat);
+    T* cpu_tmp = host_arena().acquire(lens_3d_flat);
+    srand(1);
+    for (long i = 0; i < lens_3d_flat; ++i)
+    {
+        cpu_in[i] = (T)rand();
+    }
+    stencil_3d_cpu_iterate
+        <amin_x,amin_y,amin_z
+        ,amax_x,amax_y,amax_z
+        ,CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z>
+        (cpu_in, cpu_out, cpu_tmp, lens_3d, n_iterations);
+
+    {
+        cout << "## Benchmark 3d cpu - iterative ping-pong: ";
+        printf("tile=[%d][%d][%d]f32 - %s - %d threads ##", CPU_TILE_Z, CPU_TILE_Y, CPU_TILE_X, host_isa_name(host_isa()), host_pool().size());
+        Kernel3dHostIter kfun = stencil_3d_cpu_iterate
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_3d, lens_3d_flat);
+    }
+    {
+        cout << "## Benchmark 3d cpu - time tiled: ";
+        printf("tile=[%d][%d][%d]f32 - depth=2 - %s - %d threads ##", tile_z, tile_y, tile_x, host_isa_name(host_isa()), host_pool().size());
+        Kernel3dHostIter kfun = stencil_3d_cpu_timetiled
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,tile_x,tile_y,tile_z,2>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_3d, lens_3d_flat);
+    }
+    {
+        cout << "## Benchmark 3d cpu - time tiled: ";
+        printf("tile=[%d][%d][%d]f32 - depth=4 - %s - %d threads ##", tile_z, tile_y, tile_x, host_isa_name(host_isa()), host_pool().size());
+        Kernel3dHostIter kfun = stencil_3d_cpu_timetiled
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,tile_x,tile_y,tile_z,4>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_3d, lens_3d_flat);
+    }
+    {
+        cout << "## Benchmark 3d cpu - cache-oblivious zoids: ";
+        printf("base=%d - %s - %d threads ##", CPU_ZOID_BASE, host_isa_name(host_isa()), host_pool().size());
+        Kernel3dHostIter kfun = stencil_3d_cpu_zoid
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z>;
+        do_run_iterative(kfun, cpu_in, cpu_out, lens_3d, lens_3d_flat);
+    }
+
+    host_arena().release(cpu_in);
+    host_arena().release(cpu_out);
+    host_arena().release(cpu_tmp);
+}
+
+int main()
+{
+    cout << "{ 1d: x_len = " << lens_1d << " }" << endl;
+    cout << "{ 2d: x_len = " << lens_2d.x << ", y_len = " << lens_2d.y << " }" << endl;
+    cout << "{ 3d: x_len = " << lens_3d.x << ", y_len = " << lens_3d.y
+         << ", z_len = " << lens_3d.z << " }" << endl;
+#ifdef Jacobi3D
+    cout << "running Jacobi 3D" << endl;
+#endif
+
+    doTest_iterative_1D<-1,1>();
+    doTest_iterative_1D<-4,4>();
+
+    doTest_iterative_2D<-1,1,-1,1, 256,64>();
+    doTest_iterative_2D<-2,2,-2,2, 256,64>();
+
+    // the seven point stencil of sevenpointstencil.cu is -1..1 under Jacobi3D.
+    doTest_iterative_3D<-1,1,-1,1,-1,1, 64,16,16>();
+    doTest_iterative_3D<-1,1, 0,0, 0,0, 64,16,16>();
+    doTest_iterative_3D<-2,2,-2,2,-2,2, 64,16,16>();
+
+    return 0;
+}
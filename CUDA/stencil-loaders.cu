@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "kernels-3d.h"
+#include "cpu-kernels-3d.h"
+
+/*******************************************************************************
+ * The 3d big tile kernels side by side, one per tile loader: cube,
+ * cube_reshape, flat div/rem, flat add/carry, forced coalesced and
+ * transaction aligned. They differ only in how a block's lanes walk the tile,
+ * so built as trafficproject-loaders (host-emu/traffic.h) the coalescing
+ * line under each benchmark ranks the loaders by the sectors and lines their
+ * warp loads touch, without a gpu.
+ */
+static constexpr long3 lens = {
+    ((1 << 7) + 2),
+    ((1 << 7) + 4),
+    ((1 << 7) + 8)};
+static constexpr long lens_flat = lens.x * lens.y * lens.z;
+static constexpr long n_runs = 10;
+static constexpr long n_host_runs = 1;
+static Globs
+    <long3,int3
+    ,Kernel3dVirtual
+    ,Kernel3dPhysMultiDim
+    ,Kernel3dPhysSingleDim
+    ,Kernel3dHost
+    > G(lens, lens_flat, n_runs, n_host_runs);
+
+template<
+    const int amin_z, const int amax_z,
+    const int amin_y, const int amax_y,
+    const int amin_x, const int amax_x,
+    const int group_size_x,  const int group_size_y, const int group_size_z>
+__host__
+void doTest_loaders()
+{
+    cout << "(zr,yr,xr) = (" << amin_z << "..." << amax_z << ", " << amin_y << "..." << amax_y << ", " << amin_x << "..." << amax_x << ")";
+    cout << " - Blockdim z,y,x = " << group_size_z << ", " << group_size_y << ", " << group_size_x << endl;
+
+    T* cpu_out = host_arena().acquire(lens_flat);
+    stencil_3d_cpu_tiled
+        <amin_x,amin_y,amin_z
+        ,amax_x,amax_y,amax_z
+        ,CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z>
+        (G.arr_in, cpu_out, lens);
+
+    constexpr int blockDim_flat = group_size_x * group_size_y * group_size_z;
+    constexpr int3 virtual_grid = {
+        divUp((int)lens.x, group_size_x),
+        divUp((int)lens.y, group_size_y),
+        divUp((int)lens.z, group_size_z)};
+    constexpr dim3 block_3d(group_size_x,group_size_y,group_size_z);
+    constexpr dim3 grid_3d(virtual_grid.x, virtual_grid.y, virtual_grid.z);
+    constexpr int virtual_grid_flat = virtual_grid.x * virtual_grid.y * virtual_grid.z;
+
+    constexpr int sh_size_x = group_size_x + amax_x - amin_x;
+    constexpr int sh_size_y = group_size_y + amax_y - amin_y;
+    constexpr int sh_size_z = group_size_z + amax_z - amin_z;
+    constexpr int sh_mem_size_flat = sh_size_x * sh_size_y * sh_size_z * sizeof(T);
+
+    {
+        cout << "## Benchmark 3d loader - cube ##";
+        Kernel3dPhysMultiDim kfun = big_tile_3d_inlined
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,group_size_x,group_size_y,group_size_z>;
+        G.do_run_multiDim(kfun, cpu_out, grid_3d, block_3d, sh_mem_size_flat);
+    }
+    {
+        cout << "## Benchmark 3d loader - cube reshape (div/rem) ##";
+        Kernel3dPhysMultiDim kfun = big_tile_3d_inlined_cube_reshape
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,group_size_x,group_size_y,group_size_z>;
+        G.do_run_multiDim(kfun, cpu_out, grid_3d, block_3d, sh_mem_size_flat);
+    }
+    {
+        cout << "## Benchmark 3d loader - flat (div/rem) ##";
+        Kernel3dPhysMultiDim kfun = big_tile_3d_inlined_flat
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,group_size_x,group_size_y,group_size_z>;
+        G.do_run_multiDim(kfun, cpu_out, grid_3d, block_3d, sh_mem_size_flat);
+    }
+    {
+        cout << "## Benchmark 3d loader - flat (add/carry) ##";
+        Kernel3dPhysSingleDim kfun = big_tile_3d_inlined_flat_addcarry_singleDim
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,group_size_x,group_size_y,group_size_z>;
+        G.do_run_singleDim(kfun, cpu_out, virtual_grid_flat, blockDim_flat, virtual_grid, sh_mem_size_flat);
+    }
+    {
+        cout << "## Benchmark 3d loader - forced coalesced flat (div/rem) ##";
+        Kernel3dPhysMultiDim kfun = big_tile_3d_inlined_flat_forced_coalesced
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,group_size_x,group_size_y,group_size_z>;
+        G.do_run_multiDim(kfun, cpu_out, grid_3d, block_3d, sh_mem_size_flat);
+    }
+    {
+        cout << "## Benchmark 3d loader - transaction aligned ##";
+        Kernel3dPhysMultiDim kfun = big_tile_3d_inlined_trx_align
+            <amin_x,amin_y,amin_z
+            ,amax_x,amax_y,amax_z
+            ,group_size_x,group_size_y,group_size_z>;
+        G.do_run_multiDim(kfun, cpu_out, grid_3d, block_3d, sh_mem_size_flat);
+    }
+
+    host_arena().release(cpu_out);
+}
+
+__host__
+int main()
+{
+#ifdef Jacobi3D
+    cout << "running Jacobi 3D" << endl;
+#else
+    cout << "running Dense stencil with mean" << endl;
+#endif
+    doTest_loaders<-1,1,0,0,0,0, 32,4,2>();
+    doTest_loaders<-1,1,-1,1,-1,1, 32,4,2>();
+    doTest_loaders<-1,1,-1,1,-1,1, 32,8,4>();
+    doTest_loaders<-2,2,-2,2,-2,2, 32,4,2>();
+    doTest_loaders<-1,1,-1,1,-3,3, 32,4,2>();
+    return 0;
+}
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "offsets.h"
+#include "kernels-2d.h"
+#include "kernels-3d.h"
+#include "cpu-kernels-2d.h"
+#include "cpu-kernels-3d.h"
+
+/*******************************************************************************
+ * Sparse stencils given as offset lists (offsets.h), through global reads and
+ * through the big tile with the tight halo, both validated against the host
+ * reference of the list. The big tile kernel of the bounding box runs next to
+ * them for the cost of treating the list as a dense box; it computes the box
+ * stencil, validated against its own reference. Built as
+ * trafficproject-offsets the loads per output show what the list saves.
+ */
+static constexpr long lens_1d = (1 << 22) + 2;
+static constexpr long2 lens_2d = {
+   (1 << 11)+2,
+   (1 << 11)+4};
+static constexpr long lens_2d_flat = lens_2d.x * lens_2d.y;
+static constexpr long3 lens_3d = {
+    ((1 << 8) + 2),
+    ((1 << 8) + 4),
+    ((1 << 8) + 8)};
+static constexpr long lens_3d_flat = lens_3d.x * lens_3d.y * lens_3d.z;
+static constexpr long n_runs = 100;
+static constexpr long n_host_runs = 1;
+
+static Globs
+    <long,long
+    ,Kernel1dVirtual
+    ,Kernel1dPhysMultiDim
+    ,Kernel1dPhysStripDim
+    ,Kernel1dHost
+    > G1(lens_1d, lens_1d, n_runs, n_host_runs);
+static Globs
+    <long2,int2
+    ,Kernel2dVirtual
+    ,Kernel2dPhysMultiDim
+    ,Kernel2dPhysSingleDim
+    ,Kernel2dHost
+    > G2(lens_2d, lens_2d_flat, n_runs, n_host_runs);
+static Globs
+    <long3,int3
+    ,Kernel3dVirtual
+    ,Kernel3dPhysMultiDim
+    ,Kernel3dPhysSingleDim
+    ,Kernel3dHost
+    > G3(lens_3d, lens_3d_flat, n_runs, n_host_runs);
+
+typedef Offsets<O<-3>, O<0>, O<1>, O<5>> sparse_1d;
+
+typedef Offsets<O<0,-1>, O<-1,0>, O<0,0>, O<1,0>, O<0,1>> star_2d_r1;
+typedef Offsets<
+    O<0,-2>, O<0,-1>,
+    O<-2,0>, O<-1,0>, O<0,0>, O<1,0>, O<2,0>,
+    O<0,1>, O<0,2>> star_2d_r2;
+typedef Offsets<
+    O<-2,-2>, O<2,-2>, O<-1,-1>, O<1,-1>,
+    O<0,0>,
+    O<-1,1>, O<1,1>, O<-2,2>, O<2,2>> diagonals_2d_r2;
+typedef Offsets<O<-2,0>, O<-1,0>, O<0,0>, O<0,-1>, O<0,-2>> upwind_2d;
+
+typedef Offsets<
+    O<0,0,-1>, O<0,-1,0>, O<-1,0,0>, O<0,0,0>, O<1,0,0>, O<0,1,0>, O<0,0,1>> star_3d_r1;
+typedef Offsets<
+    O<0,0,-2>, O<0,0,-1>,
+    O<0,-2,0>, O<0,-1,0>,
+    O<-2,0,0>, O<-1,0,0>, O<0,0,0>, O<1,0,0>, O<2,0,0>,
+    O<0,1,0>, O<0,2,0>,
+    O<0,0,1>, O<0,0,2>> star_3d_r2;
+typedef Offsets<
+    O<0,0,-4>, O<0,0,-3>, O<0,0,-2>, O<0,0,-1>,
+    O<0,-4,0>, O<0,-3,0>, O<0,-2,0>, O<0,-1,0>,
+    O<-4,0,0>, O<-3,0,0>, O<-2,0,0>, O<-1,0,0>, O<0,0,0>, O<1,0,0>, O<2,0,0>, O<3,0,0>, O<4,0,0>,
+    O<0,1,0>, O<0,2,0>, O<0,3,0>, O<0,4,0>,
+    O<0,0,1>, O<0,0,2>, O<0,0,3>, O<0,0,4>> star_3d_r4;
+
+// the halo is printed outermost axis first, as shapes are.
+template<typename Offs>
+__host__
+void print_offsets(const int rank, const char* name, const char* kernel)
+{
+    printf("## Benchmark %dd offsets %s (%d points, halo ", rank, name, Offs::size);
+    if(rank > 2){ printf("%d..%d,", Offs::min_z, Offs::max_z); }
+    if(rank > 1){ printf("%d..%d,", Offs::min_y, Offs::max_y); }
+    printf("%d..%d) - %s ##", Offs::min_x, Offs::max_x, kernel);
+}
+
+template<typename Offs, const int group_size>
+__host__
+void doTest_offsets_1d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_1d);
+    stencil_1d_cpu_offsets<Offs>(G1.arr_in, cpu_out, lens_1d);
+
+    const int grid = divUp(lens_1d, long(group_size));
+    {
+        print_offsets<Offs>(1, name, "global reads");
+        Kernel1dPhysMultiDim kfun = global_reads_1d_offsets<Offs,group_size>;
+        G1.do_run_multiDim(kfun, cpu_out, grid, group_size, 0);
+    }
+    {
+        print_offsets<Offs>(1, name, "big tile");
+        Kernel1dPhysMultiDim kfun = big_tile_1d_offsets<Offs,group_size>;
+        G1.do_run_multiDim(kfun, cpu_out, grid, group_size, 0);
+    }
+    host_arena().release(cpu_out);
+}
+
+template<typename Offs, const int group_size_x, const int group_size_y>
+__host__
+void doTest_offsets_2d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_2d_flat);
+    stencil_2d_cpu_offsets<Offs>(G2.arr_in, cpu_out, lens_2d);
+
+    const dim3 block(group_size_x, group_size_y);
+    const dim3 grid(
+        divUp(lens_2d.x, long(group_size_x)),
+        divUp(lens_2d.y, long(group_size_y)));
+    {
+        print_offsets<Offs>(2, name, "global reads");
+        Kernel2dPhysMultiDim kfun = global_reads_2d_offsets<Offs,group_size_x,group_size_y>;
+        G2.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_offsets<Offs>(2, name, "big tile");
+        Kernel2dPhysMultiDim kfun = big_tile_2d_offsets<Offs,group_size_x,group_size_y>;
+        G2.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+
+    stencil_2d_cpu_simd
+        <Offs::min_x,Offs::min_y
+        ,Offs::max_x,Offs::max_y
+        ,CPU_TILE_X,CPU_TILE_Y>
+        (G2.arr_in, cpu_out, lens_2d);
+    {
+        const int2 grid_single = { int(grid.x), int(grid.y) };
+        print_offsets<Offs>(2, name, "bounding box big tile");
+        Kernel2dPhysSingleDim kfun = big_tile_2d_inlined_cube_singleDim
+            <Offs::min_x,Offs::min_y
+            ,Offs::max_x,Offs::max_y
+            ,group_size_x,group_size_y>;
+        G2.do_run_singleDim(kfun, cpu_out, grid.x * grid.y, group_size_x * group_size_y, grid_single, 0);
+    }
+    host_arena().release(cpu_out);
+}
+
+template<typename Offs, const int group_size_x, const int group_size_y, const int group_size_z>
+__host__
+void doTest_offsets_3d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_3d_flat);
+    stencil_3d_cpu_offsets<Offs>(G3.arr_in, cpu_out, lens_3d);
+
+    const dim3 block(group_size_x, group_size_y, group_size_z);
+    const dim3 grid(
+        divUp(lens_3d.x, long(group_size_x)),
+        divUp(lens_3d.y, long(group_size_y)),
+        divUp(lens_3d.z, long(group_size_z)));
+    {
+        print_offsets<Offs>(3, name, "global reads");
+        Kernel3dPhysMultiDim kfun = global_reads_3d_offsets<Offs,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_offsets<Offs>(3, name, "big tile");
+        Kernel3dPhysMultiDim kfun = big_tile_3d_offsets<Offs,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+
+    stencil_3d_cpu_simd
+        <Offs::min_x,Offs::min_y,Offs::min_z
+        ,Offs::max_x,Offs::max_y,Offs::max_z
+        ,CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z>
+        (G3.arr_in, cpu_out, lens_3d);
+    {
+        constexpr int sh_size_bytes = sizeof(T)
+            * (group_size_x + Offs::max_x - Offs::min_x)
+            * (group_size_y + Offs::max_y - Offs::min_y)
+            * (group_size_z + Offs::max_z - Offs::min_z);
+        print_offsets<Offs>(3, name, "bounding box big tile");
+        Kernel3dPhysMultiDim kfun = big_tile_3d_inlined
+            <Offs::min_x,Offs::min_y,Offs::min_z
+            ,Offs::max_x,Offs::max_y,Offs::max_z
+            ,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, sh_size_bytes);
+    }
+    host_arena().release(cpu_out);
+}
+
+__host__
+int main()
+{
+#if defined(Jacobi2D) || defined(Jacobi3D)
+    cout << "running Jacobi, for the bounding boxes" << endl;
+#else
+    cout << "running Dense stencil with mean, for the bounding boxes" << endl;
+#endif
+    doTest_offsets_1d<sparse_1d, 256>("sparse");
+
+    doTest_offsets_2d<star_2d_r1, 32,8>("star");
+    doTest_offsets_2d<star_2d_r2, 32,8>("star");
+    doTest_offsets_2d<diagonals_2d_r2, 32,8>("diagonals");
+    doTest_offsets_2d<upwind_2d, 32,8>("upwind");
+
+    doTest_offsets_3d<star_3d_r1, 32,4,2>("star");
+    doTest_offsets_3d<star_3d_r2, 32,4,2>("star");
+    doTest_offsets_3d<star_3d_r4, 32,4,2>("star");
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "patterns.h"
+
+/*******************************************************************************
+ * The box, star and diagonal families (patterns.h) in one build, whatever
+ * Jacobi2D/Jacobi3D say. Every pattern runs through global reads, the tile
+ * of its offset list, and the pattern tile, which for the stars leaves out
+ * the corners of the bounding box; all are validated against the host
+ * reference of the offset list. Built as trafficproject-patterns the loads
+ * per output go with the tile sizes printed here.
+ */
+static constexpr long2 lens_2d = {
+   (1 << 11)+2,
+   (1 << 11)+4};
+static constexpr long lens_2d_flat = lens_2d.x * lens_2d.y;
+static constexpr long3 lens_3d = {
+    ((1 << 8) + 2),
+    ((1 << 8) + 4),
+    ((1 << 8) + 8)};
+static constexpr long lens_3d_flat = lens_3d.x * lens_3d.y * lens_3d.z;
+static constexpr long n_runs = 100;
+static constexpr long n_host_runs = 1;
+
+static Globs
+    <long2,int2
+    ,Kernel2dVirtual
+    ,Kernel2dPhysMultiDim
+    ,Kernel2dPhysSingleDim
+    ,Kernel2dHost
+    > G2(lens_2d, lens_2d_flat, n_runs, n_host_runs);
+static Globs
+    <long3,int3
+    ,Kernel3dVirtual
+    ,Kernel3dPhysMultiDim
+    ,Kernel3dPhysSingleDim
+    ,Kernel3dHost
+    > G3(lens_3d, lens_3d_flat, n_runs, n_host_runs);
+
+template<typename Pattern>
+__host__
+void print_pattern(const int rank, const char* name, const char* kernel, const int tile_size)
+{
+    typedef typename pattern_offsets<Pattern>::type Offs;
+    printf("## Benchmark %dd pattern %s r=", rank, name);
+    if(rank > 2){ printf("%d,", Pattern::radius_z); }
+    printf("%d,%d (%d points) - %s", Pattern::radius_y, Pattern::radius_x, Offs::size, kernel);
+    if(tile_size > 0){ printf(", tile %d elements", tile_size); }
+    printf(" ##");
+}
+
+template<typename Pattern, const int group_size_x, const int group_size_y>
+__host__
+void doTest_pattern_2d(const char* name)
+{
+    typedef typename pattern_offsets<Pattern>::type Offs;
+    T* cpu_out = host_arena().acquire(lens_2d_flat);
+    stencil_2d_cpu_offsets<Offs>(G2.arr_in, cpu_out, lens_2d);
+
+    const dim3 block(group_size_x, group_size_y);
+    const dim3 grid(
+        divUp(lens_2d.x, long(group_size_x)),
+        divUp(lens_2d.y, long(group_size_y)));
+    {
+        print_pattern<Pattern>(2, name, "global reads", 0);
+        Kernel2dPhysMultiDim kfun = global_reads_2d_offsets<Offs,group_size_x,group_size_y>;
+        G2.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_pattern<Pattern>(2, name, "offset list tile", OffsetsTile<Offs,group_size_x,group_size_y,1>::size);
+        Kernel2dPhysMultiDim kfun = big_tile_2d_offsets<Offs,group_size_x,group_size_y>;
+        G2.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_pattern<Pattern>(2, name, "pattern tile", PatternTile<Pattern,group_size_x,group_size_y,1>::size);
+        Kernel2dPhysMultiDim kfun = big_tile_2d_pattern<Pattern,group_size_x,group_size_y>;
+        G2.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    host_arena().release(cpu_out);
+}
+
+template<typename Pattern, const int group_size_x, const int group_size_y, const int group_size_z>
+__host__
+void doTest_pattern_3d(const char* name)
+{
+    typedef typename pattern_offsets<Pattern>::type Offs;
+    T* cpu_out = host_arena().acquire(lens_3d_flat);
+    stencil_3d_cpu_offsets<Offs>(G3.arr_in, cpu_out, lens_3d);
+
+    const dim3 block(group_size_x, group_size_y, group_size_z);
+    const dim3 grid(
+        divUp(lens_3d.x, long(group_size_x)),
+        divUp(lens_3d.y, long(group_size_y)),
+        divUp(lens_3d.z, long(group_size_z)));
+    {
+        print_pattern<Pattern>(3, name, "global reads", 0);
+        Kernel3dPhysMultiDim kfun = global_reads_3d_offsets<Offs,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_pattern<Pattern>(3, name, "offset list tile", OffsetsTile<Offs,group_size_x,group_size_y,group_size_z>::size);
+        Kernel3dPhysMultiDim kfun = big_tile_3d_offsets<Offs,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_pattern<Pattern>(3, name, "pattern tile", PatternTile<Pattern,group_size_x,group_size_y,group_size_z>::size);
+        Kernel3dPhysMultiDim kfun = big_tile_3d_pattern<Pattern,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    host_arena().release(cpu_out);
+}
+
+__host__
+int main()
+{
+    doTest_pattern_2d<Box<1,1>, 32,8>("box");
+    doTest_pattern_2d<Star<1,1>, 32,8>("star");
+    doTest_pattern_2d<Star<4,4>, 32,8>("star");
+    doTest_pattern_2d<Diagonal<2,2>, 32,8>("diagonal");
+
+    doTest_pattern_3d<Box<1,1,1>, 32,4,2>("box");
+    doTest_pattern_3d<Star<1,1,1>, 32,4,2>("star");
+    doTest_pattern_3d<Star<2,2,2>, 32,4,2>("star");
+    doTest_pattern_3d<Star<4,4,4>, 32,4,2>("star");
+    doTest_pattern_3d<Diagonal<1,1,1>, 32,4,2>("diagonal");
+    return 0;
+}
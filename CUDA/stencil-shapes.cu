@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "shapes.h"
+#include "jit.h"
+
+/*******************************************************************************
+ * Stencil shapes given at run time, one per line of the file named by the
+ * first argument ('#' starts a comment), or a built-in list without one:
+ *     ./runproject-shapes shapes.txt
+ * Every shape runs through stencil_1d/2d/3d, which takes the precompiled
+ * kernel when the shape is in the registry of shapes.h, and through the
+ * runtime radius kernels, both validated against a host reference.
+ * On the host the reference itself is timed next to the strategy named by the
+ * second argument (simd by default, see jit.h), compiled for the shape:
+ *     ./runproject-shapes shapes.txt zmarch
+ * The shapes run once per element type, f32, f64, i8 and f16.
+ */
+static constexpr long lens_1d = (1 << 22) + 2;
+static constexpr long2 lens_2d = {
+   (1 << 11)+2,
+   (1 << 11)+4};
+static constexpr long lens_2d_flat = lens_2d.x * lens_2d.y;
+static constexpr long3 lens_3d = {
+    ((1 << 7) + 2),
+    ((1 << 7) + 4),
+    ((1 << 7) + 8)};
+static constexpr long lens_3d_flat = lens_3d.x * lens_3d.y * lens_3d.z;
+static constexpr long n_runs = 100;
+static constexpr long n_host_runs = 1;
+
+template<typename T> using Globs1d = Globs
+    <long,long
+    ,Kernel1dVirtualOf<T>
+    ,Kernel1dPhysMultiDimOf<T>
+    ,Kernel1dPhysStripDimOf<T>
+    ,Kernel1dHostOf<T>
+    ,T>;
+template<typename T> using Globs2d = Globs
+    <long2,int2
+    ,Kernel2dVirtualOf<T>
+    ,Kernel2dPhysMultiDimOf<T>
+    ,Kernel2dPhysSingleDimOf<T>
+    ,Kernel2dHostOf<T>
+    ,T>;
+template<typename T> using Globs3d = Globs
+    <long3,int3
+    ,Kernel3dVirtualOf<T>
+    ,Kernel3dPhysMultiDimOf<T>
+    ,Kernel3dPhysSingleDimOf<T>
+    ,Kernel3dHostOf<T>
+    ,T>;
+
+static const char* default_shapes[] = {
+    "-1..1",
+    "-6..6",
+    "-1..1,-1..1",
+    "-1..3,-2..0",
+    "-1..1,-1..1,-1..1",
+    "0..2,-1..1,-1..1",
+    "-4..4,-4..4,-4..4",
+};
+
+static const char* jit_strategy = "simd";
+
+template<typename G, typename Run, typename RunRuntime, typename T>
+__host__
+void run_both(G& globs, const T* cpu_out, const StencilShape& shape, const bool precompiled, Run run, RunRuntime run_runtime)
+{
+    printf("## Benchmark %dd shape ", shape.rank);
+    print_stencil_shape(shape);
+    printf(" %s - %s ##", ElemTraits<T>::name(), precompiled ? "precompiled" : "runtime radius");
+    globs.do_run_launch(run, cpu_out);
+    if(precompiled){
+        printf("## Benchmark %dd shape ", shape.rank);
+        print_stencil_shape(shape);
+        printf(" %s - runtime radius ##", ElemTraits<T>::name());
+        globs.do_run_launch(run_runtime, cpu_out);
+    }
+}
+
+template<typename G, typename Engine, typename RunReference, typename T>
+__host__
+void run_host(G& globs, const T* cpu_out, const StencilShape& shape, Engine engine, const JitInfo& info, RunReference run_reference)
+{
+    printf("## Benchmark %dd shape ", shape.rank);
+    print_stencil_shape(shape);
+    printf(" %s - host runtime radius - %d threads ##", ElemTraits<T>::name(), host_pool().size());
+    globs.do_run_host(run_reference, cpu_out);
+    if(engine == nullptr){ return; }
+
+    const JitStrategy* s = find_jit_strategy(jit_strategy, shape.rank);
+    const int3 range = shape_range(shape.amin, shape.amax);
+    const double rel_tol = s->reassociates ? reassociation_tolerance<T>(range.x * range.y * range.z) : 0;
+    printf("## Benchmark %dd shape ", shape.rank);
+    print_stencil_shape(shape);
+    printf(" %s - host %s (jit, %s in %ld ms) - %s ##", ElemTraits<T>::name(), jit_strategy, info.compiled ? "compiled" : "cached"
+        , info.micros / 1000, host_isa_name(host_isa_for<T>()));
+    globs.do_run_host(engine, cpu_out, true, rel_tol);
+}
+
+template<typename T>
+__host__
+void doTest_shape(Globs1d<T>& G1, Globs2d<T>& G2, Globs3d<T>& G3, const StencilShape& shape)
+{
+    if(shape.rank == 1){
+        T* cpu_out = host_arena().acquire<T>(lens_1d);
+        stencil_1d_cpu_runtime(G1.arr_in, cpu_out, lens_1d, shape);
+        run_both(G1, cpu_out, shape, find_shape_1d<T>(shape) != nullptr
+            , [&](const T* A, T* out, const long nx){ stencil_1d(A, out, nx, shape); }
+            , [&](const T* A, T* out, const long nx){ stencil_1d_runtime(A, out, nx, shape); });
+        JitInfo info;
+        Kernel1dHostOf<T> engine = jit_host_1d<T>(jit_strategy, shape, &info);
+        run_host(G1, cpu_out, shape, engine, info
+            , [&](const T* A, T* out, const long nx){ stencil_1d_cpu_runtime(A, out, nx, shape); });
+        host_arena().release(cpu_out);
+    }
+    else if(shape.rank == 2){
+        T* cpu_out = host_arena().acquire<T>(lens_2d_flat);
+        stencil_2d_cpu_runtime(G2.arr_in, cpu_out, lens_2d, shape);
+        run_both(G2, cpu_out, shape, find_shape_2d<T>(shape) != nullptr
+            , [&](const T* A, T* out, const long2 lens){ stencil_2d(A, out, lens, shape); }
+            , [&](const T* A, T* out, const long2 lens){ stencil_2d_runtime(A, out, lens, shape); });
+        JitInfo info;
+        Kernel2dHostOf<T> engine = jit_host_2d<T>(jit_strategy, shape, &info);
+        run_host(G2, cpu_out, shape, engine, info
+            , [&](const T* A, T* out, const long2 lens){ stencil_2d_cpu_runtime(A, out, lens, shape); });
+        host_arena().release(cpu_out);
+    }
+    else {
+        T* cpu_out = host_arena().acquire<T>(lens_3d_flat);
+        stencil_3d_cpu_runtime(G3.arr_in, cpu_out, lens_3d, shape);
+        run_both(G3, cpu_out, shape, find_shape_3d<T>(shape) != nullptr
+            , [&](const T* A, T* out, const long3 lens){ stencil_3d(A, out, lens, shape); }
+            , [&](const T* A, T* out, const long3 lens){ stencil_3d_runtime(A, out, lens, shape); });
+        JitInfo info;
+        Kernel3dHostOf<T> engine = jit_host_3d<T>(jit_strategy, shape, &info);
+        run_host(G3, cpu_out, shape, engine, info
+            , [&](const T* A, T* out, const long3 lens){ stencil_3d_cpu_runtime(A, out, lens, shape); });
+        host_arena().release(cpu_out);
+    }
+}
+
+// every shape on grids of one element type.
+template<typename T>
+__host__
+void doTests_shapes(const std::vector<StencilShape>& shapes)
+{
+    Globs1d<T> G1(lens_1d, lens_1d, n_runs, n_host_runs);
+    Globs2d<T> G2(lens_2d, lens_2d_flat, n_runs, n_host_runs);
+    Globs3d<T> G3(lens_3d, lens_3d_flat, n_runs, n_host_runs);
+    cout << "element type " << ElemTraits<T>::name() << endl;
+    for(const StencilShape& shape : shapes){ doTest_shape(G1, G2, G3, shape); }
+}
+
+__host__
+void doTests_shapes(const std::vector<StencilShape>& shapes)
+{
+    doTests_shapes<float>(shapes);
+    doTests_shapes<double>(shapes);
+    doTests_shapes<int8_t>(shapes);
+    doTests_shapes<half_t>(shapes);
+}
+
+__host__
+int main(int argc, char** argv)
+{
+#if defined(Jacobi2D) || defined(Jacobi3D)
+    cout << "running Jacobi" << endl;
+#else
+    cout << "running Dense stencil with mean" << endl;
+#endif
+    if(argc > 2){ jit_strategy = argv[2]; }
+    StencilShape shape;
+    std::vector<StencilShape> shapes;
+    if(argc < 2){
+        for(const char* text : default_shapes){
+            if(parse_stencil_shape(text, shape)){ shapes.push_back(shape); }
+        }
+        doTests_shapes(shapes);
+        return 0;
+    }
+
+    FILE* f = fopen(argv[1], "r");
+    if(f == NULL){
+        fprintf(stderr, "can not open %s\n", argv[1]);
+        return 1;
+    }
+    char line[256];
+    int line_no = 0;
+    int status = 0;
+    while(fgets(line, sizeof(line), f)){
+        line_no++;
+        char* comment = strchr(line, '#');
+        if(comment){ *comment = '\0'; }
+        line[strcspn(line, "\r\n")] = '\0';
+        if(strspn(line, " \t") == strlen(line)){ continue; }
+        if(parse_stencil_shape(line, shape)){
+            shapes.push_back(shape);
+        }
+        else {
+            fprintf(stderr, "%s:%d: not a shape: %s\n", argv[1], line_no, line);
+            status = 1;
+        }
+    }
+    fclose(f);
+    doTests_shapes(shapes);
+    return status;
+}
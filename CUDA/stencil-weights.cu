@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <cuda_runtime.h>
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+using namespace std;
+using std::cout;
+using std::endl;
+
+#include "runners.h"
+#include "weights.h"
+#include "cpu-offsets.h"
+
+/*******************************************************************************
+ * Weighted stencils (weights.h): finite differences, Laplacians and binomial
+ * blurs, through global reads, the big tile of the offset lists and the host
+ * simd engine, all validated bit for bit against the host reference. The
+ * header of each run gives the points loaded and the products taken, which
+ * pairing the symmetric points halves.
+ */
+static constexpr long lens_1d = (1 << 22) + 2;
+static constexpr long2 lens_2d = {
+   (1 << 11)+2,
+   (1 << 11)+4};
+static constexpr long lens_2d_flat = lens_2d.x * lens_2d.y;
+static constexpr long3 lens_3d = {
+    ((1 << 8) + 2),
+    ((1 << 8) + 4),
+    ((1 << 8) + 8)};
+static constexpr long lens_3d_flat = lens_3d.x * lens_3d.y * lens_3d.z;
+static constexpr long n_runs = 100;
+static constexpr long n_host_runs = 1;
+
+static Globs
+    <long,long
+    ,Kernel1dVirtual
+    ,Kernel1dPhysMultiDim
+    ,Kernel1dPhysStripDim
+    ,Kernel1dHost
+    > G1(lens_1d, lens_1d, n_runs, n_host_runs);
+static Globs
+    <long2,int2
+    ,Kernel2dVirtual
+    ,Kernel2dPhysMultiDim
+    ,Kernel2dPhysSingleDim
+    ,Kernel2dHost
+    > G2(lens_2d, lens_2d_flat, n_runs, n_host_runs);
+static Globs
+    <long3,int3
+    ,Kernel3dVirtual
+    ,Kernel3dPhysMultiDim
+    ,Kernel3dPhysSingleDim
+    ,Kernel3dHost
+    > G3(lens_3d, lens_3d_flat, n_runs, n_host_runs);
+
+// fourth order first derivative, antisymmetric; the zero centre is dropped.
+typedef Table1d<-2,2, 12,
+    1, -8, 0, 8, -1> ddx_1d_o4;
+typedef Weights<W<O<-1>,1>, W<O<0>,-2>, W<O<1>,1>> ddx2_1d;
+
+typedef Table2d<-1,-1, 1,1, 1,
+    0,  1, 0,
+    1, -4, 1,
+    0,  1, 0> laplace_2d;
+typedef Table2d<-1,-1, 1,1, 16,
+    1, 2, 1,
+    2, 4, 2,
+    1, 2, 1> gauss_2d_3x3;
+typedef Table2d<-2,-2, 2,2, 256,
+    1,  4,  6,  4, 1,
+    4, 16, 24, 16, 4,
+    6, 24, 36, 24, 6,
+    4, 16, 24, 16, 4,
+    1,  4,  6,  4, 1> gauss_2d_5x5;
+typedef Weights<
+    W<O<-2,0>,1,12>, W<O<-1,0>,-8,12>, W<O<1,0>,8,12>, W<O<2,0>,-1,12>> ddx_2d_o4;
+
+typedef Weights<
+    W<O<0,0,-1>,1>, W<O<0,-1,0>,1>, W<O<-1,0,0>,1>,
+    W<O<0,0,0>,-6>,
+    W<O<1,0,0>,1>, W<O<0,1,0>,1>, W<O<0,0,1>,1>> laplace_3d_7pt;
+// the 19 point Laplacian, the corners of its box at zero.
+typedef Table3d<-1,-1,-1, 1,1,1, 6,
+    0,  1, 0,
+    1,  2, 1,
+    0,  1, 0,
+
+    1,  2, 1,
+    2,-24, 2,
+    1,  2, 1,
+
+    0,  1, 0,
+    1,  2, 1,
+    0,  1, 0> laplace_3d_19pt;
+
+// the halo is printed outermost axis first, as shapes are.
+template<typename Ws>
+__host__
+void print_weights(const int rank, const char* name, const char* kernel)
+{
+    printf("## Benchmark %dd weights %s (%d loads, %d products, halo ", rank, name, Ws::size, Ws::products);
+    if(rank > 2){ printf("%d..%d,", Ws::min_z, Ws::max_z); }
+    if(rank > 1){ printf("%d..%d,", Ws::min_y, Ws::max_y); }
+    printf("%d..%d) - %s ##", Ws::min_x, Ws::max_x, kernel);
+}
+
+template<typename Ws, const int group_size>
+__host__
+void doTest_weights_1d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_1d);
+    stencil_1d_cpu_offsets<Ws>(G1.arr_in, cpu_out, lens_1d);
+
+    const int grid = divUp(lens_1d, long(group_size));
+    {
+        print_weights<Ws>(1, name, "global reads");
+        Kernel1dPhysMultiDim kfun = global_reads_1d_offsets<Ws,group_size>;
+        G1.do_run_multiDim(kfun, cpu_out, grid, group_size, 0);
+    }
+    {
+        print_weights<Ws>(1, name, "big tile");
+        Kernel1dPhysMultiDim kfun = big_tile_1d_offsets<Ws,group_size>;
+        G1.do_run_multiDim(kfun, cpu_out, grid, group_size, 0);
+    }
+    {
+        print_weights<Ws>(1, name, "host simd");
+        Kernel1dHost kfun = stencil_1d_cpu_offsets_simd<Ws,CPU_TILE_1D>;
+        G1.do_run_host(kfun, cpu_out);
+    }
+    host_arena().release(cpu_out);
+}
+
+template<typename Ws, const int group_size_x, const int group_size_y>
+__host__
+void doTest_weights_2d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_2d_flat);
+    stencil_2d_cpu_offsets<Ws>(G2.arr_in, cpu_out, lens_2d);
+
+    const dim3 block(group_size_x, group_size_y);
+    const dim3 grid(
+        divUp(lens_2d.x, long(group_size_x)),
+        divUp(lens_2d.y, long(group_size_y)));
+    {
+        print_weights<Ws>(2, name, "global reads");
+        Kernel2dPhysMultiDim kfun = global_reads_2d_offsets<Ws,group_size_x,group_size_y>;
+        G2.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_weights<Ws>(2, name, "big tile");
+        Kernel2dPhysMultiDim kfun = big_tile_2d_offsets<Ws,group_size_x,group_size_y>;
+        G2.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_weights<Ws>(2, name, "host simd");
+        Kernel2dHost kfun = stencil_2d_cpu_offsets_simd<Ws,CPU_TILE_X,CPU_TILE_Y>;
+        G2.do_run_host(kfun, cpu_out);
+    }
+    host_arena().release(cpu_out);
+}
+
+template<typename Ws, const int group_size_x, const int group_size_y, const int group_size_z>
+__host__
+void doTest_weights_3d(const char* name)
+{
+    T* cpu_out = host_arena().acquire(lens_3d_flat);
+    stencil_3d_cpu_offsets<Ws>(G3.arr_in, cpu_out, lens_3d);
+
+    const dim3 block(group_size_x, group_size_y, group_size_z);
+    const dim3 grid(
+        divUp(lens_3d.x, long(group_size_x)),
+        divUp(lens_3d.y, long(group_size_y)),
+        divUp(lens_3d.z, long(group_size_z)));
+    {
+        print_weights<Ws>(3, name, "global reads");
+        Kernel3dPhysMultiDim kfun = global_reads_3d_offsets<Ws,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_weights<Ws>(3, name, "big tile");
+        Kernel3dPhysMultiDim kfun = big_tile_3d_offsets<Ws,group_size_x,group_size_y,group_size_z>;
+        G3.do_run_multiDim(kfun, cpu_out, grid, block, 0);
+    }
+    {
+        print_weights<Ws>(3, name, "host simd");
+        Kernel3dHost kfun = stencil_3d_cpu_offsets_simd<Ws,CPU_TILE_X,CPU_TILE_Y,CPU_TILE_Z>;
+        G3.do_run_host(kfun, cpu_out);
+    }
+    host_arena().release(cpu_out);
+}
+
+__host__
+int main()
+{
+    doTest_weights_1d<ddx_1d_o4, 256>("d/dx 4th order");
+    doTest_weights_1d<ddx2_1d, 256>("d2/dx2");
+
+    doTest_weights_2d<laplace_2d, 32,8>("laplacian");
+    doTest_weights_2d<gauss_2d_3x3, 32,8>("gauss 3x3");
+    doTest_weights_2d<gauss_2d_5x5, 32,8>("gauss 5x5");
+    doTest_weights_2d<ddx_2d_o4, 32,8>("d/dx 4th order");
+
+    doTest_weights_3d<laplace_3d_7pt, 32,4,2>("laplacian 7 point");
+    doTest_weights_3d<laplace_3d_19pt, 32,4,2>("laplacian 19 point");
+    return 0;
+}
@@ -0,0 +1,271 @@
+#ifndef THREADPOOL
+#define THREADPOOL
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <sched.h>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/*******************************************************************************
+ * Numa layout of the cpus this process may run on, read from sysfs. The cpus
+ * are listed node by node; without numa information they all are on node 0.
+ */
+struct HostTopology {
+    std::vector<int> cpus;
+    std::vector<int> cpu_node;
+    int n_nodes;
+};
+
+// the cpus of a sysfs list such as "0-3,8,10-11".
+static std::vector<int> parse_cpu_list(const char* path){
+    std::vector<int> cpus;
+    FILE* f = fopen(path, "r");
+    if(!f){ return cpus; }
+    int lo, hi;
+    while(fscanf(f, "%d", &lo) == 1){
+        hi = lo;
+        int c = fgetc(f);
+        if(c == '-'){
+            if(fscanf(f, "%d", &hi) != 1){ break; }
+            c = fgetc(f);
+        }
+        for(int cpu = lo; cpu <= hi; cpu++){ cpus.push_back(cpu); }
+        if(c != ','){ break; }
+    }
+    fclose(f);
+    return cpus;
+}
+
+static const HostTopology& host_topology(){
+    static const HostTopology topology = []{
+        HostTopology t;
+        t.n_nodes = 0;
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        const bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        const std::vector<int> nodes = parse_cpu_list("/sys/devices/system/node/online");
+        for(size_t i = 0; i < nodes.size(); i++){
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", nodes[i]);
+            const std::vector<int> node_cpus = parse_cpu_list(path);
+            bool any = false;
+            for(size_t k = 0; k < node_cpus.size(); k++){
+                if(masked && !CPU_ISSET(node_cpus[k], &allowed)){ continue; }
+                t.cpus.push_back(node_cpus[k]);
+                t.cpu_node.push_back(t.n_nodes);
+                any = true;
+            }
+            t.n_nodes += any;
+        }
+        if(t.cpus.empty()){
+            const int n_cpus = masked ? CPU_SETSIZE : int(std::thread::hardware_concurrency());
+            for(int cpu = 0; cpu < n_cpus; cpu++){
+                if(!masked || CPU_ISSET(cpu, &allowed)){
+                    t.cpus.push_back(cpu);
+                    t.cpu_node.push_back(0);
+                }
+            }
+            if(t.cpus.empty()){
+                t.cpus.push_back(0);
+                t.cpu_node.push_back(0);
+            }
+            t.n_nodes = 1;
+        }
+        return t;
+    }();
+    return topology;
+}
+
+/*******************************************************************************
+ * A fixed set of host worker threads used by the cpu engines.
+ * The calling thread takes part in every parallel_for as worker 0, so a pool of
+ * size n starts n-1 background threads. Tasks are handed out dynamically from a
+ * shared counter, which keeps uneven tiles (e.g. boundary tiles) balanced.
+ * With pinning, worker w runs on the cpus[w * cpus / n]-th cpu of the topology,
+ * so consecutive workers share a numa node.
+ */
+class ThreadPool {
+    public :
+        typedef std::function<void(const long, const int)> Task;
+
+        explicit ThreadPool(const int n_threads, const bool pin = false)
+            : n_workers(n_threads < 1 ? 1 : n_threads)
+            , pinned(pin)
+            , job(nullptr)
+            , generation(0)
+            , n_tasks(0)
+            , per_worker(false)
+            , busy(0)
+            , shutting_down(false)
+        {
+            if(pinned){ pin_to_cpu(0); }
+            for(int w = 1; w < n_workers; w++){
+                workers.push_back(std::thread(&ThreadPool::worker_loop, this, w));
+            }
+        }
+
+        ~ThreadPool(void){
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                shutting_down = true;
+            }
+            wake.notify_all();
+            for(size_t i = 0; i < workers.size(); i++){
+                workers[i].join();
+            }
+        }
+
+        int size() const { return n_workers; }
+
+        // the numa node worker w runs on; 0 when the workers are not pinned.
+        int node_of_worker(const int w) const {
+            return pinned ? host_topology().cpu_node[cpu_of_worker(w)] : 0;
+        }
+        int n_nodes() const {
+            return pinned ? host_topology().n_nodes : 1;
+        }
+
+        // runs fun(task, worker) for every task in [0,tasks) and returns once all
+        // of them are done. Nested calls from inside a task run serially.
+        void parallel_for(const long tasks, const Task& fun){
+            if(tasks <= 0){ return; }
+            const int nested_in = current_worker();
+            if(nested_in >= 0 || n_workers == 1 || tasks == 1){
+                const int worker = nested_in >= 0 ? nested_in : 0;
+                current_worker() = worker;
+                for(long t = 0; t < tasks; t++){ fun(t, worker); }
+                current_worker() = nested_in;
+                return;
+            }
+            std::lock_guard<std::mutex> serialize(submit_mtx);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                job = &fun;
+                n_tasks = tasks;
+                next_task.store(0);
+                per_worker = false;
+                busy = n_workers - 1;
+                generation++;
+            }
+            wake.notify_all();
+            run_tasks(0);
+            std::unique_lock<std::mutex> lock(mtx);
+            done.wait(lock, [this]{ return busy == 0; });
+            job = nullptr;
+        }
+
+        // runs fun(worker, worker) once on every worker, for work that must
+        // stay with a given thread such as first-touching its share of a grid.
+        // Nested calls run all shares serially.
+        void for_each_worker(const Task& fun){
+            const int nested_in = current_worker();
+            if(nested_in >= 0 || n_workers == 1){
+                current_worker() = nested_in >= 0 ? nested_in : 0;
+                for(int w = 0; w < n_workers; w++){ fun(w, w); }
+                current_worker() = nested_in;
+                return;
+            }
+            std::lock_guard<std::mutex> serialize(submit_mtx);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                job = &fun;
+                n_tasks = n_workers;
+                per_worker = true;
+                busy = n_workers - 1;
+                generation++;
+            }
+            wake.notify_all();
+            run_tasks(0);
+            std::unique_lock<std::mutex> lock(mtx);
+            done.wait(lock, [this]{ return busy == 0; });
+            job = nullptr;
+        }
+
+    private :
+        const int n_workers;
+        const bool pinned;
+        std::vector<std::thread> workers;
+        std::mutex submit_mtx;
+        std::mutex mtx;
+        std::condition_variable wake;
+        std::condition_variable done;
+        const Task* job;
+        unsigned long generation;
+        long n_tasks;
+        bool per_worker;
+        int busy;
+        bool shutting_down;
+        std::atomic<long> next_task;
+
+        // the worker id of the calling thread while it runs a task, otherwise -1.
+        static int& current_worker(){
+            static thread_local int worker = -1;
+            return worker;
+        }
+
+        int cpu_of_worker(const int w) const {
+            const long n_cpus = host_topology().cpus.size();
+            return int((w * n_cpus / n_workers) % n_cpus);
+        }
+
+        void pin_to_cpu(const int w){
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(host_topology().cpus[cpu_of_worker(w)], &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+
+        void run_tasks(const int worker){
+            current_worker() = worker;
+            if(per_worker){
+                (*job)(worker, worker);
+                current_worker() = -1;
+                return;
+            }
+            for(long t = next_task.fetch_add(1); t < n_tasks; t = next_task.fetch_add(1)){
+                (*job)(t, worker);
+            }
+            current_worker() = -1;
+        }
+
+        void worker_loop(const int worker){
+            if(pinned){ pin_to_cpu(worker); }
+            unsigned long seen = 0;
+            for(;;){
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    wake.wait(lock, [&]{ return shutting_down || generation != seen; });
+                    if(shutting_down){ return; }
+                    seen = generation;
+                }
+                run_tasks(worker);
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    busy--;
+                }
+                done.notify_one();
+            }
+        }
+};
+
+// the pool shared by all host engines; STENCIL_THREADS overrides its size.
+// The workers are pinned on numa machines, or as STENCIL_PIN=0/1 says.
+static ThreadPool& host_pool(){
+    static ThreadPool pool([]{
+        const char* env = getenv("STENCIL_THREADS");
+        const int n = env ? atoi(env) : int(std::thread::hardware_concurrency());
+        return n < 1 ? 1 : n;
+    }(), []{
+        const char* env = getenv("STENCIL_PIN");
+        return env ? atoi(env) != 0 : host_topology().n_nodes > 1;
+    }());
+    return pool;
+}
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef STENCIL_WEIGHTS
+#define STENCIL_WEIGHTS
+
+#include <cuda_runtime.h>
+#include "constants.h"
+#include "cpu-simd.h"
+#include "offsets.h"
+
+/*******************************************************************************
+ * Stencils with a coefficient per offset, the weighted sum of the points:
+ *     typedef Weights<W<O<-1>,1>, W<O<0>,-2>, W<O<1>,1>> second_difference;
+ * W<O<x,y,z>, num, den> weighs the point at the offset with num/den. The
+ * weight is rounded to T at compile time, so it is exact for the power of two
+ * denominators of Laplacians, finite differences and binomial blurs, and
+ * rounded for others like 1/3 or 1/9. A stencil can also be written as a
+ * table over its box, outermost axis first as printed:
+ *     typedef Table2d<-1,-1, 1,1, 16,
+ *         1, 2, 1,
+ *         2, 4, 2,
+ *         1, 2, 1> gauss_3x3;
+ * Points with a zero coefficient are not part of the stencil: they neither
+ * count for the halo nor are loaded. A point whose mirror image through the
+ * centre has the same coefficient is added to it before the product, and one
+ * whose mirror has the opposite coefficient is subtracted from it, so that a
+ * symmetric stencil takes half the products.
+ * The lists run in every kernel and engine of offsets.h; the products are
+ * never fused with the sums, and the gpu build of the weighted drivers turns
+ * contraction off (-fmad=false) to stay bit-identical to the host.
+ */
+template<typename Offset, const int num, const int den = 1>
+struct W {
+    static constexpr int dx = Offset::dx;
+    static constexpr int dy = Offset::dy;
+    static constexpr int dz = Offset::dz;
+    static constexpr int numerator = num;
+    static constexpr int denominator = den;
+};
+
+// the coefficients of a list, to look up the mirror image of a point.
+template<typename... Ws>
+struct weights_list;
+
+template<>
+struct weights_list<> {
+    MACROLIKE static constexpr bool has(const int, const int, const int, const int, const int){ return false; }
+};
+
+template<typename W0, typename... Ws>
+struct weights_list<W0, Ws...> {
+    // true when the point at (x,y,z) weighs num/den.
+    MACROLIKE static constexpr bool has(const int x, const int y, const int z, const int num, const int den){
+        return (W0::dx == x && W0::dy == y && W0::dz == z
+                && W0::numerator != 0 && W0::numerator * den == num * W0::denominator)
+            || weights_list<Ws...>::has(x, y, z, num, den);
+    }
+};
+
+SIMD_ABI_BEGIN
+template<typename List, typename... Ws>
+struct weights_terms;
+
+template<typename List>
+struct weights_terms<List> {
+    static constexpr int size = 0;
+    static constexpr int products = 0;
+    static constexpr int min_x = OFFSETS_NONE;
+    static constexpr int min_y = OFFSETS_NONE;
+    static constexpr int min_z = OFFSETS_NONE;
+    static constexpr int max_x = -OFFSETS_NONE;
+    static constexpr int max_y = -OFFSETS_NONE;
+    static constexpr int max_z = -OFFSETS_NONE;
+
+    MACROLIKE static constexpr int lo_x(const int, const int, const int, const int, const int lo = OFFSETS_NONE){ return lo; }
+    MACROLIKE static constexpr int hi_x(const int, const int, const int, const int, const int hi = -OFFSETS_NONE){ return hi; }
+
+    template<typename Read>
+    MACROLIKE static void accumulate(T&, Read){}
+    template<typename Ops>
+    SIMD_INLINE static void accumulate_ops(typename Ops::V&, const T*, const long, const long){}
+};
+
+template<typename List, typename W0, typename... Ws>
+struct weights_terms<List, W0, Ws...> {
+    typedef weights_terms<List, Ws...> Rest;
+    static constexpr bool used = W0::numerator != 0;
+    static constexpr bool centre = W0::dx == 0 && W0::dy == 0 && W0::dz == 0;
+    // of the two points of a pair the one before the centre in z, y, x order
+    // takes both, the other one nothing.
+    static constexpr bool before_centre = W0::dz < 0 || (W0::dz == 0 && (W0::dy < 0 || (W0::dy == 0 && W0::dx < 0)));
+    static constexpr bool symmetric = used && !centre
+        && List::has(-W0::dx, -W0::dy, -W0::dz, W0::numerator, W0::denominator);
+    static constexpr bool antisymmetric = used && !centre && !symmetric
+        && List::has(-W0::dx, -W0::dy, -W0::dz, -W0::numerator, W0::denominator);
+    static constexpr bool paired = symmetric || antisymmetric;
+    static constexpr bool product = used && (!paired || before_centre);
+
+    static constexpr int size = (used ? 1 : 0) + Rest::size;
+    static constexpr int products = (product ? 1 : 0) + Rest::products;
+    static constexpr int min_x = used && W0::dx < Rest::min_x ? W0::dx : Rest::min_x;
+    static constexpr int min_y = used && W0::dy < Rest::min_y ? W0::dy : Rest::min_y;
+    static constexpr int min_z = used && W0::dz < Rest::min_z ? W0::dz : Rest::min_z;
+    static constexpr int max_x = used && W0::dx > Rest::max_x ? W0::dx : Rest::max_x;
+    static constexpr int max_y = used && W0::dy > Rest::max_y ? W0::dy : Rest::max_y;
+    static constexpr int max_z = used && W0::dz > Rest::max_z ? W0::dz : Rest::max_z;
+
+    MACROLIKE static constexpr bool in_rows(const int y0, const int y1, const int z0, const int z1){
+        return used && y0 <= W0::dy && W0::dy <= y1 && z0 <= W0::dz && W0::dz <= z1;
+    }
+    MACROLIKE static constexpr int lo_x(const int y0, const int y1, const int z0, const int z1, const int lo = OFFSETS_NONE){
+        return Rest::lo_x(y0, y1, z0, z1, in_rows(y0, y1, z0, z1) && W0::dx < lo ? W0::dx : lo);
+    }
+    MACROLIKE static constexpr int hi_x(const int y0, const int y1, const int z0, const int z1, const int hi = -OFFSETS_NONE){
+        return Rest::hi_x(y0, y1, z0, z1, in_rows(y0, y1, z0, z1) && W0::dx > hi ? W0::dx : hi);
+    }
+
+    template<typename Read>
+    MACROLIKE static void accumulate(T& acc, Read read){
+        constexpr T w = T(W0::numerator) / T(W0::denominator);
+        if(product){
+            const T a = read(W0::dx, W0::dy, W0::dz);
+            if(symmetric){ acc += (a + read(-W0::dx, -W0::dy, -W0::dz)) * w; }
+            else if(antisymmetric){ acc += (a - read(-W0::dx, -W0::dy, -W0::dz)) * w; }
+            else { acc += a * w; }
+        }
+        Rest::accumulate(acc, read);
+    }
+
+    template<typename Ops>
+    SIMD_INLINE static void accumulate_ops(typename Ops::V& acc, const T* p, const long sy, const long sz){
+        constexpr T w = T(W0::numerator) / T(W0::denominator);
+        if(product){
+            const typename Ops::V a = Ops::load(p + W0::dz * sz + W0::dy * sy + W0::dx);
+            if(paired){
+                const typename Ops::V b = Ops::load(p - W0::dz * sz - W0::dy * sy - W0::dx);
+                acc = Ops::add(acc, Ops::mul(symmetric ? Ops::add(a, b) : Ops::sub(a, b), w));
+            }
+            else {
+                acc = Ops::add(acc, Ops::mul(a, w));
+            }
+        }
+        Rest::template accumulate_ops<Ops>(acc, p, sy, sz);
+    }
+};
+
+template<typename... Ws>
+struct Weights : weights_terms<weights_list<Ws...>, Ws...> {
+    typedef weights_terms<weights_list<Ws...>, Ws...> Terms;
+
+    template<typename Read>
+    MACROLIKE static T apply(Read read){
+        T acc = 0;
+        Terms::accumulate(acc, read);
+        return acc;
+    }
+
+    template<typename Ops>
+    SIMD_INLINE static typename Ops::V apply_ops(const T* p, const long sy, const long sz){
+        typename Ops::V acc = Ops::zero();
+        Terms::template accumulate_ops<Ops>(acc, p, sy, sz);
+        return acc;
+    }
+};
+SIMD_ABI_END
+
+/*******************************************************************************
+ * Coefficient tables over a box, the numerators outermost axis first, all
+ * over one denominator. They are Weights of the non-zero entries.
+ */
+template<typename A, typename B>
+struct weights_cat;
+
+template<typename... As, typename... Bs>
+struct weights_cat<Weights<As...>, Weights<Bs...>> {
+    typedef Weights<As..., Bs...> type;
+};
+
+// the entries [begin, end) of the table, split in halves to keep the
+// instantiation depth logarithmic.
+template<typename Table, const int begin, const int end, const bool leaf = (end - begin == 1)>
+struct table_entries {
+    typedef typename weights_cat
+        <typename table_entries<Table, begin, (begin + end) / 2>::type
+        ,typename table_entries<Table, (begin + end) / 2, end>::type
+        >::type type;
+};
+
+template<typename Table, const int begin, const int end>
+struct table_entries<Table, begin, end, true> {
+    static constexpr int range_x = Table::amax_x - Table::amin_x + 1;
+    static constexpr int range_y = Table::amax_y - Table::amin_y + 1;
+    static constexpr int num = Table::numerators[begin];
+    typedef W<O<begin % range_x + Table::amin_x
+               ,begin / range_x % range_y + Table::amin_y
+               ,begin / range_x / range_y + Table::amin_z>
+             ,num, Table::denominator> entry;
+    typedef typename std::conditional<num != 0, Weights<entry>, Weights<>>::type type;
+};
+
+template<
+    const int min_x, const int min_y, const int min_z,
+    const int max_x, const int max_y, const int max_z,
+    const int den, const int... nums>
+struct weights_table {
+    static_assert(sizeof...(nums) == (max_x - min_x + 1) * (max_y - min_y + 1) * (max_z - min_z + 1)
+        , "the table needs one coefficient per point of its box");
+    static constexpr int amin_x = min_x, amin_y = min_y, amin_z = min_z;
+    static constexpr int amax_x = max_x, amax_y = max_y, amax_z = max_z;
+    static constexpr int denominator = den;
+    static constexpr int numerators[sizeof...(nums)] = { nums... };
+    typedef typename table_entries<weights_table, 0, sizeof...(nums)>::type type;
+};
+
+template<const int amin_x, const int amax_x, const int den, const int... nums>
+using Table1d = typename weights_table<amin_x,0,0, amax_x,0,0, den, nums...>::type;
+
+template<const int amin_x, const int amin_y, const int amax_x, const int amax_y, const int den, const int... nums>
+using Table2d = typename weights_table<amin_x,amin_y,0, amax_x,amax_y,0, den, nums...>::type;
+
+template<
+    const int amin_x, const int amin_y, const int amin_z,
+    const int amax_x, const int amax_y, const int amax_z,
+    const int den, const int... nums>
+using Table3d = typename weights_table<amin_x,amin_y,amin_z, amax_x,amax_y,amax_z, den, nums...>::type;
+
+#endif